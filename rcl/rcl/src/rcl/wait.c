@@ -265,6 +265,9 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
 #define SET_RESIZE(Type, ExtraDealloc, ExtraRealloc) \
   do { \
     rcl_allocator_t allocator = wait_set->impl->allocator; \
+    /* Keep the storage as is when the size does not change, like rcl_wait_set_clear(). */ \
+    bool same_size = NULL != wait_set->Type ## s && \
+      wait_set->size_of_ ## Type ## s == Type ## s_size; \
     wait_set->size_of_ ## Type ## s = 0; \
     wait_set->impl->Type ## _index = 0; \
     if (0 == Type ## s_size) { \
@@ -274,11 +277,13 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
       } \
       ExtraDealloc \
     } else { \
-      wait_set->Type ## s = (const rcl_ ## Type ## _t **)allocator.reallocate( \
-        (void *)wait_set->Type ## s, sizeof(rcl_ ## Type ## _t *) * Type ## s_size, \
-        allocator.state); \
-      RCL_CHECK_FOR_NULL_WITH_MSG( \
-        wait_set->Type ## s, "allocating memory failed", return RCL_RET_BAD_ALLOC); \
+      if (!same_size) { \
+        wait_set->Type ## s = (const rcl_ ## Type ## _t **)allocator.reallocate( \
+          (void *)wait_set->Type ## s, sizeof(rcl_ ## Type ## _t *) * Type ## s_size, \
+          allocator.state); \
+        RCL_CHECK_FOR_NULL_WITH_MSG( \
+          wait_set->Type ## s, "allocating memory failed", return RCL_RET_BAD_ALLOC); \
+      } \
       memset((void *)wait_set->Type ## s, 0, sizeof(rcl_ ## Type ## _t *) * Type ## s_size); \
       wait_set->size_of_ ## Type ## s = Type ## s_size; \
       ExtraRealloc \
@@ -296,8 +301,10 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
 #define SET_RESIZE_RMW_REALLOC(Type, RMWStorage, RMWCount) \
   /* Also resize the rmw storage. */ \
   wait_set->impl->RMWCount = 0; \
-  wait_set->impl->RMWStorage = (void **)allocator.reallocate( \
-    wait_set->impl->RMWStorage, sizeof(void *) * Type ## s_size, allocator.state); \
+  if (!same_size || !wait_set->impl->RMWStorage) { \
+    wait_set->impl->RMWStorage = (void **)allocator.reallocate( \
+      wait_set->impl->RMWStorage, sizeof(void *) * Type ## s_size, allocator.state); \
+  } \
   if (!wait_set->impl->RMWStorage) { \
     allocator.deallocate((void *)wait_set->Type ## s, allocator.state); \
     wait_set->size_of_ ## Type ## s = 0; \
@@ -381,6 +388,7 @@ rcl_wait_set_resize(
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set->impl, RCL_RET_WAIT_SET_INVALID);
+  const size_t previous_num_rmw_gc = wait_set->size_of_guard_conditions + wait_set->size_of_timers;
   SET_RESIZE(
     subscription,
     SET_RESIZE_RMW_DEALLOC(
@@ -403,8 +411,10 @@ rcl_wait_set_resize(
       rmw_gcs->guard_conditions = NULL;
     }
   } else {
-    rmw_gcs->guard_conditions = (void **)wait_set->impl->allocator.reallocate(
-      rmw_gcs->guard_conditions, sizeof(void *) * num_rmw_gc, wait_set->impl->allocator.state);
+    if (!rmw_gcs->guard_conditions || previous_num_rmw_gc != num_rmw_gc) {
+      rmw_gcs->guard_conditions = (void **)wait_set->impl->allocator.reallocate(
+        rmw_gcs->guard_conditions, sizeof(void *) * num_rmw_gc, wait_set->impl->allocator.state);
+    }
     if (!rmw_gcs->guard_conditions) {
       // Deallocate rcl arrays to match unallocated rmw guard conditions
       wait_set->impl->allocator.deallocate(
@@ -85,6 +85,46 @@ TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), test_resize_to_zero) {
   ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
 }
 
+namespace
+{
+size_t reallocation_count = 0;
+
+void *
+counting_reallocate(void * pointer, size_t size, void * state)
+{
+  ++reallocation_count;
+  return rcl_get_default_allocator().reallocate(pointer, size, state);
+}
+}  // namespace
+
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), test_resize_to_same_size) {
+  // Resizing to the sizes the wait set has only clears it, without reallocating.
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  allocator.reallocate = counting_reallocate;
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  rcl_ret_t ret = rcl_wait_set_init(&wait_set, 1, 1, 1, 1, 1, 0, context_ptr, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  const rcl_subscription_t ** subscriptions = wait_set.subscriptions;
+  wait_set.subscriptions[0] = reinterpret_cast<const rcl_subscription_t *>(&wait_set);
+
+  reallocation_count = 0;
+  ret = rcl_wait_set_resize(&wait_set, 1u, 1u, 1u, 1u, 1u, 0u);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, reallocation_count);
+  EXPECT_EQ(subscriptions, wait_set.subscriptions);
+  EXPECT_EQ(nullptr, wait_set.subscriptions[0]);
+  EXPECT_EQ(wait_set.size_of_subscriptions, 1ull);
+  EXPECT_EQ(wait_set.size_of_timers, 1ull);
+
+  ret = rcl_wait_set_resize(&wait_set, 2u, 1u, 1u, 1u, 1u, 0u);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_LT(0u, reallocation_count);
+  EXPECT_EQ(wait_set.size_of_subscriptions, 2ull);
+
+  ret = rcl_wait_set_fini(&wait_set);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+}
+
 // Test rcl_wait with a positive finite timeout value (1ms)
 TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), finite_timeout) {
   rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
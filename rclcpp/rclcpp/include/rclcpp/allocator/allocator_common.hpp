@@ -16,6 +16,7 @@
 #define RCLCPP__ALLOCATOR__ALLOCATOR_COMMON_HPP_
 
 #include <memory>
+#include <type_traits>
 
 #include "rcl/allocator.h"
 
@@ -29,6 +30,10 @@ namespace allocator
 template<typename T, typename Alloc>
 using AllocRebind = typename std::allocator_traits<Alloc>::template rebind_traits<T>;
 
+/// Allocators that get_rcl_allocator() does not hand to rcl, which gets its default one instead.
+template<typename Alloc>
+struct uses_default_rcl_allocator : std::is_same<Alloc, std::allocator<void>> {};
+
 template<typename Alloc>
 void * retyped_allocate(size_t size, void * untyped_allocator)
 {
@@ -67,7 +72,7 @@ void * retyped_reallocate(void * untyped_pointer, size_t size, void * untyped_al
 template<
   typename T,
   typename Alloc,
-  typename std::enable_if<!std::is_same<Alloc, std::allocator<void>>::value>::type * = nullptr>
+  typename std::enable_if<!uses_default_rcl_allocator<Alloc>::value>::type * = nullptr>
 rcl_allocator_t get_rcl_allocator(Alloc & allocator)
 {
   rcl_allocator_t rcl_allocator = rcl_get_default_allocator();
@@ -86,7 +91,7 @@ rcl_allocator_t get_rcl_allocator(Alloc & allocator)
 template<
   typename T,
   typename Alloc,
-  typename std::enable_if<std::is_same<Alloc, std::allocator<void>>::value>::type * = nullptr>
+  typename std::enable_if<uses_default_rcl_allocator<Alloc>::value>::type * = nullptr>
 rcl_allocator_t get_rcl_allocator(Alloc & allocator)
 {
   (void)allocator;
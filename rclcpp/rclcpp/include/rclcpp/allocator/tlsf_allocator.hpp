@@ -0,0 +1,248 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__ALLOCATOR__TLSF_ALLOCATOR_HPP_
+#define RCLCPP__ALLOCATOR__TLSF_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+#include "rclcpp/allocator/allocator_common.hpp"
+#include "rclcpp/macros.hpp"
+#include "rclcpp/visibility_control.hpp"
+
+namespace rclcpp
+{
+namespace allocator
+{
+
+class TlsfArena;
+
+/// Allocation statistics of one arena of a TlsfHeap.
+/**
+ * Byte counts include the block headers, so that high_water_mark can be compared with capacity
+ * to size the arenas.
+ */
+struct TlsfArenaStatistics
+{
+  /// Bytes of the arena that can be handed out.
+  size_t capacity = 0;
+  /// Bytes in use. Frees from other threads count once the owning thread picked them up.
+  size_t in_use = 0;
+  /// The most bytes that were ever in use at once.
+  size_t high_water_mark = 0;
+  uint64_t allocations = 0;
+  /// Allocations that did not fit, and threw std::bad_alloc.
+  uint64_t failed_allocations = 0;
+  /// Whether a thread allocates from the arena.
+  bool claimed = false;
+};
+
+/// Preallocated memory, handed out by a two-level segregated fit (TLSF) allocator.
+/**
+ * The memory is allocated, and touched, when the heap is constructed, and split in arenas of
+ * equal size. A thread claims an arena the first time it allocates, and from then on allocates
+ * from that arena only, without locks: finding and splitting or merging a block takes a bounded
+ * number of steps, independent of the number of blocks, which makes the allocation latency
+ * deterministic. Each executor thread thus gets its own arena, as does any other thread that
+ * publishes. When a thread ends, its arenas go back to the heap, for the next threads that
+ * allocate, with what was allocated from them.
+ *
+ * Memory can be freed by any thread, which is the usual pattern of messages: allocated by the
+ * publishing thread and released by the executor threads of the subscriptions. The owner frees
+ * directly, others push the block on a lock-free list of the arena. The owner merges a few of
+ * those back per allocation, so that they do not make it unbounded, and all of them when an
+ * allocation would fail otherwise or when it gives the arena up. Blocks freed into an arena
+ * without owner wait for the next owner.
+ *
+ * Allocations throw std::bad_alloc once the arena of the thread is full, or no arena is left for
+ * a new thread; they never fall back to the system heap.
+ */
+class TlsfHeap
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS_NOT_COPYABLE(TlsfHeap)
+
+  /// Allocate all arenas.
+  /**
+   * \param[in] arena_size The size of each arena in bytes, which bounds the largest allocation.
+   * \param[in] arena_count The number of threads that can allocate from the heap.
+   * \throws std::invalid_argument if an arena is too small or too large, or arena_count is zero.
+   */
+  RCLCPP_PUBLIC
+  TlsfHeap(size_t arena_size, size_t arena_count);
+
+  /// Frees the memory. Nothing allocated from the heap may be in use anymore.
+  RCLCPP_PUBLIC
+  ~TlsfHeap();
+
+  /// The heap of default constructed TlsfAllocators, created on first use.
+  /**
+   * Unless set with set_default(), it has default_arena_count arenas of default_arena_size.
+   */
+  RCLCPP_PUBLIC
+  static SharedPtr
+  get_default();
+
+  /// Set the heap of default constructed TlsfAllocators, before any is constructed.
+  RCLCPP_PUBLIC
+  static void
+  set_default(SharedPtr heap);
+
+  static constexpr size_t default_arena_size = 8 * 1024 * 1024;
+  static constexpr size_t default_arena_count = 4;
+
+  /// Allocate from the arena of the calling thread. Suitably aligned for any fundamental type.
+  /**
+   * \throws std::bad_alloc if the arena has no block this large, or no arena is left.
+   */
+  RCLCPP_PUBLIC
+  void *
+  allocate(size_t size);
+
+  /// Free memory allocated from this heap, from any thread.
+  RCLCPP_PUBLIC
+  void
+  deallocate(void * pointer) noexcept;
+
+  /// Claim an arena for the calling thread, if it has none yet, before it first allocates.
+  /**
+   * \return false if no arena is left.
+   */
+  RCLCPP_PUBLIC
+  bool
+  claim_thread_arena();
+
+  /// Give the arena of the calling thread to the next thread that needs one.
+  /**
+   * Threads do so when they end anyway, this is for threads that stop allocating earlier.
+   * What was allocated from the arena stays valid.
+   */
+  RCLCPP_PUBLIC
+  void
+  release_thread_arena();
+
+  RCLCPP_PUBLIC
+  size_t
+  get_arena_size() const;
+
+  RCLCPP_PUBLIC
+  size_t
+  get_arena_count() const;
+
+  /// Statistics of an arena, which may be read while the owning thread allocates.
+  /**
+   * \throws std::out_of_range if there is no such arena.
+   */
+  RCLCPP_PUBLIC
+  TlsfArenaStatistics
+  get_arena_statistics(size_t index) const;
+
+private:
+  /// The arena of the calling thread, claimed if needed, nullptr if none is left.
+  TlsfArena *
+  get_thread_arena(bool claim);
+
+  uint64_t serial_;
+  size_t arena_size_;
+  size_t arena_count_;
+  std::unique_ptr<unsigned char[]> memory_;
+  std::unique_ptr<TlsfArena[]> arenas_;
+};
+
+/// Allocator of a TlsfHeap, for the Alloc parameter of publishers, subscriptions and strategies.
+/**
+ * Copies and rebound copies share the heap. Default constructed allocators use
+ * TlsfHeap::get_default().
+ *
+ * rcl and the middleware keep using the default allocator for their own handles and buffers,
+ * which are not allocated while publishing or taking messages, see get_rcl_allocator().
+ */
+template<typename T>
+class TlsfAllocator
+{
+public:
+  using value_type = T;
+
+  TlsfAllocator()
+  : heap_(TlsfHeap::get_default())
+  {}
+
+  explicit TlsfAllocator(TlsfHeap::SharedPtr heap)
+  : heap_(std::move(heap))
+  {
+    if (!heap_) {
+      throw std::invalid_argument("TlsfAllocator needs a heap");
+    }
+  }
+
+  template<typename U>
+  TlsfAllocator(const TlsfAllocator<U> & other) noexcept
+  : heap_(other.get_heap())
+  {}
+
+  T *
+  allocate(size_t n)
+  {
+    static_assert(
+      alignof(T) <= alignof(std::max_align_t), "TlsfAllocator does not support over-aligned types");
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T *>(heap_->allocate(n * sizeof(T)));
+  }
+
+  void
+  deallocate(T * pointer, size_t) noexcept
+  {
+    heap_->deallocate(pointer);
+  }
+
+  const TlsfHeap::SharedPtr &
+  get_heap() const noexcept
+  {
+    return heap_;
+  }
+
+private:
+  TlsfHeap::SharedPtr heap_;
+};
+
+template<typename T, typename U>
+bool
+operator==(const TlsfAllocator<T> & lhs, const TlsfAllocator<U> & rhs) noexcept
+{
+  return lhs.get_heap() == rhs.get_heap();
+}
+
+template<typename T, typename U>
+bool
+operator!=(const TlsfAllocator<T> & lhs, const TlsfAllocator<U> & rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+template<typename T>
+struct uses_default_rcl_allocator<TlsfAllocator<T>>
+  : std::true_type {};
+
+}  // namespace allocator
+}  // namespace rclcpp
+
+#endif  // RCLCPP__ALLOCATOR__TLSF_ALLOCATOR_HPP_
@@ -40,6 +40,17 @@ struct AnyExecutable
   RCLCPP_PUBLIC
   virtual ~AnyExecutable();
 
+  AnyExecutable(const AnyExecutable &) = default;
+  AnyExecutable & operator=(const AnyExecutable &) = default;
+
+  /// Moves hand the callback group over: the source is left without one, and releases nothing.
+  /**
+   * Declared, as the virtual destructor would otherwise leave copies only, e.g. when a vector
+   * of them grows or has an element erased, and each destroyed copy released the group.
+   */
+  AnyExecutable(AnyExecutable &&) noexcept = default;
+  AnyExecutable & operator=(AnyExecutable &&) noexcept = default;
+
   // Only one of the following pointers will be set.
   rclcpp::SubscriptionBase::SharedPtr subscription;
   rclcpp::SubscriptionBase::SharedPtr subscription_intra_process;
@@ -0,0 +1,453 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__ASYNC_RESULT_HPP_
+#define RCLCPP__ASYNC_RESULT_HPP_
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rclcpp
+{
+
+template<typename T>
+class AsyncResult;
+
+namespace detail
+{
+
+/// Completion state shared by all copies of an AsyncResult, except for the value.
+class AsyncStateBase
+{
+public:
+  bool
+  is_ready() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ready_;
+  }
+
+  /// Only meaningful once ready.
+  std::exception_ptr
+  error() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+  }
+
+  /// Called with the completed state, which it must not keep: that would keep itself alive.
+  using Continuation = std::function<void(const AsyncStateBase &)>;
+
+  /// Run continuation on completion, in the completing thread. Right away if already complete.
+  void
+  add_continuation(Continuation continuation)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!ready_) {
+      continuations_.emplace_back(std::move(continuation));
+      return;
+    }
+    lock.unlock();
+    continuation(*this);
+  }
+
+  void
+  set_exception(std::exception_ptr error)
+  {
+    complete([this, &error]() {error_ = error;});
+  }
+
+protected:
+  /// Store the outcome with fill, under the lock, then run the continuations outside of it.
+  template<typename FillT>
+  void
+  complete(FillT && fill)
+  {
+    std::vector<Continuation> continuations;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (ready_) {
+        throw std::logic_error("AsyncResult completed twice");
+      }
+      fill();
+      ready_ = true;
+      // Taken out, so that what they hold goes with them once they ran.
+      continuations.swap(continuations_);
+    }
+    for (auto & continuation : continuations) {
+      continuation(*this);
+    }
+  }
+
+  /// Throws if not complete yet, rethrows the error if it failed. Call with mutex_ held.
+  void
+  check_ready() const
+  {
+    if (!ready_) {
+      throw std::logic_error("AsyncResult is not ready yet");
+    }
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+  mutable std::mutex mutex_;
+  bool ready_ = false;
+  std::exception_ptr error_;
+  std::vector<Continuation> continuations_;
+};
+
+template<typename T>
+class AsyncState : public AsyncStateBase
+{
+public:
+  void
+  set_value(T value)
+  {
+    complete([this, &value]() {value_.reset(new T(std::move(value)));});
+  }
+
+  T
+  get() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    check_ready();
+    return *value_;
+  }
+
+  /// The value without copying it. Only once complete without error: it never changes then.
+  const T &
+  value() const
+  {
+    return *value_;
+  }
+
+  /// Complete the same way as other, which has completed.
+  void
+  complete_from(const AsyncState & other)
+  {
+    auto error = other.error();
+    if (error) {
+      set_exception(error);
+    } else {
+      set_value(other.value());
+    }
+  }
+
+private:
+  std::unique_ptr<T> value_;
+};
+
+template<>
+class AsyncState<void>: public AsyncStateBase
+{
+public:
+  void
+  set_value()
+  {
+    complete([]() {});
+  }
+
+  void
+  get() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    check_ready();
+  }
+
+  void
+  complete_from(const AsyncState & other)
+  {
+    auto error = other.error();
+    if (error) {
+      set_exception(error);
+    } else {
+      set_value();
+    }
+  }
+};
+
+/// Call a continuation with the value of a result that completed without error.
+template<typename T>
+struct ValueInvoker
+{
+  template<typename FunctorT>
+  static auto
+  invoke(FunctorT & functor, const AsyncState<T> & state) -> decltype(functor(state.value()))
+  {
+    return functor(state.value());
+  }
+};
+
+template<>
+struct ValueInvoker<void>
+{
+  template<typename FunctorT>
+  static auto
+  invoke(FunctorT & functor, const AsyncState<void> &) -> decltype(functor())
+  {
+    return functor();
+  }
+};
+
+/// Complete the result of then() with what the continuation returned, of type ReturnT.
+template<typename ReturnT>
+struct Completer
+{
+  using Result = AsyncResult<ReturnT>;
+
+  template<typename InvokeT, typename NextT>
+  static void
+  complete(InvokeT && invoke, NextT & next)
+  {
+    next.set_value(invoke());
+  }
+};
+
+template<>
+struct Completer<void>
+{
+  using Result = AsyncResult<void>;
+
+  template<typename InvokeT, typename NextT>
+  static void
+  complete(InvokeT && invoke, NextT & next)
+  {
+    invoke();
+    next.set_value();
+  }
+};
+
+/// A continuation that returns an AsyncResult completes the result of then() once that does.
+template<typename U>
+struct Completer<AsyncResult<U>>
+{
+  using Result = AsyncResult<U>;
+
+  template<typename InvokeT, typename NextT>
+  static void
+  complete(InvokeT && invoke, NextT & next)
+  {
+    invoke().forward_to(next);
+  }
+};
+
+}  // namespace detail
+
+/// The outcome of an asynchronous operation, a value of type T or an error, to chain work onto.
+/**
+ * Unlike std::shared_future, nothing ever blocks on an AsyncResult: work is attached with then()
+ * and runs in the thread that completes the result. For a service response, that is the executor
+ * thread that executes the client, so continuations run on the executor that owns the client,
+ * like any other callback, and any number of requests can be in flight without a thread each.
+ * A continuation attached after completion runs right away, in the thread that attaches it.
+ *
+ * then() returns the result of the continuation, so steps chain: a continuation that returns an
+ * AsyncResult itself (e.g. a further service call) completes the chained result when that one
+ * completes. Errors skip the continuations and propagate down the chain, to on_error().
+ *
+ * Copies share the outcome. All members are thread-safe.
+ */
+template<typename T>
+class AsyncResult
+{
+public:
+  using ValueType = T;
+
+  /// Create a result that is not complete yet.
+  AsyncResult()
+  : state_(std::make_shared<detail::AsyncState<T>>())
+  {}
+
+  /// Complete with a value, e.g. set_value(response), or set_value() for AsyncResult<void>.
+  /** Throws std::logic_error if already complete. Runs the continuations in this thread. */
+  template<typename ... Args>
+  void
+  set_value(Args && ... args)
+  {
+    state_->set_value(std::forward<Args>(args)...);
+  }
+
+  /// Complete with an error.
+  /** Throws std::logic_error if already complete. Runs the continuations in this thread. */
+  void
+  set_exception(std::exception_ptr error)
+  {
+    state_->set_exception(error);
+  }
+
+  bool
+  is_ready() const
+  {
+    return state_->is_ready();
+  }
+
+  /// The value, without waiting: throws std::logic_error if not complete, or the error if failed.
+  T
+  get() const
+  {
+    return state_->get();
+  }
+
+  /// Run functor with the value once complete, and return a result for what it returns.
+  /**
+   * \param[in] functor Called with the value (nothing for AsyncResult<void>). May return a value,
+   *   nothing, or an AsyncResult to wait for. If it throws, the returned result fails.
+   * \return Completed with what functor returned, or with the error of this result, in which case
+   *   functor is not called.
+   */
+  template<typename FunctorT>
+  auto
+  then(FunctorT && functor) -> typename detail::Completer<
+    decltype(detail::ValueInvoker<T>::invoke(
+      std::declval<typename std::decay<FunctorT>::type &>(),
+      std::declval<const detail::AsyncState<T> &>()))>::Result
+  {
+    using ReturnT = decltype(detail::ValueInvoker<T>::invoke(
+        std::declval<typename std::decay<FunctorT>::type &>(),
+        std::declval<const detail::AsyncState<T> &>()));
+    typename detail::Completer<ReturnT>::Result next;
+    auto continuation = std::forward<FunctorT>(functor);
+    state_->add_continuation(
+      [next, continuation](const detail::AsyncStateBase & completed) mutable {
+        auto & state = static_cast<const detail::AsyncState<T> &>(completed);
+        auto error = state.error();
+        if (error) {
+          next.set_exception(error);
+          return;
+        }
+        try {
+          detail::Completer<ReturnT>::complete(
+            [&state, &continuation]() {
+              return detail::ValueInvoker<T>::invoke(continuation, state);
+            }, next);
+        } catch (...) {
+          if (!next.is_ready()) {
+            next.set_exception(std::current_exception());
+          }
+        }
+      });
+    return next;
+  }
+
+  /// Run functor with the error if this result fails, to recover or to report it.
+  /**
+   * \param[in] functor Called with the std::exception_ptr, returns a replacement value (nothing
+   *   for AsyncResult<void>). It may rethrow to fail the returned result.
+   * \return Completed with the value of this result, or with what functor returned.
+   */
+  template<typename FunctorT>
+  AsyncResult<T>
+  on_error(FunctorT && functor)
+  {
+    AsyncResult<T> next;
+    auto handler = std::forward<FunctorT>(functor);
+    state_->add_continuation(
+      [next, handler](const detail::AsyncStateBase & completed) mutable {
+        auto & state = static_cast<const detail::AsyncState<T> &>(completed);
+        auto error = state.error();
+        if (!error) {
+          next.state_->complete_from(state);
+          return;
+        }
+        try {
+          detail::Completer<T>::complete([&handler, &error]() {return handler(error);}, next);
+        } catch (...) {
+          if (!next.is_ready()) {
+            next.set_exception(std::current_exception());
+          }
+        }
+      });
+    return next;
+  }
+
+  /// Complete next the same way as this result, once this one completes.
+  void
+  forward_to(AsyncResult<T> next) const
+  {
+    state_->add_continuation(
+      [next](const detail::AsyncStateBase & completed) {
+        next.state_->complete_from(static_cast<const detail::AsyncState<T> &>(completed));
+      });
+  }
+
+private:
+  std::shared_ptr<detail::AsyncState<T>> state_;
+};
+
+/// Combine results into one that completes once all of them have, or as soon as one fails.
+/**
+ * \return The values in the order of results.
+ */
+template<typename T>
+AsyncResult<std::vector<T>>
+when_all(const std::vector<AsyncResult<T>> & results)
+{
+  struct Gather
+  {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<T>> values;
+    size_t remaining;
+    bool failed = false;
+  };
+
+  AsyncResult<std::vector<T>> all;
+  if (results.empty()) {
+    all.set_value(std::vector<T>());
+    return all;
+  }
+  auto gather = std::make_shared<Gather>();
+  gather->values.resize(results.size());
+  gather->remaining = results.size();
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto result = results[i];
+    result.then(
+      [gather, all, i](const T & value) mutable {
+        std::vector<T> values;
+        {
+          std::lock_guard<std::mutex> lock(gather->mutex);
+          gather->values[i].reset(new T(value));
+          if (--gather->remaining > 0 || gather->failed) {
+            return;
+          }
+          values.reserve(gather->values.size());
+          for (auto & gathered : gather->values) {
+            values.emplace_back(std::move(*gathered));
+          }
+        }
+        all.set_value(std::move(values));
+      }).on_error(
+      [gather, all](std::exception_ptr error) mutable {
+        {
+          std::lock_guard<std::mutex> lock(gather->mutex);
+          if (gather->failed) {
+            return;
+          }
+          gather->failed = true;
+        }
+        all.set_exception(error);
+      });
+  }
+  return all;
+}
+
+}  // namespace rclcpp
+
+#endif  // RCLCPP__ASYNC_RESULT_HPP_
@@ -16,6 +16,8 @@
 #define RCLCPP__CALLBACK_GROUP_HPP_
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -90,6 +92,32 @@ public:
   const CallbackGroupType &
   type() const;
 
+  /// Priority for executors with SchedulingPolicy::FIXED_PRIORITY, higher runs first.
+  /**
+   * The default is 0. To prioritize a single entity, give it a callback group of its own.
+   * Can be changed while spinning.
+   */
+  RCLCPP_PUBLIC
+  void
+  set_priority(int32_t priority);
+
+  RCLCPP_PUBLIC
+  int32_t
+  get_priority() const;
+
+  /// Deadline, relative to becoming ready, for SchedulingPolicy::EARLIEST_DEADLINE_FIRST.
+  /**
+   * The default of 0 means no deadline: the group runs after all groups that have one.
+   * Can be changed while spinning.
+   */
+  RCLCPP_PUBLIC
+  void
+  set_relative_deadline(std::chrono::nanoseconds relative_deadline);
+
+  RCLCPP_PUBLIC
+  std::chrono::nanoseconds
+  get_relative_deadline() const;
+
 protected:
   RCLCPP_DISABLE_COPY(CallbackGroup)
 
@@ -130,6 +158,8 @@ protected:
   std::vector<rclcpp::ClientBase::WeakPtr> client_ptrs_;
   std::vector<rclcpp::Waitable::WeakPtr> waitable_ptrs_;
   std::atomic_bool can_be_taken_from_;
+  std::atomic<int32_t> priority_;
+  std::atomic<int64_t> relative_deadline_ns_;
 };
 
 }  // namespace callback_group
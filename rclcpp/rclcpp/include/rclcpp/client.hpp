@@ -27,6 +27,7 @@
 #include "rcl/error_handling.h"
 #include "rcl/wait.h"
 
+#include "rclcpp/async_result.hpp"
 #include "rclcpp/exceptions.hpp"
 #include "rclcpp/function_traits.hpp"
 #include "rclcpp/macros.hpp"
@@ -270,6 +271,25 @@ public:
     return future_with_request;
   }
 
+  /// Send a request, and get the response as an AsyncResult to chain continuations onto.
+  /**
+   * Nothing blocks and nothing spins: the result completes when the executor that spins this
+   * client handles the response, and continuations attached with AsyncResult::then() run right
+   * there, on that executor thread, like any other callback of this client.
+   * \param[in] request The request to send.
+   * \return Completed with the response. Never completed if the client is destroyed first.
+   */
+  AsyncResult<SharedResponse>
+  async_call(SharedRequest request)
+  {
+    AsyncResult<SharedResponse> result;
+    CallbackType complete = [result](SharedFuture future) mutable {
+        result.set_value(future.get());
+      };
+    async_send_request(request, std::move(complete));
+    return result;
+  }
+
 private:
   RCLCPP_DISABLE_COPY(Client)
 
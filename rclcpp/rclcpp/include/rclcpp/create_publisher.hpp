@@ -25,6 +25,7 @@
 #include "rclcpp/publisher_options.hpp"
 #include "rclcpp/qos.hpp"
 #include "rmw/qos_profiles.h"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
 
 namespace rclcpp
 {
@@ -112,6 +113,9 @@ create_publisher(
     options.template to_rcl_publisher_options<MessageT>(qos),
     use_intra_process
   );
+  pub->setup_shared_memory_transport(
+    options.shared_memory_transport,
+    *rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>());
   node_topics->add_publisher(pub, options.callback_group);
   return std::dynamic_pointer_cast<PublisherT>(pub);
 }
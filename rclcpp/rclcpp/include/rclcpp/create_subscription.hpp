@@ -21,6 +21,7 @@
 
 #include "rclcpp/node_interfaces/get_node_topics_interface.hpp"
 #include "rclcpp/node_interfaces/node_topics_interface.hpp"
+#include "rclcpp/shared_memory_transport.hpp"
 #include "rclcpp/subscription_factory.hpp"
 #include "rclcpp/subscription_options.hpp"
 #include "rclcpp/qos.hpp"
@@ -137,6 +138,11 @@ create_subscription(
     factory,
     options.template to_rcl_subscription_options<MessageT>(qos),
     use_intra_process);
+  if (options.shared_memory_transport.enabled) {
+    sub->set_shared_memory_waitable(
+      std::make_shared<rclcpp::SharedMemorySubscription>(
+        node_topics->get_node_base_interface()->get_shared_rcl_node_handle(), sub));
+  }
   node_topics->add_subscription(sub, options.callback_group);
   return std::dynamic_pointer_cast<SubscriptionT>(sub);
 }
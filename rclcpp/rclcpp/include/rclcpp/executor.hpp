@@ -18,9 +18,12 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <exception>
 #include <iostream>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -32,10 +35,12 @@
 #include "rclcpp/contexts/default_context.hpp"
 #include "rclcpp/memory_strategies.hpp"
 #include "rclcpp/memory_strategy.hpp"
+#include "rclcpp/measuring/realtime_violation_counter.hpp"
 #include "rclcpp/node_interfaces/node_base_interface.hpp"
 #include "rclcpp/utilities.hpp"
 #include "rclcpp/visibility_control.hpp"
 #include "rclcpp/scope_exit.hpp"
+#include "rclcpp/thread_configuration.hpp"
 
 namespace rclcpp
 {
@@ -62,6 +67,36 @@ RCLCPP_PUBLIC
 std::string
 to_string(const FutureReturnCode & future_return_code);
 
+/// Order in which an executor picks among the executables that are ready.
+/**
+ * FIFO: timers first, then subscriptions, services, clients and waitables, each in the order
+ *   they were collected. The default.
+ * FIXED_PRIORITY: highest CallbackGroup::get_priority() first, FIFO among equal priorities.
+ * EARLIEST_DEADLINE_FIRST: earliest (ready time + CallbackGroup::get_relative_deadline()) first,
+ *   groups without deadline last, then by priority, then FIFO.
+ *
+ * The ready time is the end of the wait that found the executable ready.
+ * Applies to executors that pick their work through Executor::get_next_executable, like the
+ * SingleThreadedExecutor and the MultiThreadedExecutor.
+ */
+enum class SchedulingPolicy {FIFO, FIXED_PRIORITY, EARLIEST_DEADLINE_FIRST};
+
+/// Time from becoming ready until being picked for execution, of one callback group priority.
+struct DispatchLatencyStatistics
+{
+  uint64_t count = 0;
+  std::chrono::nanoseconds total = std::chrono::nanoseconds(0);
+  std::chrono::nanoseconds max = std::chrono::nanoseconds(0);
+  /// Executables that were picked after their deadline had passed.
+  uint64_t deadline_misses = 0;
+
+  std::chrono::nanoseconds
+  mean() const
+  {
+    return count ? total / count : std::chrono::nanoseconds(0);
+  }
+};
+
 ///
 /**
  * Options to be passed to the executor constructor.
@@ -71,12 +106,33 @@ struct ExecutorArgs
   ExecutorArgs()
   : memory_strategy(memory_strategies::create_default_strategy()),
     context(rclcpp::contexts::default_context::get_global_default_context()),
-    max_conditions(0)
+    max_conditions(0),
+    track_realtime_violations(false),
+    scheduling_policy(SchedulingPolicy::FIFO),
+    lock_memory(false),
+    subscription_batch_size(1)
   {}
 
   memory_strategy::MemoryStrategy::SharedPtr memory_strategy;
   std::shared_ptr<rclcpp::Context> context;
   size_t max_conditions;
+  /// Count heap allocations and contended lock waits per callback execution and report them
+  /// through the tracker of the executed timer or subscription.
+  bool track_realtime_violations;
+  /// See SchedulingPolicy.
+  SchedulingPolicy scheduling_policy;
+  /// Per executor thread, by thread number, applied when the thread starts spinning.
+  /**
+   * Threads without an entry are left alone. The SingleThreadedExecutor configures the thread
+   * that calls spin() with the first entry, for good. The MultiThreadedExecutor numbers the
+   * threads it creates from 0, and the calling thread last.
+   */
+  std::vector<ThreadConfiguration> thread_configurations;
+  /// Lock the process memory (mlockall) when the executor is constructed.
+  bool lock_memory;
+  /// How many messages to take from a ready subscription at once, unless it sets its own.
+  /** See SubscriptionBase::set_batch_size(). Zero acts as one. */
+  size_t subscription_batch_size;
 };
 
 static inline ExecutorArgs create_default_executor_arguments()
@@ -290,6 +346,23 @@ public:
   void
   set_memory_strategy(memory_strategy::MemoryStrategy::SharedPtr memory_strategy);
 
+  RCLCPP_PUBLIC
+  SchedulingPolicy
+  get_scheduling_policy() const;
+
+  /// Dispatch latency per callback group priority, since construction or the last reset.
+  /**
+   * Only recorded with a scheduling policy other than FIFO, empty otherwise.
+   * Can be called from any thread.
+   */
+  RCLCPP_PUBLIC
+  std::map<int32_t, DispatchLatencyStatistics>
+  get_dispatch_latency_statistics() const;
+
+  RCLCPP_PUBLIC
+  void
+  reset_dispatch_latency_statistics();
+
 protected:
   RCLCPP_PUBLIC
   void
@@ -305,15 +378,39 @@ protected:
   void
   execute_any_executable(AnyExecutable & any_exec);
 
+  /// Forward counted real-time violations to the tracker of whatever any_exec ran.
+  /**
+   * Services, clients and waitables have no tracker, so their violations are dropped.
+   */
   RCLCPP_PUBLIC
   static void
+  report_realtime_violations(
+    AnyExecutable & any_exec,
+    const rclcpp::RealtimeViolationCounts & counts);
+
+  /// Take and handle up to max_messages messages, stopping early once the subscription is empty.
+  /**
+   * Each message is handled as soon as it is taken, unless the subscription has a batch callback:
+   * then all messages are taken first and handed over together.
+   * \return The number of messages taken, zero if the subscription had none.
+   */
+  RCLCPP_PUBLIC
+  static size_t
   execute_subscription(
-    rclcpp::SubscriptionBase::SharedPtr subscription);
+    rclcpp::SubscriptionBase::SharedPtr subscription,
+    size_t max_messages = 1);
 
+  /// Same as execute_subscription(), for the intra-process subscription.
   RCLCPP_PUBLIC
-  static void
+  static size_t
   execute_intra_process_subscription(
-    rclcpp::SubscriptionBase::SharedPtr subscription);
+    rclcpp::SubscriptionBase::SharedPtr subscription,
+    size_t max_messages = 1);
+
+  /// The batch size of the subscription, or the one of this executor if it has none.
+  RCLCPP_PUBLIC
+  size_t
+  get_subscription_batch_size(const rclcpp::SubscriptionBase & subscription) const;
 
   RCLCPP_PUBLIC
   static void
@@ -347,6 +444,11 @@ protected:
   bool
   get_next_ready_executable(AnyExecutable & any_executable);
 
+  /// get_next_ready_executable() for the scheduling policies other than FIFO.
+  RCLCPP_PUBLIC
+  bool
+  get_next_scheduled_executable(AnyExecutable & any_executable);
+
   RCLCPP_PUBLIC
   bool
   get_next_executable(
@@ -371,15 +473,72 @@ protected:
   /// The context associated with this executor.
   std::shared_ptr<rclcpp::Context> context_;
 
-private:
-  RCLCPP_DISABLE_COPY(Executor)
+  /// Whether callback executions are wrapped in a rclcpp::RealtimeViolationScope.
+  bool track_realtime_violations_;
 
+  /// See ExecutorArgs::subscription_batch_size, at least one.
+  size_t subscription_batch_size_;
+
+  /// Apply ExecutorArgs::thread_configurations[thread_number] to the calling thread, if any.
   RCLCPP_PUBLIC
   void
+  configure_thread(size_t thread_number);
+
+  /// configure_thread() for threads the executor created, where an exception would terminate.
+  /**
+   * On failure the exception is kept for rethrow_thread_configuration_error() and the executor
+   * is canceled.
+   * \return false on failure, the thread should not spin then.
+   */
+  RCLCPP_PUBLIC
+  bool
+  configure_thread_or_cancel(size_t thread_number);
+
+  /// Rethrow the first failure of configure_thread_or_cancel(), if any. Call after joining.
+  RCLCPP_PUBLIC
+  void
+  rethrow_thread_configuration_error();
+
+  std::vector<ThreadConfiguration> thread_configurations_;
+  std::mutex thread_configuration_error_mutex_;
+  std::exception_ptr thread_configuration_error_;
+
+  /// Wait for and execute at most one executable. Used by spin_once and spin_until_future_complete.
+  RCLCPP_PUBLIC
+  virtual void
   spin_once_impl(std::chrono::nanoseconds timeout);
 
   std::list<rclcpp::node_interfaces::NodeBaseInterface::WeakPtr> weak_nodes_;
   std::list<const rcl_guard_condition_t *> guard_conditions_;
+
+  SchedulingPolicy scheduling_policy_;
+
+  /// An executable taken from the memory strategy that waits for its turn.
+  struct ReadyExecutable
+  {
+    AnyExecutable executable;
+    std::chrono::steady_clock::time_point ready_time;
+  };
+
+  /// Everything that is ready, when the scheduling policy is not FIFO.
+  /**
+   * The callback groups of these are not marked as taken, only the one that is picked. Entries
+   * are only ever moved, which leaves no group behind, so dropping them never releases a group.
+   * Reserved up front, it only grows when more is ready at once than ever before.
+   */
+  std::vector<ReadyExecutable> ready_executables_;
+
+  /// Groups of the timers reported while queueing, see get_next_scheduled_executable.
+  std::vector<rclcpp::callback_group::CallbackGroup::SharedPtr> hidden_groups_;
+
+  /// When the last wait_for_work returned.
+  std::chrono::steady_clock::time_point last_wait_end_;
+
+  mutable std::mutex dispatch_latency_mutex_;
+  std::map<int32_t, DispatchLatencyStatistics> dispatch_latency_statistics_;
+
+private:
+  RCLCPP_DISABLE_COPY(Executor)
 };
 
 }  // namespace executor
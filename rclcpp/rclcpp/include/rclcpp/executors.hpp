@@ -18,8 +18,12 @@
 #include <future>
 #include <memory>
 
+#include "rclcpp/executors/busy_polling_executor.hpp"
+#include "rclcpp/executors/callback_group_thread_executor.hpp"
 #include "rclcpp/executors/multi_threaded_executor.hpp"
 #include "rclcpp/executors/single_threaded_executor.hpp"
+#include "rclcpp/executors/static_single_threaded_executor.hpp"
+#include "rclcpp/executors/work_stealing_executor.hpp"
 #include "rclcpp/node.hpp"
 #include "rclcpp/utilities.hpp"
 #include "rclcpp/visibility_control.hpp"
@@ -52,6 +56,8 @@ namespace executors
 
 using rclcpp::executors::MultiThreadedExecutor;
 using rclcpp::executors::SingleThreadedExecutor;
+using rclcpp::executors::StaticSingleThreadedExecutor;
+using rclcpp::executors::WorkStealingExecutor;
 
 /// Spin (blocking) until the future is complete, it times out waiting, or rclcpp is interrupted.
 /**
@@ -0,0 +1,180 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__EXECUTORS__CALLBACK_GROUP_THREAD_EXECUTOR_HPP_
+#define RCLCPP__EXECUTORS__CALLBACK_GROUP_THREAD_EXECUTOR_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "rcl/guard_condition.h"
+
+#include "rclcpp/callback_group.hpp"
+#include "rclcpp/executor.hpp"
+#include "rclcpp/macros.hpp"
+#include "rclcpp/node.hpp"
+#include "rclcpp/thread_configuration.hpp"
+#include "rclcpp/visibility_control.hpp"
+
+namespace rclcpp
+{
+namespace executors
+{
+
+/// Executor that runs every callback group on a thread of its own.
+/**
+ * Each callback group of the added nodes gets a worker: a thread with its own rcl wait set that
+ * only holds the entities of that group, and that executes them itself. Workers share no lock and
+ * hand nothing over to each other, so the latency of a group does not depend on what the other
+ * groups are doing, unlike with the MultiThreadedExecutor, where all threads take turns waiting
+ * on one wait set. Callback group types do not matter: a group only ever runs on its own thread.
+ *
+ * The thread that calls spin() coordinates: it waits on the notify guard conditions of the nodes
+ * only, starts a worker for every new callback group, tells workers to collect their group again
+ * when an entity is added to its node, and stops the workers of nodes that are removed or
+ * destroyed. A worker collects its group like the StaticSingleThreadedExecutor collects its
+ * nodes, so an idle group costs nothing but its thread.
+ *
+ * A callback group that its node no longer knows about keeps its worker until the node is
+ * removed. If a callback throws, the executor is canceled and spin() rethrows the exception once
+ * all workers have stopped.
+ */
+class CallbackGroupThreadExecutor : public executor::Executor
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS(CallbackGroupThreadExecutor)
+
+  /// Constructor.
+  /**
+   * The first entry of ExecutorArgs::thread_configurations, if any, configures the thread that
+   * calls spin(). Workers are configured per callback group, see set_thread_configuration().
+   */
+  RCLCPP_PUBLIC
+  explicit CallbackGroupThreadExecutor(
+    const executor::ExecutorArgs & args = executor::ExecutorArgs());
+
+  RCLCPP_PUBLIC
+  virtual ~CallbackGroupThreadExecutor();
+
+  /// Run the workers until canceled or Ctrl-C.
+  RCLCPP_PUBLIC
+  void
+  spin() override;
+
+  /// Not supported: callbacks only run on the threads of their groups, see spin().
+  RCLCPP_PUBLIC
+  void
+  spin_some(std::chrono::nanoseconds max_duration = std::chrono::nanoseconds(0)) override;
+
+  using executor::Executor::add_node;
+  using executor::Executor::remove_node;
+
+  RCLCPP_PUBLIC
+  void
+  add_node(
+    rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_ptr,
+    bool notify = true) override;
+
+  RCLCPP_PUBLIC
+  void
+  remove_node(
+    rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_ptr,
+    bool notify = true) override;
+
+  /// Configure the thread of a callback group, e.g. to pin it to a CPU.
+  /**
+   * Applied when the worker of the group starts, so call it before spin(), or before adding the
+   * group to a node that is already spinning. A failing configuration cancels the executor.
+   */
+  RCLCPP_PUBLIC
+  void
+  set_thread_configuration(
+    rclcpp::callback_group::CallbackGroup::SharedPtr group,
+    const ThreadConfiguration & thread_configuration);
+
+  /// Number of running workers, one per callback group.
+  RCLCPP_PUBLIC
+  size_t
+  get_number_of_threads();
+
+protected:
+  /// Not supported, like spin_some(). spin_once() and spin_until_future_complete() throw.
+  RCLCPP_PUBLIC
+  void
+  spin_once_impl(std::chrono::nanoseconds timeout) override;
+
+private:
+  RCLCPP_DISABLE_COPY(CallbackGroupThreadExecutor)
+
+  using WeakNodeVector = std::vector<rclcpp::node_interfaces::NodeBaseInterface::WeakPtr>;
+
+  struct Worker;
+
+  /// Start workers for new callback groups, stop those of nodes that are gone.
+  /**
+   * \param[in] nodes The nodes added to this executor.
+   * \param[in] changed_nodes The nodes that got a new entity, their workers collect again.
+   */
+  void
+  update_workers(const WeakNodeVector & nodes, const WeakNodeVector & changed_nodes);
+
+  /// Wait for a node notify guard condition or the interrupt guard conditions.
+  /**
+   * Also times out now and then, to notice destroyed nodes.
+   * \return The nodes whose notify guard condition was triggered.
+   */
+  WeakNodeVector
+  wait_for_changes(
+    const WeakNodeVector & nodes,
+    const std::vector<const rcl_guard_condition_t *> & node_guard_conditions);
+
+  void
+  start_worker(
+    const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node,
+    const rclcpp::callback_group::CallbackGroup::SharedPtr & group);
+
+  void
+  stop_workers();
+
+  // Protects weak_nodes_ and guard_conditions_ of the base class, which add_node() and
+  // remove_node() change, likely from a callback on a worker thread.
+  std::mutex nodes_mutex_;
+
+  // Only used by the thread in spin().
+  std::map<
+    rclcpp::callback_group::CallbackGroup::WeakPtr,
+    std::unique_ptr<Worker>,
+    std::owner_less<rclcpp::callback_group::CallbackGroup::WeakPtr>> workers_;
+  std::atomic<size_t> number_of_threads_;
+  size_t wait_set_guard_conditions_;
+
+  std::mutex group_thread_configurations_mutex_;
+  std::map<
+    rclcpp::callback_group::CallbackGroup::WeakPtr,
+    ThreadConfiguration,
+    std::owner_less<rclcpp::callback_group::CallbackGroup::WeakPtr>> group_thread_configurations_;
+
+  std::mutex worker_error_mutex_;
+  std::exception_ptr worker_error_;
+};
+
+}  // namespace executors
+}  // namespace rclcpp
+
+#endif  // RCLCPP__EXECUTORS__CALLBACK_GROUP_THREAD_EXECUTOR_HPP_
@@ -15,11 +15,15 @@
 #ifndef RCLCPP__EXECUTORS__MULTI_THREADED_EXECUTOR_HPP_
 #define RCLCPP__EXECUTORS__MULTI_THREADED_EXECUTOR_HPP_
 
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "rclcpp/executor.hpp"
 #include "rclcpp/macros.hpp"
@@ -67,6 +71,24 @@ public:
   size_t
   get_number_of_threads();
 
+  /// Execute the callbacks of a group only on the given thread.
+  /**
+   * The thread becomes dedicated: it no longer waits for work itself, but only runs what the
+   * other threads hand over to it, so give it a ThreadConfiguration (ExecutorArgs) to pin it.
+   * Several groups can share a thread. At least one thread has to stay undedicated.
+   * Call before spin().
+   *
+   * \param[in] group The callback group.
+   * \param[in] thread_number From 0 to get_number_of_threads() - 1, numbered as for
+   *   ExecutorArgs::thread_configurations.
+   * \throws std::invalid_argument if the thread does not exist or is the last undedicated one.
+   */
+  RCLCPP_PUBLIC
+  void
+  assign_callback_group(
+    rclcpp::callback_group::CallbackGroup::SharedPtr group,
+    size_t thread_number);
+
 protected:
   RCLCPP_PUBLIC
   void
@@ -75,11 +97,39 @@ protected:
 private:
   RCLCPP_DISABLE_COPY(MultiThreadedExecutor)
 
+  /// Hand-over queue of a thread that callback groups are assigned to.
+  struct DedicatedThread
+  {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::unique_ptr<executor::AnyExecutable>> queue;
+  };
+
+  void
+  run_dedicated(size_t this_thread_number);
+
+  /// Move any_exec to the queue of the thread its group is assigned to, if that is another one.
+  /** \return whether it was handed over. Called with wait_mutex_ held. */
+  bool
+  hand_over(executor::AnyExecutable & any_exec, size_t this_thread_number);
+
+  void
+  execute(executor::AnyExecutable & any_exec);
+
+  void
+  wake_dedicated_threads();
+
   std::mutex wait_mutex_;
   size_t number_of_threads_;
   bool yield_before_execute_;
 
   std::set<TimerBase::SharedPtr> scheduled_timers_;
+
+  std::map<
+    rclcpp::callback_group::CallbackGroup::WeakPtr, size_t,
+    std::owner_less<rclcpp::callback_group::CallbackGroup::WeakPtr>> group_threads_;
+  // Indexed by thread number, nullptr for the undedicated threads.
+  std::vector<std::unique_ptr<DedicatedThread>> dedicated_threads_;
 };
 
 }  // namespace executors
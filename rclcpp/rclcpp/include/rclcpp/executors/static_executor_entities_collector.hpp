@@ -0,0 +1,185 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__EXECUTORS__STATIC_EXECUTOR_ENTITIES_COLLECTOR_HPP_
+#define RCLCPP__EXECUTORS__STATIC_EXECUTOR_ENTITIES_COLLECTOR_HPP_
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "rcl/guard_condition.h"
+#include "rcl/wait.h"
+
+#include "rclcpp/callback_group.hpp"
+#include "rclcpp/client.hpp"
+#include "rclcpp/macros.hpp"
+#include "rclcpp/node_interfaces/node_base_interface.hpp"
+#include "rclcpp/service.hpp"
+#include "rclcpp/subscription_base.hpp"
+#include "rclcpp/timer.hpp"
+#include "rclcpp/visibility_control.hpp"
+#include "rclcpp/waitable.hpp"
+
+namespace rclcpp
+{
+namespace executors
+{
+
+/// Snapshot of the entities of a set of nodes, laid out the way they go into an rcl wait set.
+/**
+ * The collector holds strong references to everything it collected, because the wait set points
+ * at their rcl handles. The index of an entity in each vector is its index in the wait set, so
+ * after rcl_wait the ready entities are found without any lookup.
+ *
+ * Guard conditions are laid out as: the fixed ones given to collect() (e.g. the interrupt guard
+ * conditions of the executor), then one notify guard condition per node, then the ones that
+ * waitables add themselves.
+ *
+ * Timers on a steady clock are kept apart in queued_timers() and not added to the wait set: the
+ * executor keeps them in a TimerQueue and passes the time until the next one is due as the wait
+ * timeout. Other timers may jump with their clock, so rcl_wait keeps handling those.
+ */
+class StaticExecutorEntitiesCollector
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS(StaticExecutorEntitiesCollector)
+
+  template<typename EntityT>
+  struct Entry
+  {
+    std::shared_ptr<EntityT> entity;
+    rclcpp::callback_group::CallbackGroup::SharedPtr callback_group;
+  };
+
+  /// A subscription takes one wait set slot per rcl subscription it has.
+  struct SubscriptionEntry
+  {
+    rclcpp::SubscriptionBase::SharedPtr subscription;
+    rclcpp::callback_group::CallbackGroup::SharedPtr callback_group;
+    bool intra_process;
+  };
+
+  using WeakNodeList = std::list<rclcpp::node_interfaces::NodeBaseInterface::WeakPtr>;
+
+  /// Walk all nodes and collect their entities. Replaces the previous collection.
+  /**
+   * \return true if one of the nodes has been destroyed.
+   */
+  RCLCPP_PUBLIC
+  bool
+  collect(
+    const WeakNodeList & weak_nodes,
+    const std::vector<const rcl_guard_condition_t *> & fixed_guard_conditions);
+
+  /// Collect the entities of a single callback group. Replaces the previous collection.
+  /**
+   * No nodes are collected, so there are no node notify guard conditions in the wait set:
+   * whoever owns the node has to tell about new entities.
+   */
+  RCLCPP_PUBLIC
+  void
+  collect_group(
+    const rclcpp::callback_group::CallbackGroup::SharedPtr & group,
+    const std::vector<const rcl_guard_condition_t *> & fixed_guard_conditions);
+
+  /// Drop all strong references.
+  RCLCPP_PUBLIC
+  void
+  clear();
+
+  /// Resize the wait set to fit the collection. Only needed after collect().
+  RCLCPP_PUBLIC
+  void
+  resize_wait_set(rcl_wait_set_t * wait_set) const;
+
+  /// Clear the wait set and add the collection to it again, rcl_wait leaves only the ready ones.
+  /**
+   * Only pointer stores: the rcl handles are looked up by collect(), so neither weak nor shared
+   * pointers are touched here, and nothing is allocated.
+   */
+  RCLCPP_PUBLIC
+  void
+  fill_wait_set(rcl_wait_set_t * wait_set) const;
+
+  /// Whether a node notify guard condition was triggered in the last wait.
+  /**
+   * Nodes trigger it when an entity is added to them.
+   */
+  RCLCPP_PUBLIC
+  bool
+  node_guard_condition_triggered(const rcl_wait_set_t * wait_set) const;
+
+  /// Whether one of the collected nodes has been destroyed. Cheap: one check per node.
+  RCLCPP_PUBLIC
+  bool
+  has_expired_nodes() const;
+
+  /// Whether some collected entity is only still alive because this collection holds it.
+  /**
+   * One check per entity, so not something to do on every wait.
+   */
+  RCLCPP_PUBLIC
+  bool
+  has_orphans() const;
+
+  const std::vector<SubscriptionEntry> & subscriptions() const {return subscriptions_;}
+  const std::vector<Entry<rclcpp::TimerBase>> & timers() const {return timers_;}
+  const std::vector<Entry<rclcpp::TimerBase>> & queued_timers() const {return queued_timers_;}
+  const std::vector<Entry<rclcpp::ServiceBase>> & services() const {return services_;}
+  const std::vector<Entry<rclcpp::ClientBase>> & clients() const {return clients_;}
+  const std::vector<Entry<rclcpp::Waitable>> & waitables() const {return waitables_;}
+
+  /// is_orphan() for the subscription at index, which may be listed twice.
+  RCLCPP_PUBLIC
+  bool
+  subscription_is_orphan(size_t index) const;
+
+  /// Check if an entity is only still alive because this collection holds it.
+  template<typename EntityT>
+  static bool
+  is_orphan(const std::shared_ptr<EntityT> & entity)
+  {
+    return entity.use_count() == 1;
+  }
+
+private:
+  void
+  collect_group_entities(const rclcpp::callback_group::CallbackGroup::SharedPtr & group);
+
+  std::vector<SubscriptionEntry> subscriptions_;
+  std::vector<Entry<rclcpp::TimerBase>> timers_;
+  std::vector<Entry<rclcpp::TimerBase>> queued_timers_;
+  std::vector<Entry<rclcpp::ServiceBase>> services_;
+  std::vector<Entry<rclcpp::ClientBase>> clients_;
+  std::vector<Entry<rclcpp::Waitable>> waitables_;
+
+  // The rcl handles of the entities above, in the same order. The entities own them, and the
+  // entries keep the entities alive.
+  std::vector<const rcl_subscription_t *> subscription_handles_;
+  std::vector<const rcl_timer_t *> timer_handles_;
+  std::vector<const rcl_service_t *> service_handles_;
+  std::vector<const rcl_client_t *> client_handles_;
+
+  std::vector<const rcl_guard_condition_t *> guard_conditions_;
+  size_t first_node_guard_condition_ = 0;
+  // Not owned: holding the nodes would keep them alive. Their notify guard conditions are in the
+  // wait set though, so the executor checks has_expired_nodes() before every wait.
+  std::vector<rclcpp::node_interfaces::NodeBaseInterface::WeakPtr> nodes_;
+};
+
+}  // namespace executors
+}  // namespace rclcpp
+
+#endif  // RCLCPP__EXECUTORS__STATIC_EXECUTOR_ENTITIES_COLLECTOR_HPP_
@@ -0,0 +1,160 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__EXECUTORS__STATIC_SINGLE_THREADED_EXECUTOR_HPP_
+#define RCLCPP__EXECUTORS__STATIC_SINGLE_THREADED_EXECUTOR_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "rclcpp/executor.hpp"
+#include "rclcpp/executors/static_executor_entities_collector.hpp"
+#include "rclcpp/executors/timer_queue.hpp"
+#include "rclcpp/macros.hpp"
+#include "rclcpp/node.hpp"
+#include "rclcpp/visibility_control.hpp"
+
+namespace rclcpp
+{
+namespace executors
+{
+
+/// Single-threaded executor that collects its entities once, instead of on every wait.
+/**
+ * The Executor base class collects all entities of all nodes and rebuilds the rcl wait set before
+ * every wait, which locks every weak pointer of every node, group and entity. With a few hundred
+ * entities this dominates the CPU usage of an otherwise idle process.
+ *
+ * This executor keeps the collection (see StaticExecutorEntitiesCollector) and the wait set size
+ * until something changes, and then collects again. It notices changes when:
+ *  - a node is added or removed through add_node() or remove_node(),
+ *  - a node triggers its notify guard condition, which it does when an entity is added to it,
+ *  - a node has been destroyed (checked before every wait, once per node),
+ *  - an entity is only kept alive by the collection anymore, because its owner released it
+ *    (checked right before executing it, and for all entities once per orphan check period).
+ * Or when refresh_entities() is called.
+ *
+ * Ready entities are executed straight from the wait set, timers first, in the same order as the
+ * other executors. Callback group exclusivity is not needed with a single thread, and not checked.
+ *
+ * Timers on a steady clock (e.g. those of create_wall_timer()) are not put in the wait set. They
+ * are kept in a TimerQueue by next due time instead: the wait times out when the earliest one is
+ * due, and only due timers are checked after the wait. rcl_wait would otherwise go through all
+ * timers twice per wait, for its timeout and for their readiness. Other timers go through rcl_wait.
+ * A canceled timer is looked at every 100 ms, to notice that it has been reset.
+ */
+class StaticSingleThreadedExecutor : public executor::Executor
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS(StaticSingleThreadedExecutor)
+
+  /// Default constructor. See the default constructor for Executor.
+  RCLCPP_PUBLIC
+  explicit StaticSingleThreadedExecutor(
+    const executor::ExecutorArgs & args = executor::ExecutorArgs());
+
+  RCLCPP_PUBLIC
+  virtual ~StaticSingleThreadedExecutor();
+
+  /// Block and execute work as it comes in, until canceled or Ctrl-C.
+  RCLCPP_PUBLIC
+  void
+  spin() override;
+
+  /// Execute all work that is ready now, waiting once.
+  RCLCPP_PUBLIC
+  void
+  spin_some(std::chrono::nanoseconds max_duration = std::chrono::nanoseconds(0)) override;
+
+  using executor::Executor::add_node;
+  using executor::Executor::remove_node;
+
+  RCLCPP_PUBLIC
+  void
+  add_node(
+    rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_ptr,
+    bool notify = true) override;
+
+  RCLCPP_PUBLIC
+  void
+  remove_node(
+    rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_ptr,
+    bool notify = true) override;
+
+  /// Collect the entities again before the next wait.
+  /** Thread-safe, but does not wake up a blocked spin. */
+  RCLCPP_PUBLIC
+  void
+  refresh_entities();
+
+  /// How often all entities are checked for having been released by their owner.
+  /** Zero checks before every wait. The default is 100 ms. Set it before spinning. */
+  RCLCPP_PUBLIC
+  void
+  set_orphan_check_period(std::chrono::nanoseconds period);
+
+protected:
+  RCLCPP_PUBLIC
+  void
+  spin_once_impl(std::chrono::nanoseconds timeout) override;
+
+  /// Fill entities_collector_ with what to wait on, the entities of all nodes by default.
+  /**
+   * \param[in] fixed_guard_conditions The guard conditions of the executor, to wait on as well.
+   * \return true if one of the nodes has been destroyed.
+   */
+  RCLCPP_PUBLIC
+  virtual bool
+  collect_entities(const std::vector<const rcl_guard_condition_t *> & fixed_guard_conditions);
+
+  /// Rebuild if needed, then wait on the cached wait set.
+  RCLCPP_PUBLIC
+  void
+  wait_for_ready(std::chrono::nanoseconds timeout);
+
+  /// Execute what the last wait found ready.
+  /** \return whether anything was executed. */
+  RCLCPP_PUBLIC
+  bool
+  execute_ready_executables(bool only_one);
+
+  StaticExecutorEntitiesCollector entities_collector_;
+
+private:
+  RCLCPP_DISABLE_COPY(StaticSingleThreadedExecutor)
+
+  void
+  execute_ready_executable(executor::AnyExecutable & any_exec);
+
+  void
+  rebuild();
+
+  /// Estimate of when timer is due next, in steady time.
+  static TimerQueue::Clock::time_point
+  next_due_time(rclcpp::TimerBase & timer, TimerQueue::Clock::time_point now);
+
+  /// Indexes into entities_collector_.queued_timers(), refilled by rebuild().
+  TimerQueue timer_queue_;
+  std::atomic_bool entities_changed_;
+  bool collected_;
+  std::chrono::nanoseconds orphan_check_period_;
+  std::chrono::steady_clock::time_point last_orphan_check_;
+};
+
+}  // namespace executors
+}  // namespace rclcpp
+
+#endif  // RCLCPP__EXECUTORS__STATIC_SINGLE_THREADED_EXECUTOR_HPP_
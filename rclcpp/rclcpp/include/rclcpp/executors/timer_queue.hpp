@@ -0,0 +1,96 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__EXECUTORS__TIMER_QUEUE_HPP_
+#define RCLCPP__EXECUTORS__TIMER_QUEUE_HPP_
+
+#include <chrono>
+#include <vector>
+
+#include "rclcpp/visibility_control.hpp"
+
+namespace rclcpp
+{
+namespace executors
+{
+
+/// Min-heap of timers, by the steady time they are due next.
+/**
+ * Timers are referred to by an index into a collection the owner keeps, the queue only orders
+ * them. Peeking at the earliest due time is O(1), taking or adding a timer O(log n), so the owner
+ * only looks at timers that are due, instead of polling all of them before and after every wait.
+ *
+ * The due times are estimates the owner computed (e.g. now + TimerBase::time_until_trigger()),
+ * the timer itself stays the authority: a popped timer is checked with is_ready() and pushed
+ * again with a fresh estimate. Timers due at the same time pop in index order.
+ * Not thread-safe.
+ */
+class TimerQueue
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  RCLCPP_PUBLIC
+  void
+  clear();
+
+  RCLCPP_PUBLIC
+  void
+  push(size_t index, Clock::time_point due);
+
+  /// Pop the earliest timer, if it is due at now.
+  /**
+   * \param[in] now The current steady time.
+   * \param[out] index The index given to push(), only set when true is returned.
+   * \return true if a timer was due.
+   */
+  RCLCPP_PUBLIC
+  bool
+  pop_due(Clock::time_point now, size_t & index);
+
+  /// The earliest due time, Clock::time_point::max() if empty.
+  RCLCPP_PUBLIC
+  Clock::time_point
+  next_due() const;
+
+  /// How long to wait at most from now: until the next timer is due, or timeout if that is sooner.
+  /**
+   * \param[in] timeout Negative for no timeout, as for rcl_wait().
+   * \return The timeout to pass to rcl_wait(), zero if a timer is overdue.
+   */
+  RCLCPP_PUBLIC
+  std::chrono::nanoseconds
+  wait_timeout(Clock::time_point now, std::chrono::nanoseconds timeout) const;
+
+  bool empty() const {return heap_.empty();}
+  size_t size() const {return heap_.size();}
+
+private:
+  struct Item
+  {
+    Clock::time_point due;
+    size_t index;
+  };
+
+  /// Heap order for std::push_heap and friends: true if a is due later than b.
+  static bool
+  later(const Item & a, const Item & b);
+
+  std::vector<Item> heap_;
+};
+
+}  // namespace executors
+}  // namespace rclcpp
+
+#endif  // RCLCPP__EXECUTORS__TIMER_QUEUE_HPP_
@@ -0,0 +1,150 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__EXECUTORS__WORK_STEALING_DEQUE_HPP_
+#define RCLCPP__EXECUTORS__WORK_STEALING_DEQUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "rclcpp/macros.hpp"
+
+namespace rclcpp
+{
+namespace executors
+{
+
+/// Bounded lock-free work-stealing deque of pointers (Chase-Lev).
+/**
+ * One owner thread pushes and pops at the bottom, any other thread steals from the top.
+ * None of the operations block or allocate, the capacity is fixed at construction.
+ *
+ * Based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al., PPoPP 2013),
+ * without the growing of the buffer.
+ */
+template<typename T>
+class WorkStealingDeque
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS(WorkStealingDeque<T>)
+
+  /// \param capacity rounded up to a power of two.
+  explicit WorkStealingDeque(size_t capacity)
+  : top_(0), bottom_(0)
+  {
+    if (capacity == 0) {
+      throw std::invalid_argument("capacity must be a positive, non-zero value");
+    }
+    size_t rounded = 1;
+    while (rounded < capacity) {
+      rounded <<= 1;
+    }
+    mask_ = static_cast<int64_t>(rounded - 1);
+    buffer_.reset(new std::atomic<T *>[rounded]);
+    for (size_t i = 0; i < rounded; ++i) {
+      buffer_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  size_t
+  capacity() const
+  {
+    return static_cast<size_t>(mask_ + 1);
+  }
+
+  /// Owner only. \return false when full, the item is not pushed then.
+  bool
+  push(T * item)
+  {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t > mask_) {
+      return false;
+    }
+    buffer_[b & mask_].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// Owner only, takes the most recently pushed item. \return nullptr when empty.
+  T *
+  pop()
+  {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T * item = buffer_[b & mask_].load(std::memory_order_relaxed);
+    if (t == b) {
+      // Last item, race the thieves for it.
+      if (!top_.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      {
+        item = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  /// Any thread, takes the oldest item. \return nullptr when empty or when another thread won.
+  T *
+  steal()
+  {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return nullptr;
+    }
+    T * item = buffer_[t & mask_].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(
+        t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      return nullptr;
+    }
+    return item;
+  }
+
+  /// Racy, only a hint.
+  bool
+  empty() const
+  {
+    return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+  }
+
+private:
+  RCLCPP_DISABLE_COPY(WorkStealingDeque<T>)
+
+  // top_ is written by thieves, bottom_ by the owner: keep them on separate cache lines.
+  std::atomic<int64_t> top_;
+  char top_padding_[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> bottom_;
+  char bottom_padding_[64 - sizeof(std::atomic<int64_t>)];
+  int64_t mask_;
+  std::unique_ptr<std::atomic<T *>[]> buffer_;
+};
+
+}  // namespace executors
+}  // namespace rclcpp
+
+#endif  // RCLCPP__EXECUTORS__WORK_STEALING_DEQUE_HPP_
@@ -0,0 +1,162 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__EXECUTORS__WORK_STEALING_EXECUTOR_HPP_
+#define RCLCPP__EXECUTORS__WORK_STEALING_EXECUTOR_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "rclcpp/executor.hpp"
+#include "rclcpp/executors/work_stealing_deque.hpp"
+#include "rclcpp/macros.hpp"
+#include "rclcpp/memory_strategies.hpp"
+#include "rclcpp/visibility_control.hpp"
+
+namespace rclcpp
+{
+namespace executors
+{
+
+/// Multi-threaded executor where the threads do not share a lock to get work.
+/**
+ * The MultiThreadedExecutor makes every thread take wait_mutex_ to wait and to pick the next
+ * executable, so only one thread at a time makes progress there, which stops scaling after a few
+ * threads.
+ *
+ * Here one thread at a time is the leader: it waits, turns everything that is ready into tasks
+ * and pushes them onto its own WorkStealingDeque, then gives up leading and wakes the idle
+ * threads. Every thread executes from its own deque first, then steals from the others, and only
+ * when there is nothing left it tries to become the next leader, or sleeps until something
+ * changes. Taking and executing work is lock free; the only locks are the one that guards
+ * sleeping and the one around the set of in-flight timers, neither is held while waiting or
+ * executing.
+ *
+ * The tasks come from a pool of each thread that is allocated up front, so dispatching does not
+ * allocate.
+ *
+ * Callback groups work as in the other executors: a task taken from a mutually exclusive group
+ * makes the group unavailable (can_be_taken_from) until it has been executed, so the leader does
+ * not dispatch a second one from it.
+ */
+class WorkStealingExecutor : public executor::Executor
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS(WorkStealingExecutor)
+
+  /// Constructor for WorkStealingExecutor.
+  /**
+   * \param args common arguments for all executors
+   * \param number_of_threads number of threads to have in the thread pool,
+   *   the default 0 will use the number of cpu cores found instead
+   * \param queue_capacity tasks each thread can queue; when the leader's deque is full, the rest
+   *   stays ready and is dispatched by the next leader
+   */
+  RCLCPP_PUBLIC
+  WorkStealingExecutor(
+    const executor::ExecutorArgs & args = executor::ExecutorArgs(),
+    size_t number_of_threads = 0,
+    size_t queue_capacity = 256);
+
+  RCLCPP_PUBLIC
+  virtual ~WorkStealingExecutor();
+
+  RCLCPP_PUBLIC
+  void
+  spin() override;
+
+  RCLCPP_PUBLIC
+  size_t
+  get_number_of_threads();
+
+protected:
+  RCLCPP_PUBLIC
+  void
+  run(size_t this_thread_number);
+
+private:
+  RCLCPP_DISABLE_COPY(WorkStealingExecutor)
+
+  using Task = executor::AnyExecutable;
+
+  /// A task of a TaskPool, in use from being taken until it has been executed.
+  struct PooledTask
+  {
+    Task executable;
+    std::atomic_bool in_use{false};
+  };
+
+  /// Tasks that only its owner thread takes, and any thread gives back.
+  struct TaskPool
+  {
+    explicit TaskPool(size_t size)
+    : tasks(size), next(0) {}
+
+    /// Owner only. \return nullptr when all tasks are in use.
+    PooledTask *
+    take();
+
+    std::vector<PooledTask> tasks;
+    size_t next;
+  };
+
+  /// Wait once and queue everything that is ready on the deque of this thread.
+  void
+  lead(size_t this_thread_number);
+
+  /// Like Executor::get_next_ready_executable, but also marks the group and skips in-flight timers.
+  bool
+  take_ready_executable(Task & task);
+
+  PooledTask *
+  steal(size_t this_thread_number);
+
+  void
+  execute_task(PooledTask * task);
+
+  /// Drop what the task refers to and give it back to its pool.
+  static void
+  give_back(PooledTask * task);
+
+  /// Wake all sleeping threads, because there may be work or nobody is leading.
+  void
+  wake_idle_threads();
+
+  void
+  sleep_while_idle(uint64_t seen_epoch);
+
+  size_t number_of_threads_;
+  std::vector<std::unique_ptr<WorkStealingDeque<PooledTask>>> deques_;
+  std::vector<std::unique_ptr<TaskPool>> task_pools_;
+
+  std::atomic_bool leader_active_;
+
+  std::mutex idle_mutex_;
+  std::condition_variable idle_condition_;
+  std::atomic<uint64_t> idle_epoch_;
+
+  // A ready timer stays ready until its callback ran, the leader must not dispatch it twice.
+  std::mutex scheduled_timers_mutex_;
+  std::set<TimerBase::SharedPtr> scheduled_timers_;
+};
+
+}  // namespace executors
+}  // namespace rclcpp
+
+#endif  // RCLCPP__EXECUTORS__WORK_STEALING_EXECUTOR_HPP_
@@ -27,6 +27,7 @@
 #include <unordered_map>
 #include <utility>
 #include <set>
+#include <vector>
 
 #include "rclcpp/allocator/allocator_deleter.hpp"
 #include "rclcpp/intra_process_manager_impl.hpp"
@@ -162,6 +163,69 @@ public:
   void
   remove_subscription(uint64_t intra_process_subscription_id);
 
+  /// Register the queue through which a subscription receives messages from publishers directly.
+  /**
+   * Messages for the subscription are then pushed by publishers to the waitable, and no longer
+   * stored here for it.
+   *
+   * \param intra_process_subscription_id id of the subscription, from add_subscription().
+   * \param waitable the queue of the subscription, only referenced weakly.
+   */
+  RCLCPP_PUBLIC
+  void
+  add_intra_process_waitable(
+    uint64_t intra_process_subscription_id,
+    std::shared_ptr<SubscriptionIntraProcessBase> waitable);
+
+  /// Read access to the targets of a publisher, see get_intra_process_targets().
+  class TargetsReader
+  {
+  public:
+    TargetsReader(const IntraProcessManagerImplBase & impl, uint64_t intra_process_publisher_id)
+    : impl_(&impl)
+    {
+      impl_->begin_read();
+      targets_ = impl_->get_targets(intra_process_publisher_id);
+    }
+
+    TargetsReader(TargetsReader && other)
+    : impl_(other.impl_), targets_(other.targets_)
+    {
+      other.impl_ = nullptr;
+    }
+
+    ~TargetsReader()
+    {
+      if (impl_) {
+        impl_->end_read();
+      }
+    }
+
+    /// nullptr if the publisher is not registered.
+    const IntraProcessTargets *
+    get() const
+    {
+      return targets_;
+    }
+
+  private:
+    RCLCPP_DISABLE_COPY(TargetsReader)
+
+    const IntraProcessManagerImplBase * impl_;
+    const IntraProcessTargets * targets_;
+  };
+
+  /// Get what a publisher delivers to: the queues of subscriptions, and those taking from here.
+  /**
+   * Neither locks nor allocates. The targets, and the waitables in them, stay valid as long as
+   * the returned reader exists, even if subscriptions are removed meanwhile.
+   *
+   * \param intra_process_publisher_id id of the publisher, from add_publisher().
+   */
+  RCLCPP_PUBLIC
+  TargetsReader
+  get_intra_process_targets(uint64_t intra_process_publisher_id) const;
+
   /// Register a publisher with the manager, returns the publisher unique id.
   /**
    * In addition to generating and returning a unique id for the publisher,
@@ -396,10 +460,23 @@ public:
   }
 
   /// Return true if the given rmw_gid_t matches any stored Publishers.
+  /**
+   * Subscriptions call this for every message from the middleware, to drop those published in
+   * this process: it is a hash lookup, which neither locks nor depends on the number of
+   * publishers.
+   */
   RCLCPP_PUBLIC
   bool
   matches_any_publishers(const rmw_gid_t * id) const;
 
+  /// Get the gid a publisher sends with to the middleware, given the publisher id.
+  /**
+   * \return false if the publisher is not registered, or no longer exists.
+   */
+  RCLCPP_PUBLIC
+  bool
+  get_publisher_gid(uint64_t intra_process_publisher_id, rmw_gid_t & gid) const;
+
   /// Return the number of intraprocess subscriptions to a topic, given the publisher id.
   RCLCPP_PUBLIC
   size_t
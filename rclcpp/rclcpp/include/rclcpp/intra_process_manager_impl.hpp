@@ -24,11 +24,12 @@
 #include <map>
 #include <memory>
 #include <mutex>
-#include <set>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "rmw/validate_full_topic_name.h"
 
@@ -40,9 +41,30 @@
 
 namespace rclcpp
 {
+
+class SubscriptionIntraProcessBase;
+
 namespace intra_process_manager
 {
 
+/// What the publishers of a topic deliver to, rebuilt whenever subscriptions come and go.
+struct IntraProcessTargets
+{
+  /// The queues of the subscriptions that publishers push messages to directly.
+  std::vector<std::shared_ptr<SubscriptionIntraProcessBase>> waitables;
+  /// One bit per subscription that takes stored messages instead, see max_taking_subscriptions.
+  uint64_t subscription_mask = 0;
+  /// The number of intra process subscriptions on the topic, of either kind.
+  size_t subscription_count = 0;
+};
+
+/// The most subscriptions on one topic that take messages from the manager, without a waitable.
+/**
+ * Each has a bit in the word that tracks which of them still have to take a stored message, the
+ * remaining bits of that word tell messages that reuse the same slot apart.
+ */
+constexpr size_t max_taking_subscriptions = 48;
+
 class IntraProcessManagerImplBase
 {
 public:
@@ -57,6 +79,11 @@ public:
   virtual void
   remove_subscription(uint64_t intra_process_subscription_id) = 0;
 
+  virtual void
+  add_intra_process_waitable(
+    uint64_t intra_process_subscription_id,
+    std::weak_ptr<SubscriptionIntraProcessBase> waitable) = 0;
+
   virtual void add_publisher(
     uint64_t id,
     PublisherBase::WeakPtr publisher,
@@ -81,9 +108,23 @@ public:
     uint64_t requesting_subscriptions_intra_process_id,
     size_t & size) = 0;
 
+  /// Start reading: the targets got until end_read() stay valid until then. Does not block.
+  virtual void
+  begin_read() const = 0;
+
+  virtual void
+  end_read() const = 0;
+
+  /// The targets of a publisher, between begin_read() and end_read(). nullptr if unknown.
+  virtual const IntraProcessTargets *
+  get_targets(uint64_t intra_process_publisher_id) const = 0;
+
   virtual bool
   matches_any_publishers(const rmw_gid_t * id) const = 0;
 
+  virtual bool
+  get_publisher_gid(uint64_t intra_process_publisher_id, rmw_gid_t & gid) const = 0;
+
   virtual size_t
   get_subscription_count(uint64_t intra_process_publisher_id) const = 0;
 
@@ -91,34 +132,70 @@ private:
   RCLCPP_DISABLE_COPY(IntraProcessManagerImplBase)
 };
 
+/// Bookkeeping of intra process publishers and subscriptions that publishing never waits for.
+/**
+ * Publishers and subscriptions change rarely, messages flow all the time. Changes therefore
+ * rebuild an immutable snapshot of who delivers to whom, under a mutex, and swap it in
+ * atomically. Publishing and taking only read the current snapshot, after announcing themselves
+ * in a reader count, and neither lock nor allocate. A replaced snapshot is freed by the next
+ * change that sees no readers, as they may still use it until then (read-copy-update).
+ *
+ * Which subscriptions still have to take a stored message is a word per slot of the publisher,
+ * the slot being the message sequence number modulo the buffer size. Storing a message sets the
+ * bits of the subscriptions on the topic in it, taking clears one with an atomic operation.
+ */
 template<typename Allocator = std::allocator<void>>
 class IntraProcessManagerImpl : public IntraProcessManagerImplBase
 {
 public:
-  IntraProcessManagerImpl() = default;
-  ~IntraProcessManagerImpl() = default;
+  IntraProcessManagerImpl()
+  : snapshot_(new Snapshot()),
+    readers_(0)
+  {}
+
+  ~IntraProcessManagerImpl()
+  {
+    delete snapshot_.load();
+  }
 
   void
   add_subscription(uint64_t id, SubscriptionBase::SharedPtr subscription)
   {
-    subscriptions_[id] = subscription;
-    subscription_ids_by_topic_[fixed_size_string(subscription->get_topic_name())].insert(id);
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    SubscriptionInfo & info = subscriptions_[id];
+    info.topic = fixed_size_string(subscription->get_topic_name());
+    info.bit = allocate_bit(info.topic);
+    update_snapshot();
   }
 
   void
   remove_subscription(uint64_t intra_process_subscription_id)
   {
-    subscriptions_.erase(intra_process_subscription_id);
-    for (auto & pair : subscription_ids_by_topic_) {
-      pair.second.erase(intra_process_subscription_id);
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    auto it = subscriptions_.find(intra_process_subscription_id);
+    if (it == subscriptions_.end()) {
+      return;
     }
-    // Iterate over all publisher infos and all stored subscription id's and
-    // remove references to this subscription's id.
-    for (auto & publisher_pair : publishers_) {
-      for (auto & sub_pair : publisher_pair.second.target_subscriptions_by_message_sequence) {
-        sub_pair.second.erase(intra_process_subscription_id);
-      }
+    // Stored messages that wait for this subscription no longer do.
+    clear_bit(it->second.topic, it->second.bit);
+    subscriptions_.erase(it);
+    update_snapshot();
+  }
+
+  void
+  add_intra_process_waitable(
+    uint64_t intra_process_subscription_id,
+    std::weak_ptr<SubscriptionIntraProcessBase> waitable)
+  {
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    auto it = subscriptions_.find(intra_process_subscription_id);
+    if (it == subscriptions_.end()) {
+      throw std::runtime_error("add_intra_process_waitable called with invalid subscription id");
     }
+    clear_bit(it->second.topic, it->second.bit);
+    it->second.bit = 0;
+    it->second.waitable = waitable;
+    update_snapshot();
   }
 
   void add_publisher(
@@ -127,21 +204,38 @@ public:
     mapped_ring_buffer::MappedRingBufferBase::SharedPtr mrb,
     size_t size)
   {
-    publishers_[id].publisher = publisher;
+    auto locked_publisher = publisher.lock();
+    if (!locked_publisher) {
+      throw std::runtime_error("publisher has unexpectedly gone out of scope");
+    }
     // As long as the size of the ring buffer is less than the max sequence number, we're safe.
     if (size > std::numeric_limits<uint64_t>::max()) {
       throw std::invalid_argument("the calculated buffer size is too large");
     }
-    publishers_[id].sequence_number.store(0);
+    auto info = std::make_shared<PublisherInfo>();
+    info->publisher = publisher;
+    info->topic = fixed_size_string(locked_publisher->get_topic_name());
+    info->sequence_number.store(0);
+    info->buffer = mrb;
+    info->gid = gid_key(locked_publisher->get_gid());
+    info->intra_process_gid = gid_key(locked_publisher->get_intra_process_gid());
+    info->size = std::max<size_t>(size, 1);
+    info->pending.reset(new std::atomic<uint64_t>[info->size]);
+    for (size_t i = 0; i < info->size; ++i) {
+      info->pending[i].store(0);
+    }
 
-    publishers_[id].buffer = mrb;
-    publishers_[id].target_subscriptions_by_message_sequence.reserve(size);
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    publishers_[id] = info;
+    update_snapshot();
   }
 
   void
   remove_publisher(uint64_t intra_process_publisher_id)
   {
+    std::lock_guard<std::mutex> lock(update_mutex_);
     publishers_.erase(intra_process_publisher_id);
+    update_snapshot();
   }
 
   // return message_seq and mrb
@@ -150,51 +244,31 @@ public:
     uint64_t intra_process_publisher_id,
     uint64_t & message_seq)
   {
-    std::lock_guard<std::mutex> lock(runtime_mutex_);
-    auto it = publishers_.find(intra_process_publisher_id);
-    if (it == publishers_.end()) {
+    ReadGuard guard(*this);
+    auto entry = guard.snapshot->find_publisher(intra_process_publisher_id);
+    if (!entry) {
       throw std::runtime_error("get_publisher_info_for_id called with invalid publisher id");
     }
-    PublisherInfo & info = it->second;
     // Calculate the next message sequence number.
-    message_seq = info.sequence_number.fetch_add(1);
+    message_seq = entry->info->sequence_number.fetch_add(1);
 
-    return info.buffer;
+    return entry->info->buffer;
   }
 
   void
   store_intra_process_message(uint64_t intra_process_publisher_id, uint64_t message_seq)
   {
-    std::lock_guard<std::mutex> lock(runtime_mutex_);
-    auto it = publishers_.find(intra_process_publisher_id);
-    if (it == publishers_.end()) {
+    ReadGuard guard(*this);
+    auto entry = guard.snapshot->find_publisher(intra_process_publisher_id);
+    if (!entry) {
       throw std::runtime_error("store_intra_process_message called with invalid publisher id");
     }
-    PublisherInfo & info = it->second;
-    auto publisher = info.publisher.lock();
-    if (!publisher) {
+    PublisherInfo & info = *entry->info;
+    if (info.publisher.expired()) {
       throw std::runtime_error("publisher has unexpectedly gone out of scope");
     }
-
-    // Figure out what subscriptions should receive the message.
-    auto & destined_subscriptions =
-      subscription_ids_by_topic_[fixed_size_string(publisher->get_topic_name())];
-    // Store the list for later comparison.
-    if (info.target_subscriptions_by_message_sequence.count(message_seq) == 0) {
-      info.target_subscriptions_by_message_sequence.emplace(
-        message_seq, AllocSet(std::less<uint64_t>(), uint64_allocator));
-    } else {
-      info.target_subscriptions_by_message_sequence[message_seq].clear();
-    }
-    std::copy(
-      destined_subscriptions.begin(), destined_subscriptions.end(),
-      // Memory allocation occurs in info.target_subscriptions_by_message_sequence[message_seq]
-      std::inserter(
-        info.target_subscriptions_by_message_sequence[message_seq],
-        // This ends up only being a hint to std::set, could also be .begin().
-        info.target_subscriptions_by_message_sequence[message_seq].end()
-      )
-    );
+    info.pending[message_seq % info.size].store(
+      lap_tag(info, message_seq) | entry->targets->subscription_mask);
   }
 
   mapped_ring_buffer::MappedRingBufferBase::SharedPtr
@@ -205,74 +279,87 @@ public:
     size_t & size
   )
   {
-    std::lock_guard<std::mutex> lock(runtime_mutex_);
-    PublisherInfo * info;
-    {
-      auto it = publishers_.find(intra_process_publisher_id);
-      if (it == publishers_.end()) {
-        // Publisher is either invalid or no longer exists.
-        return 0;
-      }
-      info = &it->second;
+    ReadGuard guard(*this);
+    auto entry = guard.snapshot->find_publisher(intra_process_publisher_id);
+    if (!entry) {
+      // Publisher is either invalid or no longer exists.
+      return 0;
     }
-    // Figure out how many subscriptions are left.
-    AllocSet * target_subs;
+    auto subscription_it =
+      guard.snapshot->subscription_bits.find(requesting_subscriptions_intra_process_id);
+    if (subscription_it == guard.snapshot->subscription_bits.end() ||
+      subscription_it->second.targets != entry->targets.get())
     {
-      auto it = info->target_subscriptions_by_message_sequence.find(message_sequence_number);
-      if (it == info->target_subscriptions_by_message_sequence.end()) {
-        // Message is no longer being stored by this publisher.
-        return 0;
-      }
-      target_subs = &it->second;
+      // This subscription does not take messages from the manager, or not on this topic.
+      return 0;
     }
-    {
-      auto it = std::find(
-        target_subs->begin(), target_subs->end(),
-        requesting_subscriptions_intra_process_id);
-      if (it == target_subs->end()) {
-        // This publisher id/message seq pair was not intended for this subscription.
+    uint64_t bit = subscription_it->second.bit;
+    PublisherInfo & info = *entry->info;
+    std::atomic<uint64_t> & pending = info.pending[message_sequence_number % info.size];
+    uint64_t tag = lap_tag(info, message_sequence_number);
+    uint64_t expected = pending.load();
+    do {
+      if ((expected & ~pending_bits) != tag || (expected & bit) == 0) {
+        // Message is no longer stored, or not intended for this subscription, or taken already.
         return 0;
       }
-      target_subs->erase(it);
-    }
-    size = target_subs->size();
-    return info->buffer;
+    } while (!pending.compare_exchange_weak(expected, expected & ~bit));
+    size = count_bits(expected & pending_bits & ~bit);
+    return info.buffer;
+  }
+
+  void
+  begin_read() const
+  {
+    readers_.fetch_add(1);
+  }
+
+  void
+  end_read() const
+  {
+    readers_.fetch_sub(1);
+  }
+
+  const IntraProcessTargets *
+  get_targets(uint64_t intra_process_publisher_id) const
+  {
+    auto entry = snapshot_.load()->find_publisher(intra_process_publisher_id);
+    return entry ? entry->targets.get() : nullptr;
   }
 
   bool
   matches_any_publishers(const rmw_gid_t * id) const
   {
-    for (auto & publisher_pair : publishers_) {
-      auto publisher = publisher_pair.second.publisher.lock();
-      if (!publisher) {
-        continue;
-      }
-      if (*publisher.get() == id) {
-        return true;
-      }
+    ReadGuard guard(*this);
+    return guard.snapshot->publisher_gids.count(gid_key(*id)) != 0;
+  }
+
+  bool
+  get_publisher_gid(uint64_t intra_process_publisher_id, rmw_gid_t & gid) const
+  {
+    ReadGuard guard(*this);
+    auto entry = guard.snapshot->find_publisher(intra_process_publisher_id);
+    if (!entry) {
+      return false;
+    }
+    auto publisher = entry->info->publisher.lock();
+    if (!publisher) {
+      return false;
     }
-    return false;
+    gid = publisher->get_gid();
+    return true;
   }
 
   size_t
   get_subscription_count(uint64_t intra_process_publisher_id) const
   {
-    auto publisher_it = publishers_.find(intra_process_publisher_id);
-    if (publisher_it == publishers_.end()) {
+    ReadGuard guard(*this);
+    auto entry = guard.snapshot->find_publisher(intra_process_publisher_id);
+    if (!entry) {
       // Publisher is either invalid or no longer exists.
       return 0;
     }
-    auto publisher = publisher_it->second.publisher.lock();
-    if (!publisher) {
-      throw std::runtime_error("publisher has unexpectedly gone out of scope");
-    }
-    auto sub_map_it =
-      subscription_ids_by_topic_.find(fixed_size_string(publisher->get_topic_name()));
-    if (sub_map_it == subscription_ids_by_topic_.end()) {
-      // No intraprocess subscribers
-      return 0;
-    }
-    return sub_map_it->second.size();
+    return entry->targets->subscription_count;
   }
 
 private:
@@ -300,26 +387,36 @@ private:
     }
   };
 
-  template<typename T>
-  using RebindAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
-
-  RebindAlloc<uint64_t> uint64_allocator;
+  /// The bytes of a gid, which identify a publisher among those of the same rmw implementation.
+  using GidKey = std::array<uint8_t, RMW_GID_STORAGE_SIZE>;
 
-  using AllocSet = std::set<uint64_t, std::less<uint64_t>, RebindAlloc<uint64_t>>;
-  using SubscriptionMap = std::unordered_map<
-    uint64_t, SubscriptionBase::WeakPtr,
-    std::hash<uint64_t>, std::equal_to<uint64_t>,
-    RebindAlloc<std::pair<const uint64_t, SubscriptionBase::WeakPtr>>>;
+  static GidKey
+  gid_key(const rmw_gid_t & gid)
+  {
+    GidKey key;
+    std::memcpy(key.data(), gid.data, key.size());
+    return key;
+  }
 
-  using IDTopicMap = std::map<
-    FixedSizeString,
-    AllocSet,
-    strcmp_wrapper,
-    RebindAlloc<std::pair<const FixedSizeString, AllocSet>>>;
+  /// FNV-1a over the bytes of the gid, of which some vary in every rmw implementation.
+  struct GidHash
+  {
+    size_t
+    operator()(const GidKey & key) const
+    {
+      uint64_t hash = 14695981039346656037ULL;
+      for (uint8_t byte : key) {
+        hash = (hash ^ byte) * 1099511628211ULL;
+      }
+      return static_cast<size_t>(hash);
+    }
+  };
 
-  SubscriptionMap subscriptions_;
+  template<typename T>
+  using RebindAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
 
-  IDTopicMap subscription_ids_by_topic_;
+  /// The low bits of a pending word are the subscriptions, the high bits the lap of the slot.
+  static constexpr uint64_t pending_bits = (uint64_t(1) << max_taking_subscriptions) - 1;
 
   struct PublisherInfo
   {
@@ -328,24 +425,197 @@ private:
     PublisherInfo() = default;
 
     PublisherBase::WeakPtr publisher;
+    FixedSizeString topic;
     std::atomic<uint64_t> sequence_number;
     mapped_ring_buffer::MappedRingBufferBase::SharedPtr buffer;
+    /// The gids the publisher sends with, to the middleware and within the process.
+    GidKey gid;
+    GidKey intra_process_gid;
+    size_t size;
+    /// Per slot: the lap of the message in it, and which subscriptions have yet to take it.
+    std::unique_ptr<std::atomic<uint64_t>[]> pending;
+  };
+
+  static uint64_t
+  lap_tag(const PublisherInfo & info, uint64_t message_seq)
+  {
+    return (message_seq / info.size) << max_taking_subscriptions;
+  }
+
+  static size_t
+  count_bits(uint64_t bits)
+  {
+    size_t count = 0;
+    for (; bits; bits &= bits - 1) {
+      ++count;
+    }
+    return count;
+  }
 
-    using TargetSubscriptionsMap = std::unordered_map<
-      uint64_t, AllocSet,
+  struct PublisherEntry
+  {
+    std::shared_ptr<PublisherInfo> info;
+    std::shared_ptr<const IntraProcessTargets> targets;
+  };
+
+  struct SubscriptionBit
+  {
+    /// The targets of the topic of the subscription, to tell topics apart.
+    const IntraProcessTargets * targets;
+    uint64_t bit;
+  };
+
+  /// Immutable once swapped in.
+  struct Snapshot
+  {
+    const PublisherEntry *
+    find_publisher(uint64_t id) const
+    {
+      auto it = publishers.find(id);
+      return it == publishers.end() ? nullptr : &it->second;
+    }
+
+    std::unordered_map<
+      uint64_t, PublisherEntry,
+      std::hash<uint64_t>, std::equal_to<uint64_t>,
+      RebindAlloc<std::pair<const uint64_t, PublisherEntry>>> publishers;
+    std::unordered_map<
+      uint64_t, SubscriptionBit,
       std::hash<uint64_t>, std::equal_to<uint64_t>,
-      RebindAlloc<std::pair<const uint64_t, AllocSet>>>;
-    TargetSubscriptionsMap target_subscriptions_by_message_sequence;
+      RebindAlloc<std::pair<const uint64_t, SubscriptionBit>>> subscription_bits;
+    /// The gids of all publishers, so that telling messages of this process apart is one lookup.
+    std::unordered_set<GidKey, GidHash, std::equal_to<GidKey>, RebindAlloc<GidKey>> publisher_gids;
   };
 
-  using PublisherMap = std::unordered_map<
-    uint64_t, PublisherInfo,
-    std::hash<uint64_t>, std::equal_to<uint64_t>,
-    RebindAlloc<std::pair<const uint64_t, PublisherInfo>>>;
+  /// Keeps the snapshot it got valid during its lifetime.
+  struct ReadGuard
+  {
+    explicit ReadGuard(const IntraProcessManagerImpl & impl)
+    : impl(impl)
+    {
+      impl.begin_read();
+      snapshot = impl.snapshot_.load();
+    }
 
+    ~ReadGuard()
+    {
+      impl.end_read();
+    }
+
+    const IntraProcessManagerImpl & impl;
+    const Snapshot * snapshot;
+  };
+
+  struct SubscriptionInfo
+  {
+    FixedSizeString topic;
+    std::weak_ptr<SubscriptionIntraProcessBase> waitable;
+    /// Zero for subscriptions with a waitable.
+    uint64_t bit = 0;
+  };
+
+  /// A bit no other subscription on topic without a waitable has. Call with update_mutex_ held.
+  uint64_t
+  allocate_bit(const FixedSizeString & topic) const
+  {
+    uint64_t used = 0;
+    for (auto & subscription_pair : subscriptions_) {
+      if (std::strcmp(subscription_pair.second.topic.data(), topic.data()) == 0) {
+        used |= subscription_pair.second.bit;
+      }
+    }
+    for (size_t i = 0; i < max_taking_subscriptions; ++i) {
+      uint64_t bit = uint64_t(1) << i;
+      if ((used & bit) == 0) {
+        return bit;
+      }
+    }
+    throw std::runtime_error(
+            "too many intra process subscriptions without a waitable on topic " +
+            std::string(topic.data()));
+  }
+
+  /// Stop stored messages on topic from waiting for bit. Call with update_mutex_ held.
+  void
+  clear_bit(const FixedSizeString & topic, uint64_t bit)
+  {
+    if (bit == 0) {
+      return;
+    }
+    for (auto & publisher_pair : publishers_) {
+      PublisherInfo & info = *publisher_pair.second;
+      if (std::strcmp(info.topic.data(), topic.data()) != 0) {
+        continue;
+      }
+      for (size_t i = 0; i < info.size; ++i) {
+        info.pending[i].fetch_and(~bit);
+      }
+    }
+  }
+
+  /// Rebuild the snapshot from the registrations and swap it in. Call with update_mutex_ held.
+  void
+  update_snapshot()
+  {
+    std::unique_ptr<Snapshot> snapshot(new Snapshot());
+    std::map<
+      FixedSizeString, std::shared_ptr<IntraProcessTargets>, strcmp_wrapper,
+      RebindAlloc<std::pair<const FixedSizeString, std::shared_ptr<IntraProcessTargets>>>>
+    targets_by_topic;
+    auto targets_of = [&targets_by_topic](const FixedSizeString & topic) {
+        auto & targets = targets_by_topic[topic];
+        if (!targets) {
+          targets = std::make_shared<IntraProcessTargets>();
+        }
+        return targets;
+      };
+    for (auto & subscription_pair : subscriptions_) {
+      const SubscriptionInfo & info = subscription_pair.second;
+      auto targets = targets_of(info.topic);
+      ++targets->subscription_count;
+      if (info.bit == 0) {
+        auto waitable = info.waitable.lock();
+        if (waitable) {
+          targets->waitables.push_back(waitable);
+        }
+        continue;
+      }
+      targets->subscription_mask |= info.bit;
+      snapshot->subscription_bits[subscription_pair.first] =
+        SubscriptionBit{targets.get(), info.bit};
+    }
+    for (auto & publisher_pair : publishers_) {
+      snapshot->publishers[publisher_pair.first] =
+        PublisherEntry{publisher_pair.second, targets_of(publisher_pair.second->topic)};
+      snapshot->publisher_gids.insert(publisher_pair.second->gid);
+      snapshot->publisher_gids.insert(publisher_pair.second->intra_process_gid);
+    }
+
+    const Snapshot * previous = snapshot_.exchange(snapshot.release());
+    retired_.emplace_back(previous);
+    // Readers that start from now on get the new snapshot, so without readers now, the replaced
+    // ones are not used anymore. Otherwise they are freed by a later update.
+    if (readers_.load() == 0) {
+      retired_.clear();
+    }
+  }
+
+  using SubscriptionMap = std::map<
+    uint64_t, SubscriptionInfo, std::less<uint64_t>,
+    RebindAlloc<std::pair<const uint64_t, SubscriptionInfo>>>;
+
+  using PublisherMap = std::map<
+    uint64_t, std::shared_ptr<PublisherInfo>, std::less<uint64_t>,
+    RebindAlloc<std::pair<const uint64_t, std::shared_ptr<PublisherInfo>>>>;
+
+  /// The registrations, only used with update_mutex_ held.
+  SubscriptionMap subscriptions_;
   PublisherMap publishers_;
+  std::vector<std::unique_ptr<const Snapshot>> retired_;
+  std::mutex update_mutex_;
 
-  std::mutex runtime_mutex_;
+  std::atomic<const Snapshot *> snapshot_;
+  mutable std::atomic<size_t> readers_;
 };
 
 RCLCPP_PUBLIC
@@ -0,0 +1,162 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__INTRA_PROCESS_QUEUE_HPP_
+#define RCLCPP__INTRA_PROCESS_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "rclcpp/macros.hpp"
+
+namespace rclcpp
+{
+
+/// Bounded lock-free queue of messages, for any number of producers and consumers.
+/**
+ * Each slot carries a sequence number that tells producers and consumers whose turn it is, so a
+ * push or a pop is a compare-and-swap on the position plus a store to the slot, without a lock
+ * and without allocating (D. Vyukov's bounded MPMC queue). Publishers of any thread push, the
+ * executor threads pop.
+ *
+ * The capacity is the requested one rounded up to a power of two. Neither push nor pop ever
+ * blocks: try_push() fails when full, try_pop() when empty, and the caller decides what to drop.
+ */
+template<typename T>
+class IntraProcessQueue
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS_NOT_COPYABLE(IntraProcessQueue<T>)
+
+  /// Create a queue that holds at least capacity elements.
+  explicit IntraProcessQueue(size_t capacity)
+  : mask_(round_up_to_power_of_two(capacity) - 1),
+    cells_(new Cell[mask_ + 1]),
+    enqueue_position_(0),
+    dequeue_position_(0)
+  {
+    for (size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /// Move value into the queue, unless it is full: then value is left alone.
+  bool
+  try_push(T && value)
+  {
+    Cell * cell;
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    for (;; ) {
+      cell = &cells_[position & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+      if (difference == 0) {
+        if (enqueue_position_.compare_exchange_weak(
+            position, position + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = enqueue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Move the oldest element into value, unless the queue is empty.
+  bool
+  try_pop(T & value)
+  {
+    Cell * cell;
+    size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    for (;; ) {
+      cell = &cells_[position & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+      if (difference == 0) {
+        if (dequeue_position_.compare_exchange_weak(
+            position, position + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = dequeue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->value);
+    // Leave nothing behind in the slot: a message must not outlive its last consumer.
+    cell->value = T();
+    cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Whether the queue was empty at some point during the call.
+  bool
+  empty() const
+  {
+    size_t position = dequeue_position_.load(std::memory_order_acquire);
+    return cells_[position & mask_].sequence.load(std::memory_order_acquire) != position + 1;
+  }
+
+  size_t
+  capacity() const
+  {
+    return mask_ + 1;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t
+  round_up_to_power_of_two(size_t capacity)
+  {
+    if (capacity == 0) {
+      throw std::invalid_argument("capacity must be a positive, non-zero value");
+    }
+    size_t rounded = 2;
+    while (rounded < capacity) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+  // Producers and consumers write different positions: keep them on different cache lines,
+  // without over-aligning the queue itself.
+  static constexpr size_t cache_line_size = 64;
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  char padding_before_enqueue_[cache_line_size];
+  std::atomic<size_t> enqueue_position_;
+  char padding_before_dequeue_[cache_line_size - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeue_position_;
+  char padding_after_dequeue_[cache_line_size - sizeof(std::atomic<size_t>)];
+};
+
+}  // namespace rclcpp
+
+#endif  // RCLCPP__INTRA_PROCESS_QUEUE_HPP_
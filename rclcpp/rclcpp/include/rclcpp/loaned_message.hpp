@@ -0,0 +1,88 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__LOANED_MESSAGE_HPP_
+#define RCLCPP__LOANED_MESSAGE_HPP_
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace rclcpp
+{
+
+/// A message borrowed from a publisher, to be filled in place and published.
+/**
+ * Obtained with Publisher::borrow_loaned_message() and handed back with
+ * Publisher::publish(LoanedMessage &&). The storage is owned by the publisher: a loan that is
+ * destroyed without being published simply returns it.
+ *
+ * Loans can be moved but not copied, there is only ever one writer.
+ */
+template<typename MessageT, typename AllocatorT = std::allocator<void>>
+class LoanedMessage
+{
+public:
+  /// Take over the storage of a message, done by the publisher.
+  explicit LoanedMessage(std::shared_ptr<MessageT> message)
+  : message_(std::move(message))
+  {}
+
+  LoanedMessage(LoanedMessage && other) = default;
+
+  LoanedMessage &
+  operator=(LoanedMessage && other) = default;
+
+  LoanedMessage(const LoanedMessage &) = delete;
+
+  LoanedMessage &
+  operator=(const LoanedMessage &) = delete;
+
+  /// Whether the loan still holds a message, that is, it was neither published nor moved from.
+  bool
+  is_valid() const
+  {
+    return static_cast<bool>(message_);
+  }
+
+  /// The message to fill.
+  /**
+   * \throws std::runtime_error if the loan is not valid.
+   */
+  MessageT &
+  get() const
+  {
+    if (!message_) {
+      throw std::runtime_error("loaned message is not valid");
+    }
+    return *message_;
+  }
+
+  /// Give up the loan, leaving it invalid.
+  /**
+   * \return The message, which returns to the publisher with its last owner.
+   */
+  std::shared_ptr<MessageT>
+  release()
+  {
+    return std::move(message_);
+  }
+
+private:
+  std::shared_ptr<MessageT> message_;
+};
+
+}  // namespace rclcpp
+
+#endif  // RCLCPP__LOANED_MESSAGE_HPP_
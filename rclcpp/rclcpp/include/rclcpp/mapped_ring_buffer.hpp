@@ -15,12 +15,12 @@
 #ifndef RCLCPP__MAPPED_RING_BUFFER_HPP_
 #define RCLCPP__MAPPED_RING_BUFFER_HPP_
 
-#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
-#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -47,14 +47,20 @@ public:
  * This class cannot be resized nor can it reserve additional space after construction.
  * This class is not CopyConstructable nor CopyAssignable.
  *
- * The key's are not guaranteed to be unique because push_and_replace does not
- * check for colliding keys.
- * It is up to the user to only use unique keys.
- * A side effect of this is that when get_copy_at_key or pop_at_key are called,
- * they return the first encountered instance of the key.
- * But iteration does not begin with the ring buffer's head, and therefore
- * there is no guarantee on which value is returned if a key is used multiple
- * times.
+ * A key is stored in the slot key modulo the size, so finding it is a single look up, and keys
+ * that follow each other, like the sequence numbers of the messages of a publisher, fill the
+ * buffer in order. Pushing a key displaces what the slot held, whatever its key: a key pushed
+ * twice only keeps the last value.
+ *
+ * Each slot holds a shared_ptr snapshot of its value, which is only ever swapped as a whole
+ * (std::atomic_load and friends), and a version that is odd while a push changes the key and the
+ * value. Readers take a reference to the snapshot and copy from it without staying in the slot,
+ * and pop takes the value out with a compare and swap. So a push never waits for a reader or a
+ * pop, only for another push into the same slot, which is a full lap behind unless several
+ * threads publish at once. Readers only retry while a push is swapping the pointers.
+ * Depending on the standard library, the pointer swaps may take a short internal lock, but no
+ * one holds it while copying a message.
+ * The allocator may be used from several threads at once to copy values.
  */
 template<typename T, typename Alloc = std::allocator<void>>
 class MappedRingBuffer : public MappedRingBufferBase
@@ -76,7 +82,7 @@ public:
    * \param allocator optional custom allocator
    */
   explicit MappedRingBuffer(size_t size, std::shared_ptr<Alloc> allocator = nullptr)
-  : elements_(size), head_(0)
+  : elements_(size)
   {
     if (size == 0) {
       throw std::invalid_argument("size must be a positive, non-zero value");
@@ -92,11 +98,9 @@ public:
 
   /// Return a copy of the value stored in the ring buffer at the given key.
   /**
-   * The key is matched if an element in the ring buffer has a matching key.
+   * The key is matched if the slot of the key holds it.
    * This method will allocate in order to return a copy.
    *
-   * The key is not guaranteed to be unique, see the class docs for more.
-   *
    * The contents of value before the method is called are discarded.
    *
    * \param key the key associated with the stored value
@@ -105,35 +109,19 @@ public:
   void
   get(uint64_t key, ElemUniquePtr & value)
   {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    auto it = get_iterator_of_key(key);
     value = nullptr;
-    if (it != elements_.end() && it->in_use) {
-      if (it->unique_value) {
-        ElemDeleter deleter = it->unique_value.get_deleter();
-        auto ptr = ElemAllocTraits::allocate(*allocator_.get(), 1);
-        ElemAllocTraits::construct(*allocator_.get(), ptr, *it->unique_value);
-        value = ElemUniquePtr(ptr, deleter);
-      } else if (it->shared_value) {
-        ElemDeleter * deleter = std::get_deleter<ElemDeleter, const T>(it->shared_value);
-        auto ptr = ElemAllocTraits::allocate(*allocator_.get(), 1);
-        ElemAllocTraits::construct(*allocator_.get(), ptr, *it->shared_value);
-        if (deleter) {
-          value = ElemUniquePtr(ptr, *deleter);
-        } else {
-          value = ElemUniquePtr(ptr);
-        }
-      } else {
-        throw std::runtime_error("Unexpected empty MappedRingBuffer element.");
-      }
+    ConstElemSharedPtr shared_value = load(element_of_key(key), key);
+    if (shared_value) {
+      // The snapshot keeps the value alive and unchanged: copy it without keeping the slot.
+      value = copy(*shared_value, deleter_of(shared_value));
     }
   }
 
   /// Share ownership of the value stored in the ring buffer at the given key.
   /**
-   * The key is matched if an element in the ring buffer has a matching key.
-   *
-   * The key is not guaranteed to be unique, see the class docs for more.
+   * The key is matched if the slot of the key holds it.
+   * A value that was pushed as a unique_ptr is shared from then on: a pop with the unique_ptr
+   * signature copies it, as long as the shared ownership lasts.
    *
    * The contents of value before the method is called are discarded.
    *
@@ -143,32 +131,16 @@ public:
   void
   get(uint64_t key, ConstElemSharedPtr & value)
   {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    auto it = get_iterator_of_key(key);
-    value.reset();
-    if (it != elements_.end() && it->in_use) {
-      if (!it->shared_value) {
-        // The stored unique_ptr is upgraded to a shared_ptr here.
-        // All the remaining get and pop calls done with unique_ptr
-        // signature will receive a copy.
-        if (!it->unique_value) {
-          throw std::runtime_error("Unexpected empty MappedRingBuffer element.");
-        }
-        it->shared_value = std::move(it->unique_value);
-      }
-      value = it->shared_value;
-    }
+    value = load(element_of_key(key), key);
   }
 
   /// Give the ownership of the stored value to the caller if possible, or copy and release.
   /**
-   * The key is matched if an element in the ring buffer has a matching key.
+   * The key is matched if the slot of the key holds it.
    * This method may allocate in order to return a copy.
    *
-   * If the stored value is a shared_ptr, it is not possible to downgrade it to a unique_ptr.
-   * In that case, a copy is returned and the stored value is released.
-   *
-   * The key is not guaranteed to be unique, see the class docs for more.
+   * A value that was pushed as a shared_ptr, or that is still shared with a reader, can not be
+   * downgraded to a unique_ptr. In that case, a copy is returned and the stored value is released.
    *
    * The contents of value before the method is called are discarded.
    *
@@ -178,34 +150,26 @@ public:
   void
   pop(uint64_t key, ElemUniquePtr & value)
   {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    auto it = get_iterator_of_key(key);
     value = nullptr;
-    if (it != elements_.end() && it->in_use) {
-      if (it->unique_value) {
-        value = std::move(it->unique_value);
-      } else if (it->shared_value) {
-        auto ptr = ElemAllocTraits::allocate(*allocator_.get(), 1);
-        ElemAllocTraits::construct(*allocator_.get(), ptr, *it->shared_value);
-        auto deleter = std::get_deleter<ElemDeleter, const T>(it->shared_value);
-        if (deleter) {
-          value = ElemUniquePtr(ptr, *deleter);
-        } else {
-          value = ElemUniquePtr(ptr);
-        }
-        it->shared_value.reset();
-      } else {
-        throw std::runtime_error("Unexpected empty MappedRingBuffer element.");
-      }
-      it->in_use = false;
+    ConstElemSharedPtr shared_value = take(element_of_key(key), key);
+    if (!shared_value) {
+      return;
+    }
+    auto slot_deleter = std::get_deleter<SlotDeleter>(shared_value);
+    // Out of the slot, nobody gets a new reference to it: the count only goes down.
+    if (slot_deleter && shared_value.use_count() == 1) {
+      // Pairs with the release of the last reader's reference, its copy is done.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      slot_deleter->released = true;
+      value = ElemUniquePtr(const_cast<T *>(shared_value.get()), slot_deleter->deleter);
+      return;
     }
+    value = copy(*shared_value, deleter_of(shared_value));
   }
 
   /// Give the ownership of the stored value to the caller, at the given key.
   /**
-   * The key is matched if an element in the ring buffer has a matching key.
-   *
-   * The key is not guaranteed to be unique, see the class docs for more.
+   * The key is matched if the slot of the key holds it.
    *
    * The contents of value before the method is called are discarded.
    *
@@ -215,72 +179,47 @@ public:
   void
   pop(uint64_t key, ConstElemSharedPtr & value)
   {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    auto it = get_iterator_of_key(key);
-    if (it != elements_.end() && it->in_use) {
-      if (it->shared_value) {
-        value = std::move(it->shared_value);
-      } else if (it->unique_value) {
-        value = std::move(it->unique_value);
-      } else {
-        throw std::runtime_error("Unexpected empty MappedRingBuffer element.");
-      }
-      it->in_use = false;
-    }
+    value = take(element_of_key(key), key);
   }
 
-  /// Insert a key-value pair, displacing an existing pair if necessary.
+  /// Insert a key-value pair, displacing the pair in the slot of the key if any.
   /**
-   * The key's uniqueness is not checked on insertion.
-   * It is up to the user to ensure the key is unique.
-   * This method should not allocate memory.
-   *
-   * After insertion the value will be a nullptr.
-   * If a pair were replaced, its smart pointer is reset.
+   * This method does not allocate memory.
+   * A displaced value is released once the slot is left.
    *
    * \param key the key associated with the value to be stored
-   * \param value the value to store, and optionally the value displaced
+   * \param value the value to store
+   * \return whether a pair was displaced
    */
   bool
   push_and_replace(uint64_t key, ConstElemSharedPtr value)
   {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    bool did_replace = elements_[head_].in_use;
-    Element & element = elements_[head_];
-    element.key = key;
-    element.unique_value.reset();
-    element.shared_value.reset();
-    element.shared_value = value;
-    element.in_use = true;
-    head_ = (head_ + 1) % elements_.size();
-    return did_replace;
+    return replace(key, std::move(value));
   }
 
-  /// Insert a key-value pair, displacing an existing pair if necessary.
+  /// Insert a key-value pair, displacing the pair in the slot of the key if any.
   /**
    * See `bool push_and_replace(uint64_t key, const ConstElemSharedPtr & value)`.
+   * The slot shares the value, so this allocates its shared ownership, with the allocator of the
+   * buffer. A pop with the unique_ptr signature gives the value back without copying it.
    */
   bool
   push_and_replace(uint64_t key, ElemUniquePtr value)
   {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    bool did_replace = elements_[head_].in_use;
-    Element & element = elements_[head_];
-    element.key = key;
-    element.unique_value.reset();
-    element.shared_value.reset();
-    element.unique_value = std::move(value);
-    element.in_use = true;
-    head_ = (head_ + 1) % elements_.size();
-    return did_replace;
+    if (!value) {
+      return replace(key, ConstElemSharedPtr());
+    }
+    SlotDeleter slot_deleter(value.get_deleter());
+    // Deletes the value when it throws.
+    ConstElemSharedPtr shared_value(value.release(), slot_deleter, *allocator_.get());
+    return replace(key, std::move(shared_value));
   }
 
   /// Return true if the key is found in the ring buffer, otherwise false.
   bool
   has_key(uint64_t key)
   {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    return elements_.end() != get_iterator_of_key(key);
+    return static_cast<bool>(load(element_of_key(key), key));
   }
 
 private:
@@ -288,29 +227,123 @@ private:
 
   struct Element
   {
-    uint64_t key;
-    ElemUniquePtr unique_value;
-    ConstElemSharedPtr shared_value;
-    bool in_use;
+    /// Odd while a push changes key and value.
+    std::atomic<uint64_t> version {0};
+    std::atomic<uint64_t> key {0};
+    /// Only accessed with the std::atomic_* functions for shared_ptr. Empty if the slot is free.
+    ConstElemSharedPtr value;
   };
 
-  using VectorAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Element>;
+  /// Deleter of the values pushed as unique_ptr, which pop can give back as unique_ptr.
+  struct SlotDeleter
+  {
+    explicit SlotDeleter(const ElemDeleter & deleter)
+    : deleter(deleter) {}
+
+    void
+    operator()(const T * value)
+    {
+      if (!released) {
+        deleter(const_cast<T *>(value));
+      }
+    }
+
+    ElemDeleter deleter;
+    bool released = false;
+  };
 
-  typename std::vector<Element, VectorAlloc>::iterator
-  get_iterator_of_key(uint64_t key)
+  Element &
+  element_of_key(uint64_t key)
   {
-    auto it = std::find_if(
-      elements_.begin(), elements_.end(),
-      [key](Element & e) -> bool {
-        return e.key == key && e.in_use;
-      });
-    return it;
+    return elements_[key % elements_.size()];
   }
 
+  /// The value in the slot if it holds key, without keeping the slot.
+  static ConstElemSharedPtr
+  load(const Element & element, uint64_t key)
+  {
+    for (;; ) {
+      uint64_t version = element.version.load(std::memory_order_acquire);
+      if (version & 1) {
+        // A push is swapping the pointers.
+        std::this_thread::yield();
+        continue;
+      }
+      uint64_t stored_key = element.key.load(std::memory_order_relaxed);
+      ConstElemSharedPtr value = std::atomic_load(&element.value);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (element.version.load(std::memory_order_relaxed) == version) {
+        return stored_key == key ? value : ConstElemSharedPtr();
+      }
+    }
+  }
+
+  /// Take the value out of the slot if it holds key. Does not wait for pushes.
+  static ConstElemSharedPtr
+  take(Element & element, uint64_t key)
+  {
+    ConstElemSharedPtr value = load(element, key);
+    // Fails if a push displaced it meanwhile, or another pop took it.
+    if (!value ||
+      !std::atomic_compare_exchange_strong(&element.value, &value, ConstElemSharedPtr()))
+    {
+      return ConstElemSharedPtr();
+    }
+    return value;
+  }
+
+  /// Store key and value in their slot. \return whether it held a value.
+  bool
+  replace(uint64_t key, ConstElemSharedPtr value)
+  {
+    Element & element = element_of_key(key);
+    uint64_t version = element.version.load(std::memory_order_relaxed);
+    for (;; ) {
+      if (version & 1) {
+        // Another push into this slot.
+        std::this_thread::yield();
+        version = element.version.load(std::memory_order_relaxed);
+      } else if (element.version.compare_exchange_weak(
+          version, version + 1, std::memory_order_acquire, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    // Readers that see the new key or value also see the odd version.
+    std::atomic_thread_fence(std::memory_order_release);
+    element.key.store(key, std::memory_order_relaxed);
+    // Released when this returns, after the slot has been left.
+    ConstElemSharedPtr displaced = std::atomic_exchange(&element.value, std::move(value));
+    element.version.store(version + 2, std::memory_order_release);
+    return static_cast<bool>(displaced);
+  }
+
+  /// The deleter that a copy of value gets, so that it uses the same allocator.
+  static const ElemDeleter *
+  deleter_of(const ConstElemSharedPtr & value)
+  {
+    auto slot_deleter = std::get_deleter<SlotDeleter>(value);
+    if (slot_deleter) {
+      return &slot_deleter->deleter;
+    }
+    return std::get_deleter<ElemDeleter, const T>(value);
+  }
+
+  ElemUniquePtr
+  copy(const T & value, const ElemDeleter * deleter)
+  {
+    auto ptr = ElemAllocTraits::allocate(*allocator_.get(), 1);
+    ElemAllocTraits::construct(*allocator_.get(), ptr, value);
+    if (deleter) {
+      return ElemUniquePtr(ptr, *deleter);
+    }
+    return ElemUniquePtr(ptr);
+  }
+
+  using VectorAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Element>;
+
   std::vector<Element, VectorAlloc> elements_;
-  size_t head_;
   std::shared_ptr<ElemAlloc> allocator_;
-  std::mutex data_mutex_;
 };
 
 }  // namespace mapped_ring_buffer
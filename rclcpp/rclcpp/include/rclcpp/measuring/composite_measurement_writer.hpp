@@ -0,0 +1,126 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__COMPOSITE_MEASUREMENT_WRITER_HPP_
+#define RCLCPP__COMPOSITE_MEASUREMENT_WRITER_HPP_
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "rclcpp/measuring/measurement_writer_interface.hpp"
+#include "rclcpp/measuring/message_tracker_host_info.hpp"
+#include "rclcpp/measuring/message_tracker_options.hpp"
+
+namespace rclcpp {
+
+/// What a route filter gets to see: the raw values that were passed to the writer, before any backend formatted anything.
+struct MeasurementRecord {
+    enum class Kind : uint8_t {
+        LATENCY,
+        ARRIVAL,
+        ACTIVATION_JITTER,
+        REALTIME_VIOLATIONS
+    };
+
+    Kind kind;
+    const std::string * measurement_class;
+    const MessageTrackingVariables * message; // LATENCY and ARRIVAL only, nullptr otherwise.
+    int64_t value;        // LATENCY: arrival - send time (ns). ACTIVATION_JITTER: the jitter (ns). REALTIME_VIOLATIONS: allocations.
+    int64_t second_value; // REALTIME_VIOLATIONS: lock waits.
+};
+
+using MeasurementFilter = std::function<bool(const MeasurementRecord &)>;
+
+/// Creates a backend writer for each composite writer, like MeasurementWriterFactory does for the enum values.
+using MeasurementWriterMaker = std::function<IMeasurementWriter::UniquePtr(const MessageTrackerHostInfo &)>;
+
+/// One backend of the composite writer, and which records it gets.
+struct MeasurementRoute {
+    MeasurementRoute(MeasurementWriterEnum backend_option, std::vector<std::string> classes = {}, MeasurementFilter record_filter = nullptr)
+        : backend(backend_option)
+        , measurement_classes(std::move(classes))
+        , filter(std::move(record_filter))
+    {}
+
+    /// A backend that is not one of the MeasurementWriterEnum values, e.g. a writer of the application.
+    MeasurementRoute(MeasurementWriterMaker backend_maker, std::vector<std::string> classes = {}, MeasurementFilter record_filter = nullptr)
+        : backend(MeasurementWriterEnum::NONE)
+        , make_backend(std::move(backend_maker))
+        , measurement_classes(std::move(classes))
+        , filter(std::move(record_filter))
+    {}
+
+    MeasurementWriterEnum backend;
+    MeasurementWriterMaker make_backend;          // Used instead of backend when set.
+    std::vector<std::string> measurement_classes; // e.g. "message_latency". Empty means all of them.
+    MeasurementFilter filter;                     // Empty means every record passes.
+
+    /// Passes latencies above the threshold, and all records that are not latencies.
+    static MeasurementFilter latency_above(std::chrono::nanoseconds threshold);
+};
+
+/**
+ * Fans every record out to several writers, e.g. everything to a local file and only the slow messages to InfluxDB.
+ *
+ * Each route gets its own backend writer. A measurement class is only registered at the backends whose route wants it,
+ * so unrouted classes cost nothing there (no empty files, no series). Filters run before the backend is called, so a dropped record is never formatted.
+ *
+ * The routes are process-wide and are read when a writer is created: call set_routes() before creating the nodes that use MeasurementWriterEnum::COMPOSITE.
+ */
+class CompositeMeasurementWriter : public IMeasurementWriter {
+public:
+    CompositeMeasurementWriter() = delete;
+    /// Uses the routes of set_routes().
+    CompositeMeasurementWriter(const rclcpp::MessageTrackerHostInfo & host_info);
+    CompositeMeasurementWriter(const rclcpp::MessageTrackerHostInfo & host_info, const std::vector<MeasurementRoute> & routes);
+
+    static void set_routes(std::vector<MeasurementRoute> routes);
+    static std::vector<MeasurementRoute> get_routes();
+
+    uint32_t register_measurement_class(const std::string& name, const std::vector<std::string>& columns = {}) override;
+
+    void record_latency(uint32_t key, const MessageTrackingVariables& meas, const hex_char_array_t& publisher, int64_t arrival_time) override;
+
+    void record_arrival(uint32_t key, const MessageTrackingVariables& meas, const hex_char_array_t& publisher) override;
+
+    void record_activation_jitter(uint32_t key, int64_t activation_jitter) override;
+
+    void record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) override;
+
+private:
+    struct Backend {
+        IMeasurementWriter::UniquePtr writer;
+        std::vector<std::string> measurement_classes;
+        MeasurementFilter filter;
+    };
+
+    // A backend that registered a measurement class, with the key it gave it.
+    struct Target {
+        size_t backend;
+        uint32_t key;
+    };
+
+    template<typename RecordFunction>
+    void fan_out(uint32_t key, const MeasurementRecord & record, RecordFunction && record_function);
+
+    std::vector<Backend> backends_;
+    std::vector<std::string> measurement_classes_;
+    std::vector<std::vector<Target>> targets_; // by our key
+};
+
+} // namespace rclcpp
+
+#endif // RCLCPP__COMPOSITE_MEASUREMENT_WRITER_HPP_
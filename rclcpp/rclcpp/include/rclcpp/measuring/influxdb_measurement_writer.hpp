@@ -41,6 +41,8 @@ public:
 
     void record_activation_jitter(uint32_t, int64_t) override;
 
+    void record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) override;
+
 private:
 
     void maybe_upload(influxdb_cpp::detail::ts_caller& uploadable);
@@ -26,6 +26,8 @@
 #include "rclcpp/measuring/dummy_measurement_writer.hpp"
 #include "rclcpp/measuring/print_measurement_writer.hpp"
 #include "rclcpp/measuring/file_measurement_writer.hpp"
+#include "rclcpp/measuring/prometheus_measurement_writer.hpp"
+#include "rclcpp/measuring/measurement_writer_factory.hpp"
 
 #include "rclcpp/macros.hpp"
 #include "rclcpp/measuring/jitter_tracker_options.hpp"
@@ -40,7 +42,7 @@ struct JitterTrackerFactory {
 
     static JitterTrackerFactory::UniquePtr make(JitterTrackerEnum jte);
 
-    // Note: this is duplicated from message_tracker_factory. Writer should gets its own factory if more of these factories get made.
+    // Fakes the host information a writer wants from the timer options, then defers to MeasurementWriterFactory.
     rclcpp::IMeasurementWriter::UniquePtr create_result_writer(MeasurementWriterEnum mwe, const TimerOptions& opts) const;
 };
 
@@ -19,6 +19,9 @@
 #include <chrono>
 #include "rclcpp/macros.hpp"
 #include "rclcpp/measuring/measurement_writer_interface.hpp"
+#include "rclcpp/measuring/measuring_clock.hpp"
+#include "rclcpp/measuring/realtime_violation_counter.hpp"
+#include "rclcpp/measuring/realtime_violation_recorder.hpp"
 #include "rclcpp/clock.hpp"
 
 namespace rclcpp {
@@ -34,13 +37,20 @@ public:
 
     virtual void track_jitter(const Clock::SharedPtr& clock, int64_t time_since_last_activate, int64_t intended_activation_time) = 0;
 
+    /// Same as IMessageTracker::track_realtime_violations, for timer callbacks.
+    void track_realtime_violations(const RealtimeViolationCounts & counts) {
+        realtime_violations_.record(*writer_, counts);
+    }
+
 protected:
     inline int64_t get_unix_time_64b_ns() {
-        auto now = std::chrono::system_clock::now(); // before C++20 this is implementation defined..
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        return MeasuringClock::unix_now();
     }
 
     rclcpp::IMeasurementWriter::UniquePtr writer_;
+
+private:
+    RealtimeViolationRecorder realtime_violations_;
 };
 
 } // namespace rclcpp
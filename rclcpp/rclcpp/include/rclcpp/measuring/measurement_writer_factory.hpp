@@ -0,0 +1,31 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__MEASUREMENT_WRITER_FACTORY_HPP_
+#define RCLCPP__MEASUREMENT_WRITER_FACTORY_HPP_
+
+#include "rclcpp/measuring/measurement_writer_interface.hpp"
+#include "rclcpp/measuring/message_tracker_host_info.hpp"
+#include "rclcpp/measuring/message_tracker_options.hpp"
+
+namespace rclcpp {
+
+// The one place that maps a MeasurementWriterEnum to a writer. Used by the tracker factories and by the composite writer for its backends.
+struct MeasurementWriterFactory {
+    static rclcpp::IMeasurementWriter::UniquePtr create(MeasurementWriterEnum mwe, const MessageTrackerHostInfo & host_information);
+};
+
+} // namespace rclcpp
+
+#endif // RCLCPP__MEASUREMENT_WRITER_FACTORY_HPP_
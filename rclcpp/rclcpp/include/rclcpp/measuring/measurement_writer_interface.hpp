@@ -39,6 +39,9 @@ public:
 
     virtual void record_activation_jitter(uint32_t key, int64_t activation_jitter) = 0;
 
+    /// Heap allocations and contended lock waits that happened during a single callback execution. Only called when there was at least one.
+    virtual void record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) = 0;
+
     // Useful for keeping consistent timestamping when writing multiple measurements in sequence.
     inline void use_timestamp(int64_t timestamp) { output_timestamp_ = timestamp; }
 
@@ -0,0 +1,69 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__MEASURING_CLOCK_HPP_
+#define RCLCPP__MEASURING_CLOCK_HPP_
+
+#include <chrono>
+#include <cstdint>
+
+namespace rclcpp {
+
+/// One event, both time bases.
+struct MeasuringTimestamp {
+    int64_t monotonic_ns; // what goes on the wire / into latency computations.
+    int64_t unix_ns;      // what writers use to timestamp a measurement.
+};
+
+/**
+ * The clock all trackers share.
+ *
+ * Every event costs a single monotonic clock read. Unix time is derived from it by adding an offset,
+ * which is re-measured (monotonic, realtime, monotonic; keep the tightest of a few samples) once the last calibration is older than the recalibration period.
+ * Recalibration is done by whichever thread notices first, the others keep using the old offset instead of waiting.
+ *
+ * Monotonic time is CLOCK_MONOTONIC (std::chrono::steady_clock), which is served by the vDSO on Linux.
+ * It is deliberately not CLOCK_MONOTONIC_RAW or the TSC: publisher stamps must stay comparable between processes and with rcl's steady time,
+ * which the activation jitter tracker compares against.
+ */
+class MeasuringClock {
+public:
+    MeasuringClock() = delete;
+
+    /// One clock read, converted to both time bases.
+    static MeasuringTimestamp now();
+
+    /// Only the monotonic part of now(). For stamping messages.
+    static int64_t monotonic_now();
+
+    /// Unix time of the current moment, derived. Still a single clock read.
+    static int64_t unix_now();
+
+    /// Convert a monotonic timestamp (taken on this host) to unix time with the current offset.
+    static int64_t to_unix(int64_t monotonic_ns);
+
+    /// Measure the monotonic->unix offset right now, e.g. after the system time was stepped.
+    static void recalibrate();
+
+    /// Default is one second. NTP slews are slow enough that this keeps the derived unix time well within a microsecond.
+    static void set_recalibration_period(std::chrono::nanoseconds period);
+
+private:
+    static int64_t read_monotonic();
+    static void maybe_recalibrate(int64_t monotonic_ns);
+};
+
+} // namespace rclcpp
+
+#endif // RCLCPP__MEASURING_CLOCK_HPP_
@@ -28,6 +28,8 @@
 #include "rclcpp/measuring/print_measurement_writer.hpp"
 #include "rclcpp/measuring/file_measurement_writer.hpp"
 #include "rclcpp/measuring/influxdb_measurement_writer.hpp"
+#include "rclcpp/measuring/prometheus_measurement_writer.hpp"
+#include "rclcpp/measuring/measurement_writer_factory.hpp"
 
 #include "rclcpp/macros.hpp"
 #include "rclcpp/measuring/message_tracker_options.hpp"
@@ -19,7 +19,10 @@
 #include <chrono>
 #include "rclcpp/macros.hpp"
 #include "rclcpp/measuring/measurement_writer_interface.hpp"
+#include "rclcpp/measuring/measuring_clock.hpp"
 #include "rclcpp/measuring/message_tracking_variables.hpp"
+#include "rclcpp/measuring/realtime_violation_counter.hpp"
+#include "rclcpp/measuring/realtime_violation_recorder.hpp"
 
 using std::chrono::duration_cast;
 using std::chrono::steady_clock;
@@ -37,8 +40,17 @@ public:
     IMessageTracker() = delete;
     IMessageTracker(rclcpp::IMeasurementWriter::UniquePtr writer) : writer_(std::move(writer)) {}
 
-    /// Gather metrics on the provided message. The metrics that are gathered vary by implementation of the interface, e.g. metrics for publishers, metrics for subscribers.
-    virtual void track_message(const MessageTrackingVariables & msg) = 0;
+    /// Gather metrics on the provided message. The metrics that are gathered vary by implementation of the interface, e.g. metrics for subscribers.
+    /// Publisher trackers gather nothing here, they stamp instead (see stamp_message).
+    virtual void track_message(const MessageTrackingVariables &) {}
+
+    /// Write the hidden variables into a message about to be published. Only meaningful for publisher trackers, the others leave it untouched.
+    /// The publisher calls this once per message, while it is still the only one holding it, so every receiver (intra or inter process) sees the same stamps and nobody reads them while they are written.
+    virtual void stamp_message(MessageTrackingVariables &) {}
+
+    /// Same as track_message, for a message that arrived earlier than its tracking variables did (see out_of_band_tracking.hpp).
+    /// Only meaningful for subscriber trackers, the others ignore it.
+    virtual void track_late_arrival(const MessageTrackingVariables &, const MeasuringTimestamp &) {}
 
     template <typename MessageT>
     void track_message(const MessageT & msg) {
@@ -79,19 +91,36 @@ public:
         }
     }
 
+    /// Same reinterpret_cast trick as track_message above, on a message the publisher may write to.
+    template <typename MessageT>
+    void stamp_message(MessageT & msg) {
+        constexpr bool is_tracked_message = HasRequiredFields<MessageT>::value;
+
+        if (is_tracked_message) {
+            stamp_message(* reinterpret_cast<MessageTrackingVariables *>(& msg));
+        }
+    }
+
+    /// Record what the executor counted while running this entity's callback. Clean executions are not written at all.
+    void track_realtime_violations(const RealtimeViolationCounts & counts) {
+        realtime_violations_.record(*writer_, counts);
+    }
+
 protected:
  // todo: if the number of utility functions gets too large, it should instead be separately inherited object so derived classes pick and choose.
+    // Both go through the shared MeasuringClock. When you need both for one event, use MeasuringClock::now() directly: that is one read instead of two.
     inline int64_t get_monotonic_time_64b_ns() {
-        auto now = steady_clock::now();
-        return duration_cast<nanoseconds>(now.time_since_epoch()).count();
+        return MeasuringClock::monotonic_now();
     }
 
     inline int64_t get_unix_time_64b_ns() {
-        auto now = system_clock::now(); // before C++20 this is implementation defined..
-        return duration_cast<nanoseconds>(now.time_since_epoch()).count();
+        return MeasuringClock::unix_now();
     }
 
     rclcpp::IMeasurementWriter::UniquePtr writer_;
+
+private:
+    RealtimeViolationRecorder realtime_violations_;
 };
 
 } // namespace rclcpp
@@ -32,7 +32,9 @@ enum class MeasurementWriterEnum : uint8_t {
     INFLUXDB,
     FILE,
     PRINT,
-    NONE
+    NONE,
+    PROMETHEUS,
+    COMPOSITE
 };
 
 // The enum class gets converted to an int to enter a C library, and converting it back is handled here.
@@ -42,6 +44,8 @@ inline MeasurementWriterEnum intToMWE(uint8_t x) {
         case static_cast<uint8_t>(MeasurementWriterEnum::FILE): return MeasurementWriterEnum::FILE;
         case static_cast<uint8_t>(MeasurementWriterEnum::PRINT): return MeasurementWriterEnum::PRINT;
         case static_cast<uint8_t>(MeasurementWriterEnum::NONE): return MeasurementWriterEnum::NONE;
+        case static_cast<uint8_t>(MeasurementWriterEnum::PROMETHEUS): return MeasurementWriterEnum::PROMETHEUS;
+        case static_cast<uint8_t>(MeasurementWriterEnum::COMPOSITE): return MeasurementWriterEnum::COMPOSITE;
         default: throw std::invalid_argument("Unknown input for intToMWE: " + std::to_string(x));
     }
 }
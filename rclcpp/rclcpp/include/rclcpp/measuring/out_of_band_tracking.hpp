@@ -0,0 +1,107 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__OUT_OF_BAND_TRACKING_HPP_
+#define RCLCPP__OUT_OF_BAND_TRACKING_HPP_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "rcl/publisher.h"
+#include "rcl/subscription.h"
+#include "rmw/types.h"
+
+#include "rclcpp/macros.hpp"
+#include "rclcpp/measuring/measuring_clock.hpp"
+#include "rclcpp/measuring/message_tracker_interface.hpp"
+#include "rclcpp/measuring/message_tracking_variables.hpp"
+
+// Tracking for message types that were built without the vandenhoven_* fields (see PMROS2_UNTRACKED_INTERFACES in rosidl_adapter/parser.py).
+//
+// For those, the publisher sends the tracking variables on a hidden side channel '{topic}/_pmros2_tracking',
+// one sample per data message, right before the data message reaches any subscription, within the process or not.
+// The sample rides on rcl_interfaces/IntraProcessMessage: its vandenhoven_* fields carry the variables,
+// publisher_id carries a key derived from the data publisher's gid and message_sequence counts the data messages.
+// This is also why rcl_interfaces can never be opted out of field injection.
+//
+// The subscriber pairs samples with data arrivals per publisher (the gid is in rmw_message_info_t).
+// DDS gives no ordering between two topics, so pairing is by time:
+// an arrival gets the newest sample that was stamped before it, older unmatched samples are dropped (their data message was lost, or arrived before we matched).
+// Across hosts the monotonic stamps are not comparable, so there it degrades to first-in-first-out.
+// Intra process deliveries pair the same way, the subscription passes the key of the publisher, as the message info has no gid for them.
+// Non-PMROS2 peers never see the side channel and are not affected by it.
+
+namespace rclcpp {
+
+/// Name of the side channel belonging to a (fully qualified, remapped) data topic.
+std::string get_out_of_band_tracking_topic(const std::string & data_topic);
+
+/// Key that both ends can compute for a data publisher.
+uint32_t hash_publisher_gid(const rmw_gid_t & gid);
+
+class OutOfBandTrackingPublisher {
+public:
+    RCLCPP_SMART_PTR_DEFINITIONS(OutOfBandTrackingPublisher)
+
+    /// Uses the topic name, QoS and gid of the data publisher it tracks for.
+    OutOfBandTrackingPublisher(std::shared_ptr<rcl_node_t> node_handle, const rcl_publisher_t * data_publisher, const rmw_gid_t & data_publisher_gid);
+    ~OutOfBandTrackingPublisher();
+
+    /// Publish the tracking variables of the data message that is about to be published.
+    void publish(const MessageTrackingVariables & vars);
+
+    /// hash_publisher_gid() of the data publisher, which its samples are sent with.
+    uint32_t get_publisher_key() const { return publisher_key_; }
+
+private:
+    std::shared_ptr<rcl_node_t> node_handle_;
+    rcl_publisher_t publisher_;
+    uint32_t publisher_key_;
+    uint64_t sequence_ = 0;
+};
+
+class OutOfBandTrackingSubscriber {
+public:
+    RCLCPP_SMART_PTR_DEFINITIONS(OutOfBandTrackingSubscriber)
+
+    OutOfBandTrackingSubscriber(std::shared_ptr<rcl_node_t> node_handle, const rcl_subscription_t * data_subscription, size_t max_pending = 64);
+    ~OutOfBandTrackingSubscriber();
+
+    /// Call for every data message. Pairs whatever can be paired and hands it to the tracker.
+    void track_arrival(IMessageTracker & tracker, const rmw_message_info_t & data_message_info);
+
+    /// Same, for a data message delivered within the process, by the publisher with this key (see OutOfBandTrackingPublisher::get_publisher_key).
+    void track_arrival(IMessageTracker & tracker, uint32_t publisher_key);
+
+private:
+    struct PendingPublisher {
+        std::deque<MessageTrackingVariables> samples;
+        std::deque<MeasuringTimestamp> arrivals;
+    };
+
+    // non-blocking: takes everything that is waiting on the side channel.
+    void drain();
+    void pair(IMessageTracker & tracker, PendingPublisher & pending);
+
+    std::shared_ptr<rcl_node_t> node_handle_;
+    rcl_subscription_t subscription_;
+    size_t max_pending_;
+    std::unordered_map<uint32_t, PendingPublisher> pending_;
+};
+
+} // namespace rclcpp
+
+#endif // RCLCPP__OUT_OF_BAND_TRACKING_HPP_
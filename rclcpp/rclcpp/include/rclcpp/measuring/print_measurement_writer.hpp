@@ -28,6 +28,8 @@ public:
     void record_arrival(uint32_t key, const MessageTrackingVariables& meas, const hex_char_array_t& publisher) override;
 
     void record_activation_jitter(uint32_t, int64_t) override;
+
+    void record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) override;
 private:
     std::vector<std::string> measurement_classes_;
 };
@@ -0,0 +1,181 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__PROMETHEUS_MEASUREMENT_WRITER_HPP_
+#define RCLCPP__PROMETHEUS_MEASUREMENT_WRITER_HPP_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "rclcpp/measuring/measurement_writer_interface.hpp"
+#include "rclcpp/measuring/message_tracker_host_info.hpp"
+
+namespace rclcpp {
+
+enum class PrometheusMetricType : uint8_t {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+/**
+ * One labelled time series, e.g. the latency histogram of one publisher on one topic.
+ *
+ * Counters and histograms are split into shards, each on its own cache line(s). A thread always writes the same shard,
+ * so recording is a couple of relaxed atomic adds without any cache line ping-pong between executor threads.
+ * Scraping sums the shards. Gauges are a single atomic, the last write wins anyway.
+ */
+class PrometheusSeries {
+public:
+    RCLCPP_SMART_PTR_DEFINITIONS(PrometheusSeries)
+
+    static constexpr size_t shard_count = 8;
+
+    // Upper bounds of the histogram buckets in nanoseconds. Latencies and jitter of a ROS system on one or a few hosts, 10us to 1s.
+    static const std::vector<int64_t> & bucket_bounds_ns();
+
+    PrometheusSeries(PrometheusMetricType type, std::string labels);
+    ~PrometheusSeries();
+
+    PrometheusSeries(const PrometheusSeries &) = delete;
+    PrometheusSeries & operator=(const PrometheusSeries &) = delete;
+
+    void add(uint64_t amount);            // counter
+    void set(int64_t value);              // gauge
+    void observe_ns(int64_t value_ns);    // histogram, exported in seconds.
+
+    // Appends the sample lines of this series in the text exposition format.
+    void render(std::string & out, const std::string & name) const;
+
+private:
+    struct Shard;
+    Shard & local_shard();
+    const Shard & shard(size_t i) const;
+
+    PrometheusMetricType type_;
+    std::string labels_; // already formatted, 'a="x",b="y"'
+    std::atomic<int64_t> gauge_;
+    std::unique_ptr<char[]> shard_storage_; // over-allocated to align the shards, operator new does not do that for us before C++17.
+    char * shards_;
+    size_t shard_stride_;
+};
+
+/**
+ * Process-wide collection of all series, and the HTTP endpoint that serves them.
+ *
+ * The endpoint is a single background thread answering 'GET /metrics' one connection at a time, which is plenty for a Prometheus scraper.
+ * Nothing on the recording path ever touches the network or the registry lock, only series creation (once per label set) and scrapes do.
+ */
+class PrometheusRegistry {
+public:
+    static PrometheusRegistry & instance();
+
+    ~PrometheusRegistry();
+
+    /// Start serving on address:port, port 0 picks a free one. Does nothing if already serving. Returns whether it is serving.
+    bool start(const std::string & address, uint16_t port);
+
+    /**
+     * Start serving where the environment says, what the writers do. Only the first call tries, later ones return whether that worked.
+     * PMROS2_PROMETHEUS_ADDRESS defaults to 127.0.0.1, PMROS2_PROMETHEUS_PORT to 9469.
+     * When the port is taken, e.g. by another process on the host, a free one is picked instead. The port served on is logged.
+     */
+    bool start_from_environment();
+
+    /// Stop serving. Aggregated values are kept.
+    void stop();
+
+    /// The port actually being served on, 0 when not serving.
+    uint16_t port() const { return port_.load(); }
+
+    /// Get or create a series. The pointer stays valid for the lifetime of the registry.
+    PrometheusSeries * series(PrometheusMetricType type, const std::string & name, const std::string & help, const std::string & labels);
+
+    /// Everything, in the Prometheus text exposition format (version 0.0.4).
+    std::string render() const;
+
+private:
+    PrometheusRegistry() = default;
+
+    void serve();
+    void answer(int client_fd) const;
+
+    struct Family {
+        PrometheusMetricType type;
+        std::string help;
+        std::map<std::string, PrometheusSeries::UniquePtr> series; // by labels
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_; // ordered, so scrapes come out in a stable order.
+
+    std::mutex server_mutex_;
+    std::once_flag started_from_environment_;
+    std::thread server_thread_;
+    std::atomic<bool> serving_{false};
+    std::atomic<uint16_t> port_{0};
+    int listen_fd_ = -1;
+};
+
+/**
+ * Aggregates measurements in-process, for a Prometheus server to scrape. Per measurement class (e.g. 'message_latency'):
+ *  - record_latency: histogram pmros2_{class}_seconds and gauge pmros2_{class}_last_seconds, per publisher.
+ *  - record_arrival: counter pmros2_{class}_total, per publisher.
+ *  - record_activation_jitter: histogram pmros2_{class}_seconds.
+ *  - record_realtime_violations: counters pmros2_{class}_allocations_total and pmros2_{class}_lock_waits_total.
+ * All carry the topic and node as labels. Measurement timestamps are not used, Prometheus stamps at scrape time.
+ */
+class PrometheusMeasurementWriter : public IMeasurementWriter {
+public:
+    PrometheusMeasurementWriter() = delete;
+    PrometheusMeasurementWriter(const rclcpp::MessageTrackerHostInfo & host_info);
+
+    uint32_t register_measurement_class(const std::string& name, const std::vector<std::string>& columns = {}) override;
+
+    void record_latency(uint32_t key, const MessageTrackingVariables& meas, const hex_char_array_t& publisher, int64_t arrival_time) override;
+
+    void record_arrival(uint32_t key, const MessageTrackingVariables& meas, const hex_char_array_t& publisher) override;
+
+    void record_activation_jitter(uint32_t key, int64_t activation_jitter) override;
+
+    void record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) override;
+
+private:
+    // Series are looked up in the registry once, and cached here. Publishers show up over time, so those are looked up on first sight.
+    struct SeriesPair {
+        PrometheusSeries * first = nullptr;
+        PrometheusSeries * second = nullptr;
+    };
+
+    struct MeasurementClass {
+        std::string metric_name; // 'pmros2_{class}'
+        SeriesPair host_series;
+        std::unordered_map<uint32_t, SeriesPair> publisher_series;
+    };
+
+    std::string labels_with_publisher(const hex_char_array_t & publisher) const;
+
+    std::string host_labels_;
+    std::vector<MeasurementClass> measurement_classes_;
+};
+
+} // namespace rclcpp
+
+#endif // RCLCPP__PROMETHEUS_MEASUREMENT_WRITER_HPP_
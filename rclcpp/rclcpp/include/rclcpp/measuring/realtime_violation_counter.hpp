@@ -0,0 +1,113 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__REALTIME_VIOLATION_COUNTER_HPP_
+#define RCLCPP__REALTIME_VIOLATION_COUNTER_HPP_
+
+#include <cstdint>
+#include <mutex>
+
+namespace rclcpp {
+
+/// Things a real-time callback should not do, counted while it was executing.
+struct RealtimeViolationCounts {
+    uint64_t allocations = 0;
+    uint64_t lock_waits = 0;
+
+    inline bool any() const { return allocations > 0 || lock_waits > 0; }
+};
+
+/**
+ * Per-thread counters for heap allocations and contended mutex acquisitions.
+ * Nothing is counted unless a RealtimeViolationScope is alive on the calling thread,
+ * so the hooks cost a thread-local increment at most and nothing at all outside of a scope.
+ *
+ * Allocations are only counted when rclcpp is built with PMROS2_COUNT_ALLOCATIONS=ON,
+ * which compiles in the malloc / operator new hooks (see realtime_allocation_hooks.cpp).
+ * Without it, allocations always read 0 and only lock waits are reported.
+ */
+class RealtimeViolationCounter {
+public:
+    /// Called from the allocation hooks.
+    static void count_allocation();
+
+    /// Called whenever a lock taken through lock_counting_contention() had to wait.
+    static void count_lock_wait();
+
+    /// Whether a scope is active on this thread.
+    static bool is_counting();
+
+    /// Whether the allocation hooks got compiled in, i.e. whether allocation counts mean anything.
+    static bool counts_allocations();
+
+    /// Hand counts over to the next scope opened on this thread.
+    // Used when the waiting happens before it is known which entity will be executed (e.g. the multithreaded executor's wait_mutex_).
+    static void carry_over(const RealtimeViolationCounts & counts);
+
+private:
+    friend class RealtimeViolationScope;
+
+    static void enter();
+    static void leave();
+    static RealtimeViolationCounts totals();
+    static RealtimeViolationCounts take_carried_over();
+};
+
+/// RAII counting window. Inactive (and free) when constructed with enabled == false.
+class RealtimeViolationScope {
+public:
+    explicit RealtimeViolationScope(bool enabled = true);
+    ~RealtimeViolationScope();
+
+    RealtimeViolationScope(const RealtimeViolationScope &) = delete;
+    RealtimeViolationScope & operator=(const RealtimeViolationScope &) = delete;
+
+    /// Violations counted since the scope was opened, including anything carried over into it.
+    RealtimeViolationCounts counts() const;
+
+private:
+    bool enabled_;
+    RealtimeViolationCounts start_;
+    RealtimeViolationCounts carried_;
+};
+
+/// RAII gap in the counting window of this thread, for the framework's own work within it.
+// Taking the message, tracking its arrival and recording the measurements are not the
+// callback's doing.
+class RealtimeViolationPause {
+public:
+    RealtimeViolationPause();
+    ~RealtimeViolationPause();
+
+    RealtimeViolationPause(const RealtimeViolationPause &) = delete;
+    RealtimeViolationPause & operator=(const RealtimeViolationPause &) = delete;
+
+private:
+    uint32_t depth_;
+};
+
+/// Drop-in for std::unique_lock / std::lock_guard that counts it when the mutex was already held by someone else.
+template<typename MutexT>
+inline std::unique_lock<MutexT> lock_counting_contention(MutexT & mutex) {
+    std::unique_lock<MutexT> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        RealtimeViolationCounter::count_lock_wait();
+        lock.lock();
+    }
+    return lock;
+}
+
+} // namespace rclcpp
+
+#endif // RCLCPP__REALTIME_VIOLATION_COUNTER_HPP_
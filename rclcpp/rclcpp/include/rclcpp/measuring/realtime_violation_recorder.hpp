@@ -0,0 +1,52 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__REALTIME_VIOLATION_RECORDER_HPP_
+#define RCLCPP__REALTIME_VIOLATION_RECORDER_HPP_
+
+#include <cstdint>
+#include "rclcpp/measuring/measurement_writer_interface.hpp"
+#include "rclcpp/measuring/measuring_clock.hpp"
+#include "rclcpp/measuring/realtime_violation_counter.hpp"
+
+namespace rclcpp {
+
+/// Writes what the executor counted while running an entity's callback.
+// Shared by the message and the jitter trackers.
+class RealtimeViolationRecorder {
+public:
+    /// Clean executions are not written at all.
+    void record(IMeasurementWriter & writer, const RealtimeViolationCounts & counts) {
+        if (!counts.any()) {
+            return;
+        }
+        // registered on first use, so the writer does not open a file (etc.) for every entity
+        // that behaves.
+        if (!registered_) {
+            key_ = writer.register_measurement_class(
+                "realtime_violations", {"allocations", "lock_waits"});
+            registered_ = true;
+        }
+        writer.use_timestamp(MeasuringClock::unix_now());
+        writer.record_realtime_violations(key_, counts.allocations, counts.lock_waits);
+    }
+
+private:
+    bool registered_ = false;
+    uint32_t key_ = 0;
+};
+
+} // namespace rclcpp
+
+#endif // RCLCPP__REALTIME_VIOLATION_RECORDER_HPP_
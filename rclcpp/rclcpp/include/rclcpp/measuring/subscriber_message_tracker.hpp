@@ -30,6 +30,9 @@ public:
     /// Gathers metrics on a message that just got received.
     void track_message(const MessageTrackingVariables &) override;
 
+    /// Gathers metrics on a message that was received at 'arrival'.
+    void track_late_arrival(const MessageTrackingVariables &, const MeasuringTimestamp & arrival) override;
+
 private:
     uint32_t latencyKey_;
     uint32_t arrivalKey_;
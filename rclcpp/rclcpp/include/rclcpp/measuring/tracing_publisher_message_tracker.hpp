@@ -15,6 +15,7 @@
 #ifndef RCLCPP_TRACING_PUBLISHER_MESSAGE_TRACKER_HPP_
 #define RCLCPP_TRACING_PUBLISHER_MESSAGE_TRACKER_HPP_
 
+#include <atomic>
 #include <memory>
 #include "rclcpp/measuring/message_tracker_interface.hpp"
 #include "rclcpp/measuring/measurement_writer_interface.hpp"
@@ -28,10 +29,10 @@ public:
 
     TracingPublisherMessageTracker(rclcpp::IMeasurementWriter::UniquePtr writer, uint32_t host_hash) : IMessageTracker(std::move(writer)), host_hash_(host_hash) {}
 
-    /// Gather metrics on a message that just got published.
-    void track_message(const MessageTrackingVariables &) override;
+    /// Stamp a message that is about to be published. Thread-safe, publishing from several threads still gives unique ids.
+    void stamp_message(MessageTrackingVariables &) override;
 private:
-    int64_t current_msg_id = 1;
+    std::atomic<int64_t> current_msg_id{1};
     uint32_t host_hash_;
 };
 
@@ -84,6 +84,15 @@ public:
     rclcpp::executor::AnyExecutable & any_exec,
     const WeakNodeList & weak_nodes) = 0;
 
+  /// Find a ready timer whose callback group can be taken from.
+  /**
+   * The default asks every timer of every node whether it is ready.
+   */
+  virtual void
+  get_next_timer(
+    rclcpp::executor::AnyExecutable & any_exec,
+    const WeakNodeList & weak_nodes);
+
   virtual rcl_allocator_t
   get_allocator() = 0;
 
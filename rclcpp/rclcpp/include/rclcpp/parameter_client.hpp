@@ -29,6 +29,7 @@
 #include "rcl_interfaces/srv/list_parameters.hpp"
 #include "rcl_interfaces/srv/set_parameters.hpp"
 #include "rcl_interfaces/srv/set_parameters_atomically.hpp"
+#include "rclcpp/async_result.hpp"
 #include "rclcpp/executors.hpp"
 #include "rclcpp/create_subscription.hpp"
 #include "rclcpp/macros.hpp"
@@ -129,6 +130,31 @@ public:
       void(std::shared_future<rcl_interfaces::msg::ListParametersResult>)
     > callback = nullptr);
 
+  /// Like get_parameters(), but chain continuations onto the result, see AsyncResult.
+  /**
+   * Continuations run on the executor that spins the node of this client, when it handles the
+   * response. Same for the other async_* methods.
+   */
+  RCLCPP_PUBLIC
+  AsyncResult<std::vector<rclcpp::Parameter>>
+  async_get_parameters(const std::vector<std::string> & names);
+
+  RCLCPP_PUBLIC
+  AsyncResult<std::vector<rclcpp::ParameterType>>
+  async_get_parameter_types(const std::vector<std::string> & names);
+
+  RCLCPP_PUBLIC
+  AsyncResult<std::vector<rcl_interfaces::msg::SetParametersResult>>
+  async_set_parameters(const std::vector<rclcpp::Parameter> & parameters);
+
+  RCLCPP_PUBLIC
+  AsyncResult<rcl_interfaces::msg::SetParametersResult>
+  async_set_parameters_atomically(const std::vector<rclcpp::Parameter> & parameters);
+
+  RCLCPP_PUBLIC
+  AsyncResult<rcl_interfaces::msg::ListParametersResult>
+  async_list_parameters(const std::vector<std::string> & prefixes, uint64_t depth);
+
   template<
     typename CallbackT,
     typename AllocatorT = std::allocator<void>>
@@ -210,6 +236,11 @@ private:
   std::string remote_node_name_;
 };
 
+/// Parameters client that blocks until the response is there, spinning an executor meanwhile.
+/**
+ * To not block, nor spin from within a callback, use the async_* methods of
+ * AsyncParametersClient instead.
+ */
 class SyncParametersClient
 {
 public:
@@ -18,9 +18,11 @@
 #include <rmw/error_handling.h>
 #include <rmw/rmw.h>
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -30,11 +32,16 @@
 
 #include "rcl_interfaces/msg/intra_process_message.hpp"
 
+#include "rosidl_generator_cpp/traits.hpp"
+
 #include "rclcpp/allocator/allocator_common.hpp"
 #include "rclcpp/allocator/allocator_deleter.hpp"
 #include "rclcpp/intra_process_manager.hpp"
+#include "rclcpp/loaned_message.hpp"
 #include "rclcpp/macros.hpp"
 #include "rclcpp/publisher_base.hpp"
+#include "rclcpp/strategies/dynamic_message_pool_memory_strategy.hpp"
+#include "rclcpp/subscription_intra_process.hpp"
 #include "rclcpp/type_support_decl.hpp"
 #include "rclcpp/visibility_control.hpp"
 
@@ -69,6 +76,12 @@ public:
   {
     allocator::set_allocator_for_deleter(&message_deleter_, message_allocator_.get());
 
+    if (!HasRequiredFields<MessageT>::value) {
+      // built without the vandenhoven_* fields (opted out in rosidl_adapter), track on the side
+      // channel instead.
+      this->setup_out_of_band_tracking();
+    }
+
     if (event_callbacks.deadline_callback) {
       this->add_event_handler(event_callbacks.deadline_callback,
         RCL_PUBLISHER_OFFERED_DEADLINE_MISSED);
@@ -99,32 +112,127 @@ public:
   virtual void
   publish(std::unique_ptr<MessageT, MessageDeleter> msg)
   {
+    if (!msg) {
+      throw std::runtime_error("cannot publish msg which is a null pointer");
+    }
+    // Stamped once, before any subscription can see it, intra or inter process.
+    message_tracker_->stamp_message(*msg);
+    this->publish_out_of_band_tracking();
     if (!intra_process_is_enabled_) {
-      this->do_inter_process_publish(msg.get());
+      this->publish_to_middleware(msg.get());
       return;
     }
-    // If an interprocess subscription exist, then the unique_ptr is promoted
-    // to a shared_ptr and published.
-    // This allows doing the intraprocess publish first and then doing the
-    // interprocess publish, resulting in lower publish-to-subscribe latency.
-    // It's not possible to do that with an unique_ptr,
-    // as do_intra_process_publish takes the ownership of the message.
-    uint64_t message_seq;
+
+    // Subscriptions with a waitable get the message pushed to their queue directly. Others take
+    // it from the intra process manager, once notified through the middleware.
+    auto ipm = weak_ipm_.lock();
+    if (!ipm) {
+      throw std::runtime_error(
+              "intra process publish called after destruction of intra process manager");
+    }
+    auto targets_reader = ipm->get_intra_process_targets(intra_process_publisher_id_);
+    const intra_process_manager::IntraProcessTargets * targets = targets_reader.get();
+    if (!targets) {
+      throw std::runtime_error("intra process publish called with invalid publisher id");
+    }
+    const auto & waitables = targets->waitables;
+    bool other_subscriptions = targets->subscription_mask != 0;
     bool inter_process_publish_needed =
       get_subscription_count() > get_intra_process_subscription_count();
-    MessageSharedPtr shared_msg;
-    if (inter_process_publish_needed) {
-      shared_msg = std::move(msg);
-      message_seq =
-        store_intra_process_message(intra_process_publisher_id_, shared_msg);
-    } else {
-      message_seq =
-        store_intra_process_message(intra_process_publisher_id_, std::move(msg));
-    }
-    this->do_intra_process_publish(message_seq);
-    if (inter_process_publish_needed) {
-      this->do_inter_process_publish(shared_msg.get());
+
+    if (waitables.empty() && !inter_process_publish_needed) {
+      if (other_subscriptions) {
+        uint64_t message_seq =
+          store_intra_process_message(intra_process_publisher_id_, std::move(msg));
+        this->do_intra_process_publish(message_seq);
+      }
+      return;
+    }
+    if (waitables.size() == 1 && !other_subscriptions && !inter_process_publish_needed) {
+      using SubscriptionIntraProcessT = SubscriptionIntraProcess<MessageT, Alloc>;
+      auto subscription = dynamic_cast<SubscriptionIntraProcessT *>(waitables.front().get());
+      if (subscription) {
+        // The only receiver gets the message itself, without a copy.
+        subscription->push(std::move(msg), this->get_out_of_band_tracking_key());
+        return;
+      }
     }
+    // Otherwise the unique_ptr is promoted to a shared_ptr, which all receivers share.
+    this->publish_shared(std::move(msg), *targets, inter_process_publish_needed);
+  }
+
+  /// Borrow a message to fill in place, then publish with publish(LoanedMessage &&).
+  /**
+   * Messages of a fixed size come from a pool of the publisher, see reserve_loaned_messages(),
+   * others are allocated with the allocator of the publisher. A message taken from the pool
+   * still holds what it was last published with.
+   *
+   * Publishing a loan copies nothing: intra process subscriptions share the storage of the
+   * message, and the middleware, or the shared memory transport, serializes from it.
+   * \return The loan, which returns the message when destroyed unpublished.
+   */
+  LoanedMessage<MessageT, Alloc>
+  borrow_loaned_message()
+  {
+    if (!rosidl_generator_traits::has_fixed_size<MessageT>::value) {
+      auto ptr = MessageAllocTraits::allocate(*message_allocator_.get(), 1);
+      MessageAllocTraits::construct(*message_allocator_.get(), ptr);
+      return LoanedMessage<MessageT, Alloc>(
+        std::shared_ptr<MessageT>(ptr, message_deleter_, *message_allocator_.get()));
+    }
+    this->reserve_loaned_messages(std::max<size_t>(this->get_queue_size(), 1) + 1);
+    return LoanedMessage<MessageT, Alloc>(loaned_message_pool_->borrow_message());
+  }
+
+  /// Preallocate this many loaned messages of a fixed size type.
+  /**
+   * By default the pool is allocated on the first loan, one message larger than the history
+   * depth. Calling this before publishing avoids that allocation and sets the size, which has no
+   * effect once the pool exists. Once all messages are in use, loans are allocated one by one.
+   */
+  void
+  reserve_loaned_messages(size_t count)
+  {
+    std::call_once(loaned_message_pool_created_, [this, count]() {
+      using strategies::message_pool_memory_strategy::PoolGrowthPolicy;
+      loaned_message_pool_ = std::make_shared<LoanedMessagePool>(
+        std::max<size_t>(count, 1), PoolGrowthPolicy::HeapFallback, 0, message_allocator_);
+    });
+  }
+
+  /// Publish a message borrowed from this publisher, invalidating the loan.
+  /**
+   * \param[in] loaned_msg The loan from borrow_loaned_message().
+   * \throws std::runtime_error if the loan is not valid.
+   */
+  void
+  publish(LoanedMessage<MessageT, Alloc> && loaned_msg)
+  {
+    if (!loaned_msg.is_valid()) {
+      throw std::runtime_error("cannot publish a loaned message which is not valid");
+    }
+    message_tracker_->stamp_message(loaned_msg.get());
+    this->publish_out_of_band_tracking();
+    MessageSharedPtr msg = loaned_msg.release();
+    if (!intra_process_is_enabled_) {
+      this->publish_to_middleware(msg.get());
+      return;
+    }
+
+    auto ipm = weak_ipm_.lock();
+    if (!ipm) {
+      throw std::runtime_error(
+              "intra process publish called after destruction of intra process manager");
+    }
+    auto targets_reader = ipm->get_intra_process_targets(intra_process_publisher_id_);
+    const intra_process_manager::IntraProcessTargets * targets = targets_reader.get();
+    if (!targets) {
+      throw std::runtime_error("intra process publish called with invalid publisher id");
+    }
+    // The storage stays with the publisher, so receivers always share it.
+    this->publish_shared(
+      std::move(msg), *targets,
+      get_subscription_count() > get_intra_process_subscription_count());
   }
 
 // Skip deprecated attribute in windows, as it raise a warning in template specialization.
@@ -139,6 +247,30 @@ public:
     publish(*msg);
   }
 
+  /// Send a message to the topic for this publisher, stamping its hidden variables in place.
+  /**
+   * Without intra process the message is not copied, so no other thread may read msg meanwhile.
+   * With intra process it is copied, as a const message is.
+   * \param[in] msg The message to send.
+   */
+  virtual void
+  publish(MessageT & msg)
+  {
+    if (!intra_process_is_enabled_) {
+      message_tracker_->stamp_message(msg);
+      this->publish_out_of_band_tracking();
+      return this->publish_to_middleware(&msg);
+    }
+    this->publish(static_cast<const MessageT &>(msg));
+  }
+
+  /// Send a message to the topic for this publisher.
+  /**
+   * msg is not written to. If its type has hidden variables, they are stamped in a copy, which
+   * is made anyway with intra process. Publish a non-const message, a unique_ptr or a loaned
+   * message to avoid the copy.
+   * \param[in] msg The message to send.
+   */
   virtual void
   publish(const MessageT & msg)
   {
@@ -204,10 +336,79 @@ public:
   }
 
 protected:
+  /// Publish a const message that the caller keeps, see publish(const MessageT &).
   void
   do_inter_process_publish(const MessageT * msg)
   {
-    message_tracker_->track_message(* msg);
+    if (!HasRequiredFields<MessageT>::value) {
+      // Nothing to stamp in the message, its variables go to the side channel.
+      this->publish_out_of_band_tracking();
+      publish_to_middleware(msg);
+      return;
+    }
+    // The caller may still read msg, so it is stamped in a copy.
+    auto ptr = MessageAllocTraits::allocate(*message_allocator_.get(), 1);
+    MessageAllocTraits::construct(*message_allocator_.get(), ptr, *msg);
+    MessageUniquePtr stamped_msg(ptr, message_deleter_);
+    message_tracker_->stamp_message(*stamped_msg);
+    publish_to_middleware(stamped_msg.get());
+  }
+
+  /// Hand a stamped message to the intra process subscriptions and, if needed, the middleware.
+  /**
+   * The intra process publish is done first, resulting in lower publish-to-subscribe latency.
+   */
+  void
+  publish_shared(
+    MessageSharedPtr shared_msg,
+    const intra_process_manager::IntraProcessTargets & targets,
+    bool inter_process_publish_needed)
+  {
+    uint32_t out_of_band_tracking_key = this->get_out_of_band_tracking_key();
+    for (auto & waitable : targets.waitables) {
+      auto buffer = dynamic_cast<SubscriptionIntraProcessBuffer<MessageT> *>(waitable.get());
+      if (buffer) {
+        buffer->push(shared_msg, out_of_band_tracking_key);
+      }
+    }
+    if (targets.subscription_mask != 0) {
+      uint64_t message_seq = store_intra_process_message(intra_process_publisher_id_, shared_msg);
+      this->do_intra_process_publish(message_seq);
+    }
+    if (inter_process_publish_needed) {
+      this->publish_to_middleware(shared_msg.get());
+    }
+  }
+
+  /// For message types without tracking variables, send them for the message being published.
+  /**
+   * Called once per message, before it reaches any subscription, so that the variables usually
+   * are there already when the message arrives, be it within the process or not.
+   */
+  void
+  publish_out_of_band_tracking()
+  {
+    if (out_of_band_tracking_) {
+      MessageTrackingVariables tracking_variables{};
+      message_tracker_->stamp_message(tracking_variables);
+      out_of_band_tracking_->publish(tracking_variables);
+    }
+  }
+
+  /// The key intra process subscriptions pair out of band tracking variables with, or 0.
+  uint32_t
+  get_out_of_band_tracking_key() const
+  {
+    return out_of_band_tracking_ ? out_of_band_tracking_->get_publisher_key() : 0;
+  }
+
+  /// Publish a message that has been stamped already.
+  void
+  publish_to_middleware(const MessageT * msg)
+  {
+    if (this->publish_to_shared_memory(msg)) {
+      return;
+    }
     auto status = rcl_publish(&publisher_handle_, msg, nullptr);
     if (RCL_RET_PUBLISHER_INVALID == status) {
       rcl_reset_error();  // next call will reset error message if not context
@@ -231,6 +432,9 @@ protected:
       // TODO(Karsten1987): support serialized message passed by intraprocess
       throw std::runtime_error("storing serialized messages in intra process is not supported yet");
     }
+    if (this->publish_to_shared_memory(*serialized_msg)) {
+      return;
+    }
     auto status = rcl_publish_serialized_message(&publisher_handle_, serialized_msg, nullptr);
     if (RCL_RET_OK != status) {
       rclcpp::exceptions::throw_from_rcl_error(status, "failed to publish serialized message");
@@ -298,6 +502,13 @@ protected:
   std::shared_ptr<MessageAlloc> message_allocator_;
 
   MessageDeleter message_deleter_;
+
+  using LoanedMessagePool =
+    strategies::message_pool_memory_strategy::DynamicMessagePoolMemoryStrategy<
+    MessageT, MessageAlloc>;
+
+  std::once_flag loaned_message_pool_created_;
+  std::shared_ptr<LoanedMessagePool> loaned_message_pool_;
 };
 
 }  // namespace rclcpp
@@ -33,6 +33,8 @@
 #include "rclcpp/type_support_decl.hpp"
 #include "rclcpp/visibility_control.hpp"
 #include "rclcpp/measuring/message_tracker_interface.hpp"
+#include "rclcpp/measuring/out_of_band_tracking.hpp"
+#include "rclcpp/shared_memory_transport.hpp"
 
 namespace rclcpp
 {
@@ -196,7 +198,35 @@ public:
     IntraProcessManagerSharedPtr ipm,
     const rcl_publisher_options_t & intra_process_options);
 
+  /// Implementation utility function used to setup the shared memory transport after creation.
+  /**
+   * \param[in] options The options of the transport.
+   * \param[in] type_support The type support of the published messages, to serialize them.
+   */
+  RCLCPP_PUBLIC
+  void
+  setup_shared_memory_transport(
+    const SharedMemoryTransportOptions & options,
+    const rosidl_message_type_support_t & type_support);
+
 protected:
+  /// Send tracking variables on the side channel, for message types built without them.
+  /** Does nothing if this publisher has no message tracker. */
+  RCLCPP_PUBLIC
+  void
+  setup_out_of_band_tracking();
+
+  /// Publish through shared memory, if enabled and all subscriptions are on this host.
+  /** \return false if the message should be published through the middleware instead. */
+  RCLCPP_PUBLIC
+  bool
+  publish_to_shared_memory(const void * msg);
+
+  /// Same for a serialized message.
+  RCLCPP_PUBLIC
+  bool
+  publish_to_shared_memory(const rcl_serialized_message_t & serialized_msg);
+
   template<typename EventCallbackT>
   void
   add_event_handler(
@@ -228,6 +258,9 @@ protected:
   rmw_gid_t intra_process_rmw_gid_;
 
   rclcpp::IMessageTracker::UniquePtr message_tracker_;
+  bool message_tracking_enabled_;
+  rclcpp::OutOfBandTrackingPublisher::UniquePtr out_of_band_tracking_;
+  rclcpp::SharedMemoryPublisher::UniquePtr shared_memory_;
 };
 
 }  // namespace rclcpp
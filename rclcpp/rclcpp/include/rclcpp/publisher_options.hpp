@@ -24,6 +24,7 @@
 #include "rclcpp/intra_process_setting.hpp"
 #include "rclcpp/qos.hpp"
 #include "rclcpp/qos_event.hpp"
+#include "rclcpp/shared_memory_transport_options.hpp"
 #include "rclcpp/visibility_control.hpp"
 #include "rcl/publisher.h"
 
@@ -42,6 +43,9 @@ struct PublisherOptionsBase
   /// Callback group in which the waitable items from the publisher should be placed.
   rclcpp::callback_group::CallbackGroup::SharedPtr callback_group;
 
+  /// Publish large messages through shared memory to the subscriptions on the same host.
+  SharedMemoryTransportOptions shared_memory_transport;
+
   // Setting to explicitly set tracking behavior of published messages.
   MessageTrackerOptions message_tracker_opts = MessageTrackerOptions(
     rclcpp::MessageTrackerEnum::PUBLISHER,
@@ -63,6 +67,16 @@ struct PublisherOptionsWithAllocator : public PublisherOptionsBase
   : PublisherOptionsBase(publisher_options_base)
   {}
 
+  /// Get the allocator, creating one if needed.
+  std::shared_ptr<Allocator>
+  get_allocator() const
+  {
+    if (!allocator) {
+      return std::make_shared<Allocator>();
+    }
+    return allocator;
+  }
+
   /// Convert this class, and a rclcpp::QoS, into an rcl_publisher_options_t.
   template<typename MessageT>
   rcl_publisher_options_t
@@ -71,7 +85,7 @@ struct PublisherOptionsWithAllocator : public PublisherOptionsBase
     rcl_publisher_options_t result;
     using AllocatorTraits = std::allocator_traits<Allocator>;
     using MessageAllocatorT = typename AllocatorTraits::template rebind_alloc<MessageT>;
-    auto message_alloc = std::make_shared<MessageAllocatorT>(*allocator.get());
+    auto message_alloc = std::make_shared<MessageAllocatorT>(*this->get_allocator());
     result.allocator = allocator::get_rcl_allocator<MessageT>(*message_alloc);
     result.qos = qos.get_rmw_qos_profile();
     result.message_tracker_options = message_tracker_opts.to_rcl_message_tracker_options();
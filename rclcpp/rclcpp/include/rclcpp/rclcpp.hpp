@@ -121,6 +121,7 @@
  *   - rclcpp/memory_strategy.hpp
  *   - rclcpp/message_memory_strategy.hpp
  *   - rclcpp/strategies/allocator_memory_strategy.hpp
+ *   - rclcpp/strategies/dynamic_message_pool_memory_strategy.hpp
  *   - rclcpp/strategies/message_pool_memory_strategy.hpp
  * - Context object which is shared amongst multiple Nodes:
  *   - rclcpp::Context
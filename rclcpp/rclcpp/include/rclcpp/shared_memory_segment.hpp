@@ -0,0 +1,192 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__SHARED_MEMORY_SEGMENT_HPP_
+#define RCLCPP__SHARED_MEMORY_SEGMENT_HPP_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "rmw/types.h"
+
+#include "rclcpp/macros.hpp"
+#include "rclcpp/visibility_control.hpp"
+
+namespace rclcpp
+{
+
+/// Slots of serialized messages in POSIX shared memory, written by one publisher.
+/**
+ * The publisher creates the segment, the subscriptions on the same host open it by its key.
+ * Each slot holds one message and a reference count shared by all processes that mapped it:
+ * the publisher sets it to the number of subscriptions it announced the message to, and each
+ * of those releases its reference when done. A slot is only written again once no references
+ * are left, so subscriptions read the message in place, without a copy.
+ *
+ * References are tagged with a generation that changes with every write, so that a late or
+ * duplicate release cannot free the slot of the next message. A subscription that died, or
+ * never got the announcement, would keep its reference forever: slots that stay referenced for
+ * longer than a lease are taken back when no free slot is left. Readers check the generation
+ * after reading, to tell whether the message was taken back meanwhile.
+ *
+ * A reader that keeps a message for longer, without copying it, pins its reference instead.
+ * Pins are recorded in the slot with the pid of the reader, and are not taken back after the
+ * lease. When no free slot is left, the publisher drops the pins of readers that are not alive
+ * anymore, so that a process that dies while it holds a pin does not keep the slot forever.
+ */
+class SharedMemorySegment
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS_NOT_COPYABLE(SharedMemorySegment)
+
+  /// Create a new segment, for the publisher.
+  /**
+   * \param[in] slot_count The number of messages that can be in flight at once.
+   * \param[in] slot_size The largest serialized message that fits, in bytes.
+   * \param[in] publisher_gid The gid of the publisher, reported to subscriptions.
+   * \param[in] mode The permissions of the shared memory, regardless of the umask.
+   * \throws std::invalid_argument if slot_count or slot_size is zero.
+   * \throws std::system_error if the shared memory cannot be created or mapped.
+   */
+  RCLCPP_PUBLIC
+  static SharedPtr
+  create(
+    size_t slot_count, size_t slot_size, const rmw_gid_t & publisher_gid, mode_t mode = 0600);
+
+  /// Map the segment with this key, for a subscription.
+  /**
+   * \return nullptr if there is no such segment (anymore), or it is not a valid segment.
+   */
+  RCLCPP_PUBLIC
+  static SharedPtr
+  open(uint64_t key);
+
+  /// Unmaps the segment. The creator also removes its name, but mappings of others stay valid.
+  RCLCPP_PUBLIC
+  ~SharedMemorySegment();
+
+  /// Key of the segment, unique on the host, which subscriptions open it by.
+  RCLCPP_PUBLIC
+  uint64_t
+  get_key() const;
+
+  RCLCPP_PUBLIC
+  size_t
+  get_slot_count() const;
+
+  RCLCPP_PUBLIC
+  size_t
+  get_slot_size() const;
+
+  /// The gid data of the publisher that created the segment.
+  RCLCPP_PUBLIC
+  const uint8_t *
+  get_publisher_gid_data() const;
+
+  /// Whether the creator destroyed the segment.
+  RCLCPP_PUBLIC
+  bool
+  is_closed() const;
+
+  /// Take a free slot to write a message into. Thread-safe.
+  /**
+   * Falls back to the slot that was leased for the longest time, if that is more than lease.
+   * \param[out] slot The slot taken.
+   * \param[out] generation The generation of the message to write.
+   * \return false if all slots are in use.
+   */
+  RCLCPP_PUBLIC
+  bool
+  acquire(size_t & slot, uint32_t & generation, std::chrono::nanoseconds lease);
+
+  /// Where to write the message of an acquired slot, get_slot_size() bytes.
+  RCLCPP_PUBLIC
+  uint8_t *
+  get_payload(size_t slot);
+
+  /// Hand the written message over to this many readers, which can be zero.
+  /** At most 65535 readers get a reference, more would release what they did not hold. */
+  RCLCPP_PUBLIC
+  void
+  commit(size_t slot, uint32_t generation, size_t length, size_t readers);
+
+  /// Give up an acquired slot without handing it over, or the references to a committed one.
+  /** Pinned references stay, the slot is free once they are unpinned. */
+  RCLCPP_PUBLIC
+  void
+  discard(size_t slot, uint32_t generation);
+
+  /// Whether the slot still holds the message of this generation.
+  RCLCPP_PUBLIC
+  bool
+  holds(size_t slot, uint32_t generation) const;
+
+  /// The message of a slot, as written by the publisher.
+  /**
+   * \param[out] length The length of the message, zero if the slot is invalid.
+   * \return The message, valid while the reference to it is held, nullptr if the slot is invalid.
+   */
+  RCLCPP_PUBLIC
+  const uint8_t *
+  read(size_t slot, uint32_t generation, size_t & length) const;
+
+  /// Release a reader's reference.
+  /**
+   * \return false if the slot was taken back before, in which case what was read is not valid.
+   */
+  RCLCPP_PUBLIC
+  bool
+  release(size_t slot, uint32_t generation);
+
+  /// Turn a reader's reference into a pin of this process, which is not taken back after the lease.
+  /**
+   * What the slot holds stays valid until unpin(), or until the process ends.
+   * \return false if the slot was taken back before, or too many pins are held already.
+   */
+  RCLCPP_PUBLIC
+  bool
+  pin(size_t slot, uint32_t generation);
+
+  /// Release a pin of this process.
+  /** \return false if this process holds no pin of this generation. */
+  RCLCPP_PUBLIC
+  bool
+  unpin(size_t slot, uint32_t generation);
+
+  /// The number of references that were taken back, after their lease or from dead readers.
+  RCLCPP_PUBLIC
+  uint64_t
+  get_reclaimed_count() const;
+
+private:
+  SharedMemorySegment(uint64_t key, std::string name, void * memory, size_t size, bool owner);
+
+  uint64_t key_;
+  std::string name_;
+  void * memory_;
+  size_t size_;
+  bool owner_;
+  std::atomic<size_t> next_slot_;
+  std::atomic<uint64_t> reclaimed_count_;
+};
+
+}  // namespace rclcpp
+
+#endif  // RCLCPP__SHARED_MEMORY_SEGMENT_HPP_
@@ -0,0 +1,185 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__SHARED_MEMORY_TRANSPORT_HPP_
+#define RCLCPP__SHARED_MEMORY_TRANSPORT_HPP_
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "rcl/publisher.h"
+#include "rcl/subscription.h"
+#include "rcl/wait.h"
+#include "rmw/types.h"
+#include "rosidl_generator_c/message_type_support_struct.h"
+
+#include "rclcpp/macros.hpp"
+#include "rclcpp/shared_memory_segment.hpp"
+#include "rclcpp/shared_memory_transport_options.hpp"
+#include "rclcpp/visibility_control.hpp"
+#include "rclcpp/waitable.hpp"
+
+// Same-host transport for large messages, enabled with SharedMemoryTransportOptions.
+//
+// A publisher serializes the message straight into a slot of its SharedMemorySegment and only
+// announces it on a hidden side channel '{topic}/_pmros2_shm_{host}', where {host} identifies the
+// host, so that only subscriptions on the same host ever subscribe to it. The announcement rides
+// on rcl_interfaces/IntraProcessMessage: publisher_id is the key of the segment, message_sequence
+// the generation and slot of the message. A serialized message therefore never goes through the
+// middleware, which would copy it several times and fragment it on the way.
+//
+// The publisher only does so when every subscription of the data topic listens on the side
+// channel, otherwise it publishes normally, which then reaches all subscriptions, remote or not.
+// Intra process subscriptions of the publisher's own process count too: they ignore messages of
+// the publisher that come from outside, so they can not be told apart from the others, and
+// leaving them out would let a remote subscription go unnoticed.
+//
+// Subscriptions of serialized messages get a read-only view of the slot. The view pins the slot:
+// it stays valid for as long as it is held, even past the lease, and the publisher cannot use
+// the slot meanwhile, so views that are kept for long leave the publisher fewer slots. Others
+// get the message deserialized from the slot, once.
+
+namespace rclcpp
+{
+
+class SubscriptionBase;
+
+/// Name of the side channel belonging to a (fully qualified, remapped) data topic on this host.
+RCLCPP_PUBLIC
+std::string
+get_shared_memory_topic(const std::string & data_topic);
+
+class SharedMemoryPublisher
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS(SharedMemoryPublisher)
+
+  /// Uses the topic name, QoS and gid of the data publisher it publishes for.
+  RCLCPP_PUBLIC
+  SharedMemoryPublisher(
+    std::shared_ptr<rcl_node_t> node_handle,
+    const rcl_publisher_t * data_publisher,
+    const rmw_gid_t & data_publisher_gid,
+    const rosidl_message_type_support_t & type_support,
+    const SharedMemoryTransportOptions & options);
+
+  RCLCPP_PUBLIC
+  ~SharedMemoryPublisher();
+
+  /// Publish through shared memory, if all subscriptions of the data topic can get it from there.
+  /**
+   * \param[in] msg The message, of the type of the type support.
+   * \param[in] data_subscriptions The subscriptions of the data topic, intra process ones included.
+   * \return false if the message should be published through the middleware instead.
+   */
+  RCLCPP_PUBLIC
+  bool
+  publish(const void * msg, size_t data_subscriptions);
+
+  /// Same for a serialized message.
+  RCLCPP_PUBLIC
+  bool
+  publish(const rcl_serialized_message_t & serialized_msg, size_t data_subscriptions);
+
+  /// The subscriptions that listen on the side channel, 0 if that cannot be told.
+  RCLCPP_PUBLIC
+  size_t
+  get_reader_count() const;
+
+  /// The slots of this publisher, for instance for get_reclaimed_count().
+  RCLCPP_PUBLIC
+  SharedMemorySegment &
+  get_segment();
+
+private:
+  RCLCPP_DISABLE_COPY(SharedMemoryPublisher)
+
+  /// Take a slot, unless some of the subscriptions are not on the side channel.
+  bool
+  acquire(size_t data_subscriptions, size_t & slot, uint32_t & generation, size_t & readers);
+
+  /// Hand the message over and tell the readers about it.
+  bool
+  announce(size_t slot, uint32_t generation, size_t length, size_t readers);
+
+  std::shared_ptr<rcl_node_t> node_handle_;
+  rcl_publisher_t publisher_;
+  rosidl_message_type_support_t type_support_;
+  std::chrono::nanoseconds lease_;
+  SharedMemorySegment::SharedPtr segment_;
+};
+
+/// Waitable that receives the messages announced on the side channel for a subscription.
+class SharedMemorySubscription : public rclcpp::Waitable
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS_NOT_COPYABLE(SharedMemorySubscription)
+
+  /// Uses the topic name and QoS of the subscription it receives for.
+  /** \param[in] subscription The subscription to deliver to, only referenced weakly. */
+  RCLCPP_PUBLIC
+  SharedMemorySubscription(
+    std::shared_ptr<rcl_node_t> node_handle,
+    std::shared_ptr<SubscriptionBase> subscription);
+
+  RCLCPP_PUBLIC
+  ~SharedMemorySubscription();
+
+  RCLCPP_PUBLIC
+  size_t
+  get_number_of_ready_subscriptions() override;
+
+  RCLCPP_PUBLIC
+  bool
+  add_to_wait_set(rcl_wait_set_t * wait_set) override;
+
+  RCLCPP_PUBLIC
+  bool
+  is_ready(rcl_wait_set_t * wait_set) override;
+
+  /// Deliver up to the batch size of the subscription of the announced messages.
+  RCLCPP_PUBLIC
+  void
+  execute() override;
+
+private:
+  RCLCPP_DISABLE_COPY(SharedMemorySubscription)
+
+  /// The mapping of a publisher's segment, mapped on first use.
+  SharedMemorySegment::SharedPtr
+  get_segment(uint64_t key);
+
+  void
+  deliver(
+    SubscriptionBase & subscription,
+    SharedMemorySegment::SharedPtr segment,
+    size_t slot,
+    uint32_t generation,
+    const rmw_message_info_t & message_info);
+
+  std::shared_ptr<rcl_node_t> node_handle_;
+  rcl_subscription_t subscription_;
+  std::weak_ptr<SubscriptionBase> data_subscription_;
+  size_t wait_set_subscription_index_;
+
+  std::mutex segments_mutex_;
+  std::unordered_map<uint64_t, SharedMemorySegment::SharedPtr> segments_;
+};
+
+}  // namespace rclcpp
+
+#endif  // RCLCPP__SHARED_MEMORY_TRANSPORT_HPP_
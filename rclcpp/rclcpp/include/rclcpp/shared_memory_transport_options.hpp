@@ -0,0 +1,48 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__SHARED_MEMORY_TRANSPORT_OPTIONS_HPP_
+#define RCLCPP__SHARED_MEMORY_TRANSPORT_OPTIONS_HPP_
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstddef>
+
+namespace rclcpp
+{
+
+/// Used in PublisherOptions and SubscriptionOptions, see rclcpp/shared_memory_transport.hpp.
+struct SharedMemoryTransportOptions
+{
+  /// Exchange messages with the publishers or subscriptions on the same host that enable it too.
+  bool enabled = false;
+  /// Publishers only: the number of messages that can be in flight at once.
+  size_t slot_count = 16;
+  /// Publishers only: the largest serialized message sent through shared memory, in bytes.
+  /** Larger messages are published through the middleware. */
+  size_t slot_size = 4 * 1024 * 1024;
+  /// Publishers only: how long a message may stay unreleased before its slot can be taken back.
+  std::chrono::milliseconds lease = std::chrono::milliseconds(1000);
+  /// Publishers only: the permissions of the shared memory, as for chmod.
+  /**
+   * Subscriptions need to read and write it, e.g. 0660 lets processes of other users in the
+   * group of the publisher's process subscribe. Those that cannot, lose the messages.
+   */
+  mode_t mode = 0600;
+};
+
+}  // namespace rclcpp
+
+#endif  // RCLCPP__SHARED_MEMORY_TRANSPORT_OPTIONS_HPP_
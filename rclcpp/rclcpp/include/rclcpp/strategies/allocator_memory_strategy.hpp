@@ -52,6 +52,12 @@ public:
   using VoidAlloc = typename VoidAllocTraits::allocator_type;
 
   explicit AllocatorMemoryStrategy(std::shared_ptr<Alloc> allocator)
+  : guard_conditions_(*allocator.get()),
+    subscription_handles_(*allocator.get()),
+    service_handles_(*allocator.get()),
+    client_handles_(*allocator.get()),
+    timer_handles_(*allocator.get()),
+    waitable_handles_(*allocator.get())
   {
     allocator_ = std::make_shared<VoidAlloc>(*allocator.get());
   }
@@ -205,7 +211,7 @@ public:
 
   bool add_handles_to_wait_set(rcl_wait_set_t * wait_set)
   {
-    for (auto subscription : subscription_handles_) {
+    for (const auto & subscription : subscription_handles_) {
       if (rcl_wait_set_add_subscription(wait_set, subscription.get(), NULL) != RCL_RET_OK) {
         RCUTILS_LOG_ERROR_NAMED(
           "rclcpp",
@@ -214,7 +220,7 @@ public:
       }
     }
 
-    for (auto client : client_handles_) {
+    for (const auto & client : client_handles_) {
       if (rcl_wait_set_add_client(wait_set, client.get(), NULL) != RCL_RET_OK) {
         RCUTILS_LOG_ERROR_NAMED(
           "rclcpp",
@@ -223,7 +229,7 @@ public:
       }
     }
 
-    for (auto service : service_handles_) {
+    for (const auto & service : service_handles_) {
       if (rcl_wait_set_add_service(wait_set, service.get(), NULL) != RCL_RET_OK) {
         RCUTILS_LOG_ERROR_NAMED(
           "rclcpp",
@@ -232,7 +238,7 @@ public:
       }
     }
 
-    for (auto timer : timer_handles_) {
+    for (const auto & timer : timer_handles_) {
       if (rcl_wait_set_add_timer(wait_set, timer.get(), NULL) != RCL_RET_OK) {
         RCUTILS_LOG_ERROR_NAMED(
           "rclcpp",
@@ -251,7 +257,7 @@ public:
       }
     }
 
-    for (auto waitable : waitable_handles_) {
+    for (const auto & waitable : waitable_handles_) {
       if (!waitable->add_to_wait_set(wait_set)) {
         RCUTILS_LOG_ERROR_NAMED(
           "rclcpp",
@@ -415,7 +421,7 @@ public:
   size_t number_of_ready_subscriptions() const
   {
     size_t number_of_subscriptions = subscription_handles_.size();
-    for (auto waitable : waitable_handles_) {
+    for (const auto & waitable : waitable_handles_) {
       number_of_subscriptions += waitable->get_number_of_ready_subscriptions();
     }
     return number_of_subscriptions;
@@ -424,7 +430,7 @@ public:
   size_t number_of_ready_services() const
   {
     size_t number_of_services = service_handles_.size();
-    for (auto waitable : waitable_handles_) {
+    for (const auto & waitable : waitable_handles_) {
       number_of_services += waitable->get_number_of_ready_services();
     }
     return number_of_services;
@@ -433,7 +439,7 @@ public:
   size_t number_of_ready_events() const
   {
     size_t number_of_events = 0;
-    for (auto waitable : waitable_handles_) {
+    for (const auto & waitable : waitable_handles_) {
       number_of_events += waitable->get_number_of_ready_events();
     }
     return number_of_events;
@@ -442,7 +448,7 @@ public:
   size_t number_of_ready_clients() const
   {
     size_t number_of_clients = client_handles_.size();
-    for (auto waitable : waitable_handles_) {
+    for (const auto & waitable : waitable_handles_) {
       number_of_clients += waitable->get_number_of_ready_clients();
     }
     return number_of_clients;
@@ -451,7 +457,7 @@ public:
   size_t number_of_guard_conditions() const
   {
     size_t number_of_guard_conditions = guard_conditions_.size();
-    for (auto waitable : waitable_handles_) {
+    for (const auto & waitable : waitable_handles_) {
       number_of_guard_conditions += waitable->get_number_of_ready_guard_conditions();
     }
     return number_of_guard_conditions;
@@ -460,7 +466,7 @@ public:
   size_t number_of_ready_timers() const
   {
     size_t number_of_timers = timer_handles_.size();
-    for (auto waitable : waitable_handles_) {
+    for (const auto & waitable : waitable_handles_) {
       number_of_timers += waitable->get_number_of_ready_timers();
     }
     return number_of_timers;
@@ -0,0 +1,318 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__STRATEGIES__DYNAMIC_MESSAGE_POOL_MEMORY_STRATEGY_HPP_
+#define RCLCPP__STRATEGIES__DYNAMIC_MESSAGE_POOL_MEMORY_STRATEGY_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "rclcpp/macros.hpp"
+#include "rclcpp/message_memory_strategy.hpp"
+#include "rclcpp/visibility_control.hpp"
+
+namespace rclcpp
+{
+namespace strategies
+{
+namespace message_pool_memory_strategy
+{
+
+/// What DynamicMessagePoolMemoryStrategy does when all of its messages are in use.
+enum class PoolGrowthPolicy
+{
+  /// Throw std::runtime_error, like MessagePoolMemoryStrategy.
+  Fixed,
+  /// Add a message to the pool, up to its maximum size, then throw.
+  BoundedGrow,
+  /// Add a message to the pool, up to its maximum size, then allocate one like
+  /// MessageMemoryStrategy and count it.
+  HeapFallback,
+};
+
+/// Pool of reused messages of any type, borrowed and returned without locks or allocations.
+/**
+ * Unlike MessagePoolMemoryStrategy, messages need not have a fixed size: a pooled message is
+ * never destroyed between uses, so the vectors and strings in it keep their capacity, and taking
+ * a message of about the same size as the previous one into it allocates nothing. A borrowed
+ * message therefore still holds what it was last filled with, which taking overwrites.
+ *
+ * Free messages are kept on a lock-free stack of indices, for any number of executor threads.
+ * The index of a message travels with the shared_ptr handed out: its control block is built in
+ * storage reserved next to the message, and freeing that storage, once the last owner let go,
+ * is what pushes the index back. Borrowing and returning thus are a couple of atomic operations.
+ *
+ * The pool may outlive the strategy, as long as messages are in use.
+ */
+template<typename MessageT, typename Alloc = std::allocator<void>>
+class DynamicMessagePoolMemoryStrategy
+  : public message_memory_strategy::MessageMemoryStrategy<MessageT, Alloc>
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS(DynamicMessagePoolMemoryStrategy)
+
+  /// Constructor.
+  /**
+   * \param[in] initial_size The number of messages allocated up front, at least one.
+   * \param[in] policy What to do when all messages are in use.
+   * \param[in] max_size The size the pool can grow to, ignored with PoolGrowthPolicy::Fixed.
+   * \param[in] allocator Allocates the messages of the pool and the heap fallbacks.
+   */
+  explicit DynamicMessagePoolMemoryStrategy(
+    size_t initial_size,
+    PoolGrowthPolicy policy = PoolGrowthPolicy::Fixed,
+    size_t max_size = 0,
+    std::shared_ptr<Alloc> allocator = std::make_shared<Alloc>())
+  : message_memory_strategy::MessageMemoryStrategy<MessageT, Alloc>(allocator),
+    policy_(policy),
+    pool_(std::make_shared<Pool>(
+        initial_size,
+        policy == PoolGrowthPolicy::Fixed ? initial_size : std::max(initial_size, max_size),
+        *allocator))
+  {}
+
+  /// Borrow a free message of the pool, growing it or falling back to the heap if needed.
+  /**
+   * \return Shared pointer to the borrowed message, which returns to the pool with its last owner.
+   * \throws std::runtime_error if all messages are in use and the policy does not allow more.
+   */
+  std::shared_ptr<MessageT> borrow_message() override
+  {
+    size_t index = 0;
+    if (!pool_->pop_free(index) && !pool_->grow(index)) {
+      if (policy_ != PoolGrowthPolicy::HeapFallback) {
+        throw std::runtime_error("All messages of the message pool are in use.");
+      }
+      heap_fallback_count_.fetch_add(1, std::memory_order_relaxed);
+      return message_memory_strategy::MessageMemoryStrategy<MessageT, Alloc>::borrow_message();
+    }
+    Slot & slot = pool_->slot(index);
+    return std::shared_ptr<MessageT>(
+      &slot.message, KeepMessage(), ControlBlockAllocator<MessageT>(pool_, index));
+  }
+
+  /// Let go of the message, which returns to the pool if this was its last owner.
+  void return_message(std::shared_ptr<MessageT> & msg) override
+  {
+    msg.reset();
+  }
+
+  /// The number of messages in the pool, in use or not.
+  size_t get_pool_size() const
+  {
+    return pool_->size();
+  }
+
+  /// The number of messages allocated from the heap because the pool was exhausted.
+  uint64_t get_heap_fallback_count() const
+  {
+    return heap_fallback_count_.load(std::memory_order_relaxed);
+  }
+
+private:
+  /// Room for the control block of the shared_ptr to a pooled message.
+  static constexpr size_t control_block_capacity = 128;
+
+  struct Slot
+  {
+    MessageT message;
+    typename std::aligned_storage<
+      control_block_capacity, alignof(std::max_align_t)>::type control_block;
+  };
+
+  using SlotAllocTraits = allocator::AllocRebind<Slot, Alloc>;
+  using SlotAlloc = typename SlotAllocTraits::allocator_type;
+
+  /// The messages, and a stack of the free ones.
+  class Pool
+  {
+  public:
+    Pool(size_t initial_size, size_t max_size, const Alloc & allocator)
+    : slot_allocator_(allocator),
+      slots_(max_size, nullptr),
+      next_(new std::atomic<uint32_t>[max_size]),
+      free_head_(0),
+      size_(0)
+    {
+      if (initial_size == 0) {
+        throw std::invalid_argument("initial_size must be a positive, non-zero value");
+      }
+      if (max_size >= std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("max_size is too large");
+      }
+      for (size_t i = 0; i < initial_size; ++i) {
+        size_t index = 0;
+        grow(index);
+        push_free(index);
+      }
+    }
+
+    ~Pool()
+    {
+      for (Slot * slot : slots_) {
+        if (slot) {
+          SlotAllocTraits::destroy(slot_allocator_, slot);
+          SlotAllocTraits::deallocate(slot_allocator_, slot, 1);
+        }
+      }
+    }
+
+    Slot &
+    slot(size_t index)
+    {
+      return *slots_[index];
+    }
+
+    size_t
+    size() const
+    {
+      return size_.load(std::memory_order_acquire);
+    }
+
+    /// Take a free message off the stack.
+    bool
+    pop_free(size_t & index)
+    {
+      uint64_t head = free_head_.load(std::memory_order_acquire);
+      for (;; ) {
+        // The low half is the index plus one, zero when empty, the high half counts pops to
+        // tell apart a head that got popped and pushed again meanwhile.
+        uint32_t top = static_cast<uint32_t>(head);
+        if (top == 0) {
+          return false;
+        }
+        uint64_t next = ((head >> 32) + 1) << 32 | next_[top - 1].load(std::memory_order_relaxed);
+        if (free_head_.compare_exchange_weak(
+            head, next, std::memory_order_acquire, std::memory_order_acquire))
+        {
+          index = top - 1;
+          return true;
+        }
+      }
+    }
+
+    /// Put a message back on the stack, for the next borrow.
+    void
+    push_free(size_t index)
+    {
+      uint64_t head = free_head_.load(std::memory_order_relaxed);
+      do {
+        next_[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+      } while (!free_head_.compare_exchange_weak(
+        head, (head & ~uint64_t(0xffffffff)) | (index + 1),
+        std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /// Allocate one more message for the caller, unless the pool is at its maximum size.
+    bool
+    grow(size_t & index)
+    {
+      size_t size = size_.load(std::memory_order_relaxed);
+      do {
+        if (size >= slots_.size()) {
+          return false;
+        }
+      } while (!size_.compare_exchange_weak(size, size + 1, std::memory_order_relaxed));
+      Slot * slot = SlotAllocTraits::allocate(slot_allocator_, 1);
+      SlotAllocTraits::construct(slot_allocator_, slot);
+      // Only this thread uses it until it is pushed, which publishes it to the others.
+      slots_[size] = slot;
+      index = size;
+      return true;
+    }
+
+  private:
+    RCLCPP_DISABLE_COPY(Pool)
+
+    SlotAlloc slot_allocator_;
+    std::vector<Slot *> slots_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;
+    std::atomic<uint64_t> free_head_;
+    std::atomic<size_t> size_;
+  };
+
+  /// The message belongs to the pool: the last owner of a borrowed one does not destroy it.
+  struct KeepMessage
+  {
+    void operator()(MessageT *) const {}
+  };
+
+  /// Puts the control block of a borrowed message in its slot, and frees the slot with it.
+  template<typename T>
+  struct ControlBlockAllocator
+  {
+    using value_type = T;
+
+    ControlBlockAllocator(std::shared_ptr<Pool> pool, size_t index)
+    : pool(std::move(pool)), index(index)
+    {}
+
+    template<typename U>
+    ControlBlockAllocator(const ControlBlockAllocator<U> & other)  // NOLINT(runtime/explicit)
+    : pool(other.pool), index(other.index)
+    {}
+
+    T *
+    allocate(size_t n)
+    {
+      static_assert(alignof(T) <= alignof(std::max_align_t), "control block is over-aligned");
+      if (n * sizeof(T) > control_block_capacity) {
+        throw std::bad_alloc();
+      }
+      return reinterpret_cast<T *>(&pool->slot(index).control_block);
+    }
+
+    void
+    deallocate(T *, size_t)
+    {
+      // The control block is gone with the last owner and the last weak_ptr: free the message.
+      pool->push_free(index);
+    }
+
+    template<typename U>
+    bool
+    operator==(const ControlBlockAllocator<U> & other) const
+    {
+      return pool == other.pool && index == other.index;
+    }
+
+    template<typename U>
+    bool
+    operator!=(const ControlBlockAllocator<U> & other) const
+    {
+      return !(*this == other);
+    }
+
+    std::shared_ptr<Pool> pool;
+    size_t index;
+  };
+
+  const PoolGrowthPolicy policy_;
+  std::shared_ptr<Pool> pool_;
+  std::atomic<uint64_t> heap_fallback_count_ {0};
+};
+
+}  // namespace message_pool_memory_strategy
+}  // namespace strategies
+}  // namespace rclcpp
+
+#endif  // RCLCPP__STRATEGIES__DYNAMIC_MESSAGE_POOL_MEMORY_STRATEGY_HPP_
@@ -0,0 +1,682 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__STRATEGIES__INDEXED_MEMORY_STRATEGY_HPP_
+#define RCLCPP__STRATEGIES__INDEXED_MEMORY_STRATEGY_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "rcl/allocator.h"
+#include "rcl/error_handling.h"
+
+#include "rclcpp/macros.hpp"
+#include "rclcpp/memory_strategy.hpp"
+#include "rclcpp/node.hpp"
+#include "rclcpp/visibility_control.hpp"
+
+#include "rcutils/logging_macros.h"
+
+namespace rclcpp
+{
+namespace memory_strategies
+{
+namespace indexed_memory_strategy
+{
+
+/// One bit per collected entity, set when the last wait found it ready.
+class ReadyBitmap
+{
+public:
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  /// Clear all bits and make room for size bits. Only allocates when growing past the capacity.
+  void
+  reset(size_t size)
+  {
+    size_ = size;
+    words_.assign((size + 63) / 64, 0);
+  }
+
+  void
+  set(size_t index)
+  {
+    words_[index / 64] |= uint64_t(1) << (index % 64);
+  }
+
+  void
+  clear(size_t index)
+  {
+    words_[index / 64] &= ~(uint64_t(1) << (index % 64));
+  }
+
+  /// Index of the first set bit at or after from, or npos.
+  size_t
+  find_next(size_t from) const
+  {
+    if (from >= size_) {
+      return npos;
+    }
+    size_t word_index = from / 64;
+    uint64_t word = words_[word_index] & (~uint64_t(0) << (from % 64));
+    while (true) {
+      if (word) {
+        size_t index = word_index * 64 + count_trailing_zeros(word);
+        return index < size_ ? index : npos;
+      }
+      if (++word_index == words_.size()) {
+        return npos;
+      }
+      word = words_[word_index];
+    }
+  }
+
+private:
+  static size_t
+  count_trailing_zeros(uint64_t word)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_ctzll(word));
+#else
+    size_t count = 0;
+    while (!(word & 1)) {
+      word >>= 1;
+      ++count;
+    }
+    return count;
+#endif
+  }
+
+  size_t size_ = 0;
+  std::vector<uint64_t> words_;
+};
+
+/// Memory strategy that finds the ready entities without searching the nodes.
+/**
+ * The AllocatorMemoryStrategy only keeps the rcl handles of what it collected. To dispatch a ready
+ * handle it searches all nodes and callback groups for the entity that owns it, and again for its
+ * callback group, so every dispatch costs O(handles * nodes * groups). Its get_next_timer walks
+ * all timers and asks each whether it is ready.
+ *
+ * This strategy remembers the entity, callback group and node of every handle when collecting,
+ * at the index the handle gets in the wait set. After the wait the results are copied into one
+ * ReadyBitmap per kind, and dispatching walks the set bits: O(ready), one weak pointer lock per
+ * dispatched entity.
+ *
+ * Entities, groups and nodes are held weakly, the rcl handles strongly (they are in the wait set).
+ * Timers are dispatched from the wait set results like everything else, not by polling them, so
+ * a timer is only dispatched once per wait.
+ *
+ * The entries outlive clear_handles(): as long as the entities stay the same, collecting checks
+ * them in place instead of building them again, so a spin neither allocates nor copies shared
+ * pointers until something is dispatched.
+ */
+class IndexedMemoryStrategy : public memory_strategy::MemoryStrategy
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS(IndexedMemoryStrategy)
+
+  template<typename EntityT, typename HandleT>
+  struct Entry
+  {
+    std::weak_ptr<EntityT> entity;
+    std::shared_ptr<const HandleT> handle;
+    rclcpp::callback_group::CallbackGroup::WeakPtr group;
+    rclcpp::node_interfaces::NodeBaseInterface::WeakPtr node;
+  };
+
+  struct SubscriptionEntry : Entry<rclcpp::SubscriptionBase, rcl_subscription_t>
+  {
+    bool intra_process;
+  };
+
+  struct WaitableEntry
+  {
+    rclcpp::Waitable::SharedPtr waitable;
+    rclcpp::callback_group::CallbackGroup::WeakPtr group;
+    rclcpp::node_interfaces::NodeBaseInterface::WeakPtr node;
+  };
+
+  void add_guard_condition(const rcl_guard_condition_t * guard_condition)
+  {
+    for (const auto & existing_guard_condition : guard_conditions_) {
+      if (existing_guard_condition == guard_condition) {
+        return;
+      }
+    }
+    guard_conditions_.push_back(guard_condition);
+  }
+
+  void remove_guard_condition(const rcl_guard_condition_t * guard_condition)
+  {
+    for (auto it = guard_conditions_.begin(); it != guard_conditions_.end(); ++it) {
+      if (*it == guard_condition) {
+        guard_conditions_.erase(it);
+        break;
+      }
+    }
+  }
+
+  /// Forget the last wait results. The entries are kept for collect_entities() to reuse.
+  void clear_handles()
+  {
+    ready_subscriptions_.reset(0);
+    ready_services_.reset(0);
+    ready_clients_.reset(0);
+    ready_timers_.reset(0);
+    ready_waitables_.reset(0);
+  }
+
+  void remove_null_handles(rcl_wait_set_t * wait_set)
+  {
+    // The entries come first in each wait set array, the ones that waitables added follow.
+    ready_subscriptions_.reset(subscriptions_.size());
+    for (size_t i = 0; i < subscriptions_.size(); ++i) {
+      if (wait_set->subscriptions[i]) {
+        ready_subscriptions_.set(i);
+      }
+    }
+    ready_services_.reset(services_.size());
+    for (size_t i = 0; i < services_.size(); ++i) {
+      if (wait_set->services[i]) {
+        ready_services_.set(i);
+      }
+    }
+    ready_clients_.reset(clients_.size());
+    for (size_t i = 0; i < clients_.size(); ++i) {
+      if (wait_set->clients[i]) {
+        ready_clients_.set(i);
+      }
+    }
+    ready_timers_.reset(timers_.size());
+    for (size_t i = 0; i < timers_.size(); ++i) {
+      if (wait_set->timers[i]) {
+        ready_timers_.set(i);
+      }
+    }
+    ready_waitables_.reset(waitables_.size());
+    for (size_t i = 0; i < waitables_.size(); ++i) {
+      if (waitables_[i].waitable->is_ready(wait_set)) {
+        ready_waitables_.set(i);
+      }
+    }
+  }
+
+  bool collect_entities(const WeakNodeList & weak_nodes)
+  {
+    bool has_invalid_weak_nodes = false;
+    size_t subscription_count = 0;
+    size_t service_count = 0;
+    size_t client_count = 0;
+    size_t timer_count = 0;
+    size_t waitable_count = 0;
+    for (auto & weak_node : weak_nodes) {
+      auto node = weak_node.lock();
+      if (!node) {
+        has_invalid_weak_nodes = true;
+        continue;
+      }
+      for (auto & weak_group : node->get_callback_groups()) {
+        auto group = weak_group.lock();
+        if (!group || !group->can_be_taken_from().load()) {
+          continue;
+        }
+        for (auto & weak_subscription : group->get_subscription_ptrs()) {
+          collect_subscription(weak_subscription, group, node, subscription_count);
+        }
+        for (auto & weak_service : group->get_service_ptrs()) {
+          collect_entry(services_, service_count, weak_service, group, node,
+            [](const rclcpp::ServiceBase::SharedPtr & service) {
+              return service->get_service_handle();
+            });
+        }
+        for (auto & weak_client : group->get_client_ptrs()) {
+          collect_entry(clients_, client_count, weak_client, group, node,
+            [](const rclcpp::ClientBase::SharedPtr & client) {
+              return client->get_client_handle();
+            });
+        }
+        for (auto & weak_timer : group->get_timer_ptrs()) {
+          collect_entry(timers_, timer_count, weak_timer, group, node,
+            [](const rclcpp::TimerBase::SharedPtr & timer) {
+              return timer->get_timer_handle();
+            });
+        }
+        for (auto & weak_waitable : group->get_waitable_ptrs()) {
+          collect_waitable(weak_waitable, group, node, waitable_count);
+        }
+      }
+    }
+    // Release what is no longer collected, its handles are not waited for anymore.
+    subscriptions_.resize(subscription_count);
+    services_.resize(service_count);
+    clients_.resize(client_count);
+    timers_.resize(timer_count);
+    waitables_.resize(waitable_count);
+    return has_invalid_weak_nodes;
+  }
+
+  bool add_handles_to_wait_set(rcl_wait_set_t * wait_set)
+  {
+    for (const auto & entry : subscriptions_) {
+      if (rcl_wait_set_add_subscription(wait_set, entry.handle.get(), NULL) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(
+          "rclcpp",
+          "Couldn't add subscription to wait set: %s", rcl_get_error_string().str);
+        return false;
+      }
+    }
+
+    for (const auto & entry : clients_) {
+      if (rcl_wait_set_add_client(wait_set, entry.handle.get(), NULL) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(
+          "rclcpp",
+          "Couldn't add client to wait set: %s", rcl_get_error_string().str);
+        return false;
+      }
+    }
+
+    for (const auto & entry : services_) {
+      if (rcl_wait_set_add_service(wait_set, entry.handle.get(), NULL) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(
+          "rclcpp",
+          "Couldn't add service to wait set: %s", rcl_get_error_string().str);
+        return false;
+      }
+    }
+
+    for (const auto & entry : timers_) {
+      if (rcl_wait_set_add_timer(wait_set, entry.handle.get(), NULL) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(
+          "rclcpp",
+          "Couldn't add timer to wait set: %s", rcl_get_error_string().str);
+        return false;
+      }
+    }
+
+    for (auto guard_condition : guard_conditions_) {
+      if (rcl_wait_set_add_guard_condition(wait_set, guard_condition, NULL) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(
+          "rclcpp",
+          "Couldn't add guard_condition to wait set: %s",
+          rcl_get_error_string().str);
+        return false;
+      }
+    }
+
+    for (const auto & entry : waitables_) {
+      if (!entry.waitable->add_to_wait_set(wait_set)) {
+        RCUTILS_LOG_ERROR_NAMED(
+          "rclcpp",
+          "Couldn't add waitable to wait set: %s", rcl_get_error_string().str);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void
+  get_next_subscription(executor::AnyExecutable & any_exec, const WeakNodeList &)
+  {
+    for (size_t i = ready_subscriptions_.find_next(0); i != ReadyBitmap::npos;
+      i = ready_subscriptions_.find_next(i + 1))
+    {
+      auto & entry = subscriptions_[i];
+      rclcpp::callback_group::CallbackGroup::SharedPtr group;
+      auto subscription = take_if_possible(entry, ready_subscriptions_, i, group);
+      if (!subscription) {
+        continue;
+      }
+      if (entry.intra_process) {
+        any_exec.subscription_intra_process = subscription;
+      } else {
+        any_exec.subscription = subscription;
+      }
+      any_exec.callback_group = group;
+      any_exec.node_base = entry.node.lock();
+      return;
+    }
+  }
+
+  void
+  get_next_service(executor::AnyExecutable & any_exec, const WeakNodeList &)
+  {
+    for (size_t i = ready_services_.find_next(0); i != ReadyBitmap::npos;
+      i = ready_services_.find_next(i + 1))
+    {
+      rclcpp::callback_group::CallbackGroup::SharedPtr group;
+      auto service = take_if_possible(services_[i], ready_services_, i, group);
+      if (service) {
+        any_exec.service = service;
+        any_exec.callback_group = group;
+        any_exec.node_base = services_[i].node.lock();
+        return;
+      }
+    }
+  }
+
+  void
+  get_next_client(executor::AnyExecutable & any_exec, const WeakNodeList &)
+  {
+    for (size_t i = ready_clients_.find_next(0); i != ReadyBitmap::npos;
+      i = ready_clients_.find_next(i + 1))
+    {
+      rclcpp::callback_group::CallbackGroup::SharedPtr group;
+      auto client = take_if_possible(clients_[i], ready_clients_, i, group);
+      if (client) {
+        any_exec.client = client;
+        any_exec.callback_group = group;
+        any_exec.node_base = clients_[i].node.lock();
+        return;
+      }
+    }
+  }
+
+  void
+  get_next_timer(executor::AnyExecutable & any_exec, const WeakNodeList &)
+  {
+    for (size_t i = ready_timers_.find_next(0); i != ReadyBitmap::npos;
+      i = ready_timers_.find_next(i + 1))
+    {
+      rclcpp::callback_group::CallbackGroup::SharedPtr group;
+      auto timer = take_if_possible(timers_[i], ready_timers_, i, group);
+      if (!timer) {
+        continue;
+      }
+      if (!timer->is_ready()) {
+        // Canceled or reset since the wait.
+        continue;
+      }
+      any_exec.timer = timer;
+      any_exec.callback_group = group;
+      any_exec.node_base = timers_[i].node.lock();
+      return;
+    }
+  }
+
+  void
+  get_next_waitable(executor::AnyExecutable & any_exec, const WeakNodeList &)
+  {
+    for (size_t i = ready_waitables_.find_next(0); i != ReadyBitmap::npos;
+      i = ready_waitables_.find_next(i + 1))
+    {
+      auto & entry = waitables_[i];
+      auto group = entry.group.lock();
+      if (!group) {
+        ready_waitables_.clear(i);
+        continue;
+      }
+      if (!group->can_be_taken_from().load()) {
+        continue;
+      }
+      ready_waitables_.clear(i);
+      any_exec.waitable = entry.waitable;
+      any_exec.callback_group = group;
+      any_exec.node_base = entry.node.lock();
+      return;
+    }
+  }
+
+  rcl_allocator_t get_allocator()
+  {
+    return rcl_get_default_allocator();
+  }
+
+  size_t number_of_ready_subscriptions() const
+  {
+    size_t number_of_subscriptions = subscriptions_.size();
+    for (const auto & entry : waitables_) {
+      number_of_subscriptions += entry.waitable->get_number_of_ready_subscriptions();
+    }
+    return number_of_subscriptions;
+  }
+
+  size_t number_of_ready_services() const
+  {
+    size_t number_of_services = services_.size();
+    for (const auto & entry : waitables_) {
+      number_of_services += entry.waitable->get_number_of_ready_services();
+    }
+    return number_of_services;
+  }
+
+  size_t number_of_ready_events() const
+  {
+    size_t number_of_events = 0;
+    for (const auto & entry : waitables_) {
+      number_of_events += entry.waitable->get_number_of_ready_events();
+    }
+    return number_of_events;
+  }
+
+  size_t number_of_ready_clients() const
+  {
+    size_t number_of_clients = clients_.size();
+    for (const auto & entry : waitables_) {
+      number_of_clients += entry.waitable->get_number_of_ready_clients();
+    }
+    return number_of_clients;
+  }
+
+  size_t number_of_guard_conditions() const
+  {
+    size_t number_of_guard_conditions = guard_conditions_.size();
+    for (const auto & entry : waitables_) {
+      number_of_guard_conditions += entry.waitable->get_number_of_ready_guard_conditions();
+    }
+    return number_of_guard_conditions;
+  }
+
+  size_t number_of_ready_timers() const
+  {
+    size_t number_of_timers = timers_.size();
+    for (const auto & entry : waitables_) {
+      number_of_timers += entry.waitable->get_number_of_ready_timers();
+    }
+    return number_of_timers;
+  }
+
+  size_t number_of_waitables() const
+  {
+    return waitables_.size();
+  }
+
+private:
+  /// Whether a and b, weak or shared pointers, point to the same object, without locking them.
+  template<typename A, typename B>
+  static bool
+  same_owner(const A & a, const B & b)
+  {
+    return !a.owner_before(b) && !b.owner_before(a);
+  }
+
+  /// Whether entry was collected for the same entity, group and node the last time.
+  template<typename EntryT, typename WeakEntityT>
+  static bool
+  is_same_entry(
+    const EntryT & entry,
+    const WeakEntityT & weak_entity,
+    const rclcpp::callback_group::CallbackGroup::SharedPtr & group,
+    const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node)
+  {
+    return same_owner(entry.entity, weak_entity) && !weak_entity.expired() &&
+           same_owner(entry.group, group) && same_owner(entry.node, node);
+  }
+
+  /// The entry at count, made room for if needed, then counted.
+  template<typename EntryT>
+  static EntryT &
+  next_entry(std::vector<EntryT> & entries, size_t & count)
+  {
+    if (count == entries.size()) {
+      entries.emplace_back();
+    }
+    return entries[count++];
+  }
+
+  /// Add an entity to entries, or keep its entry from the last collection in place.
+  /**
+   * While nothing changes, every entity is where it was the last time: its entry is checked, not
+   * rebuilt, and neither reference counts are touched nor memory allocated.
+   */
+  template<typename EntryT, typename WeakEntityT, typename GetHandleT>
+  static void
+  collect_entry(
+    std::vector<EntryT> & entries,
+    size_t & count,
+    const WeakEntityT & weak_entity,
+    const rclcpp::callback_group::CallbackGroup::SharedPtr & group,
+    const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node,
+    GetHandleT get_handle)
+  {
+    if (count < entries.size() && is_same_entry(entries[count], weak_entity, group, node)) {
+      ++count;
+      return;
+    }
+    auto entity = weak_entity.lock();
+    if (!entity) {
+      return;
+    }
+    auto & entry = next_entry(entries, count);
+    entry.entity = entity;
+    entry.handle = get_handle(entity);
+    entry.group = group;
+    entry.node = node;
+  }
+
+  void
+  collect_subscription(
+    const rclcpp::SubscriptionBase::WeakPtr & weak_subscription,
+    const rclcpp::callback_group::CallbackGroup::SharedPtr & group,
+    const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node,
+    size_t & count)
+  {
+    // A subscription has the same handles all its life: one, and one for intra process if any.
+    if (count < subscriptions_.size() &&
+      !subscriptions_[count].intra_process &&
+      is_same_entry(subscriptions_[count], weak_subscription, group, node))
+    {
+      ++count;
+      if (count < subscriptions_.size() && subscriptions_[count].intra_process &&
+        same_owner(subscriptions_[count].entity, weak_subscription))
+      {
+        ++count;
+      }
+      return;
+    }
+    auto subscription = weak_subscription.lock();
+    if (!subscription) {
+      return;
+    }
+    set_subscription_entry(
+      next_entry(subscriptions_, count), subscription, subscription->get_subscription_handle(),
+      false, group, node);
+    auto intra_process_handle = subscription->get_intra_process_subscription_handle();
+    if (intra_process_handle) {
+      set_subscription_entry(
+        next_entry(subscriptions_, count), subscription, std::move(intra_process_handle),
+        true, group, node);
+    }
+  }
+
+  static void
+  set_subscription_entry(
+    SubscriptionEntry & entry,
+    const rclcpp::SubscriptionBase::SharedPtr & subscription,
+    std::shared_ptr<const rcl_subscription_t> handle,
+    bool intra_process,
+    const rclcpp::callback_group::CallbackGroup::SharedPtr & group,
+    const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node)
+  {
+    entry.entity = subscription;
+    entry.handle = std::move(handle);
+    entry.group = group;
+    entry.node = node;
+    entry.intra_process = intra_process;
+  }
+
+  void
+  collect_waitable(
+    const rclcpp::Waitable::WeakPtr & weak_waitable,
+    const rclcpp::callback_group::CallbackGroup::SharedPtr & group,
+    const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node,
+    size_t & count)
+  {
+    if (count < waitables_.size()) {
+      auto & entry = waitables_[count];
+      // The entry owns the waitable: when it is the only owner left, the waitable is gone.
+      if (same_owner(entry.waitable, weak_waitable) && entry.waitable.use_count() > 1 &&
+        same_owner(entry.group, group) && same_owner(entry.node, node))
+      {
+        ++count;
+        return;
+      }
+    }
+    auto waitable = weak_waitable.lock();
+    if (!waitable) {
+      return;
+    }
+    auto & entry = next_entry(waitables_, count);
+    entry.waitable = std::move(waitable);
+    entry.group = group;
+    entry.node = node;
+  }
+
+  /// Lock the entity at a set bit and its group.
+  /**
+   * Clears the bit when the entity can be dispatched, or when it is gone. Leaves it set when its
+   * group is busy, to be checked next time.
+   */
+  template<typename EntryT>
+  static auto
+  take_if_possible(
+    EntryT & entry, ReadyBitmap & ready, size_t index,
+    rclcpp::callback_group::CallbackGroup::SharedPtr & group) -> decltype(entry.entity.lock())
+  {
+    auto entity = entry.entity.lock();
+    group = entry.group.lock();
+    if (!entity || !group) {
+      ready.clear(index);
+      return nullptr;
+    }
+    if (!group->can_be_taken_from().load()) {
+      return nullptr;
+    }
+    ready.clear(index);
+    return entity;
+  }
+
+  std::vector<const rcl_guard_condition_t *> guard_conditions_;
+
+  // Index i is the i-th entity of its kind in the wait set.
+  std::vector<SubscriptionEntry> subscriptions_;
+  std::vector<Entry<rclcpp::ServiceBase, rcl_service_t>> services_;
+  std::vector<Entry<rclcpp::ClientBase, rcl_client_t>> clients_;
+  std::vector<Entry<rclcpp::TimerBase, rcl_timer_t>> timers_;
+  std::vector<WaitableEntry> waitables_;
+
+  ReadyBitmap ready_subscriptions_;
+  ReadyBitmap ready_services_;
+  ReadyBitmap ready_clients_;
+  ReadyBitmap ready_timers_;
+  ReadyBitmap ready_waitables_;
+};
+
+}  // namespace indexed_memory_strategy
+}  // namespace memory_strategies
+}  // namespace rclcpp
+
+#endif  // RCLCPP__STRATEGIES__INDEXED_MEMORY_STRATEGY_HPP_
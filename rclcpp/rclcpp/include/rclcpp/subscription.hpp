@@ -24,7 +24,7 @@
 #include <sstream>
 #include <string>
 #include <utility>
-
+#include <vector>
 
 #include "rcl/error_handling.h"
 #include "rcl/subscription.h"
@@ -66,6 +66,7 @@ public:
   using MessageDeleter = allocator::Deleter<MessageAlloc, CallbackMessageT>;
   using ConstMessageSharedPtr = std::shared_ptr<const CallbackMessageT>;
   using MessageUniquePtr = std::unique_ptr<CallbackMessageT, MessageDeleter>;
+  using BatchCallbackType = std::function<void(const std::vector<ConstMessageSharedPtr> &)>;
 
   RCLCPP_SMART_PTR_DEFINITIONS(Subscription)
 
@@ -99,6 +100,11 @@ public:
     any_callback_(callback),
     message_memory_strategy_(memory_strategy)
   {
+    if (!HasRequiredFields<CallbackMessageT>::value) {
+      // built without the vandenhoven_* fields (opted out in rosidl_adapter), track on the side
+      // channel instead.
+      this->setup_out_of_band_tracking();
+    }
     if (event_callbacks.deadline_callback) {
       this->add_event_handler(event_callbacks.deadline_callback,
         RCL_SUBSCRIPTION_REQUESTED_DEADLINE_MISSED);
@@ -121,11 +127,32 @@ public:
     message_memory_strategy_ = message_memory_strategy;
   }
 
+  /// Receive all messages taken in one dispatch with a single call, instead of one by one.
+  /**
+   * Replaces the callback given at construction for messages taken from the middleware, intra
+   * process messages still go to that one. Combine with set_batch_size(), otherwise the batches
+   * are as large as the batch size of the executor, which is one by default.
+   * Messages are tracked one by one before the batch callback is called. The messages are only
+   * valid during the call, unless the message memory strategy allocates them anew each time.
+   * Behavior may be undefined if called while the subscription could be executing.
+   * \param[in] batch_callback Called with the messages of a batch, oldest first. Empty to unset.
+   */
+  void set_batch_callback(BatchCallbackType batch_callback)
+  {
+    batch_callback_ = batch_callback;
+  }
+
+  bool has_batch_callback() const
+  {
+    return static_cast<bool>(batch_callback_);
+  }
+
   std::shared_ptr<void> create_message()
   {
     /* The default message memory strategy provides a dynamically allocated message on each call to
      * create_message, though alternative memory strategies that re-use a preallocated message may be
-     * used (see rclcpp/strategies/message_pool_memory_strategy.hpp).
+     * used (see rclcpp/strategies/message_pool_memory_strategy.hpp and
+     * rclcpp/strategies/dynamic_message_pool_memory_strategy.hpp).
      */
     return message_memory_strategy_->borrow_message();
   }
@@ -143,10 +170,44 @@ public:
       return;
     }
     auto typed_message = std::static_pointer_cast<CallbackMessageT>(message);
-    message_tracker_->track_message(*typed_message.get());
+    {
+      // Tracking is not the callback's doing.
+      rclcpp::RealtimeViolationPause pause;
+      message_tracker_->track_message(*typed_message.get());
+      if (out_of_band_tracking_) {
+        out_of_band_tracking_->track_arrival(*message_tracker_, message_info);
+      }
+    }
     any_callback_.dispatch(typed_message, message_info);
   }
 
+  void handle_message_batch(
+    std::vector<std::shared_ptr<void>> & messages,
+    const std::vector<rmw_message_info_t> & message_infos)
+  {
+    std::vector<ConstMessageSharedPtr> batch;
+    {
+      // Gathering and tracking the batch is not the callback's doing, see handle_message.
+      rclcpp::RealtimeViolationPause pause;
+      batch.reserve(messages.size());
+      for (size_t i = 0; i < messages.size(); ++i) {
+        if (matches_any_intra_process_publishers(&message_infos[i].publisher_gid)) {
+          // Delivered via intra process, see handle_message.
+          continue;
+        }
+        auto typed_message = std::static_pointer_cast<CallbackMessageT>(messages[i]);
+        message_tracker_->track_message(*typed_message.get());
+        if (out_of_band_tracking_) {
+          out_of_band_tracking_->track_arrival(*message_tracker_, message_infos[i]);
+        }
+        batch.emplace_back(std::move(typed_message));
+      }
+    }
+    if (!batch.empty()) {
+      batch_callback_(batch);
+    }
+  }
+
   /// Return the loaned message.
   /** \param message message to be returned */
   void return_message(std::shared_ptr<void> & message)
@@ -180,11 +241,14 @@ public:
 
     if (any_callback_.use_take_shared_method()) {
       ConstMessageSharedPtr msg;
-      take_intra_process_message(
-        ipm.publisher_id,
-        ipm.message_sequence,
-        intra_process_subscription_id_,
-        msg);
+      {
+        rclcpp::RealtimeViolationPause pause;
+        take_intra_process_message(
+          ipm.publisher_id,
+          ipm.message_sequence,
+          intra_process_subscription_id_,
+          msg);
+      }
       if (!msg) {
         // This can happen when having two nodes in different process both using intraprocess
         // communication. It could happen too if the publisher no longer exists or the requested
@@ -193,14 +257,22 @@ public:
         // but not in the first one.
         return;
       }
+      {
+        rclcpp::RealtimeViolationPause pause;
+        message_tracker_->track_message(*msg);
+        track_intra_process_arrival(ipm.publisher_id);
+      }
       any_callback_.dispatch_intra_process(msg, message_info);
     } else {
       MessageUniquePtr msg;
-      take_intra_process_message(
-        ipm.publisher_id,
-        ipm.message_sequence,
-        intra_process_subscription_id_,
-        msg);
+      {
+        rclcpp::RealtimeViolationPause pause;
+        take_intra_process_message(
+          ipm.publisher_id,
+          ipm.message_sequence,
+          intra_process_subscription_id_,
+          msg);
+      }
       if (!msg) {
         // This can happen when having two nodes in different process both using intraprocess
         // communication. It could happen too if the publisher no longer exists or the requested
@@ -209,21 +281,87 @@ public:
         // but not in the first one.
         return;
       }
+      {
+        rclcpp::RealtimeViolationPause pause;
+        message_tracker_->track_message(*msg);
+        track_intra_process_arrival(ipm.publisher_id);
+      }
       any_callback_.dispatch_intra_process(std::move(msg), message_info);
     }
   }
 
+  /// Whether the callback takes shared messages, rather than unique ones.
+  bool use_take_shared_method() const
+  {
+    return any_callback_.use_take_shared_method();
+  }
+
+  /// Deliver a message handed over by SubscriptionIntraProcess.
+  /**
+   * \param[in] message The message.
+   * \param[in] out_of_band_tracking_key The key of the publisher for out of band tracking.
+   */
+  void handle_direct_intra_process_message(
+    ConstMessageSharedPtr message, uint32_t out_of_band_tracking_key)
+  {
+    {
+      rclcpp::RealtimeViolationPause pause;
+      message_tracker_->track_message(*message);
+      if (out_of_band_tracking_) {
+        out_of_band_tracking_->track_arrival(*message_tracker_, out_of_band_tracking_key);
+      }
+    }
+    any_callback_.dispatch_intra_process(message, direct_intra_process_message_info());
+  }
+
+  void handle_direct_intra_process_message(
+    MessageUniquePtr message, uint32_t out_of_band_tracking_key)
+  {
+    {
+      rclcpp::RealtimeViolationPause pause;
+      message_tracker_->track_message(*message);
+      if (out_of_band_tracking_) {
+        out_of_band_tracking_->track_arrival(*message_tracker_, out_of_band_tracking_key);
+      }
+    }
+    any_callback_.dispatch_intra_process(
+      std::move(message), direct_intra_process_message_info());
+  }
+
   /// Implemenation detail.
   const std::shared_ptr<rcl_subscription_t>
   get_intra_process_subscription_handle() const
   {
-    if (!use_intra_process_) {
+    if (!use_intra_process_ || intra_process_waitable_) {
       return nullptr;
     }
     return intra_process_subscription_handle_;
   }
 
 private:
+  /// Pair an intra process message with its out of band tracking variables, if it has none.
+  void
+  track_intra_process_arrival(uint64_t intra_process_publisher_id)
+  {
+    if (!out_of_band_tracking_) {
+      return;
+    }
+    auto ipm = weak_ipm_.lock();
+    rmw_gid_t gid;
+    if (ipm && ipm->get_publisher_gid(intra_process_publisher_id, gid)) {
+      out_of_band_tracking_->track_arrival(*message_tracker_, hash_publisher_gid(gid));
+    }
+  }
+
+  static rmw_message_info_t
+  direct_intra_process_message_info()
+  {
+    rmw_message_info_t message_info;
+    message_info.publisher_gid = rmw_gid_t();
+    message_info.from_intra_process = true;
+    return message_info;
+  }
+
   void
   take_intra_process_message(
     uint64_t publisher_id,
@@ -256,26 +394,12 @@ private:
       publisher_id, message_sequence, subscription_id, message);
   }
 
-  bool
-  matches_any_intra_process_publishers(const rmw_gid_t * sender_gid)
-  {
-    if (!use_intra_process_) {
-      return false;
-    }
-    auto ipm = weak_ipm_.lock();
-    if (!ipm) {
-      throw std::runtime_error(
-              "intra process publisher check called "
-              "after destruction of intra process manager");
-    }
-    return ipm->matches_any_publishers(sender_gid);
-  }
-
   RCLCPP_DISABLE_COPY(Subscription)
 
   AnySubscriptionCallback<CallbackMessageT, Alloc> any_callback_;
   typename message_memory_strategy::MessageMemoryStrategy<CallbackMessageT, Alloc>::SharedPtr
     message_memory_strategy_;
+  BatchCallbackType batch_callback_;
 };
 
 }  // namespace rclcpp
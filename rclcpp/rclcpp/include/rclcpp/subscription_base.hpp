@@ -15,6 +15,7 @@
 #ifndef RCLCPP__SUBSCRIPTION_BASE_HPP_
 #define RCLCPP__SUBSCRIPTION_BASE_HPP_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,9 +29,12 @@
 #include "rclcpp/any_subscription_callback.hpp"
 #include "rclcpp/macros.hpp"
 #include "rclcpp/qos_event.hpp"
+#include "rclcpp/subscription_intra_process_base.hpp"
 #include "rclcpp/type_support_decl.hpp"
 #include "rclcpp/visibility_control.hpp"
+#include "rclcpp/waitable.hpp"
 #include "rclcpp/measuring/message_tracker_interface.hpp"
+#include "rclcpp/measuring/out_of_band_tracking.hpp"
 
 namespace rclcpp
 {
@@ -127,17 +131,63 @@ public:
   virtual void
   return_serialized_message(std::shared_ptr<rcl_serialized_message_t> & message) = 0;
 
+  /// Whether the executor should hand taken messages over in batches, see handle_message_batch().
+  RCLCPP_PUBLIC
+  virtual bool
+  has_batch_callback() const;
+
+  /// Handle all messages taken in one dispatch at once.
+  /**
+   * Only called when has_batch_callback() is true. The default calls handle_message() for each.
+   * \param[in] messages The messages, borrowed in create_message.
+   * \param[in] message_infos Metadata associated with the messages, by index.
+   */
+  RCLCPP_PUBLIC
+  virtual void
+  handle_message_batch(
+    std::vector<std::shared_ptr<void>> & messages,
+    const std::vector<rmw_message_info_t> & message_infos);
+
   virtual void
   handle_intra_process_message(
     rcl_interfaces::msg::IntraProcessMessage & ipm,
     const rmw_message_info_t & message_info) = 0;
 
+  /// Take up to this many messages each time an executor finds this subscription ready.
+  /**
+   * Draining the queue saves a wait set rebuild and an rcl_wait per message on high rate topics,
+   * at the cost of the other entities in the callback group waiting for the whole batch.
+   * Zero, the default, uses the batch size the executor was created with (see ExecutorArgs).
+   * Thread-safe, takes effect with the next dispatch.
+   */
+  RCLCPP_PUBLIC
+  void
+  set_batch_size(size_t batch_size);
+
+  RCLCPP_PUBLIC
+  size_t
+  get_batch_size() const;
+
   const rosidl_message_type_support_t &
   get_message_type_support_handle() const;
 
   bool
   is_serialized() const;
 
+  /// Hand the violations counted during the last callback execution to the message tracker.
+  RCLCPP_PUBLIC
+  void
+  report_realtime_violations(const rclcpp::RealtimeViolationCounts & counts);
+
+  /// Whether messages of this publisher reach the subscription through intra process.
+  /**
+   * Copies of them that come from outside are ignored, see handle_message().
+   * \param[in] sender_gid The gid of the publisher, as in the message info.
+   */
+  RCLCPP_PUBLIC
+  bool
+  matches_any_intra_process_publishers(const rmw_gid_t * sender_gid) const;
+
   /// Get matching publisher count.
   /** \return The number of publishers on this topic. */
   RCLCPP_PUBLIC
@@ -153,7 +203,44 @@ public:
     IntraProcessManagerWeakPtr weak_ipm,
     const rcl_subscription_options_t & intra_process_options);
 
+  /// Receive intra process messages through waitable instead of the middleware.
+  /**
+   * Implementation detail, set by NodeTopics before setup_intra_process(), which then does not
+   * create the intra process subscription to the middleware.
+   */
+  RCLCPP_PUBLIC
+  void
+  set_intra_process_waitable(rclcpp::SubscriptionIntraProcessBase::SharedPtr waitable);
+
+  /// The waitable set with set_intra_process_waitable(), if any.
+  RCLCPP_PUBLIC
+  rclcpp::SubscriptionIntraProcessBase::SharedPtr
+  get_intra_process_waitable() const;
+
+  /// Also receive messages through shared memory, from publishers on the same host.
+  /**
+   * Implementation detail, set by create_subscription() before the subscription is added to its
+   * callback group, see rclcpp/shared_memory_transport.hpp.
+   */
+  RCLCPP_PUBLIC
+  void
+  set_shared_memory_waitable(rclcpp::Waitable::SharedPtr waitable);
+
+  /// The waitable set with set_shared_memory_waitable(), if any.
+  RCLCPP_PUBLIC
+  rclcpp::Waitable::SharedPtr
+  get_shared_memory_waitable() const;
+
 protected:
+  /// Pair tracking variables from the side channel with arrivals.
+  /**
+   * For message types built without them.
+   * Does nothing if this subscription has no message tracker or takes serialized messages.
+   */
+  RCLCPP_PUBLIC
+  void
+  setup_out_of_band_tracking();
+
   template<typename EventCallbackT>
   void
   add_event_handler(
@@ -177,13 +264,18 @@ protected:
   bool use_intra_process_;
   IntraProcessManagerWeakPtr weak_ipm_;
   uint64_t intra_process_subscription_id_;
+  rclcpp::SubscriptionIntraProcessBase::SharedPtr intra_process_waitable_;
+  rclcpp::Waitable::SharedPtr shared_memory_waitable_;
   rclcpp::IMessageTracker::UniquePtr message_tracker_;
+  bool message_tracking_enabled_;
+  rclcpp::OutOfBandTrackingSubscriber::UniquePtr out_of_band_tracking_;
 
 private:
   RCLCPP_DISABLE_COPY(SubscriptionBase)
 
   rosidl_message_type_support_t type_support_;
   bool is_serialized_;
+  std::atomic<size_t> batch_size_;
 };
 
 }  // namespace rclcpp
@@ -24,7 +24,9 @@
 
 #include "rosidl_typesupport_cpp/message_type_support.hpp"
 
+#include "rclcpp/context.hpp"
 #include "rclcpp/subscription.hpp"
+#include "rclcpp/subscription_intra_process.hpp"
 #include "rclcpp/subscription_traits.hpp"
 #include "rclcpp/intra_process_manager.hpp"
 #include "rclcpp/node_interfaces/node_base_interface.hpp"
@@ -63,6 +65,16 @@ struct SubscriptionFactory
       const rcl_subscription_options_t & subscription_options)>;
 
   SetupIntraProcessFunction setup_intra_process;
+
+  // Creates the queue through which intra process publishers deliver to the subscription.
+  // Returns nullptr for subscriptions that keep receiving through the middleware.
+  using CreateIntraProcessWaitableFunction = std::function<
+    rclcpp::SubscriptionIntraProcessBase::SharedPtr(
+      rclcpp::SubscriptionBase::SharedPtr subscription,
+      rclcpp::Context::SharedPtr context,
+      const rcl_subscription_options_t & subscription_options)>;
+
+  CreateIntraProcessWaitableFunction create_intra_process_waitable;
 };
 
 /// Return a SubscriptionFactory setup to create a SubscriptionT<MessageT, AllocatorT>.
@@ -92,8 +104,8 @@ create_subscription_factory(
   AnySubscriptionCallback<CallbackMessageT, Alloc> any_subscription_callback(allocator);
   any_subscription_callback.set(std::forward<CallbackT>(callback));
 
-  auto message_alloc =
-    std::make_shared<typename Subscription<CallbackMessageT, Alloc>::MessageAlloc>();
+  using MessageAlloc = typename Subscription<CallbackMessageT, Alloc>::MessageAlloc;
+  auto message_alloc = std::make_shared<MessageAlloc>(*allocator.get());
 
   // factory function that creates a MessageT specific SubscriptionT
   factory.create_typed_subscription =
@@ -122,6 +134,28 @@ create_subscription_factory(
       return sub_base_ptr;
     };
 
+  factory.create_intra_process_waitable =
+    [message_alloc](
+    rclcpp::SubscriptionBase::SharedPtr subscription,
+    rclcpp::Context::SharedPtr context,
+    const rcl_subscription_options_t & subscription_options
+    ) -> rclcpp::SubscriptionIntraProcessBase::SharedPtr
+    {
+      // Serialized messages are not stored in intra process, see Publisher::publish.
+      if (rclcpp::subscription_traits::is_serialized_subscription_argument<
+          CallbackMessageT>::value)
+      {
+        return nullptr;
+      }
+      using SubscriptionT = rclcpp::Subscription<CallbackMessageT, Alloc>;
+      auto typed_subscription = std::dynamic_pointer_cast<SubscriptionT>(subscription);
+      if (!typed_subscription) {
+        return nullptr;
+      }
+      return std::make_shared<rclcpp::SubscriptionIntraProcess<CallbackMessageT, Alloc>>(
+        typed_subscription, context, subscription_options.qos.depth, message_alloc);
+    };
+
   // return the factory now that it is populated
   return factory;
 }
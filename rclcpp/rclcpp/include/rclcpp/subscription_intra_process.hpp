@@ -0,0 +1,197 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__SUBSCRIPTION_INTRA_PROCESS_HPP_
+#define RCLCPP__SUBSCRIPTION_INTRA_PROCESS_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "rclcpp/allocator/allocator_common.hpp"
+#include "rclcpp/allocator/allocator_deleter.hpp"
+#include "rclcpp/context.hpp"
+#include "rclcpp/intra_process_queue.hpp"
+#include "rclcpp/macros.hpp"
+#include "rclcpp/subscription.hpp"
+#include "rclcpp/subscription_intra_process_base.hpp"
+
+namespace rclcpp
+{
+
+/// The part of SubscriptionIntraProcess that only depends on the message type.
+/**
+ * Publishers of MessageT hand shared messages over through this interface, whatever the allocator
+ * of the subscription.
+ */
+template<typename MessageT>
+class SubscriptionIntraProcessBuffer : public SubscriptionIntraProcessBase
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS_NOT_COPYABLE(SubscriptionIntraProcessBuffer<MessageT>)
+
+  explicit SubscriptionIntraProcessBuffer(rclcpp::Context::SharedPtr context)
+  : SubscriptionIntraProcessBase(context)
+  {}
+
+  virtual ~SubscriptionIntraProcessBuffer() = default;
+
+  /// Queue a message shared with other subscriptions. Thread-safe, does not block.
+  /**
+   * \param[in] message The message.
+   * \param[in] out_of_band_tracking_key The key of the publisher for out of band tracking.
+   */
+  virtual void
+  push(std::shared_ptr<const MessageT> message, uint32_t out_of_band_tracking_key) = 0;
+};
+
+/// Queue of intra process messages for one Subscription, executed by its executor.
+/**
+ * The queue keeps the last messages, as many as the history depth of the subscription: when it
+ * is full, the oldest message is dropped, as the middleware would.
+ *
+ * A message published to this subscription only can be pushed as a unique_ptr, which goes to a
+ * callback taking a unique_ptr without a copy. Shared messages are copied for such callbacks.
+ */
+template<typename MessageT, typename Alloc = std::allocator<void>>
+class SubscriptionIntraProcess : public SubscriptionIntraProcessBuffer<MessageT>
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS_NOT_COPYABLE(SubscriptionIntraProcess)
+
+  using SubscriptionT = rclcpp::Subscription<MessageT, Alloc>;
+  using MessageAllocTraits = typename SubscriptionT::MessageAllocTraits;
+  using MessageAlloc = typename SubscriptionT::MessageAlloc;
+  using MessageDeleter = typename SubscriptionT::MessageDeleter;
+  using ConstMessageSharedPtr = typename SubscriptionT::ConstMessageSharedPtr;
+  using MessageUniquePtr = typename SubscriptionT::MessageUniquePtr;
+
+  /// Constructor.
+  /**
+   * \param[in] subscription The subscription to deliver to, only referenced weakly.
+   * \param[in] context The context of the node of the subscription.
+   * \param[in] depth The number of messages to keep, rounded up to a power of two.
+   * \param[in] allocator Allocates the copies made for callbacks taking a unique_ptr.
+   */
+  SubscriptionIntraProcess(
+    std::shared_ptr<SubscriptionT> subscription,
+    rclcpp::Context::SharedPtr context,
+    size_t depth,
+    std::shared_ptr<MessageAlloc> allocator)
+  : SubscriptionIntraProcessBuffer<MessageT>(context),
+    subscription_(subscription),
+    queue_(std::max<size_t>(depth, 1)),
+    message_allocator_(allocator)
+  {
+    allocator::set_allocator_for_deleter(&message_deleter_, message_allocator_.get());
+  }
+
+  virtual ~SubscriptionIntraProcess() = default;
+
+  void
+  push(ConstMessageSharedPtr message, uint32_t out_of_band_tracking_key) override
+  {
+    Item item;
+    item.shared = std::move(message);
+    item.out_of_band_tracking_key = out_of_band_tracking_key;
+    push_item(std::move(item));
+  }
+
+  /// Queue a message that no other subscription receives. Thread-safe, does not block.
+  void
+  push(MessageUniquePtr message, uint32_t out_of_band_tracking_key)
+  {
+    Item item;
+    item.unique = std::move(message);
+    item.out_of_band_tracking_key = out_of_band_tracking_key;
+    push_item(std::move(item));
+  }
+
+  bool
+  has_data() const override
+  {
+    return !queue_.empty();
+  }
+
+  /// Deliver up to the batch size of the subscription of the queued messages, oldest first.
+  void
+  execute() override
+  {
+    this->clear_notified();
+    auto subscription = subscription_.lock();
+    if (!subscription) {
+      return;
+    }
+    size_t batch_size = std::max<size_t>(subscription->get_batch_size(), 1);
+    Item item;
+    for (size_t taken = 0; taken < batch_size && queue_.try_pop(item); ++taken) {
+      if (subscription->use_take_shared_method()) {
+        if (item.unique) {
+          item.shared = std::move(item.unique);
+        }
+        subscription->handle_direct_intra_process_message(
+          std::move(item.shared), item.out_of_band_tracking_key);
+      } else {
+        if (!item.unique) {
+          item.unique = copy(*item.shared);
+          item.shared.reset();
+        }
+        subscription->handle_direct_intra_process_message(
+          std::move(item.unique), item.out_of_band_tracking_key);
+      }
+    }
+    if (!queue_.empty()) {
+      // Left for the next turn, so the other entities of the callback group get theirs.
+      this->notify();
+    }
+  }
+
+private:
+  RCLCPP_DISABLE_COPY(SubscriptionIntraProcess)
+
+  struct Item
+  {
+    ConstMessageSharedPtr shared;
+    MessageUniquePtr unique;
+    uint32_t out_of_band_tracking_key = 0;
+  };
+
+  void
+  push_item(Item && item)
+  {
+    while (!queue_.try_push(std::move(item))) {
+      Item oldest;
+      queue_.try_pop(oldest);
+    }
+    this->notify();
+  }
+
+  MessageUniquePtr
+  copy(const MessageT & message)
+  {
+    auto ptr = MessageAllocTraits::allocate(*message_allocator_.get(), 1);
+    MessageAllocTraits::construct(*message_allocator_.get(), ptr, message);
+    return MessageUniquePtr(ptr, message_deleter_);
+  }
+
+  std::weak_ptr<SubscriptionT> subscription_;
+  IntraProcessQueue<Item> queue_;
+  std::shared_ptr<MessageAlloc> message_allocator_;
+  MessageDeleter message_deleter_;
+};
+
+}  // namespace rclcpp
+
+#endif  // RCLCPP__SUBSCRIPTION_INTRA_PROCESS_HPP_
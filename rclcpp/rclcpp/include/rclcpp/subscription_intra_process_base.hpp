@@ -0,0 +1,90 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__SUBSCRIPTION_INTRA_PROCESS_BASE_HPP_
+#define RCLCPP__SUBSCRIPTION_INTRA_PROCESS_BASE_HPP_
+
+#include <atomic>
+#include <memory>
+
+#include "rcl/guard_condition.h"
+#include "rcl/wait.h"
+
+#include "rclcpp/context.hpp"
+#include "rclcpp/macros.hpp"
+#include "rclcpp/visibility_control.hpp"
+#include "rclcpp/waitable.hpp"
+
+namespace rclcpp
+{
+
+/// Waitable through which intra process publishers hand messages to a subscription directly.
+/**
+ * Publishers push messages into a queue of the subscription (see SubscriptionIntraProcess) and
+ * trigger a guard condition to wake the executor, which then executes this waitable in the
+ * callback group of the subscription. Messages never go through the middleware: no
+ * IntraProcessMessage is serialized, written and received by a middleware thread.
+ *
+ * The guard condition is only triggered when the queue goes from empty to not empty, so a burst
+ * of messages costs one wake up. is_ready() looks at the queue rather than at the guard condition.
+ */
+class SubscriptionIntraProcessBase : public rclcpp::Waitable
+{
+public:
+  RCLCPP_SMART_PTR_DEFINITIONS_NOT_COPYABLE(SubscriptionIntraProcessBase)
+
+  RCLCPP_PUBLIC
+  explicit SubscriptionIntraProcessBase(rclcpp::Context::SharedPtr context);
+
+  RCLCPP_PUBLIC
+  virtual ~SubscriptionIntraProcessBase();
+
+  RCLCPP_PUBLIC
+  size_t
+  get_number_of_ready_guard_conditions() override;
+
+  RCLCPP_PUBLIC
+  bool
+  add_to_wait_set(rcl_wait_set_t * wait_set) override;
+
+  RCLCPP_PUBLIC
+  bool
+  is_ready(rcl_wait_set_t * wait_set) override;
+
+  /// Whether a message is queued.
+  virtual bool
+  has_data() const = 0;
+
+protected:
+  /// Wake the executor, unless it has been woken for the queued messages already.
+  /** Call after queueing a message. */
+  RCLCPP_PUBLIC
+  void
+  notify();
+
+  /// Call before taking messages: messages queued after this call notify again.
+  RCLCPP_PUBLIC
+  void
+  clear_notified();
+
+private:
+  RCLCPP_DISABLE_COPY(SubscriptionIntraProcessBase)
+
+  rcl_guard_condition_t guard_condition_;
+  std::atomic_bool notified_;
+};
+
+}  // namespace rclcpp
+
+#endif  // RCLCPP__SUBSCRIPTION_INTRA_PROCESS_BASE_HPP_
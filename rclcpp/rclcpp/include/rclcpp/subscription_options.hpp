@@ -24,6 +24,7 @@
 #include "rclcpp/intra_process_setting.hpp"
 #include "rclcpp/qos.hpp"
 #include "rclcpp/qos_event.hpp"
+#include "rclcpp/shared_memory_transport_options.hpp"
 #include "rclcpp/visibility_control.hpp"
 
 namespace rclcpp
@@ -40,6 +41,8 @@ struct SubscriptionOptionsBase
   rclcpp::callback_group::CallbackGroup::SharedPtr callback_group = nullptr;
   /// Setting to explicitly set intraprocess communications.
   IntraProcessSetting use_intra_process_comm = IntraProcessSetting::NodeDefault;
+  /// Receive messages through shared memory from the publishers on the same host.
+  SharedMemoryTransportOptions shared_memory_transport;
 
   // Setting to explicitly set tracking behavior of subscribed-to messages.
   MessageTrackerOptions message_tracker_opts = MessageTrackerOptions(
@@ -63,6 +66,16 @@ struct SubscriptionOptionsWithAllocator : public SubscriptionOptionsBase
   : SubscriptionOptionsBase(subscription_options_base)
   {}
 
+  /// Get the allocator, creating one if needed.
+  std::shared_ptr<Allocator>
+  get_allocator() const
+  {
+    if (!allocator) {
+      return std::make_shared<Allocator>();
+    }
+    return allocator;
+  }
+
   /// Convert this class, with a rclcpp::QoS, into an rcl_subscription_options_t.
   template<typename MessageT>
   rcl_subscription_options_t
@@ -71,7 +84,7 @@ struct SubscriptionOptionsWithAllocator : public SubscriptionOptionsBase
     rcl_subscription_options_t result;
     using AllocatorTraits = std::allocator_traits<Allocator>;
     using MessageAllocatorT = typename AllocatorTraits::template rebind_alloc<MessageT>;
-    auto message_alloc = std::make_shared<MessageAllocatorT>(*allocator.get());
+    auto message_alloc = std::make_shared<MessageAllocatorT>(*this->get_allocator());
     result.allocator = allocator::get_rcl_allocator<MessageT>(*message_alloc);
     result.ignore_local_publications = this->ignore_local_publications;
     result.qos = qos.get_rmw_qos_profile();
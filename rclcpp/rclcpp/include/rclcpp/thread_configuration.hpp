@@ -0,0 +1,79 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCLCPP__THREAD_CONFIGURATION_HPP_
+#define RCLCPP__THREAD_CONFIGURATION_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rclcpp/visibility_control.hpp"
+
+namespace rclcpp
+{
+namespace executor
+{
+
+/// Linux scheduling policy of an executor thread.
+/**
+ * INHERIT leaves the thread as it was created (or as the caller of spin() left it).
+ * FIFO and ROUND_ROBIN use ThreadConfiguration::priority (1 to 99).
+ * DEADLINE uses runtime, deadline and period. The kernel refuses it for threads whose CPU set is
+ * smaller than their root domain, so do not combine it with ThreadConfiguration::cpus unless the
+ * CPUs are isolated in a cpuset of their own.
+ * The real-time policies need CAP_SYS_NICE or a suitable RLIMIT_RTPRIO.
+ */
+enum class ThreadSchedulingPolicy {INHERIT, OTHER, FIFO, ROUND_ROBIN, DEADLINE};
+
+/// How an executor sets up one of its threads before it starts spinning.
+struct ThreadConfiguration
+{
+  /// CPUs the thread may run on. Empty leaves the affinity alone.
+  std::vector<size_t> cpus;
+
+  ThreadSchedulingPolicy scheduling_policy = ThreadSchedulingPolicy::INHERIT;
+  /// FIFO and ROUND_ROBIN only.
+  int priority = 0;
+  /// DEADLINE only: the thread gets runtime of CPU time every period, before deadline.
+  std::chrono::nanoseconds runtime = std::chrono::nanoseconds(0);
+  std::chrono::nanoseconds deadline = std::chrono::nanoseconds(0);
+  std::chrono::nanoseconds period = std::chrono::nanoseconds(0);
+
+  /// Touch this much of the stack up front, so the first deep callback does not page fault.
+  /** Only useful together with locked memory, see ExecutorArgs::lock_memory. */
+  size_t stack_prefault_size = 0;
+};
+
+/// Apply a configuration to the calling thread.
+/**
+ * \throws std::runtime_error when the operating system refuses, or does not support, a setting.
+ */
+RCLCPP_PUBLIC
+void
+configure_current_thread(const ThreadConfiguration & configuration);
+
+/// Lock all current and future pages of the process in memory (mlockall).
+/**
+ * \throws std::runtime_error when it fails, typically for lack of CAP_IPC_LOCK or RLIMIT_MEMLOCK.
+ */
+RCLCPP_PUBLIC
+void
+lock_process_memory();
+
+}  // namespace executor
+}  // namespace rclcpp
+
+#endif  // RCLCPP__THREAD_CONFIGURATION_HPP_
@@ -102,6 +102,11 @@ public:
   RCLCPP_PUBLIC
   bool is_ready();
 
+  /// Hand the violations counted during the last callback execution to the jitter tracker.
+  RCLCPP_PUBLIC
+  void
+  report_realtime_violations(const rclcpp::RealtimeViolationCounts & counts);
+
 protected:
   Clock::SharedPtr clock_;
   std::shared_ptr<rcl_timer_t> timer_handle_;
@@ -0,0 +1,622 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/allocator/tlsf_allocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using rclcpp::allocator::TlsfArena;
+using rclcpp::allocator::TlsfArenaStatistics;
+using rclcpp::allocator::TlsfHeap;
+
+namespace
+{
+
+// Block sizes are multiples of the alignment. Below small_block_size each size has its own free
+// list, above it each power of two (first level) is split in sl_count ranges (second level).
+constexpr unsigned alignment_log2 = 4;
+constexpr size_t alignment = size_t(1) << alignment_log2;
+constexpr unsigned sl_count_log2 = 5;
+constexpr unsigned sl_count = 1u << sl_count_log2;
+constexpr unsigned fl_shift = sl_count_log2 + alignment_log2;
+constexpr size_t small_block_size = size_t(1) << fl_shift;
+constexpr unsigned fl_max = 40;
+constexpr unsigned fl_count = fl_max - fl_shift + 1;
+constexpr size_t block_size_max = size_t(1) << fl_max;
+
+// Frees of other threads merged back per allocation, so that they do not make it unbounded.
+constexpr size_t remote_frees_per_allocation = 8;
+
+static_assert(alignof(std::max_align_t) <= alignment, "blocks must suit any fundamental type");
+static_assert(fl_count <= 64, "the first level bitmap has 64 bits");
+
+/// Index of the highest bit set, x must not be zero.
+unsigned
+highest_bit(size_t x)
+{
+#if defined(__GNUC__)
+  return 63 - static_cast<unsigned>(__builtin_clzll(x));
+#else
+  unsigned bit = 0;
+  while (x >>= 1) {
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+/// Index of the lowest bit set, x must not be zero.
+unsigned
+lowest_bit(uint64_t x)
+{
+#if defined(__GNUC__)
+  return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+  unsigned bit = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+/// Free list of the blocks of this size.
+void
+mapping_insert(size_t size, unsigned & fl, unsigned & sl)
+{
+  if (size < small_block_size) {
+    fl = 0;
+    sl = static_cast<unsigned>(size >> alignment_log2);
+  } else {
+    unsigned bit = highest_bit(size);
+    sl = static_cast<unsigned>(size >> (bit - sl_count_log2)) ^ sl_count;
+    fl = bit - fl_shift + 1;
+  }
+}
+
+/// First free list whose blocks are all at least this large.
+void
+mapping_search(size_t size, unsigned & fl, unsigned & sl)
+{
+  if (size >= small_block_size) {
+    size += (size_t(1) << (highest_bit(size) - sl_count_log2)) - 1;
+  }
+  mapping_insert(size, fl, sl);
+}
+
+std::atomic<uint64_t> next_thread_id{1};
+
+/// Identifies the calling thread as the owner of an arena. Never reused, 0 is no thread.
+uint64_t
+this_thread_id()
+{
+  thread_local const uint64_t id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+// The arena the calling thread last allocated from, by the serial number of its heap.
+struct ThreadArenaCache
+{
+  uint64_t heap_serial = 0;
+  TlsfArena * arena = nullptr;
+};
+thread_local ThreadArenaCache thread_arena_cache;
+
+/// The arenas a thread claimed, released when it ends.
+struct ThreadArenas
+{
+  ~ThreadArenas();
+
+  std::vector<std::pair<uint64_t, TlsfArena *>> claimed;
+};
+thread_local ThreadArenas thread_arenas;
+// Set once thread_arenas is gone, after which the thread can not claim arenas anymore.
+thread_local bool thread_arenas_released = false;
+
+std::atomic<uint64_t> next_heap_serial{1};
+
+/// The serial numbers of the heaps that exist, so that ending threads only touch those.
+struct LiveHeaps
+{
+  std::mutex mutex;
+  std::unordered_set<uint64_t> serials;
+};
+
+LiveHeaps &
+live_heaps()
+{
+  // Never destroyed: threads may end, and heaps be destroyed, during static destruction.
+  static LiveHeaps * heaps = new LiveHeaps();
+  return *heaps;
+}
+
+std::mutex &
+default_heap_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+TlsfHeap::SharedPtr &
+default_heap()
+{
+  static TlsfHeap::SharedPtr heap;
+  return heap;
+}
+
+}  // namespace
+
+namespace rclcpp
+{
+namespace allocator
+{
+
+/// One thread's part of a TlsfHeap. Only the owner allocates and frees, others use free_remote().
+class TlsfArena
+{
+public:
+  /// this_thread_id() of the owning thread, 0 while unclaimed.
+  std::atomic<uint64_t> owner{0};
+
+  void
+  init(unsigned char * memory, size_t size)
+  {
+    // One free block over the whole arena, followed by a used block without payload, so that
+    // every block has a next one.
+    Block * first = reinterpret_cast<Block *>(memory);
+    first->prev_physical = nullptr;
+    first->size = size - 2 * header_size;
+    Block * sentinel = next_physical(first);
+    sentinel->prev_physical = first;
+    sentinel->size = 0;
+    capacity_ = size - header_size;
+    first->size |= free_bit;
+    insert_free(first);
+  }
+
+  void *
+  allocate(size_t size)
+  {
+    merge_remote_frees(remote_frees_per_allocation);
+    size_t adjusted = size <= block_size_min ?
+      block_size_min : (size + alignment - 1) & ~(alignment - 1);
+    unsigned fl = 0;
+    unsigned sl = 0;
+    Block * block = nullptr;
+    if (size < block_size_max) {
+      mapping_search(adjusted, fl, sl);
+      if (fl < fl_count) {
+        block = find_free(fl, sl);
+        if (!block && (pending_frees_ || remote_frees_.load(std::memory_order_relaxed))) {
+          // Rather than fail, take the time to merge all of them.
+          merge_remote_frees(std::numeric_limits<size_t>::max());
+          mapping_search(adjusted, fl, sl);
+          block = find_free(fl, sl);
+        }
+      }
+    }
+    if (!block) {
+      failed_allocations_.store(
+        failed_allocations_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    remove_free(block);
+
+    // Split off what is not needed, if that makes a block.
+    size_t remaining = block_size(block) - adjusted;
+    if (remaining >= sizeof(Block)) {
+      Block * rest = reinterpret_cast<Block *>(payload(block) + adjusted);
+      rest->prev_physical = block;
+      rest->size = (remaining - header_size) | free_bit;
+      next_physical(rest)->prev_physical = rest;
+      block->size = adjusted;
+      insert_free(rest);
+    } else {
+      block->size = block_size(block);
+    }
+
+    size_t in_use = in_use_.load(std::memory_order_relaxed) + header_size + block->size;
+    in_use_.store(in_use, std::memory_order_relaxed);
+    if (in_use > high_water_mark_.load(std::memory_order_relaxed)) {
+      high_water_mark_.store(in_use, std::memory_order_relaxed);
+    }
+    allocations_.store(allocations_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return payload(block);
+  }
+
+  void
+  free(void * pointer)
+  {
+    Block * block = reinterpret_cast<Block *>(static_cast<unsigned char *>(pointer) - header_size);
+    size_t size = block_size(block);
+    in_use_.store(
+      in_use_.load(std::memory_order_relaxed) - header_size - size, std::memory_order_relaxed);
+
+    // Merge with the free neighbours, so that free blocks never touch.
+    Block * prev = block->prev_physical;
+    if (prev && is_free(prev)) {
+      remove_free(prev);
+      size += header_size + block_size(prev);
+      block = prev;
+      block->size = size;
+    }
+    Block * next = next_physical(block);
+    if (is_free(next)) {
+      remove_free(next);
+      size += header_size + block_size(next);
+    }
+    block->size = size | free_bit;
+    next_physical(block)->prev_physical = block;
+    insert_free(block);
+  }
+
+  /// Hand a block to the owner, from any thread.
+  void
+  free_remote(void * pointer)
+  {
+    RemoteFree * node = static_cast<RemoteFree *>(pointer);
+    RemoteFree * head = remote_frees_.load(std::memory_order_relaxed);
+    do {
+      node->next = head;
+    } while (!remote_frees_.compare_exchange_weak(
+      head, node, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  /// Give the arena up, from its owner, with the remote frees merged back.
+  /**
+   * Frees that come in later wait on the remote list for the next owner, who merges them.
+   */
+  void
+  release()
+  {
+    merge_remote_frees(std::numeric_limits<size_t>::max());
+    // The next owner sees all blocks as this thread left them.
+    owner.store(0, std::memory_order_release);
+  }
+
+  TlsfArenaStatistics
+  get_statistics() const
+  {
+    TlsfArenaStatistics statistics;
+    statistics.capacity = capacity_;
+    statistics.in_use = in_use_.load(std::memory_order_relaxed);
+    statistics.high_water_mark = high_water_mark_.load(std::memory_order_relaxed);
+    statistics.allocations = allocations_.load(std::memory_order_relaxed);
+    statistics.failed_allocations = failed_allocations_.load(std::memory_order_relaxed);
+    statistics.claimed = owner.load(std::memory_order_relaxed) != 0;
+    return statistics;
+  }
+
+private:
+  struct Block
+  {
+    // The block before this one in memory, nullptr for the first one.
+    Block * prev_physical;
+    // Of the payload, with free_bit set while free.
+    size_t size;
+    // Only while free, these take the place of the payload.
+    Block * next_free;
+    Block * prev_free;
+  };
+
+  struct RemoteFree
+  {
+    RemoteFree * next;
+  };
+
+  static constexpr size_t header_size = offsetof(Block, next_free);
+  static constexpr size_t block_size_min = sizeof(Block) - header_size;
+  static constexpr size_t free_bit = 1;
+
+  static_assert(header_size % alignment == 0, "payloads must stay aligned");
+  static_assert(block_size_min % alignment == 0, "block sizes must stay aligned");
+
+  static size_t
+  block_size(const Block * block)
+  {
+    return block->size & ~free_bit;
+  }
+
+  static bool
+  is_free(const Block * block)
+  {
+    return (block->size & free_bit) != 0;
+  }
+
+  static unsigned char *
+  payload(Block * block)
+  {
+    return reinterpret_cast<unsigned char *>(block) + header_size;
+  }
+
+  static Block *
+  next_physical(Block * block)
+  {
+    return reinterpret_cast<Block *>(payload(block) + block_size(block));
+  }
+
+  Block *
+  find_free(unsigned & fl, unsigned & sl)
+  {
+    uint32_t sl_map = sl_bitmap_[fl] & (~uint32_t(0) << sl);
+    if (!sl_map) {
+      uint64_t fl_map = fl_bitmap_ & (~uint64_t(0) << (fl + 1));
+      if (!fl_map) {
+        return nullptr;
+      }
+      fl = lowest_bit(fl_map);
+      sl_map = sl_bitmap_[fl];
+    }
+    sl = lowest_bit(sl_map);
+    return free_lists_[fl][sl];
+  }
+
+  void
+  insert_free(Block * block)
+  {
+    unsigned fl = 0;
+    unsigned sl = 0;
+    mapping_insert(block_size(block), fl, sl);
+    Block * head = free_lists_[fl][sl];
+    block->next_free = head;
+    block->prev_free = nullptr;
+    if (head) {
+      head->prev_free = block;
+    }
+    free_lists_[fl][sl] = block;
+    fl_bitmap_ |= uint64_t(1) << fl;
+    sl_bitmap_[fl] |= uint32_t(1) << sl;
+  }
+
+  void
+  remove_free(Block * block)
+  {
+    unsigned fl = 0;
+    unsigned sl = 0;
+    mapping_insert(block_size(block), fl, sl);
+    if (block->next_free) {
+      block->next_free->prev_free = block->prev_free;
+    }
+    if (block->prev_free) {
+      block->prev_free->next_free = block->next_free;
+      return;
+    }
+    free_lists_[fl][sl] = block->next_free;
+    if (!block->next_free) {
+      sl_bitmap_[fl] &= ~(uint32_t(1) << sl);
+      if (!sl_bitmap_[fl]) {
+        fl_bitmap_ &= ~(uint64_t(1) << fl);
+      }
+    }
+  }
+
+  /// Merge up to limit blocks freed by other threads, taking all that are waiting at once.
+  void
+  merge_remote_frees(size_t limit)
+  {
+    for (size_t merged = 0; merged < limit; ++merged) {
+      if (!pending_frees_) {
+        pending_frees_ = remote_frees_.exchange(nullptr, std::memory_order_acquire);
+        if (!pending_frees_) {
+          return;
+        }
+      }
+      RemoteFree * node = pending_frees_;
+      pending_frees_ = node->next;
+      free(node);
+    }
+  }
+
+  uint64_t fl_bitmap_ = 0;
+  uint32_t sl_bitmap_[fl_count] = {};
+  Block * free_lists_[fl_count][sl_count] = {};
+  std::atomic<RemoteFree *> remote_frees_{nullptr};
+  // Taken from remote_frees_, not merged yet. Only the owner uses it.
+  RemoteFree * pending_frees_ = nullptr;
+
+  size_t capacity_ = 0;
+  std::atomic<size_t> in_use_{0};
+  std::atomic<size_t> high_water_mark_{0};
+  std::atomic<uint64_t> allocations_{0};
+  std::atomic<uint64_t> failed_allocations_{0};
+};
+
+constexpr size_t TlsfHeap::default_arena_size;
+constexpr size_t TlsfHeap::default_arena_count;
+
+}  // namespace allocator
+}  // namespace rclcpp
+
+ThreadArenas::~ThreadArenas()
+{
+  thread_arenas_released = true;
+  thread_arena_cache = ThreadArenaCache();
+  LiveHeaps & heaps = live_heaps();
+  std::lock_guard<std::mutex> lock(heaps.mutex);
+  uint64_t id = this_thread_id();
+  for (const auto & entry : claimed) {
+    // Unless the heap is gone, or the arena was released with release_thread_arena() already.
+    if (heaps.serials.count(entry.first) &&
+      entry.second->owner.load(std::memory_order_relaxed) == id)
+    {
+      entry.second->release();
+    }
+  }
+}
+
+TlsfHeap::TlsfHeap(size_t arena_size, size_t arena_count)
+: serial_(next_heap_serial.fetch_add(1, std::memory_order_relaxed)),
+  arena_size_(arena_size & ~(alignment - 1)),
+  arena_count_(arena_count)
+{
+  // Room for one block of the smallest size, next to the largest block the free lists map.
+  if (arena_size_ < 4 * alignment || arena_size_ > block_size_max) {
+    throw std::invalid_argument("TLSF arena size out of range");
+  }
+  if (arena_count_ == 0 || arena_count_ > std::numeric_limits<size_t>::max() / arena_size_) {
+    throw std::invalid_argument("TLSF arena count out of range");
+  }
+  memory_.reset(new unsigned char[arena_size_ * arena_count_]);
+  // Touch every page now, rather than on some allocation later on.
+  std::memset(memory_.get(), 0, arena_size_ * arena_count_);
+  arenas_.reset(new TlsfArena[arena_count_]);
+  for (size_t i = 0; i < arena_count_; ++i) {
+    arenas_[i].init(memory_.get() + i * arena_size_, arena_size_);
+  }
+  LiveHeaps & heaps = live_heaps();
+  std::lock_guard<std::mutex> lock(heaps.mutex);
+  heaps.serials.insert(serial_);
+}
+
+TlsfHeap::~TlsfHeap()
+{
+  // Threads that end from now on leave the arenas alone.
+  LiveHeaps & heaps = live_heaps();
+  std::lock_guard<std::mutex> lock(heaps.mutex);
+  heaps.serials.erase(serial_);
+}
+
+TlsfHeap::SharedPtr
+TlsfHeap::get_default()
+{
+  std::lock_guard<std::mutex> lock(default_heap_mutex());
+  if (!default_heap()) {
+    default_heap() = std::make_shared<TlsfHeap>(default_arena_size, default_arena_count);
+  }
+  return default_heap();
+}
+
+void
+TlsfHeap::set_default(SharedPtr heap)
+{
+  std::lock_guard<std::mutex> lock(default_heap_mutex());
+  default_heap() = std::move(heap);
+}
+
+void *
+TlsfHeap::allocate(size_t size)
+{
+  TlsfArena * arena = get_thread_arena(true);
+  void * pointer = arena ? arena->allocate(size) : nullptr;
+  if (!pointer) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void
+TlsfHeap::deallocate(void * pointer) noexcept
+{
+  if (!pointer) {
+    return;
+  }
+  size_t index = static_cast<size_t>(static_cast<unsigned char *>(pointer) - memory_.get()) /
+    arena_size_;
+  TlsfArena & arena = arenas_[index];
+  // Only the owner itself can see its own id, so no ordering is needed.
+  if (arena.owner.load(std::memory_order_relaxed) == this_thread_id()) {
+    arena.free(pointer);
+  } else {
+    arena.free_remote(pointer);
+  }
+}
+
+bool
+TlsfHeap::claim_thread_arena()
+{
+  return get_thread_arena(true) != nullptr;
+}
+
+void
+TlsfHeap::release_thread_arena()
+{
+  TlsfArena * arena = get_thread_arena(false);
+  if (!arena) {
+    return;
+  }
+  thread_arena_cache = ThreadArenaCache();
+  arena->release();
+}
+
+size_t
+TlsfHeap::get_arena_size() const
+{
+  return arena_size_;
+}
+
+size_t
+TlsfHeap::get_arena_count() const
+{
+  return arena_count_;
+}
+
+TlsfArenaStatistics
+TlsfHeap::get_arena_statistics(size_t index) const
+{
+  if (index >= arena_count_) {
+    throw std::out_of_range("no such TLSF arena");
+  }
+  return arenas_[index].get_statistics();
+}
+
+TlsfArena *
+TlsfHeap::get_thread_arena(bool claim)
+{
+  ThreadArenaCache & cache = thread_arena_cache;
+  if (cache.heap_serial == serial_) {
+    return cache.arena;
+  }
+  uint64_t id = this_thread_id();
+  TlsfArena * arena = nullptr;
+  for (size_t i = 0; i < arena_count_ && !arena; ++i) {
+    if (arenas_[i].owner.load(std::memory_order_acquire) == id) {
+      arena = &arenas_[i];
+    }
+  }
+  if (!arena && claim && !thread_arenas_released) {
+    // Room for the entry first, so that a claimed arena is always released when the thread ends.
+    thread_arenas.claimed.reserve(thread_arenas.claimed.size() + 1);
+    for (size_t i = 0; i < arena_count_ && !arena; ++i) {
+      uint64_t unclaimed = 0;
+      if (arenas_[i].owner.compare_exchange_strong(
+          unclaimed, id, std::memory_order_acq_rel, std::memory_order_relaxed))
+      {
+        arena = &arenas_[i];
+      }
+    }
+    std::pair<uint64_t, TlsfArena *> entry(serial_, arena);
+    if (arena && std::find(
+        thread_arenas.claimed.begin(), thread_arenas.claimed.end(), entry) ==
+      thread_arenas.claimed.end())
+    {
+      thread_arenas.claimed.push_back(entry);
+    }
+  }
+  if (arena) {
+    cache.heap_serial = serial_;
+    cache.arena = arena;
+  }
+  return arena;
+}
@@ -20,7 +20,7 @@ using rclcpp::callback_group::CallbackGroup;
 using rclcpp::callback_group::CallbackGroupType;
 
 CallbackGroup::CallbackGroup(CallbackGroupType group_type)
-: type_(group_type), can_be_taken_from_(true)
+: type_(group_type), can_be_taken_from_(true), priority_(0), relative_deadline_ns_(0)
 {}
 
 const std::vector<rclcpp::SubscriptionBase::WeakPtr> &
@@ -70,6 +70,30 @@ CallbackGroup::type() const
   return type_;
 }
 
+void
+CallbackGroup::set_priority(int32_t priority)
+{
+  priority_.store(priority);
+}
+
+int32_t
+CallbackGroup::get_priority() const
+{
+  return priority_.load();
+}
+
+void
+CallbackGroup::set_relative_deadline(std::chrono::nanoseconds relative_deadline)
+{
+  relative_deadline_ns_.store(relative_deadline.count());
+}
+
+std::chrono::nanoseconds
+CallbackGroup::get_relative_deadline() const
+{
+  return std::chrono::nanoseconds(relative_deadline_ns_.load());
+}
+
 void
 CallbackGroup::add_subscription(
   const rclcpp::SubscriptionBase::SharedPtr subscription_ptr)
@@ -13,9 +13,13 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "rcl/allocator.h"
 #include "rcl/error_handling.h"
@@ -36,10 +40,29 @@ using rclcpp::executor::Executor;
 using rclcpp::executor::ExecutorArgs;
 using rclcpp::executor::FutureReturnCode;
 
+namespace
+{
+// Executables a scheduling policy can queue before the queue allocates.
+constexpr size_t initial_ready_capacity = 64;
+}  // namespace
+
 Executor::Executor(const ExecutorArgs & args)
 : spinning(false),
-  memory_strategy_(args.memory_strategy)
+  memory_strategy_(args.memory_strategy),
+  track_realtime_violations_(args.track_realtime_violations),
+  subscription_batch_size_(std::max<size_t>(args.subscription_batch_size, 1)),
+  thread_configurations_(args.thread_configurations),
+  scheduling_policy_(args.scheduling_policy),
+  last_wait_end_(std::chrono::steady_clock::now())
 {
+  if (args.lock_memory) {
+    lock_process_memory();
+  }
+  if (scheduling_policy_ != SchedulingPolicy::FIFO) {
+    ready_executables_.reserve(initial_ready_capacity);
+    hidden_groups_.reserve(initial_ready_capacity);
+  }
+
   rcl_guard_condition_options_t guard_condition_options = rcl_guard_condition_get_default_options();
   rcl_ret_t ret = rcl_guard_condition_init(
     &interrupt_guard_condition_, args.context->get_rcl_context().get(), guard_condition_options);
@@ -82,6 +105,12 @@ Executor::Executor(const ExecutorArgs & args)
 
 Executor::~Executor()
 {
+  // Queued executables never marked their group, so they must not release it either.
+  for (auto & entry : ready_executables_) {
+    entry.executable.callback_group.reset();
+  }
+  ready_executables_.clear();
+
   // Disassocate all nodes
   for (auto & weak_node : weak_nodes_) {
     auto node = weak_node.lock();
@@ -140,7 +169,7 @@ Executor::add_node(rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_pt
     }
   }
   // Add the node's notify condition to the guard condition handles
-  std::unique_lock<std::mutex> lock(memory_strategy_mutex_);
+  auto lock = rclcpp::lock_counting_contention(memory_strategy_mutex_);
   memory_strategy_->add_guard_condition(node_ptr->get_notify_guard_condition());
 }
 
@@ -179,7 +208,7 @@ Executor::remove_node(rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node
       }
     }
   }
-  std::unique_lock<std::mutex> lock(memory_strategy_mutex_);
+  auto lock = rclcpp::lock_counting_contention(memory_strategy_mutex_);
   memory_strategy_->remove_guard_condition(node_ptr->get_notify_guard_condition());
 }
 
@@ -281,20 +310,83 @@ Executor::set_memory_strategy(rclcpp::memory_strategy::MemoryStrategy::SharedPtr
   memory_strategy_ = memory_strategy;
 }
 
+void
+Executor::configure_thread(size_t thread_number)
+{
+  if (thread_number < thread_configurations_.size()) {
+    configure_current_thread(thread_configurations_[thread_number]);
+  }
+}
+
+bool
+Executor::configure_thread_or_cancel(size_t thread_number)
+{
+  try {
+    configure_thread(thread_number);
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(thread_configuration_error_mutex_);
+      if (!thread_configuration_error_) {
+        thread_configuration_error_ = std::current_exception();
+      }
+    }
+    cancel();
+    return false;
+  }
+  return true;
+}
+
+void
+Executor::rethrow_thread_configuration_error()
+{
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(thread_configuration_error_mutex_);
+    std::swap(error, thread_configuration_error_);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+rclcpp::executor::SchedulingPolicy
+Executor::get_scheduling_policy() const
+{
+  return scheduling_policy_;
+}
+
+std::map<int32_t, rclcpp::executor::DispatchLatencyStatistics>
+Executor::get_dispatch_latency_statistics() const
+{
+  std::lock_guard<std::mutex> lock(dispatch_latency_mutex_);
+  return dispatch_latency_statistics_;
+}
+
+void
+Executor::reset_dispatch_latency_statistics()
+{
+  std::lock_guard<std::mutex> lock(dispatch_latency_mutex_);
+  dispatch_latency_statistics_.clear();
+}
+
 void
 Executor::execute_any_executable(AnyExecutable & any_exec)
 {
   if (!spinning.load()) {
     return;
   }
+  rclcpp::RealtimeViolationScope violation_scope(track_realtime_violations_);
   if (any_exec.timer) {
     execute_timer(any_exec.timer);
   }
   if (any_exec.subscription) {
-    execute_subscription(any_exec.subscription);
+    execute_subscription(
+      any_exec.subscription, get_subscription_batch_size(*any_exec.subscription));
   }
   if (any_exec.subscription_intra_process) {
-    execute_intra_process_subscription(any_exec.subscription_intra_process);
+    execute_intra_process_subscription(
+      any_exec.subscription_intra_process,
+      get_subscription_batch_size(*any_exec.subscription_intra_process));
   }
   if (any_exec.service) {
     execute_service(any_exec.service);
@@ -305,6 +397,9 @@ Executor::execute_any_executable(AnyExecutable & any_exec)
   if (any_exec.waitable) {
     any_exec.waitable->execute();
   }
+  if (track_realtime_violations_) {
+    report_realtime_violations(any_exec, violation_scope.counts());
+  }
   // Reset the callback_group, regardless of type
   any_exec.callback_group->can_be_taken_from().store(true);
   // Wake the wait, because it may need to be recalculated or work that
@@ -315,68 +410,172 @@ Executor::execute_any_executable(AnyExecutable & any_exec)
 }
 
 void
+Executor::report_realtime_violations(
+  AnyExecutable & any_exec,
+  const rclcpp::RealtimeViolationCounts & counts)
+{
+  if (!counts.any()) {
+    return;
+  }
+  if (any_exec.timer) {
+    any_exec.timer->report_realtime_violations(counts);
+  }
+  if (any_exec.subscription) {
+    any_exec.subscription->report_realtime_violations(counts);
+  }
+  if (any_exec.subscription_intra_process) {
+    any_exec.subscription_intra_process->report_realtime_violations(counts);
+  }
+}
+
+size_t
+Executor::get_subscription_batch_size(const rclcpp::SubscriptionBase & subscription) const
+{
+  size_t batch_size = subscription.get_batch_size();
+  return batch_size ? batch_size : subscription_batch_size_;
+}
+
+size_t
 Executor::execute_subscription(
-  rclcpp::SubscriptionBase::SharedPtr subscription)
+  rclcpp::SubscriptionBase::SharedPtr subscription,
+  size_t max_messages)
 {
+  max_messages = std::max<size_t>(max_messages, 1);
   rmw_message_info_t message_info;
   message_info.from_intra_process = false;
 
+  // Taking and returning the messages is not the callback's doing, only handling them counts.
+  size_t taken = 0;
   if (subscription->is_serialized()) {
-    auto serialized_msg = subscription->create_serialized_message();
-    auto ret = rcl_take_serialized_message(
-      subscription->get_subscription_handle().get(),
-      serialized_msg.get(), &message_info, nullptr);
-    if (RCL_RET_OK == ret) {
-      auto void_serialized_msg = std::static_pointer_cast<void>(serialized_msg);
-      subscription->handle_message(void_serialized_msg, message_info);
-    } else if (RCL_RET_SUBSCRIPTION_TAKE_FAILED != ret) {
-      RCUTILS_LOG_ERROR_NAMED(
-        "rclcpp",
-        "take_serialized failed for subscription on topic '%s': %s",
-        subscription->get_topic_name(), rcl_get_error_string().str);
-      rcl_reset_error();
+    for (; taken < max_messages; ++taken) {
+      std::shared_ptr<rcl_serialized_message_t> serialized_msg;
+      rcl_ret_t ret;
+      {
+        rclcpp::RealtimeViolationPause pause;
+        serialized_msg = subscription->create_serialized_message();
+        ret = rcl_take_serialized_message(
+          subscription->get_subscription_handle().get(),
+          serialized_msg.get(), &message_info, nullptr);
+      }
+      if (RCL_RET_OK == ret) {
+        auto void_serialized_msg = std::static_pointer_cast<void>(serialized_msg);
+        subscription->handle_message(void_serialized_msg, message_info);
+      } else if (RCL_RET_SUBSCRIPTION_TAKE_FAILED != ret) {
+        RCUTILS_LOG_ERROR_NAMED(
+          "rclcpp",
+          "take_serialized failed for subscription on topic '%s': %s",
+          subscription->get_topic_name(), rcl_get_error_string().str);
+        rcl_reset_error();
+      }
+      {
+        rclcpp::RealtimeViolationPause pause;
+        subscription->return_serialized_message(serialized_msg);
+      }
+      if (RCL_RET_OK != ret) {
+        break;
+      }
+    }
+  } else if (subscription->has_batch_callback()) {
+    std::vector<std::shared_ptr<void>> messages;
+    std::vector<rmw_message_info_t> message_infos;
+    {
+      rclcpp::RealtimeViolationPause pause;
+      messages.reserve(max_messages);
+      message_infos.reserve(max_messages);
+      while (messages.size() < max_messages) {
+        std::shared_ptr<void> message = subscription->create_message();
+        auto ret = rcl_take(
+          subscription->get_subscription_handle().get(),
+          message.get(), &message_info, nullptr);
+        if (RCL_RET_OK != ret) {
+          if (RCL_RET_SUBSCRIPTION_TAKE_FAILED != ret) {
+            RCUTILS_LOG_ERROR_NAMED(
+              "rclcpp",
+              "could not deserialize serialized message on topic '%s': %s",
+              subscription->get_topic_name(), rcl_get_error_string().str);
+            rcl_reset_error();
+          }
+          subscription->return_message(message);
+          break;
+        }
+        messages.emplace_back(std::move(message));
+        message_infos.push_back(message_info);
+      }
+    }
+    taken = messages.size();
+    if (!messages.empty()) {
+      subscription->handle_message_batch(messages, message_infos);
+    }
+    rclcpp::RealtimeViolationPause pause;
+    for (auto & message : messages) {
+      subscription->return_message(message);
     }
-    subscription->return_serialized_message(serialized_msg);
   } else {
-    std::shared_ptr<void> message = subscription->create_message();
-    auto ret = rcl_take(
-      subscription->get_subscription_handle().get(),
-      message.get(), &message_info, nullptr);
-    if (RCL_RET_OK == ret) {
-      subscription->handle_message(message, message_info);
-    } else if (RCL_RET_SUBSCRIPTION_TAKE_FAILED != ret) {
-      RCUTILS_LOG_ERROR_NAMED(
-        "rclcpp",
-        "could not deserialize serialized message on topic '%s': %s",
-        subscription->get_topic_name(), rcl_get_error_string().str);
-      rcl_reset_error();
+    for (; taken < max_messages; ++taken) {
+      std::shared_ptr<void> message;
+      rcl_ret_t ret;
+      {
+        rclcpp::RealtimeViolationPause pause;
+        message = subscription->create_message();
+        ret = rcl_take(
+          subscription->get_subscription_handle().get(),
+          message.get(), &message_info, nullptr);
+      }
+      if (RCL_RET_OK == ret) {
+        subscription->handle_message(message, message_info);
+      } else if (RCL_RET_SUBSCRIPTION_TAKE_FAILED != ret) {
+        RCUTILS_LOG_ERROR_NAMED(
+          "rclcpp",
+          "could not deserialize serialized message on topic '%s': %s",
+          subscription->get_topic_name(), rcl_get_error_string().str);
+        rcl_reset_error();
+      }
+      {
+        rclcpp::RealtimeViolationPause pause;
+        subscription->return_message(message);
+      }
+      if (RCL_RET_OK != ret) {
+        break;
+      }
     }
-    subscription->return_message(message);
   }
+  return taken;
 }
 
-void
+size_t
 Executor::execute_intra_process_subscription(
-  rclcpp::SubscriptionBase::SharedPtr subscription)
+  rclcpp::SubscriptionBase::SharedPtr subscription,
+  size_t max_messages)
 {
-  rcl_interfaces::msg::IntraProcessMessage ipm;
-  rmw_message_info_t message_info;
-  rcl_ret_t status = rcl_take(
-    subscription->get_intra_process_subscription_handle().get(),
-    &ipm,
-    &message_info,
-    nullptr);
+  max_messages = std::max<size_t>(max_messages, 1);
+  size_t taken = 0;
+  for (; taken < max_messages; ++taken) {
+    rcl_interfaces::msg::IntraProcessMessage ipm;
+    rmw_message_info_t message_info;
+    rcl_ret_t status;
+    {
+      rclcpp::RealtimeViolationPause pause;
+      status = rcl_take(
+        subscription->get_intra_process_subscription_handle().get(),
+        &ipm,
+        &message_info,
+        nullptr);
+    }
 
-  if (status == RCL_RET_OK) {
-    message_info.from_intra_process = true;
-    subscription->handle_intra_process_message(ipm, message_info);
-  } else if (status != RCL_RET_SUBSCRIPTION_TAKE_FAILED) {
-    RCUTILS_LOG_ERROR_NAMED(
-      "rclcpp",
-      "take failed for intra process subscription on topic '%s': %s",
-      subscription->get_topic_name(), rcl_get_error_string().str);
-    rcl_reset_error();
+    if (status == RCL_RET_OK) {
+      message_info.from_intra_process = true;
+      subscription->handle_intra_process_message(ipm, message_info);
+      continue;
+    } else if (status != RCL_RET_SUBSCRIPTION_TAKE_FAILED) {
+      RCUTILS_LOG_ERROR_NAMED(
+        "rclcpp",
+        "take failed for intra process subscription on topic '%s': %s",
+        subscription->get_topic_name(), rcl_get_error_string().str);
+      rcl_reset_error();
+    }
+    break;
   }
+  return taken;
 }
 
 void
@@ -390,12 +589,18 @@ void
 Executor::execute_service(
   rclcpp::ServiceBase::SharedPtr service)
 {
-  auto request_header = service->create_request_header();
-  std::shared_ptr<void> request = service->create_request();
-  rcl_ret_t status = rcl_take_request(
-    service->get_service_handle().get(),
-    request_header.get(),
-    request.get());
+  std::shared_ptr<rmw_request_id_t> request_header;
+  std::shared_ptr<void> request;
+  rcl_ret_t status;
+  {
+    rclcpp::RealtimeViolationPause pause;
+    request_header = service->create_request_header();
+    request = service->create_request();
+    status = rcl_take_request(
+      service->get_service_handle().get(),
+      request_header.get(),
+      request.get());
+  }
   if (status == RCL_RET_OK) {
     service->handle_request(request_header, request);
   } else if (status != RCL_RET_SERVICE_TAKE_FAILED) {
@@ -411,12 +616,18 @@ void
 Executor::execute_client(
   rclcpp::ClientBase::SharedPtr client)
 {
-  auto request_header = client->create_request_header();
-  std::shared_ptr<void> response = client->create_response();
-  rcl_ret_t status = rcl_take_response(
-    client->get_client_handle().get(),
-    request_header.get(),
-    response.get());
+  std::shared_ptr<rmw_request_id_t> request_header;
+  std::shared_ptr<void> response;
+  rcl_ret_t status;
+  {
+    rclcpp::RealtimeViolationPause pause;
+    request_header = client->create_request_header();
+    response = client->create_response();
+    status = rcl_take_response(
+      client->get_client_handle().get(),
+      request_header.get(),
+      response.get());
+  }
   if (status == RCL_RET_OK) {
     client->handle_response(request_header, response);
   } else if (status != RCL_RET_CLIENT_TAKE_FAILED) {
@@ -432,7 +643,7 @@ void
 Executor::wait_for_work(std::chrono::nanoseconds timeout)
 {
   {
-    std::unique_lock<std::mutex> lock(memory_strategy_mutex_);
+    auto lock = rclcpp::lock_counting_contention(memory_strategy_mutex_);
 
     // Collect the subscriptions and timers to be waited on
     memory_strategy_->clear_handles();
@@ -484,6 +695,8 @@ Executor::wait_for_work(std::chrono::nanoseconds timeout)
     throw_from_rcl_error(status, "rcl_wait() failed");
   }
 
+  last_wait_end_ = std::chrono::steady_clock::now();
+
   // check the null handles in the wait set and remove them from the handles in memory strategy
   // for callback-based entities
   memory_strategy_->remove_null_handles(&wait_set_);
@@ -537,32 +750,15 @@ Executor::get_group_by_timer(rclcpp::TimerBase::SharedPtr timer)
 void
 Executor::get_next_timer(AnyExecutable & any_exec)
 {
-  for (auto & weak_node : weak_nodes_) {
-    auto node = weak_node.lock();
-    if (!node) {
-      continue;
-    }
-    for (auto & weak_group : node->get_callback_groups()) {
-      auto group = weak_group.lock();
-      if (!group || !group->can_be_taken_from().load()) {
-        continue;
-      }
-      for (auto & timer_ref : group->get_timer_ptrs()) {
-        auto timer = timer_ref.lock();
-        if (timer && timer->is_ready()) {
-          any_exec.timer = timer;
-          any_exec.callback_group = group;
-          node = get_node_by_group(group);
-          return;
-        }
-      }
-    }
-  }
+  memory_strategy_->get_next_timer(any_exec, weak_nodes_);
 }
 
 bool
 Executor::get_next_ready_executable(AnyExecutable & any_executable)
 {
+  if (scheduling_policy_ != SchedulingPolicy::FIFO) {
+    return get_next_scheduled_executable(any_executable);
+  }
   // Check the timers to see if there are any that are ready, if so return
   get_next_timer(any_executable);
   if (any_executable.timer) {
@@ -592,6 +788,151 @@ Executor::get_next_ready_executable(AnyExecutable & any_executable)
   return false;
 }
 
+bool
+Executor::get_next_scheduled_executable(AnyExecutable & any_executable)
+{
+  using rclcpp::executor::SchedulingPolicy;
+  using WeakNodeList = memory_strategy::MemoryStrategy::WeakNodeList;
+
+  // Drops an entry without releasing its callback group, which it never marked. Keeps the order
+  // of the others, which breaks ties: they are moved down, which leaves no group behind.
+  auto discard = [this](size_t index) {
+      ready_executables_[index].executable.callback_group.reset();
+      ready_executables_.erase(ready_executables_.begin() + static_cast<std::ptrdiff_t>(index));
+    };
+  auto is_queued = [this](const AnyExecutable & candidate, size_t count) {
+      for (size_t i = 0; i < count; ++i) {
+        const AnyExecutable & queued = ready_executables_[i].executable;
+        if (queued.timer == candidate.timer && queued.subscription == candidate.subscription &&
+          queued.subscription_intra_process == candidate.subscription_intra_process &&
+          queued.service == candidate.service && queued.client == candidate.client &&
+          queued.waitable == candidate.waitable)
+        {
+          return true;
+        }
+      }
+      return false;
+    };
+
+  // Move everything that became ready since the last call into the queue. A timer stays ready
+  // until it has been executed, and a subscription can show up again in the next wait while
+  // it is still queued, so skip what is already there.
+  //
+  // A memory strategy that polls the timers (the default) reports the same ready timer until it
+  // has been executed. So the group of every reported timer is hidden until all timers are in,
+  // and each call reports a timer of another group. Timers of one group share its priority and
+  // deadline, the next one of a group is queued once the first has been executed.
+  {
+    RCLCPP_SCOPE_EXIT(
+    {
+      for (auto & group : hidden_groups_) {
+        group->can_be_taken_from().store(true);
+      }
+      hidden_groups_.clear();
+    });
+    while (true) {
+      ready_executables_.emplace_back();
+      auto & entry = ready_executables_.back();
+      memory_strategy_->get_next_timer(entry.executable, weak_nodes_);
+      if (!entry.executable.timer) {
+        ready_executables_.pop_back();
+        break;
+      }
+      entry.executable.callback_group->can_be_taken_from().store(false);
+      hidden_groups_.push_back(entry.executable.callback_group);
+      if (is_queued(entry.executable, ready_executables_.size() - 1)) {
+        discard(ready_executables_.size() - 1);
+        continue;
+      }
+      // Overdue timers report a negative time until the trigger: when they became ready.
+      entry.ready_time = std::chrono::steady_clock::now() +
+        std::min(entry.executable.timer->time_until_trigger(), std::chrono::nanoseconds(0));
+    }
+  }
+  using GetNext = void (memory_strategy::MemoryStrategy::*)(AnyExecutable &, const WeakNodeList &);
+  for (GetNext get_next : {
+      &memory_strategy::MemoryStrategy::get_next_subscription,
+      &memory_strategy::MemoryStrategy::get_next_service,
+      &memory_strategy::MemoryStrategy::get_next_client,
+      &memory_strategy::MemoryStrategy::get_next_waitable})
+  {
+    while (true) {
+      ready_executables_.emplace_back();
+      auto & entry = ready_executables_.back();
+      ((*memory_strategy_).*get_next)(entry.executable, weak_nodes_);
+      if (!entry.executable.callback_group) {
+        // Nothing (more) of this kind.
+        ready_executables_.pop_back();
+        break;
+      }
+      if (is_queued(entry.executable, ready_executables_.size() - 1)) {
+        discard(ready_executables_.size() - 1);
+        continue;
+      }
+      entry.ready_time = last_wait_end_;
+    }
+  }
+
+  auto deadline_of = [](const ReadyExecutable & entry) {
+      auto relative_deadline = entry.executable.callback_group->get_relative_deadline();
+      if (relative_deadline <= std::chrono::nanoseconds(0)) {
+        return std::chrono::steady_clock::time_point::max();
+      }
+      return entry.ready_time + relative_deadline;
+    };
+  auto goes_before = [this, &deadline_of](const ReadyExecutable & a, const ReadyExecutable & b) {
+      if (scheduling_policy_ == SchedulingPolicy::EARLIEST_DEADLINE_FIRST) {
+        auto deadline_a = deadline_of(a);
+        auto deadline_b = deadline_of(b);
+        if (deadline_a != deadline_b) {
+          return deadline_a < deadline_b;
+        }
+      }
+      return a.executable.callback_group->get_priority() >
+             b.executable.callback_group->get_priority();
+    };
+
+  size_t best_index = ready_executables_.size();
+  for (size_t i = 0; i < ready_executables_.size(); ) {
+    auto & entry = ready_executables_[i];
+    if (entry.executable.timer && !entry.executable.timer->is_ready()) {
+      // Canceled or reset since it was queued.
+      discard(i);
+      continue;
+    }
+    if (entry.executable.callback_group->can_be_taken_from().load() &&
+      (best_index == ready_executables_.size() ||
+      goes_before(entry, ready_executables_[best_index])))
+    {
+      best_index = i;
+    }
+    ++i;
+  }
+  if (best_index == ready_executables_.size()) {
+    return false;
+  }
+  auto best = ready_executables_.begin() + static_cast<std::ptrdiff_t>(best_index);
+
+  auto now = std::chrono::steady_clock::now();
+  auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - best->ready_time);
+  bool deadline_missed = now > deadline_of(*best);
+  int32_t priority = best->executable.callback_group->get_priority();
+  {
+    auto lock = rclcpp::lock_counting_contention(dispatch_latency_mutex_);
+    auto & statistics = dispatch_latency_statistics_[priority];
+    ++statistics.count;
+    statistics.total += latency;
+    statistics.max = std::max(statistics.max, latency);
+    if (deadline_missed) {
+      ++statistics.deadline_misses;
+    }
+  }
+
+  any_executable = std::move(best->executable);
+  discard(best_index);
+  return true;
+}
+
 bool
 Executor::get_next_executable(AnyExecutable & any_executable, std::chrono::nanoseconds timeout)
 {
@@ -0,0 +1,147 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/executors/busy_polling_executor.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "rclcpp/scope_exit.hpp"
+#include "rclcpp/utilities.hpp"
+
+using rclcpp::executors::BusyPollingExecutor;
+
+BusyPollingExecutor::BusyPollingExecutor(
+  const rclcpp::executor::ExecutorArgs & args,
+  std::chrono::nanoseconds max_spin_budget)
+: StaticSingleThreadedExecutor(args),
+  max_spin_budget_(std::max(max_spin_budget, std::chrono::nanoseconds(0))),
+  min_spin_budget_(max_spin_budget_ / 64),
+  spin_budget_ns_(max_spin_budget_.count())
+{}
+
+BusyPollingExecutor::~BusyPollingExecutor() {}
+
+void
+BusyPollingExecutor::spin()
+{
+  if (spinning.exchange(true)) {
+    throw std::runtime_error("spin() called while already spinning");
+  }
+  RCLCPP_SCOPE_EXIT(this->spinning.store(false); );
+  configure_thread(0);
+  while (rclcpp::ok(this->context_) && spinning.load()) {
+    // Nothing is polled before the first wait, which collects the entities.
+    bool taken = !polled_.empty() && busy_poll();
+    // Messages keep coming: only look at the rest without blocking, and poll again.
+    wait_for_ready(taken ? std::chrono::nanoseconds(0) : std::chrono::nanoseconds(-1));
+    execute_ready_executables(false);
+  }
+}
+
+void
+BusyPollingExecutor::add_busy_poll_subscription(rclcpp::SubscriptionBase::SharedPtr subscription)
+{
+  if (!subscription) {
+    throw std::invalid_argument("subscription is null");
+  }
+  {
+    std::lock_guard<std::mutex> lock(busy_poll_subscriptions_mutex_);
+    busy_poll_subscriptions_.push_back(subscription);
+  }
+  refresh_entities();
+}
+
+void
+BusyPollingExecutor::remove_busy_poll_subscription(
+  rclcpp::SubscriptionBase::SharedPtr subscription)
+{
+  {
+    std::lock_guard<std::mutex> lock(busy_poll_subscriptions_mutex_);
+    busy_poll_subscriptions_.erase(
+      std::remove_if(
+        busy_poll_subscriptions_.begin(), busy_poll_subscriptions_.end(),
+        [&subscription](const rclcpp::SubscriptionBase::WeakPtr & polled) {
+          auto polled_subscription = polled.lock();
+          return !polled_subscription || polled_subscription == subscription;
+        }),
+      busy_poll_subscriptions_.end());
+  }
+  refresh_entities();
+}
+
+std::chrono::nanoseconds
+BusyPollingExecutor::get_spin_budget() const
+{
+  return std::chrono::nanoseconds(spin_budget_ns_.load());
+}
+
+bool
+BusyPollingExecutor::collect_entities(
+  const std::vector<const rcl_guard_condition_t *> & fixed_guard_conditions)
+{
+  bool has_invalid_weak_nodes =
+    StaticSingleThreadedExecutor::collect_entities(fixed_guard_conditions);
+
+  polled_.clear();
+  std::lock_guard<std::mutex> lock(busy_poll_subscriptions_mutex_);
+  const auto & subscriptions = entities_collector_.subscriptions();
+  for (size_t i = 0; i < subscriptions.size(); ++i) {
+    const auto & subscription = subscriptions[i].subscription;
+    bool selected = std::any_of(
+      busy_poll_subscriptions_.begin(), busy_poll_subscriptions_.end(),
+      [&subscription](const rclcpp::SubscriptionBase::WeakPtr & polled) {
+        return polled.lock() == subscription;
+      });
+    if (selected) {
+      polled_.push_back(i);
+    }
+  }
+  return has_invalid_weak_nodes;
+}
+
+bool
+BusyPollingExecutor::busy_poll()
+{
+  auto budget = get_spin_budget();
+  auto deadline = std::chrono::steady_clock::now() + budget;
+  const auto & subscriptions = entities_collector_.subscriptions();
+  do {
+    for (size_t index : polled_) {
+      // Same as for waited for subscriptions: one that its owner released is not executed.
+      if (entities_collector_.subscription_is_orphan(index)) {
+        refresh_entities();
+        return false;
+      }
+      const auto & entry = subscriptions[index];
+      rclcpp::RealtimeViolationScope violation_scope(track_realtime_violations_);
+      size_t batch_size = get_subscription_batch_size(*entry.subscription);
+      size_t taken = entry.intra_process ?
+        execute_intra_process_subscription(entry.subscription, batch_size) :
+        execute_subscription(entry.subscription, batch_size);
+      if (taken > 0) {
+        if (track_realtime_violations_) {
+          entry.subscription->report_realtime_violations(violation_scope.counts());
+        }
+        spin_budget_ns_.store(
+          std::min(std::max(budget * 2, min_spin_budget_), max_spin_budget_).count());
+        return true;
+      }
+    }
+  } while (spinning.load() && std::chrono::steady_clock::now() < deadline);
+  spin_budget_ns_.store(std::max(budget / 2, min_spin_budget_).count());
+  return false;
+}
@@ -0,0 +1,375 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/executors/callback_group_thread_executor.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "rcl/error_handling.h"
+
+#include "rclcpp/exceptions.hpp"
+#include "rclcpp/executors/static_single_threaded_executor.hpp"
+#include "rclcpp/scope_exit.hpp"
+#include "rclcpp/utilities.hpp"
+
+using rclcpp::executors::CallbackGroupThreadExecutor;
+using rclcpp::executors::StaticSingleThreadedExecutor;
+
+namespace
+{
+
+// How often the coordinator looks for destroyed nodes, which trigger nothing.
+constexpr std::chrono::milliseconds coordinator_poll_period(100);
+
+/// Static executor for a single callback group, without a node.
+class GroupWorkerExecutor : public StaticSingleThreadedExecutor
+{
+public:
+  GroupWorkerExecutor(
+    const rclcpp::executor::ExecutorArgs & args,
+    rclcpp::callback_group::CallbackGroup::WeakPtr group)
+  : StaticSingleThreadedExecutor(args),
+    group_(group),
+    stopped_(false)
+  {}
+
+  /// Like spin(), but stop() also works before it is called.
+  void
+  run()
+  {
+    if (spinning.exchange(true)) {
+      throw std::runtime_error("run() called while already spinning");
+    }
+    RCLCPP_SCOPE_EXIT(this->spinning.store(false); );
+    configure_thread(0);
+    while (rclcpp::ok(context_) && spinning.load() && !stopped_.load()) {
+      wait_for_ready(std::chrono::nanoseconds(-1));
+      execute_ready_executables(false);
+    }
+  }
+
+  void
+  stop()
+  {
+    stopped_.store(true);
+    cancel();
+  }
+
+  /// Collect the group again, and wake up the wait to do so.
+  void
+  refresh()
+  {
+    refresh_entities();
+    if (rcl_trigger_guard_condition(&interrupt_guard_condition_) != RCL_RET_OK) {
+      throw std::runtime_error(rcl_get_error_string().str);
+    }
+  }
+
+protected:
+  bool
+  collect_entities(
+    const std::vector<const rcl_guard_condition_t *> & fixed_guard_conditions) override
+  {
+    auto group = group_.lock();
+    if (group) {
+      entities_collector_.collect_group(group, fixed_guard_conditions);
+    } else {
+      entities_collector_.collect({}, fixed_guard_conditions);
+    }
+    return false;
+  }
+
+private:
+  rclcpp::callback_group::CallbackGroup::WeakPtr group_;
+  std::atomic_bool stopped_;
+};
+
+bool
+same_node(
+  const rclcpp::node_interfaces::NodeBaseInterface::WeakPtr & a,
+  const rclcpp::node_interfaces::NodeBaseInterface::WeakPtr & b)
+{
+  return !a.owner_before(b) && !b.owner_before(a);
+}
+
+}  // namespace
+
+struct CallbackGroupThreadExecutor::Worker
+{
+  rclcpp::node_interfaces::NodeBaseInterface::WeakPtr node;
+  std::unique_ptr<GroupWorkerExecutor> executor;
+  std::thread thread;
+};
+
+CallbackGroupThreadExecutor::CallbackGroupThreadExecutor(
+  const rclcpp::executor::ExecutorArgs & args)
+: executor::Executor(args),
+  number_of_threads_(0),
+  wait_set_guard_conditions_(0)
+{}
+
+CallbackGroupThreadExecutor::~CallbackGroupThreadExecutor()
+{
+  stop_workers();
+}
+
+void
+CallbackGroupThreadExecutor::spin()
+{
+  if (spinning.exchange(true)) {
+    throw std::runtime_error("spin() called while already spinning");
+  }
+  {
+    RCLCPP_SCOPE_EXIT(this->stop_workers(); this->spinning.store(false); );
+    configure_thread(0);
+    WeakNodeVector changed_nodes;
+    while (rclcpp::ok(this->context_) && spinning.load()) {
+      WeakNodeVector nodes;
+      std::vector<const rcl_guard_condition_t *> node_guard_conditions;
+      {
+        std::lock_guard<std::mutex> lock(nodes_mutex_);
+        // Same clean up as Executor::wait_for_work: the guard condition of a destroyed node is
+        // gone too.
+        auto node_it = weak_nodes_.begin();
+        auto gc_it = guard_conditions_.begin();
+        while (node_it != weak_nodes_.end()) {
+          if (node_it->expired()) {
+            node_it = weak_nodes_.erase(node_it);
+            {
+              auto strategy_lock = rclcpp::lock_counting_contention(memory_strategy_mutex_);
+              memory_strategy_->remove_guard_condition(*gc_it);
+            }
+            gc_it = guard_conditions_.erase(gc_it);
+          } else {
+            ++node_it;
+            ++gc_it;
+          }
+        }
+        nodes.assign(weak_nodes_.begin(), weak_nodes_.end());
+        node_guard_conditions.assign(guard_conditions_.begin(), guard_conditions_.end());
+      }
+      update_workers(nodes, changed_nodes);
+      changed_nodes = wait_for_changes(nodes, node_guard_conditions);
+    }
+  }
+
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(worker_error_mutex_);
+    std::swap(error, worker_error_);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void
+CallbackGroupThreadExecutor::spin_some(std::chrono::nanoseconds max_duration)
+{
+  (void)max_duration;
+  throw std::runtime_error("CallbackGroupThreadExecutor only supports spin()");
+}
+
+void
+CallbackGroupThreadExecutor::spin_once_impl(std::chrono::nanoseconds timeout)
+{
+  (void)timeout;
+  throw std::runtime_error("CallbackGroupThreadExecutor only supports spin()");
+}
+
+void
+CallbackGroupThreadExecutor::add_node(
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_ptr, bool notify)
+{
+  std::lock_guard<std::mutex> lock(nodes_mutex_);
+  executor::Executor::add_node(node_ptr, notify);
+}
+
+void
+CallbackGroupThreadExecutor::remove_node(
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_ptr, bool notify)
+{
+  std::lock_guard<std::mutex> lock(nodes_mutex_);
+  executor::Executor::remove_node(node_ptr, notify);
+}
+
+void
+CallbackGroupThreadExecutor::set_thread_configuration(
+  rclcpp::callback_group::CallbackGroup::SharedPtr group,
+  const ThreadConfiguration & thread_configuration)
+{
+  if (!group) {
+    throw std::invalid_argument("group is null");
+  }
+  std::lock_guard<std::mutex> lock(group_thread_configurations_mutex_);
+  group_thread_configurations_[group] = thread_configuration;
+}
+
+size_t
+CallbackGroupThreadExecutor::get_number_of_threads()
+{
+  return number_of_threads_.load();
+}
+
+void
+CallbackGroupThreadExecutor::update_workers(
+  const WeakNodeVector & nodes,
+  const WeakNodeVector & changed_nodes)
+{
+  auto it = workers_.begin();
+  while (it != workers_.end()) {
+    auto & worker = *it->second;
+    bool added = !worker.node.expired() && std::any_of(
+      nodes.begin(), nodes.end(), [&worker](const WeakNodeVector::value_type & node) {
+        return same_node(node, worker.node);
+      });
+    if (added) {
+      ++it;
+      continue;
+    }
+    worker.executor->stop();
+    worker.thread.join();
+    it = workers_.erase(it);
+    --number_of_threads_;
+  }
+
+  for (auto & weak_node : nodes) {
+    auto node = weak_node.lock();
+    if (!node) {
+      continue;
+    }
+    bool changed = std::any_of(
+      changed_nodes.begin(), changed_nodes.end(),
+      [&weak_node](const WeakNodeVector::value_type & changed_node) {
+        return same_node(changed_node, weak_node);
+      });
+    for (auto & weak_group : node->get_callback_groups()) {
+      auto group = weak_group.lock();
+      if (!group) {
+        continue;
+      }
+      auto worker_it = workers_.find(group);
+      if (worker_it == workers_.end()) {
+        start_worker(node, group);
+      } else if (changed) {
+        worker_it->second->executor->refresh();
+      }
+    }
+  }
+}
+
+CallbackGroupThreadExecutor::WeakNodeVector
+CallbackGroupThreadExecutor::wait_for_changes(
+  const WeakNodeVector & nodes,
+  const std::vector<const rcl_guard_condition_t *> & node_guard_conditions)
+{
+  const rcl_guard_condition_t * fixed_guard_conditions[] = {
+    context_->get_interrupt_guard_condition(&wait_set_),
+    &interrupt_guard_condition_
+  };
+  const size_t number_of_fixed = sizeof(fixed_guard_conditions) / sizeof(fixed_guard_conditions[0]);
+  size_t number_of_guard_conditions = number_of_fixed + node_guard_conditions.size();
+  rcl_ret_t ret;
+  if (number_of_guard_conditions != wait_set_guard_conditions_) {
+    ret = rcl_wait_set_resize(&wait_set_, 0, number_of_guard_conditions, 0, 0, 0, 0);
+    wait_set_guard_conditions_ = number_of_guard_conditions;
+  } else {
+    ret = rcl_wait_set_clear(&wait_set_);
+  }
+  if (RCL_RET_OK != ret) {
+    rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't prepare the wait set");
+  }
+  for (auto guard_condition : fixed_guard_conditions) {
+    ret = rcl_wait_set_add_guard_condition(&wait_set_, guard_condition, nullptr);
+    if (RCL_RET_OK != ret) {
+      rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't add guard condition to wait set");
+    }
+  }
+  for (auto guard_condition : node_guard_conditions) {
+    ret = rcl_wait_set_add_guard_condition(&wait_set_, guard_condition, nullptr);
+    if (RCL_RET_OK != ret) {
+      rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't add guard condition to wait set");
+    }
+  }
+
+  ret = rcl_wait(
+    &wait_set_, std::chrono::nanoseconds(coordinator_poll_period).count());
+  if (RCL_RET_OK != ret && RCL_RET_TIMEOUT != ret) {
+    rclcpp::exceptions::throw_from_rcl_error(ret, "rcl_wait() failed");
+  }
+
+  WeakNodeVector changed_nodes;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (wait_set_.guard_conditions[number_of_fixed + i]) {
+      changed_nodes.push_back(nodes[i]);
+    }
+  }
+  return changed_nodes;
+}
+
+void
+CallbackGroupThreadExecutor::start_worker(
+  const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr & node,
+  const rclcpp::callback_group::CallbackGroup::SharedPtr & group)
+{
+  executor::ExecutorArgs args;
+  args.context = context_;
+  args.track_realtime_violations = track_realtime_violations_;
+  args.subscription_batch_size = subscription_batch_size_;
+  {
+    std::lock_guard<std::mutex> lock(group_thread_configurations_mutex_);
+    auto it = group_thread_configurations_.find(group);
+    if (it != group_thread_configurations_.end()) {
+      args.thread_configurations.push_back(it->second);
+    }
+  }
+
+  std::unique_ptr<Worker> worker(new Worker);
+  worker->node = node;
+  worker->executor.reset(new GroupWorkerExecutor(args, group));
+  auto worker_executor = worker->executor.get();
+  worker->thread = std::thread([this, worker_executor]() {
+        try {
+          worker_executor->run();
+        } catch (...) {
+          {
+            std::lock_guard<std::mutex> lock(worker_error_mutex_);
+            if (!worker_error_) {
+              worker_error_ = std::current_exception();
+            }
+          }
+          cancel();
+        }
+      });
+  workers_.emplace(group, std::move(worker));
+  ++number_of_threads_;
+}
+
+void
+CallbackGroupThreadExecutor::stop_workers()
+{
+  for (auto & entry : workers_) {
+    entry.second->executor->stop();
+  }
+  for (auto & entry : workers_) {
+    entry.second->thread.join();
+  }
+  workers_.clear();
+  number_of_threads_.store(0);
+}
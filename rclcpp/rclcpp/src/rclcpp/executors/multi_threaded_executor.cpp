@@ -17,6 +17,8 @@
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "rclcpp/utilities.hpp"
@@ -34,6 +36,7 @@ MultiThreadedExecutor::MultiThreadedExecutor(
   if (number_of_threads_ == 0) {
     number_of_threads_ = 1;
   }
+  dedicated_threads_.resize(number_of_threads_);
 }
 
 MultiThreadedExecutor::~MultiThreadedExecutor() {}
@@ -59,6 +62,14 @@ MultiThreadedExecutor::spin()
   for (auto & thread : threads) {
     thread.join();
   }
+
+  // Hand-overs that were not executed anymore. Deleting them releases their callback group.
+  for (auto & dedicated : dedicated_threads_) {
+    if (dedicated) {
+      dedicated->queue.clear();
+    }
+  }
+  rethrow_thread_configuration_error();
 }
 
 size_t
@@ -68,12 +79,63 @@ MultiThreadedExecutor::get_number_of_threads()
 }
 
 void
-MultiThreadedExecutor::run(size_t)
+MultiThreadedExecutor::assign_callback_group(
+  rclcpp::callback_group::CallbackGroup::SharedPtr group,
+  size_t thread_number)
+{
+  if (!group) {
+    throw std::invalid_argument("callback group is null");
+  }
+  if (thread_number >= number_of_threads_) {
+    throw std::invalid_argument(
+            "thread " + std::to_string(thread_number) + " does not exist, the executor has " +
+            std::to_string(number_of_threads_) + " threads");
+  }
+  if (!dedicated_threads_[thread_number]) {
+    size_t number_of_dedicated_threads = 0;
+    for (auto & dedicated : dedicated_threads_) {
+      number_of_dedicated_threads += dedicated ? 1 : 0;
+    }
+    if (number_of_dedicated_threads + 1 == number_of_threads_) {
+      throw std::invalid_argument(
+              "thread " + std::to_string(thread_number) + " is the last one that waits for work, "
+              "it can not be dedicated to callback groups");
+    }
+    dedicated_threads_[thread_number].reset(new DedicatedThread);
+  }
+  group_threads_[group] = thread_number;
+}
+
+void
+MultiThreadedExecutor::run(size_t this_thread_number)
 {
+  if (dedicated_threads_[this_thread_number]) {
+    if (configure_thread_or_cancel(this_thread_number)) {
+      run_dedicated(this_thread_number);
+    }
+    return;
+  }
+  // The dedicated threads only wake up for hand-overs, tell them when spinning stops.
+  RCLCPP_SCOPE_EXIT(this->wake_dedicated_threads(); );
+  if (!configure_thread_or_cancel(this_thread_number)) {
+    return;
+  }
+
   while (rclcpp::ok(this->context_) && spinning.load()) {
     executor::AnyExecutable any_exec;
     {
-      std::lock_guard<std::mutex> wait_lock(wait_mutex_);
+      // Waiting for wait_mutex_ happens before we know what will be executed,
+      // so the lock waits are carried over into the scope of the next execution on this thread.
+      // What the executor allocates while collecting and choosing is its own, not the callback's.
+      rclcpp::RealtimeViolationScope dispatch_scope(track_realtime_violations_);
+      RCLCPP_SCOPE_EXIT({
+        if (track_realtime_violations_) {
+          rclcpp::RealtimeViolationCounts lock_waits;
+          lock_waits.lock_waits = dispatch_scope.counts().lock_waits;
+          rclcpp::RealtimeViolationCounter::carry_over(lock_waits);
+        }
+      });
+      auto wait_lock = rclcpp::lock_counting_contention(wait_mutex_);
       if (!rclcpp::ok(this->context_) || !spinning.load()) {
         return;
       }
@@ -92,22 +154,85 @@ MultiThreadedExecutor::run(size_t)
         }
         scheduled_timers_.insert(any_exec.timer);
       }
+      if (!group_threads_.empty() && hand_over(any_exec, this_thread_number)) {
+        continue;
+      }
     }
     if (yield_before_execute_) {
       std::this_thread::yield();
     }
 
-    execute_any_executable(any_exec);
+    execute(any_exec);
+  }
+}
 
-    if (any_exec.timer) {
-      std::lock_guard<std::mutex> wait_lock(wait_mutex_);
-      auto it = scheduled_timers_.find(any_exec.timer);
-      if (it != scheduled_timers_.end()) {
-        scheduled_timers_.erase(it);
+void
+MultiThreadedExecutor::run_dedicated(size_t this_thread_number)
+{
+  auto & dedicated = *dedicated_threads_[this_thread_number];
+  while (true) {
+    std::unique_ptr<executor::AnyExecutable> any_exec;
+    {
+      std::unique_lock<std::mutex> lock(dedicated.mutex);
+      dedicated.condition.wait(
+        lock, [this, &dedicated]() {
+          return !dedicated.queue.empty() || !rclcpp::ok(this->context_) || !spinning.load();
+        });
+      if (!rclcpp::ok(this->context_) || !spinning.load()) {
+        return;
       }
+      any_exec = std::move(dedicated.queue.front());
+      dedicated.queue.pop_front();
+    }
+    execute(*any_exec);
+  }
+}
+
+bool
+MultiThreadedExecutor::hand_over(executor::AnyExecutable & any_exec, size_t this_thread_number)
+{
+  auto it = group_threads_.find(any_exec.callback_group);
+  if (it == group_threads_.end() || it->second == this_thread_number) {
+    return false;
+  }
+  // The copy takes over the marked callback group, the original must not release it.
+  std::unique_ptr<executor::AnyExecutable> handed_over(new executor::AnyExecutable(any_exec));
+  any_exec.callback_group.reset();
+
+  auto & dedicated = *dedicated_threads_[it->second];
+  {
+    auto lock = rclcpp::lock_counting_contention(dedicated.mutex);
+    dedicated.queue.push_back(std::move(handed_over));
+  }
+  dedicated.condition.notify_one();
+  return true;
+}
+
+void
+MultiThreadedExecutor::execute(executor::AnyExecutable & any_exec)
+{
+  execute_any_executable(any_exec);
+
+  if (any_exec.timer) {
+    auto wait_lock = rclcpp::lock_counting_contention(wait_mutex_);
+    auto it = scheduled_timers_.find(any_exec.timer);
+    if (it != scheduled_timers_.end()) {
+      scheduled_timers_.erase(it);
+    }
+  }
+  // Clear the callback_group to prevent the AnyExecutable destructor from
+  // resetting the callback group `can_be_taken_from`
+  any_exec.callback_group.reset();
+}
+
+void
+MultiThreadedExecutor::wake_dedicated_threads()
+{
+  for (auto & dedicated : dedicated_threads_) {
+    if (dedicated) {
+      // Taking the mutex makes sure the thread is either waiting or will see the new state.
+      { std::lock_guard<std::mutex> lock(dedicated->mutex); }
+      dedicated->condition.notify_all();
     }
-    // Clear the callback_group to prevent the AnyExecutable destructor from
-    // resetting the callback group `can_be_taken_from`
-    any_exec.callback_group.reset();
   }
 }
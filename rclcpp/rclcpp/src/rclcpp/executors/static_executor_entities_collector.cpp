@@ -0,0 +1,283 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/executors/static_executor_entities_collector.hpp"
+
+#include <string>
+#include <vector>
+
+#include "rcl/error_handling.h"
+
+#include "rclcpp/exceptions.hpp"
+
+using rclcpp::executors::StaticExecutorEntitiesCollector;
+
+bool
+StaticExecutorEntitiesCollector::collect(
+  const WeakNodeList & weak_nodes,
+  const std::vector<const rcl_guard_condition_t *> & fixed_guard_conditions)
+{
+  clear();
+
+  guard_conditions_ = fixed_guard_conditions;
+  first_node_guard_condition_ = guard_conditions_.size();
+
+  bool has_invalid_weak_nodes = false;
+  for (auto & weak_node : weak_nodes) {
+    auto node = weak_node.lock();
+    if (!node) {
+      has_invalid_weak_nodes = true;
+      continue;
+    }
+    nodes_.push_back(node);
+    guard_conditions_.push_back(node->get_notify_guard_condition());
+
+    // Unlike the memory strategies, groups that are currently executing are collected too:
+    // the collection has to stay valid across many waits.
+    for (auto & weak_group : node->get_callback_groups()) {
+      auto group = weak_group.lock();
+      if (group) {
+        collect_group_entities(group);
+      }
+    }
+  }
+  return has_invalid_weak_nodes;
+}
+
+void
+StaticExecutorEntitiesCollector::collect_group(
+  const rclcpp::callback_group::CallbackGroup::SharedPtr & group,
+  const std::vector<const rcl_guard_condition_t *> & fixed_guard_conditions)
+{
+  clear();
+
+  guard_conditions_ = fixed_guard_conditions;
+  first_node_guard_condition_ = guard_conditions_.size();
+  collect_group_entities(group);
+}
+
+void
+StaticExecutorEntitiesCollector::collect_group_entities(
+  const rclcpp::callback_group::CallbackGroup::SharedPtr & group)
+{
+  for (auto & weak_subscription : group->get_subscription_ptrs()) {
+    auto subscription = weak_subscription.lock();
+    if (subscription) {
+      subscriptions_.push_back({subscription, group, false});
+      subscription_handles_.push_back(subscription->get_subscription_handle().get());
+      auto intra_process_handle = subscription->get_intra_process_subscription_handle();
+      if (intra_process_handle) {
+        subscriptions_.push_back({subscription, group, true});
+        subscription_handles_.push_back(intra_process_handle.get());
+      }
+    }
+  }
+  for (auto & weak_timer : group->get_timer_ptrs()) {
+    auto timer = weak_timer.lock();
+    if (timer) {
+      if (timer->is_steady()) {
+        queued_timers_.push_back({timer, group});
+      } else {
+        timers_.push_back({timer, group});
+        timer_handles_.push_back(timer->get_timer_handle().get());
+      }
+    }
+  }
+  for (auto & weak_service : group->get_service_ptrs()) {
+    auto service = weak_service.lock();
+    if (service) {
+      services_.push_back({service, group});
+      service_handles_.push_back(service->get_service_handle().get());
+    }
+  }
+  for (auto & weak_client : group->get_client_ptrs()) {
+    auto client = weak_client.lock();
+    if (client) {
+      clients_.push_back({client, group});
+      client_handles_.push_back(client->get_client_handle().get());
+    }
+  }
+  for (auto & weak_waitable : group->get_waitable_ptrs()) {
+    auto waitable = weak_waitable.lock();
+    if (waitable) {
+      waitables_.push_back({waitable, group});
+    }
+  }
+}
+
+void
+StaticExecutorEntitiesCollector::clear()
+{
+  subscriptions_.clear();
+  timers_.clear();
+  queued_timers_.clear();
+  services_.clear();
+  clients_.clear();
+  waitables_.clear();
+  subscription_handles_.clear();
+  timer_handles_.clear();
+  service_handles_.clear();
+  client_handles_.clear();
+  guard_conditions_.clear();
+  nodes_.clear();
+  first_node_guard_condition_ = 0;
+}
+
+void
+StaticExecutorEntitiesCollector::resize_wait_set(rcl_wait_set_t * wait_set) const
+{
+  size_t number_of_subscriptions = subscriptions_.size();
+  size_t number_of_guard_conditions = guard_conditions_.size();
+  size_t number_of_timers = timers_.size();
+  size_t number_of_clients = clients_.size();
+  size_t number_of_services = services_.size();
+  size_t number_of_events = 0;
+  for (auto & entry : waitables_) {
+    number_of_subscriptions += entry.entity->get_number_of_ready_subscriptions();
+    number_of_guard_conditions += entry.entity->get_number_of_ready_guard_conditions();
+    number_of_timers += entry.entity->get_number_of_ready_timers();
+    number_of_clients += entry.entity->get_number_of_ready_clients();
+    number_of_services += entry.entity->get_number_of_ready_services();
+    number_of_events += entry.entity->get_number_of_ready_events();
+  }
+
+  rcl_ret_t ret = rcl_wait_set_resize(
+    wait_set, number_of_subscriptions, number_of_guard_conditions, number_of_timers,
+    number_of_clients, number_of_services, number_of_events);
+  if (RCL_RET_OK != ret) {
+    throw std::runtime_error(
+            std::string("Couldn't resize the wait set : ") + rcl_get_error_string().str);
+  }
+}
+
+void
+StaticExecutorEntitiesCollector::fill_wait_set(rcl_wait_set_t * wait_set) const
+{
+  using rclcpp::exceptions::throw_from_rcl_error;
+
+  if (rcl_wait_set_clear(wait_set) != RCL_RET_OK) {
+    throw std::runtime_error("Couldn't clear wait set");
+  }
+  // The own entities go first, in collection order, so that wait set index == vector index.
+  for (auto handle : subscription_handles_) {
+    rcl_ret_t ret = rcl_wait_set_add_subscription(wait_set, handle, nullptr);
+    if (RCL_RET_OK != ret) {
+      throw_from_rcl_error(ret, "Couldn't add subscription to wait set");
+    }
+  }
+  for (auto handle : timer_handles_) {
+    rcl_ret_t ret = rcl_wait_set_add_timer(wait_set, handle, nullptr);
+    if (RCL_RET_OK != ret) {
+      throw_from_rcl_error(ret, "Couldn't add timer to wait set");
+    }
+  }
+  for (auto handle : service_handles_) {
+    rcl_ret_t ret = rcl_wait_set_add_service(wait_set, handle, nullptr);
+    if (RCL_RET_OK != ret) {
+      throw_from_rcl_error(ret, "Couldn't add service to wait set");
+    }
+  }
+  for (auto handle : client_handles_) {
+    rcl_ret_t ret = rcl_wait_set_add_client(wait_set, handle, nullptr);
+    if (RCL_RET_OK != ret) {
+      throw_from_rcl_error(ret, "Couldn't add client to wait set");
+    }
+  }
+  for (auto guard_condition : guard_conditions_) {
+    rcl_ret_t ret = rcl_wait_set_add_guard_condition(wait_set, guard_condition, nullptr);
+    if (RCL_RET_OK != ret) {
+      throw_from_rcl_error(ret, "Couldn't add guard condition to wait set");
+    }
+  }
+  for (auto & entry : waitables_) {
+    if (!entry.entity->add_to_wait_set(wait_set)) {
+      throw std::runtime_error("Couldn't add waitable to wait set");
+    }
+  }
+}
+
+bool
+StaticExecutorEntitiesCollector::node_guard_condition_triggered(
+  const rcl_wait_set_t * wait_set) const
+{
+  size_t end = first_node_guard_condition_ + nodes_.size();
+  for (size_t i = first_node_guard_condition_; i < end; ++i) {
+    if (wait_set->guard_conditions[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+StaticExecutorEntitiesCollector::has_expired_nodes() const
+{
+  for (auto & node : nodes_) {
+    if (node.expired()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+StaticExecutorEntitiesCollector::has_orphans() const
+{
+  for (size_t i = 0; i < subscriptions_.size(); ++i) {
+    if (subscription_is_orphan(i)) {
+      return true;
+    }
+  }
+  for (auto & entry : timers_) {
+    if (is_orphan(entry.entity)) {
+      return true;
+    }
+  }
+  for (auto & entry : queued_timers_) {
+    if (is_orphan(entry.entity)) {
+      return true;
+    }
+  }
+  for (auto & entry : services_) {
+    if (is_orphan(entry.entity)) {
+      return true;
+    }
+  }
+  for (auto & entry : clients_) {
+    if (is_orphan(entry.entity)) {
+      return true;
+    }
+  }
+  for (auto & entry : waitables_) {
+    if (is_orphan(entry.entity)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+StaticExecutorEntitiesCollector::subscription_is_orphan(size_t index) const
+{
+  // A subscription with an intra-process handle has two entries, right after each other.
+  auto & subscription = subscriptions_[index].subscription;
+  long references = 1;
+  if (index > 0 && subscriptions_[index - 1].subscription == subscription) {
+    ++references;
+  }
+  if (index + 1 < subscriptions_.size() && subscriptions_[index + 1].subscription == subscription) {
+    ++references;
+  }
+  return subscription.use_count() <= references;
+}
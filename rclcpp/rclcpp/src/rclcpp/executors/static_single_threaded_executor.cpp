@@ -0,0 +1,383 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/executors/static_single_threaded_executor.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "rcl/error_handling.h"
+
+#include "rclcpp/any_executable.hpp"
+#include "rclcpp/exceptions.hpp"
+#include "rclcpp/scope_exit.hpp"
+
+#include "rcutils/logging_macros.h"
+
+using rclcpp::executors::StaticSingleThreadedExecutor;
+using rclcpp::executors::TimerQueue;
+using rclcpp::executor::AnyExecutable;
+
+namespace
+{
+// A canceled timer has no next call time, and reset() does not wake the executor: look again then.
+constexpr std::chrono::milliseconds canceled_timer_poll_period(100);
+}  // namespace
+
+StaticSingleThreadedExecutor::StaticSingleThreadedExecutor(
+  const rclcpp::executor::ExecutorArgs & args)
+: executor::Executor(args),
+  entities_changed_(true),
+  collected_(false),
+  orphan_check_period_(std::chrono::milliseconds(100))
+{}
+
+StaticSingleThreadedExecutor::~StaticSingleThreadedExecutor()
+{
+  // The wait set is finalized by the base class, drop the references before that.
+  entities_collector_.clear();
+}
+
+void
+StaticSingleThreadedExecutor::spin()
+{
+  if (spinning.exchange(true)) {
+    throw std::runtime_error("spin() called while already spinning");
+  }
+  RCLCPP_SCOPE_EXIT(this->spinning.store(false); );
+  configure_thread(0);
+  while (rclcpp::ok(this->context_) && spinning.load()) {
+    wait_for_ready(std::chrono::nanoseconds(-1));
+    execute_ready_executables(false);
+  }
+}
+
+void
+StaticSingleThreadedExecutor::spin_some(std::chrono::nanoseconds max_duration)
+{
+  auto start = std::chrono::steady_clock::now();
+  auto max_duration_not_elapsed = [max_duration, start]() {
+      return std::chrono::nanoseconds(0) == max_duration ||
+             std::chrono::steady_clock::now() - start < max_duration;
+    };
+
+  if (spinning.exchange(true)) {
+    throw std::runtime_error("spin_some() called while already spinning");
+  }
+  RCLCPP_SCOPE_EXIT(this->spinning.store(false); );
+  while (rclcpp::ok(context_) && spinning.load() && max_duration_not_elapsed()) {
+    wait_for_ready(std::chrono::nanoseconds(0));
+    if (!execute_ready_executables(false)) {
+      break;
+    }
+  }
+}
+
+void
+StaticSingleThreadedExecutor::spin_once_impl(std::chrono::nanoseconds timeout)
+{
+  wait_for_ready(timeout);
+  execute_ready_executables(true);
+}
+
+void
+StaticSingleThreadedExecutor::add_node(
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_ptr, bool notify)
+{
+  entities_changed_.store(true);
+  executor::Executor::add_node(node_ptr, notify);
+}
+
+void
+StaticSingleThreadedExecutor::remove_node(
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_ptr, bool notify)
+{
+  entities_changed_.store(true);
+  executor::Executor::remove_node(node_ptr, notify);
+}
+
+void
+StaticSingleThreadedExecutor::refresh_entities()
+{
+  entities_changed_.store(true);
+}
+
+void
+StaticSingleThreadedExecutor::set_orphan_check_period(std::chrono::nanoseconds period)
+{
+  orphan_check_period_ = period;
+}
+
+bool
+StaticSingleThreadedExecutor::collect_entities(
+  const std::vector<const rcl_guard_condition_t *> & fixed_guard_conditions)
+{
+  return entities_collector_.collect(weak_nodes_, fixed_guard_conditions);
+}
+
+void
+StaticSingleThreadedExecutor::rebuild()
+{
+  // Cleared first: a change that comes in while collecting is picked up by the next wait.
+  entities_changed_.store(false);
+
+  std::vector<const rcl_guard_condition_t *> fixed_guard_conditions {
+    context_->get_interrupt_guard_condition(&wait_set_),
+    &interrupt_guard_condition_
+  };
+  bool has_invalid_weak_nodes = collect_entities(fixed_guard_conditions);
+
+  // Same clean up as Executor::wait_for_work.
+  if (has_invalid_weak_nodes) {
+    auto lock = rclcpp::lock_counting_contention(memory_strategy_mutex_);
+    auto node_it = weak_nodes_.begin();
+    auto gc_it = guard_conditions_.begin();
+    while (node_it != weak_nodes_.end()) {
+      if (node_it->expired()) {
+        node_it = weak_nodes_.erase(node_it);
+        memory_strategy_->remove_guard_condition(*gc_it);
+        gc_it = guard_conditions_.erase(gc_it);
+      } else {
+        ++node_it;
+        ++gc_it;
+      }
+    }
+  }
+
+  entities_collector_.resize_wait_set(&wait_set_);
+  collected_ = true;
+  last_orphan_check_ = std::chrono::steady_clock::now();
+
+  timer_queue_.clear();
+  const auto & queued_timers = entities_collector_.queued_timers();
+  for (size_t i = 0; i < queued_timers.size(); ++i) {
+    timer_queue_.push(i, next_due_time(*queued_timers[i].entity, last_orphan_check_));
+  }
+}
+
+TimerQueue::Clock::time_point
+StaticSingleThreadedExecutor::next_due_time(
+  rclcpp::TimerBase & timer,
+  TimerQueue::Clock::time_point now)
+{
+  if (timer.is_canceled()) {
+    return now + canceled_timer_poll_period;
+  }
+  return now + timer.time_until_trigger();
+}
+
+void
+StaticSingleThreadedExecutor::wait_for_ready(std::chrono::nanoseconds timeout)
+{
+  bool rebuild_needed = !collected_ || entities_changed_.load() ||
+    entities_collector_.has_expired_nodes();
+  if (!rebuild_needed) {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_orphan_check_ >= orphan_check_period_) {
+      last_orphan_check_ = now;
+      rebuild_needed = entities_collector_.has_orphans();
+    }
+  }
+  if (rebuild_needed) {
+    rebuild();
+  }
+
+  entities_collector_.fill_wait_set(&wait_set_);
+
+  timeout = timer_queue_.wait_timeout(TimerQueue::Clock::now(), timeout);
+  rcl_ret_t status = rcl_wait(&wait_set_, timeout.count());
+  if (status == RCL_RET_WAIT_SET_EMPTY) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rclcpp",
+      "empty wait set received in rcl_wait(). This should never happen.");
+  } else if (status != RCL_RET_OK && status != RCL_RET_TIMEOUT) {
+    using rclcpp::exceptions::throw_from_rcl_error;
+    throw_from_rcl_error(status, "rcl_wait() failed");
+  }
+
+  if (entities_collector_.node_guard_condition_triggered(&wait_set_)) {
+    entities_changed_.store(true);
+  }
+}
+
+bool
+StaticSingleThreadedExecutor::execute_ready_executables(bool only_one)
+{
+  bool any_executed = false;
+  // An entity that was released by its owner is not executed: its callback may well point into
+  // the destroyed owner. It is dropped from the collection on the next wait.
+  auto orphaned = [this]() {
+      entities_changed_.store(true);
+    };
+
+  // Due timers from the queue first. Each is queued again, after now, so that a timer that is
+  // already late again after its callback does not starve the rest.
+  const auto & queued_timers = entities_collector_.queued_timers();
+  auto now = TimerQueue::Clock::now();
+  size_t index = 0;
+  while (spinning.load() && timer_queue_.pop_due(now, index)) {
+    auto & timer = queued_timers[index].entity;
+    if (StaticExecutorEntitiesCollector::is_orphan(timer)) {
+      orphaned();
+      continue;
+    }
+    bool executed = false;
+    if (timer->is_ready()) {
+      AnyExecutable any_exec;
+      any_exec.timer = timer;
+      execute_ready_executable(any_exec);
+      executed = true;
+    }
+    auto current_time = TimerQueue::Clock::now();
+    timer_queue_.push(
+      index, std::max(next_due_time(*timer, current_time), now + std::chrono::nanoseconds(1)));
+    if (executed) {
+      any_executed = true;
+      if (only_one) {
+        return true;
+      }
+    }
+  }
+
+  const auto & timers = entities_collector_.timers();
+  for (size_t i = 0; i < timers.size() && spinning.load(); ++i) {
+    if (!wait_set_.timers[i]) {
+      continue;
+    }
+    if (StaticExecutorEntitiesCollector::is_orphan(timers[i].entity)) {
+      orphaned();
+      continue;
+    }
+    AnyExecutable any_exec;
+    any_exec.timer = timers[i].entity;
+    execute_ready_executable(any_exec);
+    any_executed = true;
+    if (only_one) {
+      return true;
+    }
+  }
+
+  const auto & subscriptions = entities_collector_.subscriptions();
+  for (size_t i = 0; i < subscriptions.size() && spinning.load(); ++i) {
+    if (!wait_set_.subscriptions[i]) {
+      continue;
+    }
+    if (entities_collector_.subscription_is_orphan(i)) {
+      orphaned();
+      continue;
+    }
+    AnyExecutable any_exec;
+    if (subscriptions[i].intra_process) {
+      any_exec.subscription_intra_process = subscriptions[i].subscription;
+    } else {
+      any_exec.subscription = subscriptions[i].subscription;
+    }
+    execute_ready_executable(any_exec);
+    any_executed = true;
+    if (only_one) {
+      return true;
+    }
+  }
+
+  const auto & services = entities_collector_.services();
+  for (size_t i = 0; i < services.size() && spinning.load(); ++i) {
+    if (!wait_set_.services[i]) {
+      continue;
+    }
+    if (StaticExecutorEntitiesCollector::is_orphan(services[i].entity)) {
+      orphaned();
+      continue;
+    }
+    AnyExecutable any_exec;
+    any_exec.service = services[i].entity;
+    execute_ready_executable(any_exec);
+    any_executed = true;
+    if (only_one) {
+      return true;
+    }
+  }
+
+  const auto & clients = entities_collector_.clients();
+  for (size_t i = 0; i < clients.size() && spinning.load(); ++i) {
+    if (!wait_set_.clients[i]) {
+      continue;
+    }
+    if (StaticExecutorEntitiesCollector::is_orphan(clients[i].entity)) {
+      orphaned();
+      continue;
+    }
+    AnyExecutable any_exec;
+    any_exec.client = clients[i].entity;
+    execute_ready_executable(any_exec);
+    any_executed = true;
+    if (only_one) {
+      return true;
+    }
+  }
+
+  for (auto & entry : entities_collector_.waitables()) {
+    if (!spinning.load()) {
+      break;
+    }
+    if (!entry.entity->is_ready(&wait_set_)) {
+      continue;
+    }
+    if (StaticExecutorEntitiesCollector::is_orphan(entry.entity)) {
+      orphaned();
+      continue;
+    }
+    AnyExecutable any_exec;
+    any_exec.waitable = entry.entity;
+    execute_ready_executable(any_exec);
+    any_executed = true;
+    if (only_one) {
+      return true;
+    }
+  }
+  return any_executed;
+}
+
+void
+StaticSingleThreadedExecutor::execute_ready_executable(AnyExecutable & any_exec)
+{
+  // Like Executor::execute_any_executable, minus the callback group bookkeeping and the
+  // interrupt guard condition trigger: there is no other thread to tell, and triggering it would
+  // only cause a useless wake up.
+  rclcpp::RealtimeViolationScope violation_scope(track_realtime_violations_);
+  if (any_exec.timer) {
+    execute_timer(any_exec.timer);
+  }
+  if (any_exec.subscription) {
+    execute_subscription(
+      any_exec.subscription, get_subscription_batch_size(*any_exec.subscription));
+  }
+  if (any_exec.subscription_intra_process) {
+    execute_intra_process_subscription(
+      any_exec.subscription_intra_process,
+      get_subscription_batch_size(*any_exec.subscription_intra_process));
+  }
+  if (any_exec.service) {
+    execute_service(any_exec.service);
+  }
+  if (any_exec.client) {
+    execute_client(any_exec.client);
+  }
+  if (any_exec.waitable) {
+    any_exec.waitable->execute();
+  }
+  if (track_realtime_violations_) {
+    report_realtime_violations(any_exec, violation_scope.counts());
+  }
+}
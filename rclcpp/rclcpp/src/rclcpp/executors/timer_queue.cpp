@@ -0,0 +1,77 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/executors/timer_queue.hpp"
+
+#include <algorithm>
+
+using rclcpp::executors::TimerQueue;
+
+void
+TimerQueue::clear()
+{
+  heap_.clear();
+}
+
+void
+TimerQueue::push(size_t index, Clock::time_point due)
+{
+  heap_.push_back({due, index});
+  std::push_heap(heap_.begin(), heap_.end(), &TimerQueue::later);
+}
+
+bool
+TimerQueue::pop_due(Clock::time_point now, size_t & index)
+{
+  if (heap_.empty() || heap_.front().due > now) {
+    return false;
+  }
+  index = heap_.front().index;
+  std::pop_heap(heap_.begin(), heap_.end(), &TimerQueue::later);
+  heap_.pop_back();
+  return true;
+}
+
+TimerQueue::Clock::time_point
+TimerQueue::next_due() const
+{
+  if (heap_.empty()) {
+    return Clock::time_point::max();
+  }
+  return heap_.front().due;
+}
+
+std::chrono::nanoseconds
+TimerQueue::wait_timeout(Clock::time_point now, std::chrono::nanoseconds timeout) const
+{
+  if (heap_.empty()) {
+    return timeout;
+  }
+  auto until_due = std::max(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(heap_.front().due - now),
+    std::chrono::nanoseconds(0));
+  if (timeout < std::chrono::nanoseconds(0)) {
+    return until_due;
+  }
+  return std::min(until_due, timeout);
+}
+
+bool
+TimerQueue::later(const Item & a, const Item & b)
+{
+  if (a.due != b.due) {
+    return a.due > b.due;
+  }
+  return a.index > b.index;
+}
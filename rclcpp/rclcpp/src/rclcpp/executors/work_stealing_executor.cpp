@@ -0,0 +1,309 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/executors/work_stealing_executor.hpp"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/utilities.hpp"
+#include "rclcpp/scope_exit.hpp"
+
+using rclcpp::executors::WorkStealingExecutor;
+
+WorkStealingExecutor::WorkStealingExecutor(
+  const rclcpp::executor::ExecutorArgs & args,
+  size_t number_of_threads,
+  size_t queue_capacity)
+: executor::Executor(args), leader_active_(false), idle_epoch_(0)
+{
+  number_of_threads_ = number_of_threads ? number_of_threads : std::thread::hardware_concurrency();
+  if (number_of_threads_ == 0) {
+    number_of_threads_ = 1;
+  }
+  for (size_t i = 0; i < number_of_threads_; ++i) {
+    deques_.emplace_back(new WorkStealingDeque<PooledTask>(queue_capacity));
+    // A full deque, one task being executed by every thread and the one the leader is filling.
+    task_pools_.emplace_back(new TaskPool(deques_.back()->capacity() + number_of_threads_ + 1));
+  }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {}
+
+void
+WorkStealingExecutor::spin()
+{
+  if (spinning.exchange(true)) {
+    throw std::runtime_error("spin() called while already spinning");
+  }
+  RCLCPP_SCOPE_EXIT(this->spinning.store(false); );
+  std::vector<std::thread> threads;
+  size_t thread_id = 0;
+  for (; thread_id < number_of_threads_ - 1; ++thread_id) {
+    auto func = std::bind(&WorkStealingExecutor::run, this, thread_id);
+    threads.emplace_back(func);
+  }
+
+  run(thread_id);
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  // Whatever was queued but not executed anymore, its callback group is available again.
+  for (auto & deque : deques_) {
+    while (PooledTask * task = deque->pop()) {
+      if (task->executable.callback_group) {
+        task->executable.callback_group->can_be_taken_from().store(true);
+      }
+      give_back(task);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(scheduled_timers_mutex_);
+    scheduled_timers_.clear();
+  }
+  rethrow_thread_configuration_error();
+}
+
+size_t
+WorkStealingExecutor::get_number_of_threads()
+{
+  return number_of_threads_;
+}
+
+void
+WorkStealingExecutor::run(size_t this_thread_number)
+{
+  // Whoever stops, makes sure the sleeping threads notice.
+  RCLCPP_SCOPE_EXIT(this->wake_idle_threads(); );
+  if (!configure_thread_or_cancel(this_thread_number)) {
+    return;
+  }
+  auto & own_deque = *deques_[this_thread_number];
+  while (rclcpp::ok(this->context_) && spinning.load()) {
+    PooledTask * task = own_deque.pop();
+    if (!task) {
+      task = steal(this_thread_number);
+    }
+    if (task) {
+      execute_task(task);
+      continue;
+    }
+
+    uint64_t seen_epoch = idle_epoch_.load();
+    if (!leader_active_.exchange(true)) {
+      {
+        RCLCPP_SCOPE_EXIT(this->leader_active_.store(false); );
+        lead(this_thread_number);
+      }
+      wake_idle_threads();
+      continue;
+    }
+    sleep_while_idle(seen_epoch);
+  }
+}
+
+void
+WorkStealingExecutor::lead(size_t this_thread_number)
+{
+  auto & own_deque = *deques_[this_thread_number];
+  auto & pool = *task_pools_[this_thread_number];
+  // The deque is empty here: it is only pushed to by its owner, who leads only when it popped
+  // nothing. So it has room for capacity() tasks, and the pool has a task for each.
+  size_t room = own_deque.capacity();
+
+  PooledTask * task = pool.take();
+  if (!task) {
+    return;
+  }
+  if (!take_ready_executable(task->executable)) {
+    wait_for_work(std::chrono::nanoseconds(-1));
+    if (!spinning.load() || !take_ready_executable(task->executable)) {
+      give_back(task);
+      return;
+    }
+  }
+  while (true) {
+    if (!own_deque.push(task)) {
+      // Not expected, see above. The task has been taken, so it has to run: its group stays
+      // unavailable until then.
+      execute_task(task);
+      return;
+    }
+    if (--room == 0) {
+      // The rest stays ready, the next leader dispatches it.
+      return;
+    }
+    task = pool.take();
+    if (!task) {
+      return;
+    }
+    if (!take_ready_executable(task->executable)) {
+      give_back(task);
+      return;
+    }
+  }
+}
+
+bool
+WorkStealingExecutor::take_ready_executable(Task & task)
+{
+  // Executor::get_next_timer, minus the timers that are queued or executing.
+  {
+    auto lock = rclcpp::lock_counting_contention(scheduled_timers_mutex_);
+    for (auto & weak_node : weak_nodes_) {
+      auto node = weak_node.lock();
+      if (!node) {
+        continue;
+      }
+      for (auto & weak_group : node->get_callback_groups()) {
+        auto group = weak_group.lock();
+        if (!group || !group->can_be_taken_from().load()) {
+          continue;
+        }
+        for (auto & timer_ref : group->get_timer_ptrs()) {
+          auto timer = timer_ref.lock();
+          if (timer && timer->is_ready() && scheduled_timers_.count(timer) == 0) {
+            scheduled_timers_.insert(timer);
+            task.timer = timer;
+            task.callback_group = group;
+            break;
+          }
+        }
+        if (task.timer) {
+          break;
+        }
+      }
+      if (task.timer) {
+        break;
+      }
+    }
+  }
+
+  if (!task.timer) {
+    memory_strategy_->get_next_subscription(task, weak_nodes_);
+  }
+  if (!task.timer && !task.subscription && !task.subscription_intra_process) {
+    memory_strategy_->get_next_service(task, weak_nodes_);
+  }
+  if (!task.timer && !task.subscription && !task.subscription_intra_process && !task.service) {
+    memory_strategy_->get_next_client(task, weak_nodes_);
+  }
+  if (!task.timer && !task.subscription && !task.subscription_intra_process && !task.service &&
+    !task.client)
+  {
+    memory_strategy_->get_next_waitable(task, weak_nodes_);
+  }
+  if (!task.timer && !task.subscription && !task.subscription_intra_process && !task.service &&
+    !task.client && !task.waitable)
+  {
+    return false;
+  }
+
+  // Same as Executor::get_next_executable: nothing else is taken from this group until the task
+  // has been executed.
+  using callback_group::CallbackGroupType;
+  if (task.callback_group && task.callback_group->type() == CallbackGroupType::MutuallyExclusive) {
+    task.callback_group->can_be_taken_from().store(false);
+  }
+  return true;
+}
+
+WorkStealingExecutor::PooledTask *
+WorkStealingExecutor::steal(size_t this_thread_number)
+{
+  for (size_t i = 1; i < number_of_threads_; ++i) {
+    PooledTask * task = deques_[(this_thread_number + i) % number_of_threads_]->steal();
+    if (task) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void
+WorkStealingExecutor::execute_task(PooledTask * task)
+{
+  try {
+    execute_any_executable(task->executable);
+  } catch (...) {
+    // It did not get to release the group.
+    if (task->executable.callback_group) {
+      task->executable.callback_group->can_be_taken_from().store(true);
+    }
+    give_back(task);
+    throw;
+  }
+
+  if (task->executable.timer) {
+    auto lock = rclcpp::lock_counting_contention(scheduled_timers_mutex_);
+    scheduled_timers_.erase(task->executable.timer);
+  }
+  give_back(task);
+}
+
+void
+WorkStealingExecutor::give_back(PooledTask * task)
+{
+  Task & executable = task->executable;
+  executable.subscription.reset();
+  executable.subscription_intra_process.reset();
+  executable.timer.reset();
+  executable.service.reset();
+  executable.client.reset();
+  executable.waitable.reset();
+  executable.callback_group.reset();
+  executable.node_base.reset();
+  task->in_use.store(false, std::memory_order_release);
+}
+
+WorkStealingExecutor::PooledTask *
+WorkStealingExecutor::TaskPool::take()
+{
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    PooledTask & task = tasks[(next + i) % tasks.size()];
+    // Only the owner sets in_use, so nobody takes the task between the load and the store.
+    if (!task.in_use.load(std::memory_order_acquire)) {
+      task.in_use.store(true, std::memory_order_relaxed);
+      next = (next + i + 1) % tasks.size();
+      return &task;
+    }
+  }
+  return nullptr;
+}
+
+void
+WorkStealingExecutor::wake_idle_threads()
+{
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    ++idle_epoch_;
+  }
+  idle_condition_.notify_all();
+}
+
+void
+WorkStealingExecutor::sleep_while_idle(uint64_t seen_epoch)
+{
+  // Only reached while another thread leads. It bumps the epoch when it stops leading, so a
+  // change between reading seen_epoch and getting here is not missed.
+  std::unique_lock<std::mutex> lock(idle_mutex_);
+  idle_condition_.wait(
+    lock, [this, seen_epoch]() {
+      return idle_epoch_.load() != seen_epoch || !spinning.load();
+    });
+}
@@ -59,6 +59,20 @@ IntraProcessManager::remove_subscription(uint64_t intra_process_subscription_id)
   impl_->remove_subscription(intra_process_subscription_id);
 }
 
+void
+IntraProcessManager::add_intra_process_waitable(
+  uint64_t intra_process_subscription_id,
+  std::shared_ptr<SubscriptionIntraProcessBase> waitable)
+{
+  impl_->add_intra_process_waitable(intra_process_subscription_id, waitable);
+}
+
+IntraProcessManager::TargetsReader
+IntraProcessManager::get_intra_process_targets(uint64_t intra_process_publisher_id) const
+{
+  return TargetsReader(*impl_, intra_process_publisher_id);
+}
+
 void
 IntraProcessManager::remove_publisher(uint64_t intra_process_publisher_id)
 {
@@ -71,6 +85,12 @@ IntraProcessManager::matches_any_publishers(const rmw_gid_t * id) const
   return impl_->matches_any_publishers(id);
 }
 
+bool
+IntraProcessManager::get_publisher_gid(uint64_t intra_process_publisher_id, rmw_gid_t & gid) const
+{
+  return impl_->get_publisher_gid(intra_process_publisher_id, gid);
+}
+
 size_t
 IntraProcessManager::get_subscription_count(uint64_t intra_process_publisher_id) const
 {
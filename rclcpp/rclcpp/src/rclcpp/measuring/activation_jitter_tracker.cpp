@@ -22,12 +22,16 @@ ActivationJitterTracker::ActivationJitterTracker(rclcpp::IMeasurementWriter::Uni
 }
 
 void ActivationJitterTracker::track_jitter(const Clock::SharedPtr& clock, [[maybe_unused]] int64_t time_since_last_activate, int64_t intended_activation_time) {
-    auto now = clock->now().nanoseconds(); // this way, the time should be obtained from the same clock that rcl used to get the 2 nanosecond values in the function parameter.
+    // The current time must come from the same clock that rcl used to get the 2 nanosecond values in the function parameter.
+    // rcl's steady time is CLOCK_MONOTONIC, which is also what the MeasuringClock reads, so for steady timers (create_wall_timer) one read gives us both the 'now' and the unix timestamp.
+    // ROS time and system time timers need their own read.
+    auto stamp = MeasuringClock::now();
+    int64_t now = clock->get_clock_type() == RCL_STEADY_TIME ? stamp.monotonic_ns : clock->now().nanoseconds();
     // todo: This should not be calculated here. These two distinct values (current and intended time) should both be passed to the writer interface.
     // Doing this requires changing the writer interface and itsimplementations.
     auto activation_jitter = now - intended_activation_time; // rcl_time_point_t -> int64_t at the time of writing.
 
-    writer_->use_timestamp(get_unix_time_64b_ns()); // do not use clock param for this! it is not necessarily unix, most likely it is std::chrono::steady_clock (monotonic).
+    writer_->use_timestamp(stamp.unix_ns); // do not use clock param for this! it is not necessarily unix, most likely it is std::chrono::steady_clock (monotonic).
     writer_->record_activation_jitter(activation_jitter_key_, static_cast<int64_t>(activation_jitter));
 }
 
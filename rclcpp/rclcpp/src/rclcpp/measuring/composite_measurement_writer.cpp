@@ -0,0 +1,130 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/measuring/composite_measurement_writer.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#include "rclcpp/measuring/measurement_writer_factory.hpp"
+
+namespace {
+std::mutex routes_mutex;
+std::vector<rclcpp::MeasurementRoute> configured_routes;
+}
+
+namespace rclcpp {
+
+MeasurementFilter MeasurementRoute::latency_above(std::chrono::nanoseconds threshold) {
+    auto threshold_ns = threshold.count();
+    return [threshold_ns](const MeasurementRecord & record) {
+        return record.kind != MeasurementRecord::Kind::LATENCY || record.value > threshold_ns;
+    };
+}
+
+CompositeMeasurementWriter::CompositeMeasurementWriter(const rclcpp::MessageTrackerHostInfo & host_info)
+    : CompositeMeasurementWriter(host_info, get_routes())
+{}
+
+CompositeMeasurementWriter::CompositeMeasurementWriter(const rclcpp::MessageTrackerHostInfo & host_info, const std::vector<MeasurementRoute> & routes) {
+    if (routes.empty()) {
+        throw std::invalid_argument("COMPOSITE measurement writer without routes, call CompositeMeasurementWriter::set_routes() before creating the node.");
+    }
+
+    for (const auto & route : routes) {
+        Backend backend;
+        if (route.make_backend) {
+            backend.writer = route.make_backend(host_info);
+            if (!backend.writer) {
+                throw std::invalid_argument("COMPOSITE measurement writer route made no backend writer.");
+            }
+        } else if (route.backend == MeasurementWriterEnum::COMPOSITE) {
+            throw std::invalid_argument("COMPOSITE measurement writer can not route to another COMPOSITE writer.");
+        } else {
+            backend.writer = MeasurementWriterFactory::create(route.backend, host_info);
+        }
+        backend.measurement_classes = route.measurement_classes;
+        backend.filter = route.filter;
+        backends_.emplace_back(std::move(backend));
+    }
+}
+
+void CompositeMeasurementWriter::set_routes(std::vector<MeasurementRoute> routes) {
+    std::lock_guard<std::mutex> lock(routes_mutex);
+    configured_routes = std::move(routes);
+}
+
+std::vector<MeasurementRoute> CompositeMeasurementWriter::get_routes() {
+    std::lock_guard<std::mutex> lock(routes_mutex);
+    return configured_routes;
+}
+
+uint32_t CompositeMeasurementWriter::register_measurement_class(const std::string& name, const std::vector<std::string>& columns) {
+    std::vector<Target> targets;
+    for (size_t i = 0; i < backends_.size(); ++i) {
+        const auto & wanted = backends_[i].measurement_classes;
+        if (!wanted.empty() && std::find(wanted.begin(), wanted.end(), name) == wanted.end()) {
+            continue;
+        }
+        targets.push_back({i, backends_[i].writer->register_measurement_class(name, columns)});
+    }
+
+    measurement_classes_.emplace_back(name);
+    targets_.emplace_back(std::move(targets));
+    return static_cast<uint32_t>(measurement_classes_.size() - 1);
+}
+
+template<typename RecordFunction>
+void CompositeMeasurementWriter::fan_out(uint32_t key, const MeasurementRecord & record, RecordFunction && record_function) {
+    for (const auto & target : targets_[key]) {
+        auto & backend = backends_[target.backend];
+        if (backend.filter && !backend.filter(record)) {
+            continue;
+        }
+        backend.writer->use_timestamp(output_timestamp());
+        record_function(*backend.writer, target.key);
+    }
+}
+
+void CompositeMeasurementWriter::record_latency(uint32_t key, const MessageTrackingVariables& msg, const hex_char_array_t& publisher, int64_t arrival_time) {
+    MeasurementRecord record{MeasurementRecord::Kind::LATENCY, &measurement_classes_[key], &msg, arrival_time - msg.vandenhoven_timestamp, 0};
+    fan_out(key, record, [&](IMeasurementWriter & writer, uint32_t backend_key) {
+        writer.record_latency(backend_key, msg, publisher, arrival_time);
+    });
+}
+
+void CompositeMeasurementWriter::record_arrival(uint32_t key, const MessageTrackingVariables& msg, const hex_char_array_t& publisher) {
+    MeasurementRecord record{MeasurementRecord::Kind::ARRIVAL, &measurement_classes_[key], &msg, 0, 0};
+    fan_out(key, record, [&](IMeasurementWriter & writer, uint32_t backend_key) {
+        writer.record_arrival(backend_key, msg, publisher);
+    });
+}
+
+void CompositeMeasurementWriter::record_activation_jitter(uint32_t key, int64_t activation_jitter) {
+    MeasurementRecord record{MeasurementRecord::Kind::ACTIVATION_JITTER, &measurement_classes_[key], nullptr, activation_jitter, 0};
+    fan_out(key, record, [&](IMeasurementWriter & writer, uint32_t backend_key) {
+        writer.record_activation_jitter(backend_key, activation_jitter);
+    });
+}
+
+void CompositeMeasurementWriter::record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) {
+    MeasurementRecord record{MeasurementRecord::Kind::REALTIME_VIOLATIONS, &measurement_classes_[key], nullptr,
+        static_cast<int64_t>(allocations), static_cast<int64_t>(lock_waits)};
+    fan_out(key, record, [&](IMeasurementWriter & writer, uint32_t backend_key) {
+        writer.record_realtime_violations(backend_key, allocations, lock_waits);
+    });
+}
+
+} // namespace rclcpp
@@ -30,4 +30,8 @@ void DummyMeasurementWriter::record_arrival(uint32_t, const MessageTrackingVaria
 
 void DummyMeasurementWriter::record_activation_jitter(uint32_t, int64_t) {
     return;
+}
+
+void DummyMeasurementWriter::record_realtime_violations(uint32_t, uint64_t, uint64_t) {
+    return;
 }
\ No newline at end of file
@@ -76,4 +76,10 @@ void FileMeasurementWriter::record_activation_jitter(uint32_t key, int64_t activ
     std::ofstream& stream = measurement_classes_[key];
 
     stream << output_timestamp() << "," << activation_jitter << "\n";
+}
+
+void FileMeasurementWriter::record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) {
+    std::ofstream& stream = measurement_classes_[key];
+
+    stream << output_timestamp() << "," << allocations << "," << lock_waits << "\n";
 }
\ No newline at end of file
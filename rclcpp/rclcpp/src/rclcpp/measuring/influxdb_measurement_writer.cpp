@@ -95,6 +95,20 @@ void InfluxDBMeasurementWriter::record_activation_jitter(uint32_t key, int64_t a
     maybe_upload(ready_to_post_builder);
 }
 
+void InfluxDBMeasurementWriter::record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) {
+    const auto& measurement = measurements_[key];
+    // host_topic_ is the fake '__rclcpp_timer_activation_jitter' topic for timers, which still tells the two apart.
+    auto& ready_to_post_builder = influx_builder_
+        .meas(measurement)
+        .tag("topic", host_topic_)
+        .tag("node_full_name", host_fully_qualified_name_)
+        .field("allocations", static_cast<long long>(allocations))
+        .field("lock_waits", static_cast<long long>(lock_waits))
+        .timestamp(output_timestamp());
+
+    maybe_upload(ready_to_post_builder);
+}
+
 void InfluxDBMeasurementWriter::maybe_upload(influxdb_cpp::detail::ts_caller& uploadable) {
     if (heuristic_->should_upload(influx_builder_)) {
         // note alternatively, inspect return code of post and only update upload time on success. 
@@ -40,18 +40,7 @@ IMeasurementWriter::UniquePtr JitterTrackerFactory::create_result_writer(Measure
     Or we just pass in an rcl_node_t * directly, and let users fill in meta-info from there.
     */
     auto host_information = MessageTrackerHostInfo("__rclcpp_timer_activation_jitter", opts.timer_name.c_str() + 1, "/");
-    switch(mwe) {
-        case MeasurementWriterEnum::INFLUXDB:
-            return std::make_unique<InfluxDBMeasurementWriter>(host_information);
-        case MeasurementWriterEnum::FILE:
-            return std::make_unique<FileMeasurementWriter>(host_information);
-        case MeasurementWriterEnum::PRINT:
-            return std::make_unique<PrintMeasurementWriter>();
-        case MeasurementWriterEnum::NONE:
-            return std::make_unique<DummyMeasurementWriter>();
-        default:
-            throw std::invalid_argument( "Unrecognized enum value for MeasurementWriterEnum" );
-    }
+    return MeasurementWriterFactory::create(mwe, host_information);
 }
 
 IJitterTracker::UniquePtr
@@ -0,0 +1,45 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/measuring/measurement_writer_factory.hpp"
+
+#include "rclcpp/measuring/composite_measurement_writer.hpp"
+#include "rclcpp/measuring/dummy_measurement_writer.hpp"
+#include "rclcpp/measuring/file_measurement_writer.hpp"
+#include "rclcpp/measuring/influxdb_measurement_writer.hpp"
+#include "rclcpp/measuring/print_measurement_writer.hpp"
+#include "rclcpp/measuring/prometheus_measurement_writer.hpp"
+
+namespace rclcpp {
+
+IMeasurementWriter::UniquePtr MeasurementWriterFactory::create(MeasurementWriterEnum mwe, const MessageTrackerHostInfo & host_information) {
+    switch(mwe) {
+        case MeasurementWriterEnum::INFLUXDB:
+            return std::make_unique<InfluxDBMeasurementWriter>(host_information);
+        case MeasurementWriterEnum::FILE:
+            return std::make_unique<FileMeasurementWriter>(host_information);
+        case MeasurementWriterEnum::PRINT:
+            return std::make_unique<PrintMeasurementWriter>();
+        case MeasurementWriterEnum::NONE:
+            return std::make_unique<DummyMeasurementWriter>();
+        case MeasurementWriterEnum::PROMETHEUS:
+            return std::make_unique<PrometheusMeasurementWriter>(host_information);
+        case MeasurementWriterEnum::COMPOSITE:
+            return std::make_unique<CompositeMeasurementWriter>(host_information);
+        default:
+            throw std::invalid_argument( "Unrecognized enum value for MeasurementWriterEnum" );
+    }
+}
+
+} // namespace rclcpp
@@ -0,0 +1,117 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/measuring/measuring_clock.hpp"
+
+#include <atomic>
+#include <limits>
+
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+
+namespace {
+// All plain atomics with static (constant) initialization, so the clock is usable from static destructors etc.
+std::atomic<int64_t> unix_offset_ns(0);
+std::atomic<int64_t> last_calibration_ns(0);
+std::atomic<int64_t> recalibration_period_ns(1000000000);
+std::atomic<bool> calibrated(false);
+std::atomic_flag calibrating = ATOMIC_FLAG_INIT;
+
+// How many (monotonic, realtime, monotonic) samples a calibration takes. The one with the smallest window wins,
+// which filters out the samples where we got preempted between the reads.
+constexpr int calibration_samples = 3;
+
+int64_t read_realtime() {
+    return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
+}
+
+namespace rclcpp {
+
+int64_t MeasuringClock::read_monotonic() {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+MeasuringTimestamp MeasuringClock::now() {
+    MeasuringTimestamp stamp;
+    stamp.monotonic_ns = read_monotonic();
+    maybe_recalibrate(stamp.monotonic_ns);
+    stamp.unix_ns = stamp.monotonic_ns + unix_offset_ns.load(std::memory_order_relaxed);
+    return stamp;
+}
+
+int64_t MeasuringClock::monotonic_now() {
+    return read_monotonic();
+}
+
+int64_t MeasuringClock::unix_now() {
+    return now().unix_ns;
+}
+
+int64_t MeasuringClock::to_unix(int64_t monotonic_ns) {
+    maybe_recalibrate(monotonic_ns);
+    return monotonic_ns + unix_offset_ns.load(std::memory_order_relaxed);
+}
+
+void MeasuringClock::recalibrate() {
+    int64_t best_window = std::numeric_limits<int64_t>::max();
+    int64_t best_offset = 0;
+    int64_t calibration_time = 0;
+
+    for (int i = 0; i < calibration_samples; ++i) {
+        auto before = read_monotonic();
+        auto realtime = read_realtime();
+        auto after = read_monotonic();
+
+        auto window = after - before;
+        if (window < best_window) {
+            best_window = window;
+            // assume the realtime read happened halfway.
+            best_offset = realtime - (before + window / 2);
+            calibration_time = after;
+        }
+    }
+
+    unix_offset_ns.store(best_offset, std::memory_order_relaxed);
+    last_calibration_ns.store(calibration_time, std::memory_order_relaxed);
+    calibrated.store(true, std::memory_order_release);
+}
+
+void MeasuringClock::set_recalibration_period(std::chrono::nanoseconds period) {
+    recalibration_period_ns.store(period.count(), std::memory_order_relaxed);
+}
+
+void MeasuringClock::maybe_recalibrate(int64_t monotonic_ns) {
+    if (!calibrated.load(std::memory_order_acquire)) {
+        // Nobody calibrated yet. Everybody that gets here calibrates, nobody can use a zero offset.
+        recalibrate();
+        return;
+    }
+
+    auto age = monotonic_ns - last_calibration_ns.load(std::memory_order_relaxed);
+    if (age < recalibration_period_ns.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Somebody else is on it. Their offset will be at most a period old, good enough.
+    if (calibrating.test_and_set(std::memory_order_acquire)) {
+        return;
+    }
+    recalibrate();
+    calibrating.clear(std::memory_order_release);
+}
+
+} // namespace rclcpp
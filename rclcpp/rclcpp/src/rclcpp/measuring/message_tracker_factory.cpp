@@ -25,10 +25,7 @@ using rclcpp::DummyMessageTracker;
 using rclcpp::IMessageTracker;
 using rclcpp::MessageTrackerEnum;
 using rclcpp::IMeasurementWriter;
-using rclcpp::FileMeasurementWriter;
-using rclcpp::PrintMeasurementWriter;
-using rclcpp::DummyMeasurementWriter;
-using rclcpp::InfluxDBMeasurementWriter;
+using rclcpp::MeasurementWriterFactory;
 
 MessageTrackerFactory::UniquePtr MessageTrackerFactory::make(MessageTrackerEnum mte) {
     switch (mte) {
@@ -46,18 +43,7 @@ MessageTrackerFactory::UniquePtr MessageTrackerFactory::make(MessageTrackerEnum
 }
 
 IMeasurementWriter::UniquePtr MessageTrackerFactory::create_result_writer(MeasurementWriterEnum mwe, const MessageTrackerHostInfo & host_information) const {
-    switch(mwe) {
-        case MeasurementWriterEnum::INFLUXDB:
-            return std::make_unique<InfluxDBMeasurementWriter>(host_information);
-        case MeasurementWriterEnum::FILE:
-            return std::make_unique<FileMeasurementWriter>(host_information);
-        case MeasurementWriterEnum::PRINT:
-            return std::make_unique<PrintMeasurementWriter>();
-        case MeasurementWriterEnum::NONE:
-            return std::make_unique<DummyMeasurementWriter>();
-        default:
-            throw std::invalid_argument( "Unrecognized enum value for MeasurementWriterEnum" );
-    }
+    return MeasurementWriterFactory::create(mwe, host_information);
 }
 
 IMessageTracker::UniquePtr
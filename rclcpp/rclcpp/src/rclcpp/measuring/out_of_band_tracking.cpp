@@ -0,0 +1,176 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/measuring/out_of_band_tracking.hpp"
+
+#include <string>
+
+#include "rcl/error_handling.h"
+#include "rcl_interfaces/msg/intra_process_message.hpp"
+#include "rcutils/logging_macros.h"
+
+#include "rclcpp/exceptions.hpp"
+#include "rclcpp/hashing/mmh3.hpp"
+#include "rclcpp/type_support_decl.hpp"
+
+namespace {
+// Monotonic stamps further apart than this are from different hosts (different boot times), time-based pairing makes no sense then.
+constexpr int64_t same_host_window_ns = 10LL * 1000 * 1000 * 1000;
+
+inline bool comparable(int64_t a, int64_t b) {
+    auto diff = a - b;
+    return diff < same_host_window_ns && diff > -same_host_window_ns;
+}
+}
+
+namespace rclcpp {
+
+std::string get_out_of_band_tracking_topic(const std::string & data_topic) {
+    return data_topic + "/_pmros2_tracking";
+}
+
+uint32_t hash_publisher_gid(const rmw_gid_t & gid) {
+    uint32_t hash;
+    MurmurHash3_x86_32(gid.data, RMW_GID_STORAGE_SIZE, 0, &hash);
+    return hash;
+}
+
+OutOfBandTrackingPublisher::OutOfBandTrackingPublisher(std::shared_ptr<rcl_node_t> node_handle, const rcl_publisher_t * data_publisher, const rmw_gid_t & data_publisher_gid)
+    : node_handle_(std::move(node_handle))
+    , publisher_(rcl_get_zero_initialized_publisher())
+    , publisher_key_(hash_publisher_gid(data_publisher_gid))
+{
+    // same QoS as the data, so that the side channel loses (or keeps) samples the way the data does.
+    auto options = rcl_publisher_get_default_options();
+    options.qos = rcl_publisher_get_options(data_publisher)->qos;
+    auto topic = get_out_of_band_tracking_topic(rcl_publisher_get_topic_name(data_publisher));
+
+    auto ret = rcl_publisher_init(&publisher_, node_handle_.get(), rclcpp::type_support::get_intra_process_message_msg_type_support(), topic.c_str(), &options);
+    if (ret != RCL_RET_OK) {
+        rclcpp::exceptions::throw_from_rcl_error(ret, "could not create out-of-band tracking publisher");
+    }
+}
+
+OutOfBandTrackingPublisher::~OutOfBandTrackingPublisher() {
+    if (rcl_publisher_fini(&publisher_, node_handle_.get()) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED("rclcpp", "Error in destruction of out-of-band tracking publisher: %s", rcl_get_error_string().str);
+        rcl_reset_error();
+    }
+}
+
+void OutOfBandTrackingPublisher::publish(const MessageTrackingVariables & vars) {
+    rcl_interfaces::msg::IntraProcessMessage sample;
+    sample.vandenhoven_timestamp = vars.vandenhoven_timestamp;
+    sample.vandenhoven_identifier = vars.vandenhoven_identifier;
+    sample.vandenhoven_publisher_hash = vars.vandenhoven_publisher_hash;
+    sample.publisher_id = publisher_key_;
+    sample.message_sequence = sequence_++;
+
+    // A lost tracking sample is not worth failing the publish of the data for. Tell and move on.
+    if (rcl_publish(&publisher_, &sample, nullptr) != RCL_RET_OK) {
+        RCUTILS_LOG_WARN_NAMED("rclcpp", "failed to publish out-of-band tracking sample: %s", rcl_get_error_string().str);
+        rcl_reset_error();
+    }
+}
+
+OutOfBandTrackingSubscriber::OutOfBandTrackingSubscriber(std::shared_ptr<rcl_node_t> node_handle, const rcl_subscription_t * data_subscription, size_t max_pending)
+    : node_handle_(std::move(node_handle))
+    , subscription_(rcl_get_zero_initialized_subscription())
+    , max_pending_(max_pending)
+{
+    auto options = rcl_subscription_get_default_options();
+    options.qos = rcl_subscription_get_options(data_subscription)->qos;
+    auto topic = get_out_of_band_tracking_topic(rcl_subscription_get_topic_name(data_subscription));
+
+    auto ret = rcl_subscription_init(&subscription_, node_handle_.get(), rclcpp::type_support::get_intra_process_message_msg_type_support(), topic.c_str(), &options);
+    if (ret != RCL_RET_OK) {
+        rclcpp::exceptions::throw_from_rcl_error(ret, "could not create out-of-band tracking subscription");
+    }
+}
+
+OutOfBandTrackingSubscriber::~OutOfBandTrackingSubscriber() {
+    if (rcl_subscription_fini(&subscription_, node_handle_.get()) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED("rclcpp", "Error in destruction of out-of-band tracking subscription: %s", rcl_get_error_string().str);
+        rcl_reset_error();
+    }
+}
+
+void OutOfBandTrackingSubscriber::track_arrival(IMessageTracker & tracker, const rmw_message_info_t & data_message_info) {
+    track_arrival(tracker, hash_publisher_gid(data_message_info.publisher_gid));
+}
+
+void OutOfBandTrackingSubscriber::track_arrival(IMessageTracker & tracker, uint32_t publisher_key) {
+    auto arrival = MeasuringClock::now(); // before draining, which costs time.
+    drain();
+
+    auto & pending = pending_[publisher_key];
+    pending.arrivals.push_back(arrival);
+    if (pending.arrivals.size() > max_pending_) {
+        pending.arrivals.pop_front();
+    }
+    pair(tracker, pending);
+}
+
+void OutOfBandTrackingSubscriber::drain() {
+    rcl_interfaces::msg::IntraProcessMessage sample;
+    rmw_message_info_t info;
+    while (true) {
+        auto ret = rcl_take(&subscription_, &sample, &info, nullptr);
+        if (ret == RCL_RET_SUBSCRIPTION_TAKE_FAILED) {
+            return;
+        }
+        if (ret != RCL_RET_OK) {
+            RCUTILS_LOG_WARN_NAMED("rclcpp", "failed to take out-of-band tracking sample: %s", rcl_get_error_string().str);
+            rcl_reset_error();
+            return;
+        }
+
+        MessageTrackingVariables vars;
+        vars.vandenhoven_timestamp = sample.vandenhoven_timestamp;
+        vars.vandenhoven_identifier = sample.vandenhoven_identifier;
+        vars.vandenhoven_publisher_hash = sample.vandenhoven_publisher_hash;
+
+        auto & pending = pending_[static_cast<uint32_t>(sample.publisher_id)];
+        pending.samples.push_back(vars);
+        if (pending.samples.size() > max_pending_) {
+            pending.samples.pop_front();
+        }
+    }
+}
+
+void OutOfBandTrackingSubscriber::pair(IMessageTracker & tracker, PendingPublisher & pending) {
+    while (!pending.samples.empty() && !pending.arrivals.empty()) {
+        const auto & arrival = pending.arrivals.front();
+        const auto & sample = pending.samples.front();
+
+        if (comparable(arrival.monotonic_ns, sample.vandenhoven_timestamp)) {
+            // The oldest sample is younger than the oldest arrival: the sample of that arrival was lost.
+            if (sample.vandenhoven_timestamp > arrival.monotonic_ns) {
+                pending.arrivals.pop_front();
+                continue;
+            }
+            // The next sample also predates the arrival: the oldest one belongs to a data message we never got.
+            if (pending.samples.size() > 1 && pending.samples[1].vandenhoven_timestamp <= arrival.monotonic_ns) {
+                pending.samples.pop_front();
+                continue;
+            }
+        }
+
+        tracker.track_late_arrival(sample, arrival);
+        pending.samples.pop_front();
+        pending.arrivals.pop_front();
+    }
+}
+
+} // namespace rclcpp
@@ -36,4 +36,9 @@ void PrintMeasurementWriter::record_arrival(uint32_t key, const MessageTrackingV
 void PrintMeasurementWriter::record_activation_jitter(uint32_t key, int64_t activation_jitter) {
     const auto& name = measurement_classes_[key];
     std::cout << "[ " << name << " ]: (" << activation_jitter << ")\n";
+}
+
+void PrintMeasurementWriter::record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) {
+    const auto& name = measurement_classes_[key];
+    std::cout << "[ " << name << " ]: (" << allocations << " allocations, " << lock_waits << " lock waits)\n";
 }
\ No newline at end of file
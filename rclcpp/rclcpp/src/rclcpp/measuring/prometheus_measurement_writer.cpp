@@ -0,0 +1,459 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/measuring/prometheus_measurement_writer.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+constexpr size_t cache_line_size = 64;
+
+// Loopback only by default: exposing the metrics beyond the host is a deployment decision.
+constexpr const char * default_address = "127.0.0.1";
+constexpr uint16_t default_port = 9469;
+
+// Which shard a thread writes to. Handed out round robin, so the first shard_count threads never share one.
+std::atomic<size_t> next_shard_index(0);
+
+size_t this_thread_shard_index() {
+    thread_local size_t index = next_shard_index.fetch_add(1, std::memory_order_relaxed) % rclcpp::PrometheusSeries::shard_count;
+    return index;
+}
+
+std::string format_seconds(double seconds) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", seconds);
+    return buffer;
+}
+
+// label values may contain anything, the exposition format wants \\, \" and \n escaped.
+std::string escape_label_value(const std::string & value) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': result += "\\\\"; break;
+            case '"': result += "\\\""; break;
+            case '\n': result += "\\n"; break;
+            default: result += c;
+        }
+    }
+    return result;
+}
+
+// metric names are [a-zA-Z_:][a-zA-Z0-9_:]*, measurement class names are free-form.
+std::string sanitize_metric_name(const std::string & name) {
+    std::string result = name;
+    for (auto & c : result) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        if (!ok) {
+            c = '_';
+        }
+    }
+    return result;
+}
+
+const char * type_name(rclcpp::PrometheusMetricType type) {
+    switch (type) {
+        case rclcpp::PrometheusMetricType::COUNTER: return "counter";
+        case rclcpp::PrometheusMetricType::GAUGE: return "gauge";
+        case rclcpp::PrometheusMetricType::HISTOGRAM: return "histogram";
+    }
+    return "untyped";
+}
+
+std::string with_labels(const std::string & name, const std::string & labels) {
+    return labels.empty() ? name : name + "{" + labels + "}";
+}
+
+void send_all(int fd, const std::string & data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        auto ret = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (ret <= 0) {
+            return; // scraper went away, not our problem.
+        }
+        sent += static_cast<size_t>(ret);
+    }
+}
+}
+
+namespace rclcpp {
+
+struct PrometheusSeries::Shard {
+    std::atomic<uint64_t> count;
+    std::atomic<int64_t> sum;
+    std::atomic<uint64_t> buckets[16]; // non-cumulative, made cumulative when rendering. Sized for bucket_bounds_ns().
+};
+
+const std::vector<int64_t> & PrometheusSeries::bucket_bounds_ns() {
+    static const std::vector<int64_t> bounds = {
+        10000, 50000, 100000, 250000, 500000,
+        1000000, 2500000, 5000000, 10000000, 25000000,
+        50000000, 100000000, 250000000, 500000000, 1000000000
+    };
+    return bounds;
+}
+
+PrometheusSeries::PrometheusSeries(PrometheusMetricType type, std::string labels)
+    : type_(type)
+    , labels_(std::move(labels))
+    , gauge_(0)
+    , shards_(nullptr)
+    , shard_stride_(0)
+{
+    if (type_ == PrometheusMetricType::GAUGE) {
+        return;
+    }
+
+    shard_stride_ = (sizeof(Shard) + cache_line_size - 1) / cache_line_size * cache_line_size;
+    shard_storage_.reset(new char[shard_count * shard_stride_ + cache_line_size]);
+    auto address = reinterpret_cast<uintptr_t>(shard_storage_.get());
+    shards_ = shard_storage_.get() + (cache_line_size - address % cache_line_size) % cache_line_size;
+    for (size_t i = 0; i < shard_count; ++i) {
+        new (shards_ + i * shard_stride_) Shard(); // value-initialized: all zero.
+    }
+}
+
+PrometheusSeries::~PrometheusSeries() {
+    if (shards_ == nullptr) {
+        return;
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        reinterpret_cast<Shard *>(shards_ + i * shard_stride_)->~Shard();
+    }
+}
+
+PrometheusSeries::Shard & PrometheusSeries::local_shard() {
+    return *reinterpret_cast<Shard *>(shards_ + this_thread_shard_index() * shard_stride_);
+}
+
+const PrometheusSeries::Shard & PrometheusSeries::shard(size_t i) const {
+    return *reinterpret_cast<const Shard *>(shards_ + i * shard_stride_);
+}
+
+void PrometheusSeries::add(uint64_t amount) {
+    local_shard().count.fetch_add(amount, std::memory_order_relaxed);
+}
+
+void PrometheusSeries::set(int64_t value) {
+    gauge_.store(value, std::memory_order_relaxed);
+}
+
+void PrometheusSeries::observe_ns(int64_t value_ns) {
+    const auto & bounds = bucket_bounds_ns();
+    auto & s = local_shard();
+
+    size_t bucket = 0;
+    while (bucket < bounds.size() && value_ns > bounds[bucket]) {
+        ++bucket;
+    }
+    // the last slot is everything above the last bound, only +Inf counts it.
+    s.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(value_ns, std::memory_order_relaxed);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PrometheusSeries::render(std::string & out, const std::string & name) const {
+    if (type_ == PrometheusMetricType::GAUGE) {
+        out += with_labels(name, labels_) + " " + format_seconds(static_cast<double>(gauge_.load(std::memory_order_relaxed)) / 1e9) + "\n";
+        return;
+    }
+
+    uint64_t count = 0;
+    for (size_t i = 0; i < shard_count; ++i) {
+        count += shard(i).count.load(std::memory_order_relaxed);
+    }
+
+    if (type_ == PrometheusMetricType::COUNTER) {
+        out += with_labels(name, labels_) + " " + std::to_string(count) + "\n";
+        return;
+    }
+
+    // Shards are read one after the other while threads keep recording, so count, sum and buckets can be a few samples apart.
+    // Prometheus copes with that. +Inf is the sum of the buckets rather than count, so at least the buckets are monotonic.
+    const auto & bounds = bucket_bounds_ns();
+    std::string separator = labels_.empty() ? "" : ",";
+    uint64_t cumulative = 0;
+    int64_t sum = 0;
+    for (size_t b = 0; b <= bounds.size(); ++b) {
+        for (size_t i = 0; i < shard_count; ++i) {
+            cumulative += shard(i).buckets[b].load(std::memory_order_relaxed);
+        }
+        auto le = b < bounds.size() ? format_seconds(static_cast<double>(bounds[b]) / 1e9) : std::string("+Inf");
+        out += name + "_bucket{" + labels_ + separator + "le=\"" + le + "\"} " + std::to_string(cumulative) + "\n";
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        sum += shard(i).sum.load(std::memory_order_relaxed);
+    }
+    out += with_labels(name + "_sum", labels_) + " " + format_seconds(static_cast<double>(sum) / 1e9) + "\n";
+    out += with_labels(name + "_count", labels_) + " " + std::to_string(count) + "\n";
+}
+
+PrometheusRegistry & PrometheusRegistry::instance() {
+    static PrometheusRegistry registry;
+    return registry;
+}
+
+PrometheusRegistry::~PrometheusRegistry() {
+    stop();
+}
+
+bool PrometheusRegistry::start(const std::string & address, uint16_t port) {
+    std::lock_guard<std::mutex> lock(server_mutex_);
+    if (serving_) {
+        return true;
+    }
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "[PROMETHEUS_MEASUREMENT_WRITER] could not create socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1
+        || ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+        || ::listen(fd, 8) != 0)
+    {
+        // Keep aggregating, a later start() may still succeed. Nothing is lost until then.
+        std::cerr << "[PROMETHEUS_MEASUREMENT_WRITER] could not serve on " << address << ":" << port << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+
+    socklen_t addr_len = sizeof(addr);
+    ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &addr_len);
+
+    listen_fd_ = fd;
+    port_ = ntohs(addr.sin_port);
+    serving_ = true;
+    server_thread_ = std::thread(&PrometheusRegistry::serve, this);
+    return true;
+}
+
+bool PrometheusRegistry::start_from_environment() {
+    std::call_once(started_from_environment_, [this]() {
+        if (serving_) {
+            return;
+        }
+        const char * address = std::getenv("PMROS2_PROMETHEUS_ADDRESS");
+        if (!address || !*address) {
+            address = default_address;
+        }
+        uint16_t port = default_port;
+        const char * port_value = std::getenv("PMROS2_PROMETHEUS_PORT");
+        if (port_value && *port_value) {
+            char * end = nullptr;
+            unsigned long parsed = std::strtoul(port_value, &end, 10);
+            if (*end != '\0' || parsed > 65535) {
+                std::cerr << "[PROMETHEUS_MEASUREMENT_WRITER] ignoring PMROS2_PROMETHEUS_PORT=" << port_value << ", not a port\n";
+            } else {
+                port = static_cast<uint16_t>(parsed);
+            }
+        }
+        // Only one process on the host gets a given port, the others still serve somewhere.
+        if (!start(address, port) && port != 0 && !start(address, 0)) {
+            return;
+        }
+        std::cerr << "[PROMETHEUS_MEASUREMENT_WRITER] serving metrics on http://" << address << ":" << port_ << "/metrics\n";
+    });
+    return serving_;
+}
+
+void PrometheusRegistry::stop() {
+    std::lock_guard<std::mutex> lock(server_mutex_);
+    if (!serving_) {
+        return;
+    }
+    serving_ = false;
+    server_thread_.join();
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    port_ = 0;
+}
+
+PrometheusSeries * PrometheusRegistry::series(PrometheusMetricType type, const std::string & name, const std::string & help, const std::string & labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto & family = families_[name];
+    if (family.series.empty()) {
+        family.type = type;
+        family.help = help;
+    } else if (family.type != type) {
+        throw std::invalid_argument("Prometheus metric '" + name + "' registered with two different types");
+    }
+
+    auto & series = family.series[labels];
+    if (!series) {
+        series = std::make_unique<PrometheusSeries>(type, labels);
+    }
+    return series.get();
+}
+
+std::string PrometheusRegistry::render() const {
+    std::string out;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto & family : families_) {
+        out += "# HELP " + family.first + " " + family.second.help + "\n";
+        out += std::string("# TYPE ") + family.first + " " + type_name(family.second.type) + "\n";
+        for (const auto & series : family.second.series) {
+            series.second->render(out, family.first);
+        }
+    }
+    return out;
+}
+
+void PrometheusRegistry::serve() {
+    while (serving_) {
+        // Wake up now and then to notice stop().
+        pollfd listener{listen_fd_, POLLIN, 0};
+        if (::poll(&listener, 1, 200) <= 0) {
+            continue;
+        }
+        int client = ::accept(listen_fd_, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        answer(client);
+        ::close(client);
+    }
+}
+
+void PrometheusRegistry::answer(int client_fd) const {
+    // A stuck client must not block the next scrape forever.
+    timeval timeout{1, 0};
+    ::setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters, read until the end of the headers (or give up at a sane size).
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        auto ret = ::recv(client_fd, buffer, sizeof(buffer), 0);
+        if (ret <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(ret));
+    }
+
+    std::string status = "404 Not Found";
+    std::string body = "try /metrics\n";
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0) {
+        status = "200 OK";
+        body = render();
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n";
+    send_all(client_fd, response.str());
+    send_all(client_fd, body);
+}
+
+PrometheusMeasurementWriter::PrometheusMeasurementWriter(const rclcpp::MessageTrackerHostInfo & host_info) {
+    host_labels_ = "topic=\"" + escape_label_value(host_info.topic_name) + "\",node=\""
+        + escape_label_value(std::string(host_info.node_namespace) + host_info.node_name) + "\"";
+
+    PrometheusRegistry::instance().start_from_environment();
+}
+
+uint32_t PrometheusMeasurementWriter::register_measurement_class(const std::string& name, const std::vector<std::string>&) {
+    MeasurementClass measurement_class;
+    measurement_class.metric_name = "pmros2_" + sanitize_metric_name(name);
+    measurement_classes_.emplace_back(std::move(measurement_class));
+
+    return static_cast<uint32_t>(measurement_classes_.size() - 1);
+}
+
+std::string PrometheusMeasurementWriter::labels_with_publisher(const hex_char_array_t & publisher) const {
+    std::ostringstream labels;
+    labels << host_labels_ << ",publisher=\"" << publisher << "\"";
+    return labels.str();
+}
+
+void PrometheusMeasurementWriter::record_latency(uint32_t key, const MessageTrackingVariables& msg, const hex_char_array_t& publisher, int64_t arrival_time) {
+    auto & measurement = measurement_classes_[key];
+    auto & series = measurement.publisher_series[static_cast<uint32_t>(msg.vandenhoven_publisher_hash)];
+    if (series.first == nullptr) {
+        auto labels = labels_with_publisher(publisher);
+        auto & registry = PrometheusRegistry::instance();
+        series.first = registry.series(PrometheusMetricType::HISTOGRAM, measurement.metric_name + "_seconds",
+            "Time between publishing and arrival of a message.", labels);
+        series.second = registry.series(PrometheusMetricType::GAUGE, measurement.metric_name + "_last_seconds",
+            "Latency of the most recently arrived message.", labels);
+    }
+
+    auto latency = arrival_time - msg.vandenhoven_timestamp;
+    series.first->observe_ns(latency);
+    series.second->set(latency);
+}
+
+void PrometheusMeasurementWriter::record_arrival(uint32_t key, const MessageTrackingVariables& msg, const hex_char_array_t& publisher) {
+    auto & measurement = measurement_classes_[key];
+    auto & series = measurement.publisher_series[static_cast<uint32_t>(msg.vandenhoven_publisher_hash)];
+    if (series.first == nullptr) {
+        series.first = PrometheusRegistry::instance().series(PrometheusMetricType::COUNTER, measurement.metric_name + "_total",
+            "Messages that arrived.", labels_with_publisher(publisher));
+    }
+
+    series.first->add(1);
+}
+
+void PrometheusMeasurementWriter::record_activation_jitter(uint32_t key, int64_t activation_jitter) {
+    auto & measurement = measurement_classes_[key];
+    auto & series = measurement.host_series;
+    if (series.first == nullptr) {
+        series.first = PrometheusRegistry::instance().series(PrometheusMetricType::HISTOGRAM, measurement.metric_name + "_seconds",
+            "Difference between the actual and the planned activation of a timer.", host_labels_);
+    }
+
+    series.first->observe_ns(activation_jitter);
+}
+
+void PrometheusMeasurementWriter::record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t lock_waits) {
+    auto & measurement = measurement_classes_[key];
+    auto & series = measurement.host_series;
+    if (series.first == nullptr) {
+        auto & registry = PrometheusRegistry::instance();
+        series.first = registry.series(PrometheusMetricType::COUNTER, measurement.metric_name + "_allocations_total",
+            "Heap allocations during callback executions.", host_labels_);
+        series.second = registry.series(PrometheusMetricType::COUNTER, measurement.metric_name + "_lock_waits_total",
+            "Contended lock waits during callback executions.", host_labels_);
+    }
+
+    series.first->add(allocations);
+    series.second->add(lock_waits);
+}
+
+} // namespace rclcpp
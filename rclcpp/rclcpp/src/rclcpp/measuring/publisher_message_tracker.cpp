@@ -18,13 +18,10 @@
 
 using rclcpp::PublisherMessageTracker;
 
-void PublisherMessageTracker::track_message(const MessageTrackingVariables & msg) {
-    auto & message = const_cast<MessageTrackingVariables &>(msg);
-
+void PublisherMessageTracker::stamp_message(MessageTrackingVariables & message) {
     message.vandenhoven_timestamp = get_monotonic_time_64b_ns();
 
-    message.vandenhoven_identifier = current_msg_id;
-    current_msg_id++;
+    message.vandenhoven_identifier = current_msg_id.fetch_add(1, std::memory_order_relaxed);
 
     message.vandenhoven_publisher_hash = host_hash_;
 }
\ No newline at end of file
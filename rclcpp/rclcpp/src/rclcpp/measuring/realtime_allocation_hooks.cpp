@@ -0,0 +1,114 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Only compiled with -DPMROS2_COUNT_ALLOCATIONS=ON. Do not ship this in a production build:
+// it replaces the allocator entry points of the whole process that links rclcpp.
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#include "rclcpp/measuring/realtime_violation_counter.hpp"
+
+using rclcpp::RealtimeViolationCounter;
+
+#if defined(__GLIBC__)
+
+// On glibc we hook malloc itself. operator new, the rmw implementation and the DDS vendor all end up here,
+// so this also catches the C allocations that a callback triggers lower in the stack.
+// The __libc_* entry points are the real allocator, exported by glibc for exactly this purpose.
+extern "C" {
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void * ptr, size_t size);
+void * __libc_memalign(size_t alignment, size_t size);
+
+void * malloc(size_t size) {
+    RealtimeViolationCounter::count_allocation();
+    return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size) {
+    RealtimeViolationCounter::count_allocation();
+    return __libc_calloc(count, size);
+}
+
+void * realloc(void * ptr, size_t size) {
+    RealtimeViolationCounter::count_allocation();
+    return __libc_realloc(ptr, size);
+}
+
+void * memalign(size_t alignment, size_t size) {
+    RealtimeViolationCounter::count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+void * aligned_alloc(size_t alignment, size_t size) {
+    RealtimeViolationCounter::count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void ** result, size_t alignment, size_t size) {
+    RealtimeViolationCounter::count_allocation();
+    void * ptr = __libc_memalign(alignment, size);
+    if (ptr == nullptr) {
+        return ENOMEM;
+    }
+    *result = ptr;
+    return 0;
+}
+} // extern "C"
+
+#else
+
+// Elsewhere, settle for the replaceable global operator new. C allocations go uncounted.
+void * operator new(std::size_t size) {
+    RealtimeViolationCounter::count_allocation();
+    void * ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void * operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    RealtimeViolationCounter::count_allocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t & tag) noexcept {
+    return ::operator new(size, tag);
+}
+
+void operator delete(void * ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void * ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void * ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+#endif
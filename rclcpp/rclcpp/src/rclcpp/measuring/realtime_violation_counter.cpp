@@ -0,0 +1,122 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/measuring/realtime_violation_counter.hpp"
+
+// These get touched from inside malloc, so they must be plain integers (constant initialization, no TLS constructors)
+// and use the initial-exec model so that accessing them can never call into the allocator itself.
+#if defined(__GNUC__)
+#define RCLCPP_VIOLATION_TLS __attribute__((tls_model("initial-exec"))) thread_local
+#else
+#define RCLCPP_VIOLATION_TLS thread_local
+#endif
+
+namespace {
+RCLCPP_VIOLATION_TLS uint32_t scope_depth = 0;
+RCLCPP_VIOLATION_TLS uint64_t allocations = 0;
+RCLCPP_VIOLATION_TLS uint64_t lock_waits = 0;
+RCLCPP_VIOLATION_TLS uint64_t carried_allocations = 0;
+RCLCPP_VIOLATION_TLS uint64_t carried_lock_waits = 0;
+}
+
+namespace rclcpp {
+
+void RealtimeViolationCounter::count_allocation() {
+    if (scope_depth > 0) {
+        ++allocations;
+    }
+}
+
+void RealtimeViolationCounter::count_lock_wait() {
+    if (scope_depth > 0) {
+        ++lock_waits;
+    }
+}
+
+bool RealtimeViolationCounter::is_counting() {
+    return scope_depth > 0;
+}
+
+bool RealtimeViolationCounter::counts_allocations() {
+#ifdef PMROS2_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void RealtimeViolationCounter::carry_over(const RealtimeViolationCounts & counts) {
+    carried_allocations += counts.allocations;
+    carried_lock_waits += counts.lock_waits;
+}
+
+void RealtimeViolationCounter::enter() {
+    ++scope_depth;
+}
+
+void RealtimeViolationCounter::leave() {
+    --scope_depth;
+}
+
+RealtimeViolationCounts RealtimeViolationCounter::totals() {
+    RealtimeViolationCounts counts;
+    counts.allocations = allocations;
+    counts.lock_waits = lock_waits;
+    return counts;
+}
+
+RealtimeViolationCounts RealtimeViolationCounter::take_carried_over() {
+    RealtimeViolationCounts counts;
+    counts.allocations = carried_allocations;
+    counts.lock_waits = carried_lock_waits;
+    carried_allocations = 0;
+    carried_lock_waits = 0;
+    return counts;
+}
+
+RealtimeViolationScope::RealtimeViolationScope(bool enabled) : enabled_(enabled) {
+    if (!enabled_) {
+        return;
+    }
+    RealtimeViolationCounter::enter();
+    start_ = RealtimeViolationCounter::totals();
+    carried_ = RealtimeViolationCounter::take_carried_over();
+}
+
+RealtimeViolationScope::~RealtimeViolationScope() {
+    if (enabled_) {
+        RealtimeViolationCounter::leave();
+    }
+}
+
+RealtimeViolationPause::RealtimeViolationPause() : depth_(scope_depth) {
+    scope_depth = 0;
+}
+
+RealtimeViolationPause::~RealtimeViolationPause() {
+    scope_depth = depth_;
+}
+
+RealtimeViolationCounts RealtimeViolationScope::counts() const {
+    RealtimeViolationCounts counts;
+    if (!enabled_) {
+        return counts;
+    }
+    auto now = RealtimeViolationCounter::totals();
+    counts.allocations = now.allocations - start_.allocations + carried_.allocations;
+    counts.lock_waits = now.lock_waits - start_.lock_waits + carried_.lock_waits;
+    return counts;
+}
+
+} // namespace rclcpp
@@ -30,10 +30,13 @@ SubscriberMessageTracker::SubscriberMessageTracker(rclcpp::IMeasurementWriter::U
 
 void SubscriberMessageTracker::track_message(const MessageTrackingVariables & msg) {
     // SimpleTimer s("(" + std::to_string(msg.vandenhoven_identifier) + ") subscriber message track");
-    auto monotonic_time = get_monotonic_time_64b_ns(); // refresh the stamp for this flurry of measurements. Do this as early as possible.
-    writer_->use_timestamp(get_unix_time_64b_ns()); // we need unix time here, not monotonic time! Do not make the mistake I did!! My InfluxDB has data 3 hours past 1970 now!!!
+    track_late_arrival(msg, MeasuringClock::now()); // refresh the stamp for this flurry of measurements. Do this as early as possible.
+}
+
+void SubscriberMessageTracker::track_late_arrival(const MessageTrackingVariables & msg, const MeasuringTimestamp & arrival) {
+    writer_->use_timestamp(arrival.unix_ns); // we need unix time here, not monotonic time! Do not make the mistake I did!! My InfluxDB has data 3 hours past 1970 now!!!
     hex_char_array_t hexString(msg.vandenhoven_publisher_hash);
     
-    writer_->record_latency(latencyKey_, msg, hexString, monotonic_time);
+    writer_->record_latency(latencyKey_, msg, hexString, arrival.monotonic_ns);
     writer_->record_arrival(arrivalKey_, msg, hexString);
 }
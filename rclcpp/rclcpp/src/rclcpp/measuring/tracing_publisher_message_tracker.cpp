@@ -40,14 +40,11 @@ using rclcpp::TracingPublisherMessageTracker;
 // A trace origin is needed to filter B', but the trace origin of A gets overwritten by B when publishing B->C.
 // Thus to support this on the client library level, A std::vector type variable is needed, which takes 4+L bytes, where L is the number of stacked traces the user is using.
 
-void TracingPublisherMessageTracker::track_message(const MessageTrackingVariables & msg) {
-    auto & message = const_cast<MessageTrackingVariables &>(msg);
-
+void TracingPublisherMessageTracker::stamp_message(MessageTrackingVariables & message) {
     message.vandenhoven_timestamp = get_monotonic_time_64b_ns();
 
     if (message.vandenhoven_identifier == 0) {
-        message.vandenhoven_identifier = current_msg_id;
-        current_msg_id++;
+        message.vandenhoven_identifier = current_msg_id.fetch_add(1, std::memory_order_relaxed);
     }
 
     message.vandenhoven_publisher_hash = host_hash_;
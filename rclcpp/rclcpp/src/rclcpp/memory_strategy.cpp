@@ -17,6 +17,34 @@
 
 using rclcpp::memory_strategy::MemoryStrategy;
 
+void
+MemoryStrategy::get_next_timer(
+  rclcpp::executor::AnyExecutable & any_exec,
+  const WeakNodeList & weak_nodes)
+{
+  for (auto & weak_node : weak_nodes) {
+    auto node = weak_node.lock();
+    if (!node) {
+      continue;
+    }
+    for (auto & weak_group : node->get_callback_groups()) {
+      auto group = weak_group.lock();
+      if (!group || !group->can_be_taken_from().load()) {
+        continue;
+      }
+      for (auto & timer_ref : group->get_timer_ptrs()) {
+        auto timer = timer_ref.lock();
+        if (timer && timer->is_ready()) {
+          any_exec.timer = timer;
+          any_exec.callback_group = group;
+          any_exec.node_base = node;
+          return;
+        }
+      }
+    }
+  }
+}
+
 rclcpp::SubscriptionBase::SharedPtr
 MemoryStrategy::get_subscription_by_handle(
   std::shared_ptr<const rcl_subscription_t> subscriber_handle,
@@ -110,10 +110,19 @@ NodeTopics::create_subscription(
     auto context = node_base_->get_context();
     auto ipm =
       context->get_sub_context<rclcpp::intra_process_manager::IntraProcessManager>();
+    rclcpp::SubscriptionIntraProcessBase::SharedPtr waitable;
+    if (subscription_factory.create_intra_process_waitable) {
+      waitable = subscription_factory.create_intra_process_waitable(
+        subscription, context, subscription_options);
+      subscription->set_intra_process_waitable(waitable);
+    }
     uint64_t intra_process_subscription_id = ipm->add_subscription(subscription);
     auto options_copy = subscription_options;
     options_copy.ignore_local_publications = false;
     subscription->setup_intra_process(intra_process_subscription_id, ipm, options_copy);
+    if (waitable) {
+      ipm->add_intra_process_waitable(intra_process_subscription_id, waitable);
+    }
   }
 
   // Return the completed subscription.
@@ -136,6 +145,14 @@ NodeTopics::add_subscription(
   }
 
   callback_group->add_subscription(subscription);
+  auto intra_process_waitable = subscription->get_intra_process_waitable();
+  if (intra_process_waitable) {
+    callback_group->add_waitable(intra_process_waitable);
+  }
+  auto shared_memory_waitable = subscription->get_shared_memory_waitable();
+  if (shared_memory_waitable) {
+    callback_group->add_waitable(shared_memory_waitable);
+  }
   for (auto & subscription_event : subscription->get_event_handlers()) {
     callback_group->add_waitable(subscription_event);
   }
@@ -15,6 +15,8 @@
 #include "rclcpp/parameter_client.hpp"
 
 #include <algorithm>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
@@ -24,6 +26,25 @@
 using rclcpp::AsyncParametersClient;
 using rclcpp::SyncParametersClient;
 
+namespace
+{
+
+/// Callback for the std::shared_future based methods, that completes result.
+template<typename T>
+std::function<void(std::shared_future<T>)>
+complete_result(rclcpp::AsyncResult<T> result)
+{
+  return [result](std::shared_future<T> future) mutable {
+           try {
+             result.set_value(future.get());
+           } catch (...) {
+             result.set_exception(std::current_exception());
+           }
+         };
+}
+
+}  // namespace
+
 AsyncParametersClient::AsyncParametersClient(
   const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base_interface,
   const rclcpp::node_interfaces::NodeTopicsInterface::SharedPtr node_topics_interface,
@@ -297,6 +318,48 @@ AsyncParametersClient::list_parameters(
   return future_result;
 }
 
+rclcpp::AsyncResult<std::vector<rclcpp::Parameter>>
+AsyncParametersClient::async_get_parameters(const std::vector<std::string> & names)
+{
+  AsyncResult<std::vector<rclcpp::Parameter>> result;
+  get_parameters(names, complete_result(result));
+  return result;
+}
+
+rclcpp::AsyncResult<std::vector<rclcpp::ParameterType>>
+AsyncParametersClient::async_get_parameter_types(const std::vector<std::string> & names)
+{
+  AsyncResult<std::vector<rclcpp::ParameterType>> result;
+  get_parameter_types(names, complete_result(result));
+  return result;
+}
+
+rclcpp::AsyncResult<std::vector<rcl_interfaces::msg::SetParametersResult>>
+AsyncParametersClient::async_set_parameters(const std::vector<rclcpp::Parameter> & parameters)
+{
+  AsyncResult<std::vector<rcl_interfaces::msg::SetParametersResult>> result;
+  set_parameters(parameters, complete_result(result));
+  return result;
+}
+
+rclcpp::AsyncResult<rcl_interfaces::msg::SetParametersResult>
+AsyncParametersClient::async_set_parameters_atomically(
+  const std::vector<rclcpp::Parameter> & parameters)
+{
+  AsyncResult<rcl_interfaces::msg::SetParametersResult> result;
+  set_parameters_atomically(parameters, complete_result(result));
+  return result;
+}
+
+rclcpp::AsyncResult<rcl_interfaces::msg::ListParametersResult>
+AsyncParametersClient::async_list_parameters(
+  const std::vector<std::string> & prefixes, uint64_t depth)
+{
+  AsyncResult<rcl_interfaces::msg::ListParametersResult> result;
+  list_parameters(prefixes, depth, complete_result(result));
+  return result;
+}
+
 bool
 AsyncParametersClient::service_is_ready() const
 {
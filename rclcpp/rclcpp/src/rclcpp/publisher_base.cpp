@@ -17,6 +17,7 @@
 #include <rmw/error_handling.h>
 #include <rmw/rmw.h>
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -45,7 +46,8 @@ PublisherBase::PublisherBase(
   const rosidl_message_type_support_t & type_support,
   const rcl_publisher_options_t & publisher_options)
 : rcl_node_handle_(node_base->get_shared_rcl_node_handle()),
-  intra_process_is_enabled_(false), intra_process_publisher_id_(0)
+  intra_process_is_enabled_(false), intra_process_publisher_id_(0),
+  message_tracking_enabled_(false)
 {
 
   rcl_ret_t ret = rcl_publisher_init(
@@ -88,11 +90,55 @@ PublisherBase::PublisherBase(
       rclcpp::get_logger("rclcpp"),
       "creating a publishing tracker with topic '%s'", remapped_topic_str);
     message_tracker_ = MessageTrackerFactory::make(converted_options.tracker_option)->create_message_tracker(converted_options.tracker_result_writing_option, host_info);
+    message_tracking_enabled_ = converted_options.tracker_option != MessageTrackerEnum::NONE;
   }
 }
 
+void
+PublisherBase::setup_out_of_band_tracking()
+{
+  if (!message_tracking_enabled_) {
+    return;
+  }
+  out_of_band_tracking_ = std::make_unique<OutOfBandTrackingPublisher>(
+    rcl_node_handle_, &publisher_handle_, rmw_gid_);
+}
+
+void
+PublisherBase::setup_shared_memory_transport(
+  const SharedMemoryTransportOptions & options,
+  const rosidl_message_type_support_t & type_support)
+{
+  if (!options.enabled) {
+    return;
+  }
+  shared_memory_ = std::make_unique<SharedMemoryPublisher>(
+    rcl_node_handle_, &publisher_handle_, rmw_gid_, type_support, options);
+}
+
+bool
+PublisherBase::publish_to_shared_memory(const void * msg)
+{
+  if (!shared_memory_) {
+    return false;
+  }
+  return shared_memory_->publish(msg, get_subscription_count());
+}
+
+bool
+PublisherBase::publish_to_shared_memory(const rcl_serialized_message_t & serialized_msg)
+{
+  if (!shared_memory_) {
+    return false;
+  }
+  return shared_memory_->publish(serialized_msg, get_subscription_count());
+}
+
 PublisherBase::~PublisherBase()
 {
+  // the side channel publishers must go before the node handle can.
+  out_of_band_tracking_.reset();
+  shared_memory_.reset();
   // must fini the events before fini-ing the publisher
   event_handlers_.clear();
 
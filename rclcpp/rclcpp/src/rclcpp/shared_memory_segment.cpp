@@ -0,0 +1,521 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/shared_memory_segment.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+using rclcpp::SharedMemorySegment;
+
+// Other processes update the same atomics, which only works if they do not hide a lock.
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "64 bit atomics must be lock-free");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "32 bit atomics must be lock-free");
+
+namespace
+{
+
+// "PMRSHM" and a layout version, written last by the creator.
+constexpr uint64_t segment_magic = 0x504d5253484d0003ULL;
+constexpr size_t cache_line = 64;
+// Set in the references of a slot while the publisher writes it.
+constexpr uint32_t writing_bit = 1u << 31;
+constexpr uint32_t reference_mask = 0xffffu;
+// Readers that can pin the same message at once, as many as fill the cache line of the slot.
+constexpr size_t pins_per_slot = 5;
+
+constexpr size_t
+round_up(size_t size)
+{
+  return (size + cache_line - 1) / cache_line * cache_line;
+}
+
+constexpr uint64_t
+make_state(uint32_t generation, uint32_t references)
+{
+  return static_cast<uint64_t>(generation) << 32 | references;
+}
+
+constexpr uint32_t
+generation_of(uint64_t state)
+{
+  return static_cast<uint32_t>(state >> 32);
+}
+
+constexpr uint32_t
+references_of(uint64_t state)
+{
+  return static_cast<uint32_t>(state);
+}
+
+/// A pin: the pid of the reader in the high half, the generation it pinned in the low half.
+uint64_t
+make_pin(uint32_t generation)
+{
+  return static_cast<uint64_t>(getpid()) << 32 | generation;
+}
+
+constexpr pid_t
+pid_of(uint64_t pin)
+{
+  return static_cast<pid_t>(pin >> 32);
+}
+
+std::string
+segment_name(uint64_t key)
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "/pmros2_shm_%016" PRIx64, key);
+  return name;
+}
+
+int64_t
+steady_now_ns()
+{
+  // CLOCK_MONOTONIC, which all processes on the host share.
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct SegmentHeader
+{
+  std::atomic<uint64_t> magic;
+  uint64_t slot_count;
+  uint64_t slot_size;
+  uint64_t slot_stride;
+  uint8_t publisher_gid[RMW_GID_STORAGE_SIZE];
+  std::atomic<uint32_t> closed;
+};
+
+struct SlotHeader
+{
+  /// Generation of the message in the high half, references to it in the low half.
+  std::atomic<uint64_t> state;
+  /// When the message was committed, on the steady clock, for the lease.
+  std::atomic<int64_t> committed_ns;
+  std::atomic<uint64_t> length;
+  /// The readers that pinned a message, zero where none did.
+  std::atomic<uint64_t> pins[pins_per_slot];
+};
+static_assert(sizeof(SlotHeader) <= cache_line, "the payload starts on the next cache line");
+
+constexpr size_t header_size = round_up(sizeof(SegmentHeader));
+constexpr size_t payload_offset = round_up(sizeof(SlotHeader));
+
+SegmentHeader *
+header_of(void * memory)
+{
+  return static_cast<SegmentHeader *>(memory);
+}
+
+SlotHeader &
+slot_of(void * memory, size_t slot)
+{
+  return *reinterpret_cast<SlotHeader *>(
+    static_cast<uint8_t *>(memory) + header_size + slot * header_of(memory)->slot_stride);
+}
+
+bool
+is_pinned(const SlotHeader & s, uint32_t generation)
+{
+  for (const auto & pin : s.pins) {
+    uint64_t value = pin.load(std::memory_order_acquire);
+    if (value != 0 && static_cast<uint32_t>(value) == generation) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Drop the pins of readers that died while they held them. \return how many were dropped.
+size_t
+unpin_dead_readers(SlotHeader & s)
+{
+  size_t dropped = 0;
+  for (auto & pin : s.pins) {
+    uint64_t value = pin.load(std::memory_order_relaxed);
+    // A pid that got reused by another process keeps the pin, as if its reader still ran.
+    if (value != 0 && kill(pid_of(value), 0) != 0 && errno == ESRCH &&
+      pin.compare_exchange_strong(value, 0, std::memory_order_relaxed))
+    {
+      ++dropped;
+    }
+  }
+  return dropped;
+}
+
+}  // namespace
+
+SharedMemorySegment::SharedPtr
+SharedMemorySegment::create(
+  size_t slot_count, size_t slot_size, const rmw_gid_t & publisher_gid, mode_t mode)
+{
+  if (slot_count == 0 || slot_size == 0) {
+    throw std::invalid_argument("shared memory slot count and size must be non-zero");
+  }
+  if (slot_count > writing_bit) {
+    throw std::invalid_argument("too many shared memory slots");
+  }
+  size_t slot_stride = payload_offset + round_up(slot_size);
+  size_t size = header_size + slot_count * slot_stride;
+
+  // The pid makes the key unique among the live processes of the host.
+  static std::atomic<uint32_t> segment_count(0);
+  uint64_t key = static_cast<uint64_t>(getpid()) << 32 | segment_count.fetch_add(1);
+  std::string name = segment_name(key);
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    // Left behind by a process that crashed, with the pid we have now.
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  }
+  if (fd < 0) {
+    throw std::system_error(
+            errno, std::generic_category(), "could not create shared memory segment " + name);
+  }
+  // Created for the owner only, opened up once it is ours, which the umask does not restrict.
+  if (fchmod(fd, mode) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    int error = errno;
+    close(fd);
+    shm_unlink(name.c_str());
+    throw std::system_error(
+            error, std::generic_category(), "could not set up shared memory segment " + name);
+  }
+  void * memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int error = errno;
+  close(fd);
+  if (memory == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    throw std::system_error(
+            error, std::generic_category(), "could not map shared memory segment " + name);
+  }
+
+  // The memory comes zeroed: all slots are free, at generation zero.
+  auto header = new (memory) SegmentHeader();
+  header->slot_count = slot_count;
+  header->slot_size = slot_size;
+  header->slot_stride = slot_stride;
+  std::memcpy(header->publisher_gid, publisher_gid.data, RMW_GID_STORAGE_SIZE);
+  for (size_t i = 0; i < slot_count; ++i) {
+    new (static_cast<uint8_t *>(memory) + header_size + i * slot_stride) SlotHeader();
+  }
+  header->magic.store(segment_magic, std::memory_order_release);
+
+  return SharedPtr(new SharedMemorySegment(key, name, memory, size, true));
+}
+
+SharedMemorySegment::SharedPtr
+SharedMemorySegment::open(uint64_t key)
+{
+  std::string name = segment_name(key);
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < header_size) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(status.st_size);
+  void * memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+  auto header = static_cast<const SegmentHeader *>(memory);
+  if (header->magic.load(std::memory_order_acquire) != segment_magic ||
+    header->slot_stride < payload_offset + header->slot_size ||
+    header->slot_count > (size - header_size) / header->slot_stride)
+  {
+    munmap(memory, size);
+    return nullptr;
+  }
+  return SharedPtr(new SharedMemorySegment(key, name, memory, size, false));
+}
+
+SharedMemorySegment::SharedMemorySegment(
+  uint64_t key, std::string name, void * memory, size_t size, bool owner)
+: key_(key), name_(std::move(name)), memory_(memory), size_(size), owner_(owner),
+  next_slot_(0), reclaimed_count_(0)
+{}
+
+SharedMemorySegment::~SharedMemorySegment()
+{
+  if (owner_) {
+    header_of(memory_)->closed.store(1, std::memory_order_release);
+    shm_unlink(name_.c_str());
+  }
+  munmap(memory_, size_);
+}
+
+uint64_t
+SharedMemorySegment::get_key() const
+{
+  return key_;
+}
+
+size_t
+SharedMemorySegment::get_slot_count() const
+{
+  return header_of(memory_)->slot_count;
+}
+
+size_t
+SharedMemorySegment::get_slot_size() const
+{
+  return header_of(memory_)->slot_size;
+}
+
+const uint8_t *
+SharedMemorySegment::get_publisher_gid_data() const
+{
+  return header_of(memory_)->publisher_gid;
+}
+
+bool
+SharedMemorySegment::is_closed() const
+{
+  return header_of(memory_)->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool
+SharedMemorySegment::acquire(size_t & slot, uint32_t & generation, std::chrono::nanoseconds lease)
+{
+  size_t slot_count = get_slot_count();
+  size_t start = next_slot_.fetch_add(1, std::memory_order_relaxed);
+  // Once more after dropping the pins of dead readers, which no one else ever drops.
+  for (bool dropped_pins = false; ; ) {
+    for (size_t i = 0; i < slot_count; ++i) {
+      size_t candidate = (start + i) % slot_count;
+      SlotHeader & s = slot_of(memory_, candidate);
+      uint64_t state = s.state.load(std::memory_order_acquire);
+      // No reader can pin once the references are gone, so the slot stays free.
+      if (references_of(state) != 0 || is_pinned(s, generation_of(state))) {
+        continue;
+      }
+      uint32_t next_generation = generation_of(state) + 1;
+      if (s.state.compare_exchange_strong(
+          state, make_state(next_generation, writing_bit), std::memory_order_acq_rel))
+      {
+        slot = candidate;
+        generation = next_generation;
+        return true;
+      }
+    }
+    if (dropped_pins) {
+      break;
+    }
+    size_t dropped = 0;
+    for (size_t i = 0; i < slot_count; ++i) {
+      dropped += unpin_dead_readers(slot_of(memory_, i));
+    }
+    if (dropped == 0) {
+      break;
+    }
+    reclaimed_count_.fetch_add(dropped, std::memory_order_relaxed);
+    dropped_pins = true;
+  }
+
+  // All in use: take back the one leased for the longest time, if that is too long.
+  int64_t now = steady_now_ns();
+  size_t oldest = slot_count;
+  uint64_t oldest_state = 0;
+  int64_t oldest_ns = std::numeric_limits<int64_t>::max();
+  for (size_t i = 0; i < slot_count; ++i) {
+    SlotHeader & s = slot_of(memory_, i);
+    uint64_t state = s.state.load(std::memory_order_acquire);
+    // Pinned messages are in use for sure, they are only taken back from dead readers.
+    if ((references_of(state) & writing_bit) || is_pinned(s, generation_of(state))) {
+      continue;
+    }
+    int64_t committed_ns = s.committed_ns.load(std::memory_order_relaxed);
+    if (committed_ns < oldest_ns) {
+      oldest = i;
+      oldest_state = state;
+      oldest_ns = committed_ns;
+    }
+  }
+  if (oldest == slot_count || now - oldest_ns <= lease.count()) {
+    return false;
+  }
+  uint32_t next_generation = generation_of(oldest_state) + 1;
+  if (!slot_of(memory_, oldest).state.compare_exchange_strong(
+      oldest_state, make_state(next_generation, writing_bit), std::memory_order_acq_rel))
+  {
+    return false;
+  }
+  reclaimed_count_.fetch_add(1, std::memory_order_relaxed);
+  slot = oldest;
+  generation = next_generation;
+  return true;
+}
+
+uint8_t *
+SharedMemorySegment::get_payload(size_t slot)
+{
+  return reinterpret_cast<uint8_t *>(&slot_of(memory_, slot)) + payload_offset;
+}
+
+void
+SharedMemorySegment::commit(size_t slot, uint32_t generation, size_t length, size_t readers)
+{
+  SlotHeader & s = slot_of(memory_, slot);
+  s.length.store(std::min(length, get_slot_size()), std::memory_order_relaxed);
+  s.committed_ns.store(steady_now_ns(), std::memory_order_relaxed);
+  // Only the writer changes a slot being written, plain stores do.
+  readers = std::min<size_t>(readers, reference_mask);
+  s.state.store(
+    make_state(generation, static_cast<uint32_t>(readers)), std::memory_order_release);
+}
+
+void
+SharedMemorySegment::discard(size_t slot, uint32_t generation)
+{
+  SlotHeader & s = slot_of(memory_, slot);
+  uint64_t state = s.state.load(std::memory_order_relaxed);
+  // Pins stay, the slot is freed once they are gone.
+  while (generation_of(state) == generation && references_of(state) != 0) {
+    if (s.state.compare_exchange_weak(
+        state, make_state(generation, 0), std::memory_order_release, std::memory_order_relaxed))
+    {
+      return;
+    }
+  }
+}
+
+bool
+SharedMemorySegment::holds(size_t slot, uint32_t generation) const
+{
+  if (slot >= get_slot_count()) {
+    return false;
+  }
+  SlotHeader & s = slot_of(memory_, slot);
+  uint64_t state = s.state.load(std::memory_order_acquire);
+  uint32_t references = references_of(state);
+  return generation_of(state) == generation && !(references & writing_bit) &&
+         (references != 0 || is_pinned(s, generation));
+}
+
+const uint8_t *
+SharedMemorySegment::read(size_t slot, uint32_t generation, size_t & length) const
+{
+  length = 0;
+  if (!holds(slot, generation)) {
+    return nullptr;
+  }
+  SlotHeader & s = slot_of(memory_, slot);
+  // Clamped, in case the publisher wrote garbage.
+  length = std::min<size_t>(s.length.load(std::memory_order_relaxed), get_slot_size());
+  return reinterpret_cast<const uint8_t *>(&s) + payload_offset;
+}
+
+bool
+SharedMemorySegment::release(size_t slot, uint32_t generation)
+{
+  if (slot >= get_slot_count()) {
+    return false;
+  }
+  SlotHeader & s = slot_of(memory_, slot);
+  uint64_t state = s.state.load(std::memory_order_relaxed);
+  for (;; ) {
+    uint32_t references = references_of(state);
+    if (generation_of(state) != generation || (references & reference_mask) == 0 ||
+      (references & writing_bit))
+    {
+      return false;
+    }
+    if (s.state.compare_exchange_weak(
+        state, state - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+    {
+      return true;
+    }
+  }
+}
+
+bool
+SharedMemorySegment::pin(size_t slot, uint32_t generation)
+{
+  if (slot >= get_slot_count()) {
+    return false;
+  }
+  SlotHeader & s = slot_of(memory_, slot);
+  // Recorded first: the publisher must see the pin once it sees the reference gone.
+  uint64_t pin = make_pin(generation);
+  std::atomic<uint64_t> * entry = nullptr;
+  for (auto & candidate : s.pins) {
+    uint64_t unpinned = 0;
+    if (candidate.compare_exchange_strong(unpinned, pin, std::memory_order_acq_rel)) {
+      entry = &candidate;
+      break;
+    }
+  }
+  if (!entry) {
+    return false;
+  }
+  uint64_t state = s.state.load(std::memory_order_relaxed);
+  for (;; ) {
+    uint32_t references = references_of(state);
+    if (generation_of(state) != generation || (references & reference_mask) == 0 ||
+      (references & writing_bit))
+    {
+      entry->store(0, std::memory_order_relaxed);
+      return false;
+    }
+    if (s.state.compare_exchange_weak(
+        state, state - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+    {
+      return true;
+    }
+  }
+}
+
+bool
+SharedMemorySegment::unpin(size_t slot, uint32_t generation)
+{
+  if (slot >= get_slot_count()) {
+    return false;
+  }
+  uint64_t pin = make_pin(generation);
+  for (auto & entry : slot_of(memory_, slot).pins) {
+    uint64_t pinned = pin;
+    // Done reading, before the publisher may write the slot again.
+    if (entry.compare_exchange_strong(pinned, 0, std::memory_order_release)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t
+SharedMemorySegment::get_reclaimed_count() const
+{
+  return reclaimed_count_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,425 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/shared_memory_transport.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+
+#include "rcl/error_handling.h"
+#include "rcl_interfaces/msg/intra_process_message.hpp"
+#include "rcutils/logging_macros.h"
+#include "rmw/rmw.h"
+#include "rmw/serialized_message.h"
+
+#include "rclcpp/exceptions.hpp"
+#include "rclcpp/hashing/mmh3.hpp"
+#include "rclcpp/subscription_base.hpp"
+#include "rclcpp/type_support_decl.hpp"
+
+namespace
+{
+
+// Identifies the host by its name and boot, processes in other containers or boots differ.
+std::string
+host_key()
+{
+  std::string host;
+  char name[256] = {};
+  if (gethostname(name, sizeof(name) - 1) == 0) {
+    host = name;
+  }
+  std::ifstream boot_id("/proc/sys/kernel/random/boot_id");
+  std::string boot;
+  std::getline(boot_id, boot);
+  host += boot;
+
+  uint32_t hash;
+  MurmurHash3_x86_32(host.data(), static_cast<int>(host.size()), 0, &hash);
+  char key[9];
+  std::snprintf(key, sizeof(key), "%08" PRIx32, hash);
+  return key;
+}
+
+void *
+refuse_allocate(size_t, void *)
+{
+  return nullptr;
+}
+
+void
+refuse_deallocate(void *, void *)
+{}
+
+void *
+refuse_reallocate(void *, size_t, void *)
+{
+  return nullptr;
+}
+
+void *
+refuse_zero_allocate(size_t, size_t, void *)
+{
+  return nullptr;
+}
+
+/// A serialized message on memory of a slot, which can neither grow nor be freed.
+rcl_serialized_message_t
+make_slot_view(const uint8_t * buffer, size_t length, size_t capacity)
+{
+  rcl_serialized_message_t view = rmw_get_zero_initialized_serialized_message();
+  view.buffer = reinterpret_cast<char *>(const_cast<uint8_t *>(buffer));
+  view.buffer_length = length;
+  view.buffer_capacity = capacity;
+  view.allocator.allocate = refuse_allocate;
+  view.allocator.deallocate = refuse_deallocate;
+  view.allocator.reallocate = refuse_reallocate;
+  view.allocator.zero_allocate = refuse_zero_allocate;
+  view.allocator.state = nullptr;
+  return view;
+}
+
+constexpr uint64_t
+make_sequence(size_t slot, uint32_t generation)
+{
+  return static_cast<uint64_t>(generation) << 32 | static_cast<uint32_t>(slot);
+}
+
+}  // namespace
+
+namespace rclcpp
+{
+
+std::string
+get_shared_memory_topic(const std::string & data_topic)
+{
+  static const std::string key = host_key();
+  return data_topic + "/_pmros2_shm_" + key;
+}
+
+SharedMemoryPublisher::SharedMemoryPublisher(
+  std::shared_ptr<rcl_node_t> node_handle,
+  const rcl_publisher_t * data_publisher,
+  const rmw_gid_t & data_publisher_gid,
+  const rosidl_message_type_support_t & type_support,
+  const SharedMemoryTransportOptions & options)
+: node_handle_(std::move(node_handle)),
+  publisher_(rcl_get_zero_initialized_publisher()),
+  type_support_(type_support),
+  lease_(options.lease),
+  segment_(SharedMemorySegment::create(
+      options.slot_count, options.slot_size, data_publisher_gid, options.mode))
+{
+  // Same QoS as the data, so that announcements are kept (or lost) the way the data would be.
+  auto publisher_options = rcl_publisher_get_default_options();
+  publisher_options.qos = rcl_publisher_get_options(data_publisher)->qos;
+  auto topic = get_shared_memory_topic(rcl_publisher_get_topic_name(data_publisher));
+
+  auto ret = rcl_publisher_init(
+    &publisher_, node_handle_.get(),
+    rclcpp::type_support::get_intra_process_message_msg_type_support(),
+    topic.c_str(), &publisher_options);
+  if (ret != RCL_RET_OK) {
+    rclcpp::exceptions::throw_from_rcl_error(ret, "could not create shared memory publisher");
+  }
+}
+
+SharedMemoryPublisher::~SharedMemoryPublisher()
+{
+  if (rcl_publisher_fini(&publisher_, node_handle_.get()) != RCL_RET_OK) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rclcpp",
+      "Error in destruction of shared memory publisher: %s", rcl_get_error_string().str);
+    rcl_reset_error();
+  }
+}
+
+bool
+SharedMemoryPublisher::publish(const void * msg, size_t data_subscriptions)
+{
+  size_t slot;
+  uint32_t generation;
+  size_t readers;
+  if (!acquire(data_subscriptions, slot, generation, readers)) {
+    return false;
+  }
+  auto view = make_slot_view(segment_->get_payload(slot), 0, segment_->get_slot_size());
+  if (rmw_serialize(msg, &type_support_, &view) != RMW_RET_OK) {
+    // Most likely larger than a slot, which the middleware can still publish.
+    rmw_reset_error();
+    segment_->discard(slot, generation);
+    return false;
+  }
+  return announce(slot, generation, view.buffer_length, readers);
+}
+
+bool
+SharedMemoryPublisher::publish(
+  const rcl_serialized_message_t & serialized_msg, size_t data_subscriptions)
+{
+  if (serialized_msg.buffer_length > segment_->get_slot_size()) {
+    return false;
+  }
+  size_t slot;
+  uint32_t generation;
+  size_t readers;
+  if (!acquire(data_subscriptions, slot, generation, readers)) {
+    return false;
+  }
+  std::memcpy(segment_->get_payload(slot), serialized_msg.buffer, serialized_msg.buffer_length);
+  return announce(slot, generation, serialized_msg.buffer_length, readers);
+}
+
+SharedMemorySegment &
+SharedMemoryPublisher::get_segment()
+{
+  return *segment_;
+}
+
+size_t
+SharedMemoryPublisher::get_reader_count() const
+{
+  size_t readers = 0;
+  if (rcl_publisher_get_subscription_count(&publisher_, &readers) != RCL_RET_OK) {
+    rcl_reset_error();
+    return 0;
+  }
+  return readers;
+}
+
+bool
+SharedMemoryPublisher::acquire(
+  size_t data_subscriptions, size_t & slot, uint32_t & generation, size_t & readers)
+{
+  // Every subscription on the side channel also subscribes to the data topic, so fewer on the
+  // side channel means some are remote or do not use shared memory.
+  readers = get_reader_count();
+  if (readers == 0 || readers < data_subscriptions) {
+    return false;
+  }
+  return segment_->acquire(slot, generation, lease_);
+}
+
+bool
+SharedMemoryPublisher::announce(size_t slot, uint32_t generation, size_t length, size_t readers)
+{
+  segment_->commit(slot, generation, length, readers);
+
+  rcl_interfaces::msg::IntraProcessMessage descriptor;
+  descriptor.publisher_id = segment_->get_key();
+  descriptor.message_sequence = make_sequence(slot, generation);
+  if (rcl_publish(&publisher_, &descriptor, nullptr) != RCL_RET_OK) {
+    // Nobody will read it. The middleware publish reports what went wrong, if it still does.
+    rcl_reset_error();
+    segment_->discard(slot, generation);
+    return false;
+  }
+  return true;
+}
+
+SharedMemorySubscription::SharedMemorySubscription(
+  std::shared_ptr<rcl_node_t> node_handle,
+  std::shared_ptr<SubscriptionBase> subscription)
+: node_handle_(std::move(node_handle)),
+  subscription_(rcl_get_zero_initialized_subscription()),
+  data_subscription_(subscription),
+  wait_set_subscription_index_(0)
+{
+  const rcl_subscription_t * data_subscription = subscription->get_subscription_handle().get();
+  auto subscription_options = rcl_subscription_get_default_options();
+  subscription_options.qos = rcl_subscription_get_options(data_subscription)->qos;
+  auto topic = get_shared_memory_topic(rcl_subscription_get_topic_name(data_subscription));
+
+  auto ret = rcl_subscription_init(
+    &subscription_, node_handle_.get(),
+    rclcpp::type_support::get_intra_process_message_msg_type_support(),
+    topic.c_str(), &subscription_options);
+  if (ret != RCL_RET_OK) {
+    rclcpp::exceptions::throw_from_rcl_error(ret, "could not create shared memory subscription");
+  }
+}
+
+SharedMemorySubscription::~SharedMemorySubscription()
+{
+  if (rcl_subscription_fini(&subscription_, node_handle_.get()) != RCL_RET_OK) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rclcpp",
+      "Error in destruction of shared memory subscription: %s", rcl_get_error_string().str);
+    rcl_reset_error();
+  }
+}
+
+size_t
+SharedMemorySubscription::get_number_of_ready_subscriptions()
+{
+  return 1;
+}
+
+bool
+SharedMemorySubscription::add_to_wait_set(rcl_wait_set_t * wait_set)
+{
+  rcl_ret_t ret = rcl_wait_set_add_subscription(
+    wait_set, &subscription_, &wait_set_subscription_index_);
+  if (RCL_RET_OK != ret) {
+    rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't add subscription to wait set");
+  }
+  return true;
+}
+
+bool
+SharedMemorySubscription::is_ready(rcl_wait_set_t * wait_set)
+{
+  return wait_set->subscriptions[wait_set_subscription_index_] == &subscription_;
+}
+
+void
+SharedMemorySubscription::execute()
+{
+  auto subscription = data_subscription_.lock();
+  if (!subscription) {
+    return;
+  }
+  size_t batch_size = std::max<size_t>(subscription->get_batch_size(), 1);
+  for (size_t taken = 0; taken < batch_size; ++taken) {
+    rcl_interfaces::msg::IntraProcessMessage descriptor;
+    rmw_message_info_t message_info;
+    rcl_ret_t ret = rcl_take(&subscription_, &descriptor, &message_info, nullptr);
+    if (ret == RCL_RET_SUBSCRIPTION_TAKE_FAILED) {
+      return;
+    }
+    if (ret != RCL_RET_OK) {
+      RCUTILS_LOG_WARN_NAMED(
+        "rclcpp",
+        "failed to take shared memory announcement: %s", rcl_get_error_string().str);
+      rcl_reset_error();
+      return;
+    }
+    auto segment = get_segment(descriptor.publisher_id);
+    if (!segment) {
+      // Or the publisher runs as another user, whose shared memory mode does not allow us in.
+      RCUTILS_LOG_WARN_NAMED(
+        "rclcpp",
+        "shared memory of a publisher on '%s' is gone or not accessible, a message was lost",
+        subscription->get_topic_name());
+      continue;
+    }
+    // Looks like the message came from the data publisher, e.g. for intra process filtering.
+    std::memcpy(
+      message_info.publisher_gid.data, segment->get_publisher_gid_data(), RMW_GID_STORAGE_SIZE);
+    deliver(
+      *subscription, std::move(segment),
+      static_cast<uint32_t>(descriptor.message_sequence),
+      static_cast<uint32_t>(descriptor.message_sequence >> 32),
+      message_info);
+  }
+}
+
+SharedMemorySegment::SharedPtr
+SharedMemorySubscription::get_segment(uint64_t key)
+{
+  std::lock_guard<std::mutex> lock(segments_mutex_);
+  auto it = segments_.find(key);
+  if (it != segments_.end()) {
+    return it->second;
+  }
+  // A new publisher: a good moment to unmap those that are gone.
+  for (auto existing = segments_.begin(); existing != segments_.end(); ) {
+    if (existing->second->is_closed()) {
+      existing = segments_.erase(existing);
+    } else {
+      ++existing;
+    }
+  }
+  auto segment = SharedMemorySegment::open(key);
+  if (segment) {
+    segments_.emplace(key, segment);
+  }
+  return segment;
+}
+
+void
+SharedMemorySubscription::deliver(
+  SubscriptionBase & subscription,
+  SharedMemorySegment::SharedPtr segment,
+  size_t slot,
+  uint32_t generation,
+  const rmw_message_info_t & message_info)
+{
+  if (subscription.matches_any_intra_process_publishers(&message_info.publisher_gid)) {
+    // Delivered via intra process, handle_message() would drop it: not worth reading.
+    segment->release(slot, generation);
+    return;
+  }
+  // Views may be kept for any time, so their slot must not be taken back after the lease.
+  size_t length;
+  const uint8_t * payload = nullptr;
+  if (!subscription.is_serialized() || segment->pin(slot, generation)) {
+    payload = segment->read(slot, generation, length);
+  }
+  if (!payload) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rclcpp",
+      "shared memory message on '%s' was taken back before it was read",
+      subscription.get_topic_name());
+    return;
+  }
+
+  if (subscription.is_serialized()) {
+    // A view of the slot, which stays pinned until the last owner lets go of it.
+    std::shared_ptr<rcl_serialized_message_t> view(
+      new rcl_serialized_message_t(make_slot_view(payload, length, length)),
+      [segment, slot, generation](rcl_serialized_message_t * released) {
+        if (!segment->unpin(slot, generation)) {
+          RCUTILS_LOG_ERROR_NAMED(
+            "rclcpp", "shared memory slot %zu was not pinned anymore, when its view was dropped",
+            slot);
+        }
+        delete released;
+      });
+    auto message = std::static_pointer_cast<void>(view);
+    subscription.handle_message(message, message_info);
+    return;
+  }
+
+  auto message = subscription.create_message();
+  auto view = make_slot_view(payload, length, length);
+  rmw_ret_t ret = rmw_deserialize(&view, &subscription.get_message_type_support_handle(),
+      message.get());
+  // Still ours after reading? Otherwise the publisher may have written over it meanwhile.
+  bool intact = segment->release(slot, generation);
+  if (ret != RMW_RET_OK) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rclcpp",
+      "failed to deserialize shared memory message on '%s': %s",
+      subscription.get_topic_name(), rmw_get_error_string().str);
+    rmw_reset_error();
+  } else if (!intact) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rclcpp",
+      "shared memory message on '%s' was taken back while it was read",
+      subscription.get_topic_name());
+  } else {
+    subscription.handle_message(message, message_info);
+  }
+  subscription.return_message(message);
+}
+
+}  // namespace rclcpp
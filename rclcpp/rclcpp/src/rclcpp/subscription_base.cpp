@@ -16,6 +16,7 @@
 
 #include <cstdio>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -39,8 +40,10 @@ SubscriptionBase::SubscriptionBase(
 : node_handle_(node_handle),
   use_intra_process_(false),
   intra_process_subscription_id_(0),
+  message_tracking_enabled_(false),
   type_support_(type_support_handle),
-  is_serialized_(is_serialized)
+  is_serialized_(is_serialized),
+  batch_size_(0)
 {
   auto custom_deletor = [node_handle](rcl_subscription_t * rcl_subs)
     {
@@ -90,9 +93,20 @@ SubscriptionBase::SubscriptionBase(
       rclcpp::get_logger("rclcpp"),
       "creating a subscription tracker with topic '%s'", remapped_topic_name);
     message_tracker_ = MessageTrackerFactory::make(converted_options.tracker_option)->create_message_tracker(converted_options.tracker_result_writing_option, host_info);
+    message_tracking_enabled_ = converted_options.tracker_option != MessageTrackerEnum::NONE;
   }
 }
 
+void
+SubscriptionBase::setup_out_of_band_tracking()
+{
+  if (!message_tracking_enabled_ || is_serialized_) {
+    return;
+  }
+  out_of_band_tracking_ = std::make_unique<OutOfBandTrackingSubscriber>(
+    node_handle_, subscription_handle_.get());
+}
+
 SubscriptionBase::~SubscriptionBase()
 {
   if (!use_intra_process_) {
@@ -109,6 +123,21 @@ SubscriptionBase::~SubscriptionBase()
   ipm->remove_subscription(intra_process_subscription_id_);
 }
 
+bool
+SubscriptionBase::matches_any_intra_process_publishers(const rmw_gid_t * sender_gid) const
+{
+  if (!use_intra_process_) {
+    return false;
+  }
+  auto ipm = weak_ipm_.lock();
+  if (!ipm) {
+    throw std::runtime_error(
+            "intra process publisher check called "
+            "after destruction of intra process manager");
+  }
+  return ipm->matches_any_publishers(sender_gid);
+}
+
 const char *
 SubscriptionBase::get_topic_name() const
 {
@@ -166,11 +195,53 @@ SubscriptionBase::get_publisher_count() const
   return inter_process_publisher_count;
 }
 
+void
+SubscriptionBase::report_realtime_violations(const rclcpp::RealtimeViolationCounts & counts)
+{
+  message_tracker_->track_realtime_violations(counts);
+}
+
+bool
+SubscriptionBase::has_batch_callback() const
+{
+  return false;
+}
+
+void
+SubscriptionBase::handle_message_batch(
+  std::vector<std::shared_ptr<void>> & messages,
+  const std::vector<rmw_message_info_t> & message_infos)
+{
+  for (size_t i = 0; i < messages.size(); ++i) {
+    handle_message(messages[i], message_infos[i]);
+  }
+}
+
+void
+SubscriptionBase::set_batch_size(size_t batch_size)
+{
+  batch_size_.store(batch_size);
+}
+
+size_t
+SubscriptionBase::get_batch_size() const
+{
+  return batch_size_.load();
+}
+
 void SubscriptionBase::setup_intra_process(
   uint64_t intra_process_subscription_id,
   IntraProcessManagerWeakPtr weak_ipm,
   const rcl_subscription_options_t & intra_process_options)
 {
+  intra_process_subscription_id_ = intra_process_subscription_id;
+  weak_ipm_ = weak_ipm;
+  use_intra_process_ = true;
+  if (intra_process_waitable_) {
+    // Publishers hand the messages to the waitable, no notification goes through the middleware.
+    return;
+  }
+
   std::string intra_process_topic_name = std::string(get_topic_name()) + "/_intra";
   rcl_ret_t ret = rcl_subscription_init(
     intra_process_subscription_handle_.get(),
@@ -191,8 +262,29 @@ void SubscriptionBase::setup_intra_process(
 
     rclcpp::exceptions::throw_from_rcl_error(ret, "could not create intra process subscription");
   }
+}
 
-  intra_process_subscription_id_ = intra_process_subscription_id;
-  weak_ipm_ = weak_ipm;
-  use_intra_process_ = true;
+void
+SubscriptionBase::set_intra_process_waitable(
+  rclcpp::SubscriptionIntraProcessBase::SharedPtr waitable)
+{
+  intra_process_waitable_ = waitable;
+}
+
+rclcpp::SubscriptionIntraProcessBase::SharedPtr
+SubscriptionBase::get_intra_process_waitable() const
+{
+  return intra_process_waitable_;
+}
+
+void
+SubscriptionBase::set_shared_memory_waitable(rclcpp::Waitable::SharedPtr waitable)
+{
+  shared_memory_waitable_ = waitable;
+}
+
+rclcpp::Waitable::SharedPtr
+SubscriptionBase::get_shared_memory_waitable() const
+{
+  return shared_memory_waitable_;
 }
@@ -0,0 +1,88 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/subscription_intra_process_base.hpp"
+
+#include "rcl/error_handling.h"
+
+#include "rclcpp/exceptions.hpp"
+
+#include "rcutils/logging_macros.h"
+
+using rclcpp::SubscriptionIntraProcessBase;
+
+SubscriptionIntraProcessBase::SubscriptionIntraProcessBase(rclcpp::Context::SharedPtr context)
+: guard_condition_(rcl_get_zero_initialized_guard_condition()),
+  notified_(false)
+{
+  rcl_guard_condition_options_t guard_condition_options = rcl_guard_condition_get_default_options();
+  rcl_ret_t ret = rcl_guard_condition_init(
+    &guard_condition_, context->get_rcl_context().get(), guard_condition_options);
+  if (RCL_RET_OK != ret) {
+    rclcpp::exceptions::throw_from_rcl_error(
+      ret, "Failed to create intra process subscription guard condition");
+  }
+}
+
+SubscriptionIntraProcessBase::~SubscriptionIntraProcessBase()
+{
+  if (rcl_guard_condition_fini(&guard_condition_) != RCL_RET_OK) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rclcpp",
+      "failed to destroy guard condition: %s", rcl_get_error_string().str);
+    rcl_reset_error();
+  }
+}
+
+size_t
+SubscriptionIntraProcessBase::get_number_of_ready_guard_conditions()
+{
+  return 1;
+}
+
+bool
+SubscriptionIntraProcessBase::add_to_wait_set(rcl_wait_set_t * wait_set)
+{
+  rcl_ret_t ret = rcl_wait_set_add_guard_condition(wait_set, &guard_condition_, nullptr);
+  if (RCL_RET_OK != ret) {
+    rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't add guard condition to wait set");
+  }
+  return true;
+}
+
+bool
+SubscriptionIntraProcessBase::is_ready(rcl_wait_set_t * wait_set)
+{
+  (void)wait_set;
+  return has_data();
+}
+
+void
+SubscriptionIntraProcessBase::notify()
+{
+  if (notified_.exchange(true)) {
+    return;
+  }
+  rcl_ret_t ret = rcl_trigger_guard_condition(&guard_condition_);
+  if (RCL_RET_OK != ret) {
+    rclcpp::exceptions::throw_from_rcl_error(
+      ret, "Failed to trigger intra process subscription guard condition");
+  }
+}
+
+void
+SubscriptionIntraProcessBase::clear_notified()
+{
+  notified_.store(false);
+}
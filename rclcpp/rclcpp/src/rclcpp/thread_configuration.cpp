@@ -0,0 +1,166 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rclcpp/thread_configuration.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using rclcpp::executor::ThreadConfiguration;
+using rclcpp::executor::ThreadSchedulingPolicy;
+
+namespace
+{
+
+#ifdef __linux__
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+// Not in glibc before 2.41, see sched_setattr(2).
+struct SchedAttr
+{
+  uint32_t size;
+  uint32_t sched_policy;
+  uint64_t sched_flags;
+  int32_t sched_nice;
+  uint32_t sched_priority;
+  uint64_t sched_runtime;
+  uint64_t sched_deadline;
+  uint64_t sched_period;
+};
+
+[[noreturn]] void
+throw_errno(const std::string & what, int error)
+{
+  throw std::runtime_error(what + ": " + std::strerror(error));
+}
+
+void
+set_affinity(const std::vector<size_t> & cpus)
+{
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (size_t cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      throw std::runtime_error("CPU " + std::to_string(cpu) + " out of range");
+    }
+    CPU_SET(cpu, &cpu_set);
+  }
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (ret != 0) {
+    throw_errno("Failed to set the CPU affinity of the executor thread", ret);
+  }
+}
+
+void
+set_scheduling(const ThreadConfiguration & configuration)
+{
+  if (configuration.scheduling_policy == ThreadSchedulingPolicy::DEADLINE) {
+    SchedAttr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.sched_policy = SCHED_DEADLINE;
+    attr.sched_runtime = static_cast<uint64_t>(configuration.runtime.count());
+    attr.sched_deadline = static_cast<uint64_t>(configuration.deadline.count());
+    attr.sched_period = static_cast<uint64_t>(configuration.period.count());
+    if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0) {
+      throw_errno("Failed to set SCHED_DEADLINE on the executor thread", errno);
+    }
+    return;
+  }
+
+  int policy = SCHED_OTHER;
+  sched_param param;
+  std::memset(&param, 0, sizeof(param));
+  switch (configuration.scheduling_policy) {
+    case ThreadSchedulingPolicy::FIFO:
+      policy = SCHED_FIFO;
+      param.sched_priority = configuration.priority;
+      break;
+    case ThreadSchedulingPolicy::ROUND_ROBIN:
+      policy = SCHED_RR;
+      param.sched_priority = configuration.priority;
+      break;
+    default:
+      break;
+  }
+  int ret = pthread_setschedparam(pthread_self(), policy, &param);
+  if (ret != 0) {
+    throw_errno("Failed to set the scheduling policy of the executor thread", ret);
+  }
+}
+
+// Not inlined, so the touched stack is given back when it returns, and stays mapped.
+__attribute__((noinline)) void
+prefault_stack(size_t size)
+{
+  volatile char * stack = static_cast<volatile char *>(alloca(size));
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  for (size_t i = 0; i < size; i += page_size) {
+    stack[i] = 0;
+  }
+}
+
+#endif
+
+}  // namespace
+
+void
+rclcpp::executor::configure_current_thread(const ThreadConfiguration & configuration)
+{
+#ifdef __linux__
+  if (!configuration.cpus.empty()) {
+    set_affinity(configuration.cpus);
+  }
+  if (configuration.scheduling_policy != ThreadSchedulingPolicy::INHERIT) {
+    set_scheduling(configuration);
+  }
+  if (configuration.stack_prefault_size) {
+    prefault_stack(configuration.stack_prefault_size);
+  }
+#else
+  if (!configuration.cpus.empty() ||
+    configuration.scheduling_policy != ThreadSchedulingPolicy::INHERIT ||
+    configuration.stack_prefault_size)
+  {
+    throw std::runtime_error("Executor thread configuration is only supported on Linux");
+  }
+#endif
+}
+
+void
+rclcpp::executor::lock_process_memory()
+{
+#ifdef __linux__
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    throw_errno("Failed to lock the process memory", errno);
+  }
+#else
+  throw std::runtime_error("Locking the process memory is only supported on Linux");
+#endif
+}
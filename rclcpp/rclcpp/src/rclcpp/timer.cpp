@@ -88,9 +88,17 @@ TimerBase::~TimerBase()
 
 void
 TimerBase::timer_activate_callback(int64_t time_since_last_call, int64_t intended_activation_time) {
+  // Called by rcl_timer_call, before the callback itself runs.
+  rclcpp::RealtimeViolationPause pause;
   jitter_tracker_->track_jitter(clock_, time_since_last_call, intended_activation_time);
 }
 
+void
+TimerBase::report_realtime_violations(const rclcpp::RealtimeViolationCounts & counts)
+{
+  jitter_tracker_->track_realtime_violations(counts);
+}
+
 void
 TimerBase::cancel()
 {
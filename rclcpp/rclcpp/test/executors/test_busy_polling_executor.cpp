@@ -0,0 +1,83 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "rclcpp/node.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/executors.hpp"
+
+#include "rcl_interfaces/msg/intra_process_message.hpp"
+
+using namespace std::chrono_literals;
+
+class TestBusyPollingExecutor : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    rclcpp::init(0, nullptr);
+  }
+};
+
+/*
+   Test that busy-polled messages are delivered, and that the spin budget shrinks when idle.
+ */
+TEST_F(TestBusyPollingExecutor, polls_and_backs_off) {
+  using rcl_interfaces::msg::IntraProcessMessage;
+  rclcpp::executors::BusyPollingExecutor executor(rclcpp::executor::ExecutorArgs(), 100us);
+  auto node = std::make_shared<rclcpp::Node>("test_busy_polling_executor");
+
+  std::atomic<int> received {0};
+  auto sub = node->create_subscription<IntraProcessMessage>(
+    "busy_poll_topic", 10, [&received](const IntraProcessMessage::SharedPtr) {
+      ++received;
+    });
+  auto pub = node->create_publisher<IntraProcessMessage>("busy_poll_topic", 10);
+  executor.add_node(node);
+  executor.add_busy_poll_subscription(sub);
+  EXPECT_EQ(100us, executor.get_spin_budget());
+
+  // Keeps the executor waking up, and polling, without messages.
+  auto timer = node->create_wall_timer(1ms, []() {});
+
+  std::thread spinner([&executor]() {executor.spin();});
+  auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (sub->get_publisher_count() == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(10ms);
+  }
+  for (uint64_t i = 0; i < 10; ++i) {
+    IntraProcessMessage msg;
+    msg.message_sequence = i;
+    pub->publish(msg);
+    std::this_thread::sleep_for(1ms);
+  }
+  while (received.load() < 10 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  std::this_thread::sleep_for(50ms);
+  auto idle_budget = executor.get_spin_budget();
+
+  executor.cancel();
+  spinner.join();
+
+  EXPECT_EQ(10, received.load());
+  EXPECT_LT(idle_budget, 100us);
+  EXPECT_GE(idle_budget, 100us / 64);
+}
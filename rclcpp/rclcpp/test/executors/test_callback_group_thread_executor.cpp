@@ -0,0 +1,104 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "rclcpp/node.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/executors.hpp"
+
+using namespace std::chrono_literals;
+
+class TestCallbackGroupThreadExecutor : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    rclcpp::init(0, nullptr);
+  }
+};
+
+/*
+   Test that a blocked callback group does not hold up another one, which runs on its own thread.
+ */
+TEST_F(TestCallbackGroupThreadExecutor, groups_run_independently) {
+  rclcpp::executors::CallbackGroupThreadExecutor executor;
+  auto node = std::make_shared<rclcpp::Node>("test_callback_group_thread_executor");
+  auto blocked_group = node->create_callback_group(
+    rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+  auto free_group = node->create_callback_group(
+    rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+  executor.add_node(node);
+
+  std::atomic_bool blocked {false};
+  std::atomic_bool release {false};
+  std::thread::id blocked_thread;
+  auto blocked_timer = node->create_wall_timer(
+    1ms, [&]() {
+      if (blocked.exchange(true)) {
+        return;
+      }
+      blocked_thread = std::this_thread::get_id();
+      auto start = std::chrono::steady_clock::now();
+      while (!release.load() && std::chrono::steady_clock::now() - start < 5s) {
+        std::this_thread::sleep_for(1ms);
+      }
+    }, blocked_group);
+
+  int free_count = 0;
+  size_t number_of_threads = 0;
+  std::thread::id free_thread;
+  auto free_timer = node->create_wall_timer(
+    5ms, [&]() {
+      if (!blocked.load()) {
+        return;
+      }
+      free_thread = std::this_thread::get_id();
+      if (++free_count == 5) {
+        number_of_threads = executor.get_number_of_threads();
+        release.store(true);
+        executor.cancel();
+      }
+    }, free_group);
+
+  executor.spin();
+  EXPECT_EQ(5, free_count);
+  // The default group of the node, and the two created above.
+  EXPECT_EQ(3u, number_of_threads);
+  EXPECT_NE(blocked_thread, free_thread);
+  EXPECT_NE(std::this_thread::get_id(), free_thread);
+  EXPECT_EQ(0u, executor.get_number_of_threads());
+}
+
+/*
+   Test that an exception in a callback stops the executor and comes out of spin().
+ */
+TEST_F(TestCallbackGroupThreadExecutor, callback_exception_rethrown) {
+  rclcpp::executors::CallbackGroupThreadExecutor executor;
+  auto node = std::make_shared<rclcpp::Node>("test_callback_group_thread_executor_throw");
+  executor.add_node(node);
+  auto timer = node->create_wall_timer(
+    1ms, []() {
+      throw std::runtime_error("timer failed");
+    });
+
+  EXPECT_THROW(executor.spin(), std::runtime_error);
+  EXPECT_THROW(executor.spin_some(), std::runtime_error);
+}
@@ -0,0 +1,188 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/node.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/executors.hpp"
+
+#include "rcl_interfaces/msg/intra_process_message.hpp"
+
+using namespace std::chrono_literals;
+
+class TestSchedulingPolicy : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    rclcpp::init(0, nullptr);
+  }
+
+  /// Three timers that are all ready at the first spin_some(), created in the order a, b, c.
+  std::vector<std::string>
+  run_once(
+    rclcpp::executor::SchedulingPolicy policy,
+    const std::string & node_name,
+    std::function<void(const std::vector<rclcpp::callback_group::CallbackGroup::SharedPtr> &)>
+    configure)
+  {
+    rclcpp::executor::ExecutorArgs args;
+    args.scheduling_policy = policy;
+    executor_ = std::make_shared<rclcpp::executors::SingleThreadedExecutor>(args);
+    auto node = std::make_shared<rclcpp::Node>(node_name);
+
+    std::vector<std::string> order;
+    std::vector<rclcpp::callback_group::CallbackGroup::SharedPtr> groups;
+    std::vector<rclcpp::TimerBase::SharedPtr> timers;
+    for (std::string name : {"a", "b", "c"}) {
+      auto group = node->create_callback_group(
+        rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+      groups.push_back(group);
+      timers.push_back(
+        node->create_wall_timer(
+          20ms, [&order, name, &timers]() {
+            order.push_back(name);
+            if (order.size() == 3) {
+              for (auto & timer : timers) {
+                timer->cancel();
+              }
+            }
+          }, group));
+    }
+    configure(groups);
+
+    executor_->add_node(node);
+    std::this_thread::sleep_for(30ms);
+    executor_->spin_some();
+    return order;
+  }
+
+  rclcpp::executors::SingleThreadedExecutor::SharedPtr executor_;
+};
+
+TEST_F(TestSchedulingPolicy, fixed_priority) {
+  auto order = run_once(
+    rclcpp::executor::SchedulingPolicy::FIXED_PRIORITY, "test_scheduling_fixed_priority",
+    [](const std::vector<rclcpp::callback_group::CallbackGroup::SharedPtr> & groups) {
+      groups[0]->set_priority(1);
+      groups[1]->set_priority(2);
+      groups[2]->set_priority(10);
+    });
+  ASSERT_EQ(3u, order.size());
+  EXPECT_EQ("c", order[0]);
+  EXPECT_EQ("b", order[1]);
+  EXPECT_EQ("a", order[2]);
+
+  auto statistics = executor_->get_dispatch_latency_statistics();
+  ASSERT_EQ(3u, statistics.size());
+  EXPECT_EQ(1u, statistics[10].count);
+  EXPECT_LE(statistics[10].max, statistics[1].max);
+}
+
+TEST_F(TestSchedulingPolicy, earliest_deadline_first) {
+  auto order = run_once(
+    rclcpp::executor::SchedulingPolicy::EARLIEST_DEADLINE_FIRST, "test_scheduling_edf",
+    [](const std::vector<rclcpp::callback_group::CallbackGroup::SharedPtr> & groups) {
+      // No deadline for a: last, even with the highest priority.
+      groups[0]->set_priority(100);
+      groups[1]->set_relative_deadline(50ms);
+      groups[2]->set_relative_deadline(5ms);
+    });
+  ASSERT_EQ(3u, order.size());
+  EXPECT_EQ("c", order[0]);
+  EXPECT_EQ("b", order[1]);
+  EXPECT_EQ("a", order[2]);
+}
+
+TEST_F(TestSchedulingPolicy, fifo_records_nothing) {
+  auto order = run_once(
+    rclcpp::executor::SchedulingPolicy::FIFO, "test_scheduling_fifo",
+    [](const std::vector<rclcpp::callback_group::CallbackGroup::SharedPtr> & groups) {
+      groups[2]->set_priority(10);
+    });
+  ASSERT_EQ(3u, order.size());
+  EXPECT_EQ("a", order[0]);
+  EXPECT_TRUE(executor_->get_dispatch_latency_statistics().empty());
+}
+
+/*
+   More ready subscriptions of one mutually exclusive group than the queue was reserved for:
+   growing and shrinking the queue must not release the group while a thread executes in it.
+ */
+TEST_F(TestSchedulingPolicy, mutually_exclusive_group_with_many_ready) {
+  using rcl_interfaces::msg::IntraProcessMessage;
+  auto node = std::make_shared<rclcpp::Node>("test_scheduling_many_ready");
+  auto group = node->create_callback_group(
+    rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+  const size_t count = 100;
+
+  std::atomic<int> inside(0);
+  std::atomic<bool> overlapped(false);
+  std::atomic<size_t> received(0);
+  std::vector<rclcpp::Subscription<IntraProcessMessage>::SharedPtr> subscriptions;
+  std::vector<rclcpp::Publisher<IntraProcessMessage>::SharedPtr> publishers;
+  rclcpp::SubscriptionOptions options;
+  options.callback_group = group;
+  for (size_t i = 0; i < count; ++i) {
+    auto topic = "many_ready_" + std::to_string(i);
+    subscriptions.push_back(
+      node->create_subscription<IntraProcessMessage>(
+        topic, 10,
+        [&](const IntraProcessMessage::SharedPtr) {
+          if (inside.fetch_add(1) != 0) {
+            overlapped = true;
+          }
+          std::this_thread::sleep_for(1ms);
+          inside.fetch_sub(1);
+          received.fetch_add(1);
+        }, options));
+    publishers.push_back(node->create_publisher<IntraProcessMessage>(topic, 10));
+  }
+  auto deadline = std::chrono::steady_clock::now() + 10s;
+  for (auto & publisher : publishers) {
+    while (publisher->get_subscription_count() == 0 &&
+      std::chrono::steady_clock::now() < deadline)
+    {
+      std::this_thread::sleep_for(10ms);
+    }
+  }
+
+  rclcpp::executor::ExecutorArgs args;
+  args.scheduling_policy = rclcpp::executor::SchedulingPolicy::FIXED_PRIORITY;
+  rclcpp::executors::MultiThreadedExecutor executor(args, 4);
+  executor.add_node(node);
+  // All of them are ready at the first wait.
+  for (auto & publisher : publishers) {
+    publisher->publish(IntraProcessMessage());
+  }
+  std::this_thread::sleep_for(100ms);
+  std::thread spinner([&executor]() {executor.spin();});
+  while (received < count && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(10ms);
+  }
+  executor.cancel();
+  spinner.join();
+
+  EXPECT_EQ(count, received.load());
+  EXPECT_FALSE(overlapped);
+}
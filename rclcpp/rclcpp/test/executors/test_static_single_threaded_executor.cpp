@@ -0,0 +1,148 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "rclcpp/node.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/executors.hpp"
+
+using namespace std::chrono_literals;
+
+class TestStaticSingleThreadedExecutor : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    rclcpp::init(0, nullptr);
+  }
+};
+
+/*
+   Test that entities added to a node after the first wait are picked up.
+ */
+TEST_F(TestStaticSingleThreadedExecutor, entity_added_while_spinning) {
+  rclcpp::executors::StaticSingleThreadedExecutor executor;
+  auto node = std::make_shared<rclcpp::Node>("test_static_executor_entity_added");
+  executor.add_node(node);
+
+  std::atomic_int first_count {0};
+  std::atomic_int second_count {0};
+  rclcpp::TimerBase::SharedPtr second_timer;
+  // Stops the spin if the second timer is never picked up, instead of hanging the test.
+  auto deadline = std::chrono::steady_clock::now() + 5s;
+  auto first_timer = node->create_wall_timer(
+    10ms, [&]() {
+      if (std::chrono::steady_clock::now() > deadline) {
+        executor.cancel();
+      }
+      if (++first_count == 1) {
+        second_timer = node->create_wall_timer(
+          10ms, [&]() {
+            if (++second_count == 3) {
+              executor.cancel();
+            }
+          });
+      }
+    });
+
+  executor.spin();
+  EXPECT_EQ(3, second_count.load());
+}
+
+/*
+   Test that a timer released by its owner is not executed anymore.
+ */
+TEST_F(TestStaticSingleThreadedExecutor, released_timer_not_executed) {
+  rclcpp::executors::StaticSingleThreadedExecutor executor;
+  auto node = std::make_shared<rclcpp::Node>("test_static_executor_released_timer");
+  executor.add_node(node);
+
+  std::atomic_int released_count {0};
+  auto released_timer = node->create_wall_timer(1ms, [&]() {++released_count;});
+  executor.spin_once(100ms);
+  EXPECT_EQ(1, released_count.load());
+
+  released_timer.reset();
+  auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start < 50ms) {
+    executor.spin_some();
+  }
+  EXPECT_EQ(1, released_count.load());
+}
+
+/*
+   Test that queued steady timers fire at their own rate, and a long one does not delay the rest.
+ */
+TEST_F(TestStaticSingleThreadedExecutor, timers_with_different_periods) {
+  rclcpp::executors::StaticSingleThreadedExecutor executor;
+  auto node = std::make_shared<rclcpp::Node>("test_static_executor_timer_periods");
+  executor.add_node(node);
+
+  int fast_count = 0;
+  int slow_count = 0;
+  int fast_count_at_first_slow = -1;
+  int idle_count = 0;
+  auto fast_timer = node->create_wall_timer(5ms, [&]() {++fast_count;});
+  auto slow_timer = node->create_wall_timer(
+    20ms, [&]() {
+      if (++slow_count == 1) {
+        fast_count_at_first_slow = fast_count;
+      }
+      if (slow_count == 5) {
+        executor.cancel();
+      }
+    });
+  auto idle_timer = node->create_wall_timer(60s, [&]() {++idle_count;});
+
+  executor.spin();
+  // Relative to each other only, a loaded machine delays both timers alike. Nominally the fast
+  // one fires four times per slow one.
+  EXPECT_EQ(5, slow_count);
+  EXPECT_GE(fast_count_at_first_slow, 1);
+  EXPECT_GE(fast_count, 2 * slow_count);
+  EXPECT_LE(fast_count, 6 * slow_count);
+  EXPECT_EQ(0, idle_count);
+}
+
+/*
+   Test that a canceled timer that is reset fires again.
+ */
+TEST_F(TestStaticSingleThreadedExecutor, canceled_timer_reset) {
+  rclcpp::executors::StaticSingleThreadedExecutor executor;
+  auto node = std::make_shared<rclcpp::Node>("test_static_executor_canceled_timer");
+  executor.add_node(node);
+
+  int count = 0;
+  rclcpp::TimerBase::SharedPtr timer;
+  timer = node->create_wall_timer(
+    10ms, [&]() {
+      if (++count == 1) {
+        timer->cancel();
+      } else {
+        executor.cancel();
+      }
+    });
+  auto reset_timer = node->create_wall_timer(
+    50ms, [&]() {
+      timer->reset();
+    });
+
+  executor.spin();
+  EXPECT_EQ(2, count);
+}
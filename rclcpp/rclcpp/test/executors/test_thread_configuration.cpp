@@ -0,0 +1,131 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include "rclcpp/node.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/executors.hpp"
+#include "rclcpp/thread_configuration.hpp"
+
+using namespace std::chrono_literals;
+
+class TestThreadConfiguration : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    rclcpp::init(0, nullptr);
+  }
+};
+
+#ifdef __linux__
+TEST_F(TestThreadConfiguration, pin_executor_thread) {
+  // The last CPU this process may run on, CPU 0 is not necessarily one of them.
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  int pinned_cpu = -1;
+  for (int i = 0; i < CPU_SETSIZE; ++i) {
+    if (CPU_ISSET(i, &allowed)) {
+      pinned_cpu = i;
+    }
+  }
+  ASSERT_LE(0, pinned_cpu);
+
+  rclcpp::executor::ExecutorArgs args;
+  rclcpp::executor::ThreadConfiguration configuration;
+  configuration.cpus = {static_cast<size_t>(pinned_cpu)};
+  configuration.stack_prefault_size = 256 * 1024;
+  args.thread_configurations.push_back(configuration);
+
+  // Not on this thread, spin() pins the thread that calls it for good.
+  std::atomic_int cpu {-1};
+  std::exception_ptr spinner_error;
+  std::thread spinner([&args, &cpu, &spinner_error]() {
+      try {
+        rclcpp::executors::SingleThreadedExecutor executor(args);
+        auto node = std::make_shared<rclcpp::Node>("test_thread_configuration_pin");
+        auto timer = node->create_wall_timer(
+          1ms, [&cpu, &executor]() {
+            cpu.store(sched_getcpu());
+            executor.cancel();
+          });
+        executor.add_node(node);
+        executor.spin();
+      } catch (...) {
+        spinner_error = std::current_exception();
+      }
+    });
+  spinner.join();
+  if (spinner_error) {
+    std::rethrow_exception(spinner_error);
+  }
+  EXPECT_EQ(pinned_cpu, cpu.load());
+}
+#endif
+
+TEST_F(TestThreadConfiguration, callback_group_on_dedicated_thread) {
+  rclcpp::executors::MultiThreadedExecutor executor(
+    rclcpp::executor::create_default_executor_arguments(), 3u);
+  auto node = std::make_shared<rclcpp::Node>("test_thread_configuration_dedicated");
+  auto dedicated_group = node->create_callback_group(
+    rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+  auto other_group = node->create_callback_group(
+    rclcpp::callback_group::CallbackGroupType::Reentrant);
+
+  executor.assign_callback_group(dedicated_group, 1);
+  EXPECT_THROW(executor.assign_callback_group(dedicated_group, 3), std::invalid_argument);
+  executor.assign_callback_group(other_group, 0);
+  // Thread 2 is the last one left to wait for work.
+  EXPECT_THROW(executor.assign_callback_group(other_group, 2), std::invalid_argument);
+
+  std::mutex mutex;
+  std::set<std::thread::id> dedicated_ids;
+  std::set<std::thread::id> other_ids;
+  int count = 0;
+  auto dedicated_timer = node->create_wall_timer(
+    1ms, [&]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      dedicated_ids.insert(std::this_thread::get_id());
+      if (++count >= 20) {
+        executor.cancel();
+      }
+    }, dedicated_group);
+  auto other_timer = node->create_wall_timer(
+    1ms, [&]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      other_ids.insert(std::this_thread::get_id());
+    }, other_group);
+
+  executor.add_node(node);
+  executor.spin();
+
+  ASSERT_EQ(1u, dedicated_ids.size());
+  ASSERT_EQ(1u, other_ids.size());
+  EXPECT_NE(*dedicated_ids.begin(), *other_ids.begin());
+}
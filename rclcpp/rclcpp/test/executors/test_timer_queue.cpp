@@ -0,0 +1,76 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "rclcpp/executors/timer_queue.hpp"
+
+using namespace std::chrono_literals;
+using rclcpp::executors::TimerQueue;
+
+/*
+   Test that timers pop in due order, ties in index order, and only once due.
+ */
+TEST(TestTimerQueue, pop_due_order) {
+  TimerQueue queue;
+  auto start = TimerQueue::Clock::now();
+  queue.push(0, start + 30ms);
+  queue.push(1, start + 10ms);
+  queue.push(3, start + 20ms);
+  queue.push(2, start + 20ms);
+  EXPECT_EQ(4u, queue.size());
+  EXPECT_EQ(start + 10ms, queue.next_due());
+
+  size_t index = 99;
+  EXPECT_FALSE(queue.pop_due(start, index));
+  EXPECT_EQ(99u, index);
+
+  EXPECT_TRUE(queue.pop_due(start + 25ms, index));
+  EXPECT_EQ(1u, index);
+  EXPECT_TRUE(queue.pop_due(start + 25ms, index));
+  EXPECT_EQ(2u, index);
+  EXPECT_TRUE(queue.pop_due(start + 25ms, index));
+  EXPECT_EQ(3u, index);
+  EXPECT_FALSE(queue.pop_due(start + 25ms, index));
+
+  queue.push(1, start + 40ms);
+  EXPECT_TRUE(queue.pop_due(start + 50ms, index));
+  EXPECT_EQ(0u, index);
+  EXPECT_TRUE(queue.pop_due(start + 50ms, index));
+  EXPECT_EQ(1u, index);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(TimerQueue::Clock::time_point::max(), queue.next_due());
+}
+
+/*
+   Test the wait timeout: the time until the next timer is due, capped by the given timeout.
+ */
+TEST(TestTimerQueue, wait_timeout) {
+  TimerQueue queue;
+  auto start = TimerQueue::Clock::now();
+  EXPECT_EQ(std::chrono::nanoseconds(-1), queue.wait_timeout(start, std::chrono::nanoseconds(-1)));
+  EXPECT_EQ(std::chrono::nanoseconds(5ms), queue.wait_timeout(start, 5ms));
+
+  queue.push(0, start + 10ms);
+  EXPECT_EQ(std::chrono::nanoseconds(10ms),
+    queue.wait_timeout(start, std::chrono::nanoseconds(-1)));
+  EXPECT_EQ(std::chrono::nanoseconds(5ms), queue.wait_timeout(start, 5ms));
+  EXPECT_EQ(std::chrono::nanoseconds(10ms), queue.wait_timeout(start, 1s));
+  EXPECT_EQ(std::chrono::nanoseconds(0), queue.wait_timeout(start + 20ms, 1s));
+
+  queue.clear();
+  EXPECT_TRUE(queue.empty());
+}
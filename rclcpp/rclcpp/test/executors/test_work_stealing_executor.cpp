@@ -0,0 +1,170 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/executors/work_stealing_deque.hpp"
+#include "rclcpp/node.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/executors.hpp"
+
+using namespace std::chrono_literals;
+
+class TestWorkStealingExecutor : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    rclcpp::init(0, nullptr);
+  }
+};
+
+TEST(TestWorkStealingDeque, owner_lifo_thief_fifo) {
+  rclcpp::executors::WorkStealingDeque<int> deque(3);
+  ASSERT_EQ(4u, deque.capacity());
+
+  int items[5] = {0, 1, 2, 3, 4};
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(deque.push(&items[i]));
+  }
+  EXPECT_FALSE(deque.push(&items[4]));
+
+  EXPECT_EQ(&items[0], deque.steal());
+  EXPECT_EQ(&items[3], deque.pop());
+  EXPECT_EQ(&items[2], deque.pop());
+  EXPECT_EQ(&items[1], deque.steal());
+  EXPECT_EQ(nullptr, deque.pop());
+  EXPECT_EQ(nullptr, deque.steal());
+  EXPECT_TRUE(deque.empty());
+}
+
+/*
+   Test that every pushed item is taken exactly once while thieves race the owner.
+ */
+TEST(TestWorkStealingDeque, every_item_taken_once) {
+  const int number_of_items = 100000;
+  rclcpp::executors::WorkStealingDeque<int> deque(64);
+  std::vector<int> items(number_of_items);
+  std::vector<std::atomic_int> taken(number_of_items);
+  for (auto & count : taken) {
+    count.store(0);
+  }
+  std::atomic_bool done {false};
+
+  auto take = [&items, &taken](int * item) {
+      taken[static_cast<size_t>(item - items.data())]++;
+    };
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < 3; ++t) {
+    thieves.emplace_back([&]() {
+        while (!done.load()) {
+          if (int * item = deque.steal()) {
+            take(item);
+          }
+        }
+      });
+  }
+
+  for (int i = 0; i < number_of_items; ++i) {
+    while (!deque.push(&items[static_cast<size_t>(i)])) {
+      if (int * item = deque.pop()) {
+        take(item);
+      }
+    }
+    if (i % 3 == 0) {
+      if (int * item = deque.pop()) {
+        take(item);
+      }
+    }
+  }
+  while (int * item = deque.pop()) {
+    take(item);
+  }
+  done.store(true);
+  for (auto & thief : thieves) {
+    thief.join();
+  }
+
+  for (auto & count : taken) {
+    ASSERT_EQ(1, count.load());
+  }
+}
+
+/*
+   Test that a timer in a reentrant group is not executed again while it is queued or executing.
+ */
+TEST_F(TestWorkStealingExecutor, timer_over_take) {
+  rclcpp::executors::WorkStealingExecutor executor(
+    rclcpp::executor::create_default_executor_arguments(), 4u);
+  auto node = std::make_shared<rclcpp::Node>("test_work_stealing_executor_timer_over_take");
+  auto cbg = node->create_callback_group(rclcpp::callback_group::CallbackGroupType::Reentrant);
+
+  std::atomic_int concurrent {0};
+  std::atomic_int max_concurrent {0};
+  std::atomic_int timer_count {0};
+  auto timer = node->create_wall_timer(
+    1ms, [&]() {
+      int now_running = ++concurrent;
+      if (now_running > max_concurrent.load()) {
+        max_concurrent.store(now_running);
+      }
+      std::this_thread::sleep_for(5ms);
+      --concurrent;
+      if (++timer_count >= 10) {
+        executor.cancel();
+      }
+    }, cbg);
+
+  executor.add_node(node);
+  executor.spin();
+  EXPECT_EQ(1, max_concurrent.load());
+}
+
+/*
+   Test that subscription callbacks of a mutually exclusive group never overlap, while those of
+   different groups do.
+ */
+TEST_F(TestWorkStealingExecutor, callback_group_exclusion) {
+  rclcpp::executors::WorkStealingExecutor executor(
+    rclcpp::executor::create_default_executor_arguments(), 4u);
+  auto node = std::make_shared<rclcpp::Node>("test_work_stealing_executor_exclusion");
+  auto exclusive = node->create_callback_group(
+    rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+
+  std::atomic_int in_exclusive {0};
+  std::atomic_bool overlapped {false};
+  std::atomic_int count {0};
+  auto callback = [&]() {
+      if (++in_exclusive > 1) {
+        overlapped.store(true);
+      }
+      std::this_thread::sleep_for(2ms);
+      --in_exclusive;
+      if (++count >= 20) {
+        executor.cancel();
+      }
+    };
+  auto timer_a = node->create_wall_timer(1ms, callback, exclusive);
+  auto timer_b = node->create_wall_timer(1ms, callback, exclusive);
+
+  executor.add_node(node);
+  executor.spin();
+  EXPECT_FALSE(overlapped.load());
+}
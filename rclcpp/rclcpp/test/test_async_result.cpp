@@ -0,0 +1,148 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rclcpp/async_result.hpp"
+
+/*
+   Test that continuations run on completion, chain, and run right away once complete.
+ */
+TEST(TestAsyncResult, then_chains) {
+  rclcpp::AsyncResult<int> result;
+  std::string seen;
+  auto chained = result.then(
+    [](int value) {
+      return value * 2;
+    }).then(
+    [](int value) {
+      return std::to_string(value);
+    });
+  auto done = chained.then(
+    [&seen](const std::string & value) {
+      seen = value;
+    });
+  EXPECT_FALSE(chained.is_ready());
+  EXPECT_THROW(chained.get(), std::logic_error);
+
+  result.set_value(21);
+  EXPECT_TRUE(chained.is_ready());
+  EXPECT_EQ("42", chained.get());
+  EXPECT_EQ("42", seen);
+  EXPECT_TRUE(done.is_ready());
+  EXPECT_THROW(result.set_value(1), std::logic_error);
+
+  int late = 0;
+  result.then([&late](int value) {late = value;});
+  EXPECT_EQ(21, late);
+}
+
+/*
+   Test that a continuation returning an AsyncResult completes the chain when that one completes.
+ */
+TEST(TestAsyncResult, then_flattens_async_results) {
+  rclcpp::AsyncResult<int> first;
+  rclcpp::AsyncResult<std::string> second;
+  auto chained = first.then(
+    [second](int) {
+      return second;
+    });
+  first.set_value(1);
+  EXPECT_FALSE(chained.is_ready());
+  second.set_value("done");
+  EXPECT_EQ("done", chained.get());
+}
+
+/*
+   Test that errors skip continuations, and on_error recovers from them.
+ */
+TEST(TestAsyncResult, errors_propagate) {
+  rclcpp::AsyncResult<int> result;
+  bool called = false;
+  auto chained = result.then(
+    [&called](int value) {
+      called = true;
+      return value;
+    });
+  auto recovered = chained.on_error(
+    [](std::exception_ptr) {
+      return -1;
+    });
+  result.set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+  EXPECT_FALSE(called);
+  EXPECT_THROW(chained.get(), std::runtime_error);
+  EXPECT_EQ(-1, recovered.get());
+
+  rclcpp::AsyncResult<void> trigger;
+  auto thrown = trigger.then(
+    []() -> int {
+      throw std::runtime_error("continuation failed");
+    });
+  trigger.set_value();
+  EXPECT_THROW(thrown.get(), std::runtime_error);
+}
+
+/*
+   Test that when_all gathers values in order, and fails on the first error.
+ */
+TEST(TestAsyncResult, when_all) {
+  std::vector<rclcpp::AsyncResult<int>> results(3);
+  auto all = rclcpp::when_all(results);
+  results[2].set_value(2);
+  results[0].set_value(0);
+  EXPECT_FALSE(all.is_ready());
+  results[1].set_value(1);
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), all.get());
+
+  std::vector<rclcpp::AsyncResult<int>> failing(2);
+  auto failed = rclcpp::when_all(failing);
+  failing[1].set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+  EXPECT_THROW(failed.get(), std::runtime_error);
+  failing[0].set_value(0);
+
+  EXPECT_TRUE(rclcpp::when_all(std::vector<rclcpp::AsyncResult<int>>()).get().empty());
+}
+
+/*
+   Test that continuations of a result that never completes go with it, and those of a completed
+   result once they ran.
+ */
+TEST(TestAsyncResult, continuations_are_released) {
+  auto alive = std::make_shared<int>(0);
+  std::weak_ptr<int> watch(alive);
+  {
+    rclcpp::AsyncResult<int> pending;
+    auto chained = pending.then([alive](int value) {return value;});
+    pending.on_error([alive](std::exception_ptr) {return 0;});
+    chained.then([alive](int) {});
+    pending.forward_to(rclcpp::AsyncResult<int>());
+    alive.reset();
+    EXPECT_FALSE(watch.expired());
+  }
+  EXPECT_TRUE(watch.expired());
+
+  alive = std::make_shared<int>(0);
+  watch = alive;
+  rclcpp::AsyncResult<void> completed;
+  completed.then([alive]() {});
+  alive.reset();
+  completed.set_value();
+  EXPECT_TRUE(watch.expired());
+}
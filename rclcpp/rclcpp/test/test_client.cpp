@@ -14,6 +14,7 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <string>
 #include <memory>
 
@@ -97,3 +98,35 @@ TEST_F(TestClientSub, construction_and_destruction) {
     }, rclcpp::exceptions::InvalidServiceNameError);
   }
 }
+
+/*
+   Testing that async_call() continuations run on the executor that handles the response.
+ */
+TEST_F(TestClient, async_call_continuation) {
+  using rcl_interfaces::srv::ListParameters;
+  auto service = node->create_service<ListParameters>("service",
+      [](const ListParameters::Request::SharedPtr request,
+      ListParameters::Response::SharedPtr response) {
+        response->result.names = request->prefixes;
+      });
+  auto client = node->create_client<ListParameters>("service");
+  ASSERT_TRUE(client->wait_for_service(std::chrono::seconds(5)));
+
+  auto request = std::make_shared<ListParameters::Request>();
+  request->prefixes.push_back("foo");
+  auto names = client->async_call(request).then(
+    [](const ListParameters::Response::SharedPtr & response) {
+      return response->result.names;
+    });
+  EXPECT_FALSE(names.is_ready());
+
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(node);
+  auto start = std::chrono::steady_clock::now();
+  while (!names.is_ready() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+    executor.spin_once(std::chrono::milliseconds(100));
+  }
+  ASSERT_TRUE(names.is_ready());
+  ASSERT_EQ(1u, names.get().size());
+  EXPECT_EQ("foo", names.get()[0]);
+}
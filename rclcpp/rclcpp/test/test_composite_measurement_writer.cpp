@@ -0,0 +1,225 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rclcpp/measuring/composite_measurement_writer.hpp"
+
+namespace
+{
+
+/// What a backend got, as "class:value" per record.
+struct Received
+{
+  std::vector<std::string> registered;
+  std::vector<std::string> records;
+};
+
+class RecordingWriter : public rclcpp::IMeasurementWriter
+{
+public:
+  explicit RecordingWriter(std::shared_ptr<Received> received)
+  : received_(received) {}
+
+  uint32_t register_measurement_class(
+    const std::string & name, const std::vector<std::string> &) override
+  {
+    received_->registered.push_back(name);
+    classes_.push_back(name);
+    return static_cast<uint32_t>(classes_.size() - 1);
+  }
+
+  void record_latency(
+    uint32_t key, const rclcpp::MessageTrackingVariables & msg, const rclcpp::hex_char_array_t &,
+    int64_t arrival_time) override
+  {
+    record(key, arrival_time - msg.vandenhoven_timestamp);
+  }
+
+  void record_arrival(
+    uint32_t key, const rclcpp::MessageTrackingVariables & msg,
+    const rclcpp::hex_char_array_t &) override
+  {
+    record(key, static_cast<int64_t>(msg.vandenhoven_identifier));
+  }
+
+  void record_activation_jitter(uint32_t key, int64_t activation_jitter) override
+  {
+    record(key, activation_jitter);
+  }
+
+  void record_realtime_violations(uint32_t key, uint64_t allocations, uint64_t) override
+  {
+    record(key, static_cast<int64_t>(allocations));
+  }
+
+private:
+  void record(uint32_t key, int64_t value)
+  {
+    received_->records.push_back(classes_.at(key) + ":" + std::to_string(value));
+  }
+
+  std::shared_ptr<Received> received_;
+  std::vector<std::string> classes_;
+};
+
+rclcpp::MeasurementWriterMaker
+recording_into(std::shared_ptr<Received> received)
+{
+  return [received](const rclcpp::MessageTrackerHostInfo &) {
+           return rclcpp::IMeasurementWriter::UniquePtr(new RecordingWriter(received));
+         };
+}
+
+rclcpp::MessageTrackingVariables
+message(uint64_t identifier, int64_t timestamp)
+{
+  rclcpp::MessageTrackingVariables msg{};
+  msg.vandenhoven_identifier = identifier;
+  msg.vandenhoven_timestamp = timestamp;
+  return msg;
+}
+
+const rclcpp::MessageTrackerHostInfo host_info("/chatter", "listener", "/ns/");
+const rclcpp::hex_char_array_t publisher(0x1234abcdu);
+
+}  // namespace
+
+/*
+   A measurement class is only registered at, and recorded to, the backends whose route lists it.
+ */
+TEST(TestCompositeMeasurementWriter, routes_by_measurement_class) {
+  auto latency_only = std::make_shared<Received>();
+  auto everything = std::make_shared<Received>();
+  rclcpp::CompositeMeasurementWriter writer(host_info, {
+    rclcpp::MeasurementRoute(recording_into(latency_only), {"message_latency"}),
+    rclcpp::MeasurementRoute(recording_into(everything)),
+  });
+
+  auto jitter_key = writer.register_measurement_class("activation_jitter");
+  auto latency_key = writer.register_measurement_class("message_latency");
+  EXPECT_EQ(std::vector<std::string>({"message_latency"}), latency_only->registered);
+  EXPECT_EQ(
+    std::vector<std::string>({"activation_jitter", "message_latency"}), everything->registered);
+
+  writer.record_activation_jitter(jitter_key, 7);
+  auto msg = message(1, 1000);
+  writer.record_latency(latency_key, msg, publisher, 3000);
+  EXPECT_EQ(std::vector<std::string>({"message_latency:2000"}), latency_only->records);
+  EXPECT_EQ(
+    std::vector<std::string>({"activation_jitter:7", "message_latency:2000"}),
+    everything->records);
+}
+
+/*
+   A filter drops records before its backend sees them, other backends get them all the same.
+ */
+TEST(TestCompositeMeasurementWriter, filters_per_route) {
+  auto slow = std::make_shared<Received>();
+  auto all = std::make_shared<Received>();
+  rclcpp::CompositeMeasurementWriter writer(host_info, {
+    rclcpp::MeasurementRoute(
+      recording_into(slow), {},
+      rclcpp::MeasurementRoute::latency_above(std::chrono::milliseconds(5))),
+    rclcpp::MeasurementRoute(recording_into(all)),
+  });
+  auto latency_key = writer.register_measurement_class("message_latency");
+  auto arrival_key = writer.register_measurement_class("message_arrival");
+
+  auto fast_msg = message(1, 0);
+  auto slow_msg = message(2, 0);
+  writer.record_latency(latency_key, fast_msg, publisher, 1000000);
+  writer.record_latency(latency_key, slow_msg, publisher, 10000000);
+  // The filter only looks at latencies.
+  writer.record_arrival(arrival_key, fast_msg, publisher);
+
+  EXPECT_EQ(
+    std::vector<std::string>({"message_latency:10000000", "message_arrival:1"}), slow->records);
+  EXPECT_EQ(
+    std::vector<std::string>(
+      {"message_latency:1000000", "message_latency:10000000", "message_arrival:1"}),
+    all->records);
+}
+
+/*
+   Filters see the raw values of each kind of record.
+ */
+TEST(TestCompositeMeasurementWriter, filter_sees_records) {
+  auto received = std::make_shared<Received>();
+  std::vector<rclcpp::MeasurementRecord::Kind> kinds;
+  rclcpp::CompositeMeasurementWriter writer(host_info, {
+    rclcpp::MeasurementRoute(
+      recording_into(received), {},
+      [&kinds](const rclcpp::MeasurementRecord & record) {
+        kinds.push_back(record.kind);
+        return record.kind != rclcpp::MeasurementRecord::Kind::REALTIME_VIOLATIONS ||
+        record.second_value > 1;
+      }),
+  });
+  auto violations_key = writer.register_measurement_class("realtime_violations");
+  writer.record_realtime_violations(violations_key, 3, 1);
+  writer.record_realtime_violations(violations_key, 4, 2);
+
+  EXPECT_EQ(2u, kinds.size());
+  EXPECT_EQ(std::vector<std::string>({"realtime_violations:4"}), received->records);
+}
+
+/*
+   Routes are required, and a composite writer can not route to another one.
+ */
+TEST(TestCompositeMeasurementWriter, invalid_routes) {
+  EXPECT_THROW(rclcpp::CompositeMeasurementWriter(host_info, {}), std::invalid_argument);
+  EXPECT_THROW(
+    rclcpp::CompositeMeasurementWriter(host_info, {
+      rclcpp::MeasurementRoute(rclcpp::MeasurementWriterEnum::COMPOSITE),
+    }),
+    std::invalid_argument);
+  EXPECT_THROW(
+    rclcpp::CompositeMeasurementWriter(host_info, {
+      rclcpp::MeasurementRoute(
+        [](const rclcpp::MessageTrackerHostInfo &) {
+          return rclcpp::IMeasurementWriter::UniquePtr();
+        }),
+    }),
+    std::invalid_argument);
+}
+
+/*
+   Writers created without routes use the process-wide ones, each with backends of its own.
+ */
+TEST(TestCompositeMeasurementWriter, process_wide_routes) {
+  auto received = std::make_shared<Received>();
+  rclcpp::CompositeMeasurementWriter::set_routes({
+    rclcpp::MeasurementRoute(recording_into(received), {"message_arrival"}),
+  });
+  EXPECT_EQ(1u, rclcpp::CompositeMeasurementWriter::get_routes().size());
+
+  rclcpp::CompositeMeasurementWriter first(host_info);
+  rclcpp::CompositeMeasurementWriter second(host_info);
+  auto first_key = first.register_measurement_class("message_arrival");
+  auto second_key = second.register_measurement_class("message_arrival");
+  auto msg = message(5, 0);
+  first.record_arrival(first_key, msg, publisher);
+  second.record_arrival(second_key, msg, publisher);
+  EXPECT_EQ(
+    std::vector<std::string>({"message_arrival:5", "message_arrival:5"}), received->records);
+
+  rclcpp::CompositeMeasurementWriter::set_routes({});
+}
@@ -0,0 +1,127 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/strategies/dynamic_message_pool_memory_strategy.hpp"
+
+using rclcpp::strategies::message_pool_memory_strategy::DynamicMessagePoolMemoryStrategy;
+using rclcpp::strategies::message_pool_memory_strategy::PoolGrowthPolicy;
+
+struct PointCloud
+{
+  std::string frame_id;
+  std::vector<uint8_t> data;
+};
+
+/*
+   Test that a returned message is borrowed again, with the capacity it had.
+ */
+TEST(TestDynamicMessagePoolMemoryStrategy, reuses_messages) {
+  DynamicMessagePoolMemoryStrategy<PointCloud> strategy(1);
+  auto msg = strategy.borrow_message();
+  msg->data.resize(1 << 20);
+  PointCloud * first = msg.get();
+  const uint8_t * data = msg->data.data();
+  strategy.return_message(msg);
+  EXPECT_EQ(nullptr, msg);
+
+  msg = strategy.borrow_message();
+  EXPECT_EQ(first, msg.get());
+  EXPECT_EQ(data, msg->data.data());
+  EXPECT_GE(msg->data.capacity(), 1u << 20);
+  EXPECT_EQ(1u, strategy.get_pool_size());
+}
+
+/*
+   Test that a message stays borrowed as long as it has an owner, and the policies once all are.
+ */
+TEST(TestDynamicMessagePoolMemoryStrategy, growth_policies) {
+  DynamicMessagePoolMemoryStrategy<PointCloud> fixed(2);
+  auto first = fixed.borrow_message();
+  auto second = fixed.borrow_message();
+  EXPECT_NE(first.get(), second.get());
+  EXPECT_THROW(fixed.borrow_message(), std::runtime_error);
+  std::weak_ptr<PointCloud> weak = first;
+  auto owner = first;
+  fixed.return_message(first);
+  EXPECT_THROW(fixed.borrow_message(), std::runtime_error);
+  owner.reset();
+  // A weak_ptr keeps the control block, and with it the message, out of the pool.
+  EXPECT_THROW(fixed.borrow_message(), std::runtime_error);
+  weak.reset();
+  EXPECT_NE(nullptr, fixed.borrow_message());
+
+  DynamicMessagePoolMemoryStrategy<PointCloud> bounded(1, PoolGrowthPolicy::BoundedGrow, 2);
+  first = bounded.borrow_message();
+  second = bounded.borrow_message();
+  EXPECT_EQ(2u, bounded.get_pool_size());
+  EXPECT_THROW(bounded.borrow_message(), std::runtime_error);
+
+  DynamicMessagePoolMemoryStrategy<PointCloud> fallback(1, PoolGrowthPolicy::HeapFallback);
+  first = fallback.borrow_message();
+  second = fallback.borrow_message();
+  EXPECT_NE(nullptr, second);
+  EXPECT_EQ(1u, fallback.get_pool_size());
+  EXPECT_EQ(1u, fallback.get_heap_fallback_count());
+}
+
+/*
+   Test that messages can outlive the strategy.
+ */
+TEST(TestDynamicMessagePoolMemoryStrategy, message_outlives_strategy) {
+  std::shared_ptr<PointCloud> msg;
+  {
+    DynamicMessagePoolMemoryStrategy<PointCloud> strategy(1);
+    msg = strategy.borrow_message();
+  }
+  msg->frame_id = "still valid";
+  EXPECT_EQ("still valid", msg->frame_id);
+}
+
+/*
+   Test that threads borrowing and returning at once never share a message.
+ */
+TEST(TestDynamicMessagePoolMemoryStrategy, concurrent_borrow_return) {
+  DynamicMessagePoolMemoryStrategy<PointCloud> strategy(4);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back(
+      [&strategy, &failures, t]() {
+        for (int i = 0; i < 10000; ++i) {
+          auto msg = strategy.borrow_message();
+          msg->frame_id = std::to_string(t);
+          std::this_thread::yield();
+          if (msg->frame_id != std::to_string(t)) {
+            ++failures;
+          }
+          strategy.return_message(msg);
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, failures.load());
+  EXPECT_EQ(4u, strategy.get_pool_size());
+}
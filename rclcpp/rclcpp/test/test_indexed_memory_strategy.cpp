@@ -0,0 +1,208 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/strategies/indexed_memory_strategy.hpp"
+
+#include "rcl_interfaces/msg/intra_process_message.hpp"
+
+using namespace std::chrono_literals;
+
+using rclcpp::memory_strategies::indexed_memory_strategy::IndexedMemoryStrategy;
+using rclcpp::memory_strategies::indexed_memory_strategy::ReadyBitmap;
+using rcl_interfaces::msg::IntraProcessMessage;
+
+namespace
+{
+// Allocations are counted on the thread of the test only, while it asks for it.
+thread_local bool counting_allocations = false;
+thread_local size_t allocation_count = 0;
+
+void
+count_allocation()
+{
+  if (counting_allocations) {
+    ++allocation_count;
+  }
+}
+
+void *
+counting_allocate(size_t size, void * state)
+{
+  count_allocation();
+  return rcl_get_default_allocator().allocate(size, state);
+}
+
+void *
+counting_reallocate(void * pointer, size_t size, void * state)
+{
+  count_allocation();
+  return rcl_get_default_allocator().reallocate(pointer, size, state);
+}
+
+void *
+counting_zero_allocate(size_t count, size_t size, void * state)
+{
+  count_allocation();
+  return rcl_get_default_allocator().zero_allocate(count, size, state);
+}
+}  // namespace
+
+void *
+operator new(std::size_t size)
+{
+  count_allocation();
+  void * pointer = std::malloc(size == 0 ? 1 : size);
+  if (!pointer) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void
+operator delete(void * pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void
+operator delete(void * pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+TEST(TestReadyBitmap, find_next) {
+  const size_t npos = ReadyBitmap::npos;
+  ReadyBitmap bitmap;
+  bitmap.reset(130);
+  EXPECT_EQ(npos, bitmap.find_next(0));
+
+  for (size_t index : {0u, 63u, 64u, 129u}) {
+    bitmap.set(index);
+  }
+  std::vector<size_t> found;
+  for (size_t i = bitmap.find_next(0); i != npos; i = bitmap.find_next(i + 1)) {
+    found.push_back(i);
+  }
+  EXPECT_EQ((std::vector<size_t>{0u, 63u, 64u, 129u}), found);
+
+  bitmap.clear(63);
+  EXPECT_EQ(64u, bitmap.find_next(1));
+  EXPECT_EQ(npos, bitmap.find_next(130));
+
+  bitmap.reset(10);
+  EXPECT_EQ(npos, bitmap.find_next(0));
+}
+
+class TestIndexedMemoryStrategy : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    rclcpp::init(0, nullptr);
+  }
+};
+
+TEST_F(TestIndexedMemoryStrategy, dispatch_timers_and_subscriptions) {
+  rclcpp::executor::ExecutorArgs args;
+  args.memory_strategy = std::make_shared<IndexedMemoryStrategy>();
+  rclcpp::executors::SingleThreadedExecutor executor(args);
+
+  auto node = std::make_shared<rclcpp::Node>("test_indexed_memory_strategy");
+  int timer_count = 0;
+  int message_count = 0;
+  auto timer = node->create_wall_timer(1ms, [&timer_count]() {++timer_count;});
+  auto subscription = node->create_subscription<IntraProcessMessage>(
+    "test_indexed_memory_strategy", 10,
+    [&message_count](const IntraProcessMessage::SharedPtr) {++message_count;});
+  auto publisher = node->create_publisher<IntraProcessMessage>(
+    "test_indexed_memory_strategy", 10);
+  executor.add_node(node);
+
+  auto start = std::chrono::steady_clock::now();
+  while ((timer_count < 3 || message_count < 3) &&
+    std::chrono::steady_clock::now() - start < 5s)
+  {
+    if (message_count < 3) {
+      publisher->publish(IntraProcessMessage());
+    }
+    executor.spin_once(10ms);
+  }
+  EXPECT_GE(timer_count, 3);
+  EXPECT_GE(message_count, 3);
+}
+
+/*
+   Test that once warmed up, the strategy and the wait set neither allocate nor rebuild their
+   entries for a spin: collecting, filling the wait set, reading it back and dispatching.
+ */
+TEST_F(TestIndexedMemoryStrategy, steady_state_does_not_allocate) {
+  auto node = std::make_shared<rclcpp::Node>("test_indexed_memory_strategy_allocations");
+  auto timer = node->create_wall_timer(1ms, []() {});
+  auto subscription = node->create_subscription<IntraProcessMessage>(
+    "test_indexed_memory_strategy_allocations", 10, [](const IntraProcessMessage::SharedPtr) {});
+  rclcpp::memory_strategy::MemoryStrategy::WeakNodeList weak_nodes;
+  weak_nodes.push_back(node->get_node_base_interface());
+
+  IndexedMemoryStrategy strategy;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  allocator.allocate = counting_allocate;
+  allocator.reallocate = counting_reallocate;
+  allocator.zero_allocate = counting_zero_allocate;
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  auto context = rclcpp::contexts::default_context::get_global_default_context();
+  ASSERT_EQ(
+    RCL_RET_OK,
+    rcl_wait_set_init(&wait_set, 0, 0, 0, 0, 0, 0, context->get_rcl_context().get(), allocator));
+
+  auto spin = [&]() {
+      strategy.clear_handles();
+      strategy.collect_entities(weak_nodes);
+      ASSERT_EQ(RCL_RET_OK, rcl_wait_set_clear(&wait_set));
+      ASSERT_EQ(
+        RCL_RET_OK,
+        rcl_wait_set_resize(
+          &wait_set, strategy.number_of_ready_subscriptions(),
+          strategy.number_of_guard_conditions(), strategy.number_of_ready_timers(),
+          strategy.number_of_ready_clients(), strategy.number_of_ready_services(),
+          strategy.number_of_ready_events()));
+      ASSERT_TRUE(strategy.add_handles_to_wait_set(&wait_set));
+      // No rcl_wait: what the middleware does while waiting is not up to the strategy. Everything
+      // added is left in the wait set, as if ready.
+      strategy.remove_null_handles(&wait_set);
+      rclcpp::executor::AnyExecutable any_exec;
+      strategy.get_next_subscription(any_exec, weak_nodes);
+      EXPECT_NE(nullptr, any_exec.subscription);
+    };
+
+  for (int i = 0; i < 3; ++i) {
+    spin();
+  }
+  counting_allocations = true;
+  for (int i = 0; i < 100; ++i) {
+    spin();
+  }
+  counting_allocations = false;
+  EXPECT_EQ(0u, allocation_count);
+
+  EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set));
+}
@@ -56,6 +56,21 @@ public:
     return false;
   }
 
+  const rmw_gid_t &
+  get_gid() const
+  {
+    return mock_gid;
+  }
+
+  const rmw_gid_t &
+  get_intra_process_gid() const
+  {
+    return mock_intra_process_gid;
+  }
+
+  rmw_gid_t mock_gid {};
+  rmw_gid_t mock_intra_process_gid {};
+
   virtual
   mapped_ring_buffer::MappedRingBufferBase::SharedPtr
   make_mapped_ring_buffer(size_t size) const
@@ -858,3 +873,110 @@ TEST(TestIntraProcessManager, publisher_out_of_scope_store) {
   EXPECT_THROW(ipm.store_intra_process_message(p1_id, std::move(unique_msg)), std::runtime_error);
   ASSERT_EQ(nullptr, unique_msg);
 }
+
+/*
+   Tests that subscriptions with a waitable are left to the publisher, and that the targets follow
+   subscriptions as they come and go.
+   - Creates a publisher and two subscriptions, the second one then gets a waitable.
+   - Publish a message, the first subscription takes the original, the second can't take it.
+   - Remove the subscriptions, the targets are empty.
+ */
+TEST(TestIntraProcessManager, subscription_with_waitable) {
+  rclcpp::intra_process_manager::IntraProcessManager ipm;
+
+  auto p1 = std::make_shared<
+    rclcpp::mock::Publisher<rcl_interfaces::msg::IntraProcessMessage>
+    >();
+  p1->mock_topic_name = "nominal1";
+  p1->mock_queue_size = 10;
+
+  auto s1 = std::make_shared<rclcpp::mock::SubscriptionBase>();
+  s1->mock_topic_name = "nominal1";
+  s1->mock_queue_size = 10;
+
+  auto s2 = std::make_shared<rclcpp::mock::SubscriptionBase>();
+  s2->mock_topic_name = "nominal1";
+  s2->mock_queue_size = 10;
+
+  auto p1_id = ipm.add_publisher(p1);
+  auto s1_id = ipm.add_subscription(s1);
+  auto s2_id = ipm.add_subscription(s2);
+  ipm.add_intra_process_waitable(s2_id, nullptr);
+
+  {
+    auto reader = ipm.get_intra_process_targets(p1_id);
+    ASSERT_NE(nullptr, reader.get());
+    EXPECT_EQ(2u, reader.get()->subscription_count);
+    EXPECT_NE(0u, reader.get()->subscription_mask);
+  }
+  EXPECT_EQ(2u, ipm.get_subscription_count(p1_id));
+
+  rcl_interfaces::msg::IntraProcessMessage::UniquePtr unique_msg(
+    new rcl_interfaces::msg::IntraProcessMessage());
+  unique_msg->message_sequence = 42;
+  auto original_message_pointer = unique_msg.get();
+  auto p1_m1_id = ipm.store_intra_process_message(p1_id, std::move(unique_msg));
+
+  ipm.take_intra_process_message(p1_id, p1_m1_id, s2_id, unique_msg);
+  EXPECT_EQ(nullptr, unique_msg);  // The publisher pushes to the waitable instead.
+
+  ipm.take_intra_process_message(p1_id, p1_m1_id, s1_id, unique_msg);
+  ASSERT_NE(nullptr, unique_msg);
+  EXPECT_EQ(original_message_pointer, unique_msg.get());  // No other subscription to take it.
+
+  ipm.remove_subscription(s1_id);
+  ipm.remove_subscription(s2_id);
+  auto reader = ipm.get_intra_process_targets(p1_id);
+  ASSERT_NE(nullptr, reader.get());
+  EXPECT_EQ(0u, reader.get()->subscription_count);
+  EXPECT_EQ(0u, reader.get()->subscription_mask);
+  EXPECT_EQ(nullptr, ipm.get_intra_process_targets(p1_id + 1000).get());
+}
+
+/*
+   Tests that messages from publishers of this process are told apart by their gid.
+   - Creates two publishers with distinct gids.
+   - Their gids match, others don't.
+   - The gid of a publisher can be looked up by its id.
+   - Remove a publisher, its gids no longer match.
+ */
+TEST(TestIntraProcessManager, matches_any_publishers) {
+  rclcpp::intra_process_manager::IntraProcessManager ipm;
+
+  auto p1 = std::make_shared<
+    rclcpp::mock::Publisher<rcl_interfaces::msg::IntraProcessMessage>
+    >();
+  p1->mock_topic_name = "nominal1";
+  p1->mock_queue_size = 2;
+  p1->mock_gid.data[0] = 1;
+  p1->mock_intra_process_gid.data[0] = 2;
+
+  auto p2 = std::make_shared<
+    rclcpp::mock::Publisher<rcl_interfaces::msg::IntraProcessMessage>
+    >();
+  p2->mock_topic_name = "nominal2";
+  p2->mock_queue_size = 2;
+  p2->mock_gid.data[RMW_GID_STORAGE_SIZE - 1] = 3;
+  p2->mock_intra_process_gid.data[RMW_GID_STORAGE_SIZE - 1] = 4;
+
+  auto p1_id = ipm.add_publisher(p1);
+  ipm.add_publisher(p2);
+
+  rmw_gid_t other {};
+  other.data[0] = 3;
+  EXPECT_TRUE(ipm.matches_any_publishers(&p1->mock_gid));
+  EXPECT_TRUE(ipm.matches_any_publishers(&p1->mock_intra_process_gid));
+  EXPECT_TRUE(ipm.matches_any_publishers(&p2->mock_gid));
+  EXPECT_TRUE(ipm.matches_any_publishers(&p2->mock_intra_process_gid));
+  EXPECT_FALSE(ipm.matches_any_publishers(&other));
+
+  rmw_gid_t gid {};
+  EXPECT_TRUE(ipm.get_publisher_gid(p1_id, gid));
+  EXPECT_EQ(1, gid.data[0]);
+
+  ipm.remove_publisher(p1_id);
+  EXPECT_FALSE(ipm.matches_any_publishers(&p1->mock_gid));
+  EXPECT_FALSE(ipm.matches_any_publishers(&p1->mock_intra_process_gid));
+  EXPECT_TRUE(ipm.matches_any_publishers(&p2->mock_gid));
+  EXPECT_FALSE(ipm.get_publisher_gid(p1_id, gid));
+}
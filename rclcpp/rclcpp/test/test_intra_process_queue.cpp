@@ -0,0 +1,104 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "rclcpp/intra_process_queue.hpp"
+
+/*
+   Tests order, capacity and that popped slots let go of their value.
+ */
+TEST(TestIntraProcessQueue, push_pop) {
+  EXPECT_THROW(rclcpp::IntraProcessQueue<int> queue(0), std::invalid_argument);
+
+  rclcpp::IntraProcessQueue<std::unique_ptr<int>> queue(3);
+  EXPECT_EQ(4u, queue.capacity());
+  EXPECT_TRUE(queue.empty());
+
+  std::unique_ptr<int> value;
+  EXPECT_FALSE(queue.try_pop(value));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.try_push(std::unique_ptr<int>(new int(i))));
+  }
+  EXPECT_FALSE(queue.empty());
+  std::unique_ptr<int> rejected(new int(4));
+  EXPECT_FALSE(queue.try_push(std::move(rejected)));
+  ASSERT_NE(nullptr, rejected);
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.try_pop(value));
+    EXPECT_EQ(i, *value);
+  }
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.try_pop(value));
+
+  auto shared = std::make_shared<int>(5);
+  rclcpp::IntraProcessQueue<std::shared_ptr<int>> shared_queue(2);
+  EXPECT_TRUE(shared_queue.try_push(std::shared_ptr<int>(shared)));
+  std::shared_ptr<int> popped;
+  ASSERT_TRUE(shared_queue.try_pop(popped));
+  popped.reset();
+  EXPECT_EQ(1, shared.use_count());
+}
+
+/*
+   Tests that with several producers and consumers every element is popped exactly once.
+ */
+TEST(TestIntraProcessQueue, concurrent) {
+  const int producers = 4;
+  const int per_producer = 10000;
+  rclcpp::IntraProcessQueue<int> queue(64);
+  std::vector<std::atomic<int>> seen(producers * per_producer);
+  for (auto & count : seen) {
+    count.store(0);
+  }
+  std::atomic<int> popped {0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&queue, p]() {
+        for (int i = 0; i < per_producer; ++i) {
+          int value = p * per_producer + i;
+          while (!queue.try_push(std::move(value))) {
+            std::this_thread::yield();
+          }
+        }
+      });
+  }
+  for (int c = 0; c < 2; ++c) {
+    threads.emplace_back([&]() {
+        int value;
+        while (popped.load() < producers * per_producer) {
+          if (queue.try_pop(value)) {
+            ++seen[value];
+            ++popped;
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  for (auto & count : seen) {
+    EXPECT_EQ(1, count.load());
+  }
+}
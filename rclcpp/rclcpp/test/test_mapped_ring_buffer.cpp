@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <utility>
 
 #include "gtest/gtest.h"
@@ -311,24 +313,134 @@ TEST(TestMappedRingBuffer, non_unique_keys) {
   rclcpp::mapped_ring_buffer::MappedRingBuffer<char> mrb(2);
 
   std::shared_ptr<const char> input(new char('a'));
-  mrb.push_and_replace(1, input);
+  EXPECT_FALSE(mrb.push_and_replace(1, input));
   input.reset(new char('b'));
 
-  // Different value, same key.
-  mrb.push_and_replace(1, input);
+  // Different value, same key: it goes to the same slot and displaces the first one.
+  EXPECT_TRUE(mrb.push_and_replace(1, input));
   input.reset();
 
   std::unique_ptr<char> actual;
   mrb.pop(1, actual);
   EXPECT_NE(nullptr, actual);
   if (actual) {
-    EXPECT_EQ('a', *actual);
+    EXPECT_EQ('b', *actual);
   }
 
   actual = nullptr;
   mrb.pop(1, actual);
-  EXPECT_NE(nullptr, actual);
-  if (actual) {
-    EXPECT_EQ('b', *actual);
+  EXPECT_EQ(nullptr, actual);
+}
+
+/*
+   Tests that keys find their value in their slot, whatever order they are pushed in.
+ */
+TEST(TestMappedRingBuffer, slot_of_key) {
+  rclcpp::mapped_ring_buffer::MappedRingBuffer<char> mrb(3);
+
+  EXPECT_FALSE(mrb.push_and_replace(5, std::unique_ptr<char>(new char('a'))));
+  EXPECT_FALSE(mrb.push_and_replace(3, std::unique_ptr<char>(new char('b'))));
+  EXPECT_TRUE(mrb.has_key(5));
+  EXPECT_TRUE(mrb.has_key(3));
+  EXPECT_FALSE(mrb.has_key(4));
+  EXPECT_FALSE(mrb.has_key(2));  // Same slot as 5.
+
+  // Displaces 5, keeps 3.
+  EXPECT_TRUE(mrb.push_and_replace(8, std::unique_ptr<char>(new char('c'))));
+  EXPECT_FALSE(mrb.has_key(5));
+
+  std::shared_ptr<const char> actual;
+  mrb.get(3, actual);
+  ASSERT_NE(nullptr, actual);
+  EXPECT_EQ('b', *actual);
+  mrb.get(8, actual);
+  ASSERT_NE(nullptr, actual);
+  EXPECT_EQ('c', *actual);
+}
+
+/*
+   Tests that readers of other threads get either nothing or the value of their key, while the
+   publisher laps them.
+ */
+TEST(TestMappedRingBuffer, concurrent_push_get_pop) {
+  rclcpp::mapped_ring_buffer::MappedRingBuffer<uint64_t> mrb(4);
+  const uint64_t count = 20000;
+  std::atomic<uint64_t> published(0);
+  std::atomic<uint64_t> wrong(0);
+  std::atomic<uint64_t> found(0);
+  std::atomic<int> readers(0);
+
+  auto reader = [&](bool pop) {
+      ++readers;
+      while (published.load() < count) {
+        uint64_t key = published.load();
+        if (pop) {
+          std::unique_ptr<uint64_t> value;
+          mrb.pop(key, value);
+          if (value) {
+            ++found;
+            wrong += *value != key;
+          }
+        } else {
+          std::shared_ptr<const uint64_t> value;
+          mrb.get(key, value);
+          if (value) {
+            ++found;
+            wrong += *value != key;
+          }
+          std::unique_ptr<uint64_t> copy;
+          mrb.get(key, copy);
+          if (copy) {
+            wrong += *copy != key;
+          }
+        }
+      }
+    };
+  std::thread getter(reader, false);
+  std::thread popper(reader, true);
+  // Pushing does not wait for anyone, it would be done before the readers start.
+  while (readers.load() < 2) {
+    std::this_thread::yield();
+  }
+  for (uint64_t key = 0; key < count; ++key) {
+    mrb.push_and_replace(key, std::unique_ptr<uint64_t>(new uint64_t(key)));
+    published.store(key);
+    if (key % 64 == 0) {
+      // Let the readers in, also with a single CPU.
+      std::this_thread::yield();
+    }
   }
+  published.store(count);
+  getter.join();
+  popper.join();
+
+  EXPECT_EQ(0u, wrong.load());
+  EXPECT_LT(0u, found.load());
+}
+
+/*
+   Tests that readers hold a value without holding its slot: a push displaces it all the same, and
+   a unique pop copies what a reader still shares.
+ */
+TEST(TestMappedRingBuffer, readers_do_not_hold_slots) {
+  rclcpp::mapped_ring_buffer::MappedRingBuffer<char> mrb(1);
+  std::unique_ptr<char> input(new char('a'));
+  const char * input_orig = input.get();
+  EXPECT_FALSE(mrb.push_and_replace(1, std::move(input)));
+
+  std::shared_ptr<const char> reader;
+  mrb.get(1, reader);
+  ASSERT_EQ(input_orig, reader.get());
+  std::unique_ptr<char> actual;
+  mrb.pop(1, actual);
+  ASSERT_NE(nullptr, actual);
+  EXPECT_NE(input_orig, actual.get());
+  EXPECT_EQ('a', *actual);
+
+  EXPECT_FALSE(mrb.push_and_replace(2, std::unique_ptr<char>(new char('b'))));
+  mrb.get(2, reader);
+  EXPECT_TRUE(mrb.push_and_replace(3, std::unique_ptr<char>(new char('c'))));
+  ASSERT_NE(nullptr, reader);
+  EXPECT_EQ('b', *reader);
+  EXPECT_FALSE(mrb.has_key(2));
 }
@@ -0,0 +1,151 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/measuring/prometheus_measurement_writer.hpp"
+
+namespace
+{
+
+std::string scrape(uint16_t port, const std::string & path)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_GE(fd, 0);
+
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  EXPECT_EQ(0, ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)));
+
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  EXPECT_EQ(static_cast<ssize_t>(request.size()), ::send(fd, request.data(), request.size(), 0));
+
+  std::string response;
+  char buffer[4096];
+  ssize_t ret;
+  while ((ret = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, static_cast<size_t>(ret));
+  }
+  ::close(fd);
+  return response;
+}
+
+}  // namespace
+
+class TestPrometheusMeasurementWriter : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    // Before any writer exists, so the writers do not claim the default port.
+    ASSERT_TRUE(rclcpp::PrometheusRegistry::instance().start("127.0.0.1", 0));
+  }
+
+  static void TearDownTestCase()
+  {
+    rclcpp::PrometheusRegistry::instance().stop();
+  }
+};
+
+TEST_F(TestPrometheusMeasurementWriter, scrape_latency_and_arrivals) {
+  rclcpp::MessageTrackerHostInfo host_info("/chatter", "listener", "/ns/");
+  rclcpp::PrometheusMeasurementWriter writer(host_info);
+  auto latency_key = writer.register_measurement_class("message_latency");
+  auto arrival_key = writer.register_measurement_class("message_arrival");
+
+  rclcpp::MessageTrackingVariables msg;
+  msg.vandenhoven_timestamp = 1000000;
+  msg.vandenhoven_identifier = 1;
+  msg.vandenhoven_publisher_hash = 0x1234abcd;
+  rclcpp::hex_char_array_t publisher(static_cast<uint32_t>(msg.vandenhoven_publisher_hash));
+
+  // 0.2 ms and 2 ms.
+  writer.record_latency(latency_key, msg, publisher, msg.vandenhoven_timestamp + 200000);
+  writer.record_arrival(arrival_key, msg, publisher);
+  writer.record_latency(latency_key, msg, publisher, msg.vandenhoven_timestamp + 2000000);
+  writer.record_arrival(arrival_key, msg, publisher);
+
+  auto response = scrape(rclcpp::PrometheusRegistry::instance().port(), "/metrics");
+  EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK"));
+
+  std::string labels = "topic=\"/chatter\",node=\"/ns/listener\",publisher=\"1234ABCD\"";
+  EXPECT_NE(std::string::npos, response.find("# TYPE pmros2_message_latency_seconds histogram"));
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_message_latency_seconds_bucket{" + labels + ",le=\"0.0001\"} 0\n"));
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_message_latency_seconds_bucket{" + labels + ",le=\"0.00025\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_message_latency_seconds_bucket{" + labels + ",le=\"+Inf\"} 2\n"));
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_message_latency_seconds_sum{" + labels + "} 0.0022\n"));
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_message_latency_seconds_count{" + labels + "} 2\n"));
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_message_latency_last_seconds{" + labels + "} 0.002\n"));
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_message_arrival_total{" + labels + "} 2\n"));
+}
+
+TEST_F(TestPrometheusMeasurementWriter, shards_add_up) {
+  rclcpp::MessageTrackerHostInfo host_info("__rclcpp_timer_activation_jitter", "timer", "/");
+  rclcpp::PrometheusMeasurementWriter writer(host_info);
+  auto key = writer.register_measurement_class("realtime_violations");
+  writer.record_realtime_violations(key, 0, 0);  // creates the series before the threads start.
+
+  // Every thread records on its own shard, the scrape has to see all of them.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 12; ++t) {
+    threads.emplace_back([&writer, key]() {
+        for (int i = 0; i < 1000; ++i) {
+          writer.record_realtime_violations(key, 1, 2);
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  auto response = scrape(rclcpp::PrometheusRegistry::instance().port(), "/metrics");
+  std::string labels = "topic=\"__rclcpp_timer_activation_jitter\",node=\"/timer\"";
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_realtime_violations_allocations_total{" + labels + "} 12000\n"));
+  EXPECT_NE(std::string::npos,
+    response.find("pmros2_realtime_violations_lock_waits_total{" + labels + "} 24000\n"));
+}
+
+TEST_F(TestPrometheusMeasurementWriter, unknown_path) {
+  auto response = scrape(rclcpp::PrometheusRegistry::instance().port(), "/");
+  EXPECT_EQ(0u, response.find("HTTP/1.1 404 Not Found"));
+}
+
+TEST_F(TestPrometheusMeasurementWriter, writers_keep_the_running_endpoint) {
+  auto port = rclcpp::PrometheusRegistry::instance().port();
+  rclcpp::MessageTrackerHostInfo host_info("/chatter", "listener", "/ns/");
+  rclcpp::PrometheusMeasurementWriter writer(host_info);
+  EXPECT_TRUE(rclcpp::PrometheusRegistry::instance().start_from_environment());
+  EXPECT_EQ(port, rclcpp::PrometheusRegistry::instance().port());
+}
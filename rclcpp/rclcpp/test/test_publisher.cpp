@@ -14,6 +14,7 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <string>
 #include <memory>
 #include <vector>
@@ -175,6 +176,145 @@ TEST_F(TestPublisher, various_creation_signatures) {
 #endif
 }
 
+/*
+   Testing loaned messages, which reuse the storage of the publisher.
+ */
+TEST_F(TestPublisher, loaned_messages) {
+  initialize();
+  using rcl_interfaces::msg::IntraProcessMessage;
+  auto publisher = node->create_publisher<IntraProcessMessage>("topic", 10);
+  publisher->reserve_loaned_messages(1);
+
+  auto loan = publisher->borrow_loaned_message();
+  ASSERT_TRUE(loan.is_valid());
+  const IntraProcessMessage * storage = &loan.get();
+  loan.get().message_sequence = 42;
+  publisher->publish(std::move(loan));
+  EXPECT_FALSE(loan.is_valid());
+  EXPECT_THROW(loan.get(), std::runtime_error);
+  EXPECT_THROW(publisher->publish(std::move(loan)), std::runtime_error);
+
+  // Published and unpublished loans return their storage.
+  {
+    auto unpublished = publisher->borrow_loaned_message();
+    EXPECT_EQ(storage, &unpublished.get());
+  }
+  auto first = publisher->borrow_loaned_message();
+  EXPECT_EQ(storage, &first.get());
+  // The pool is exhausted, further loans are allocated.
+  auto second = publisher->borrow_loaned_message();
+  EXPECT_NE(storage, &second.get());
+}
+
+/*
+   Testing that intra process subscriptions get the storage of a loaned message itself.
+ */
+TEST_F(TestPublisher, loaned_message_intra_process) {
+  initialize(rclcpp::NodeOptions().use_intra_process_comms(true));
+  using rcl_interfaces::msg::IntraProcessMessage;
+  const IntraProcessMessage * received = nullptr;
+  auto subscription = node->create_subscription<IntraProcessMessage>(
+    "topic", 10,
+    [&received](std::shared_ptr<const IntraProcessMessage> msg) {
+      received = msg.get();
+    });
+  auto publisher = node->create_publisher<IntraProcessMessage>("topic", 10);
+
+  auto loan = publisher->borrow_loaned_message();
+  const IntraProcessMessage * storage = &loan.get();
+  publisher->publish(std::move(loan));
+
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(node);
+  for (size_t i = 0; i < 100 && !received; ++i) {
+    executor.spin_some(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(storage, received);
+}
+
+/*
+   Testing that intra and inter process subscriptions see the same stamps, while the message
+   published by reference stays as it was.
+ */
+TEST_F(TestPublisher, stamps_match_intra_and_inter_process) {
+  initialize(rclcpp::NodeOptions().use_intra_process_comms(true));
+  using rcl_interfaces::msg::IntraProcessMessage;
+  auto other_node = std::make_shared<rclcpp::Node>("other_node", "/ns");
+  IntraProcessMessage::SharedPtr intra_received;
+  IntraProcessMessage::SharedPtr inter_received;
+  auto intra_subscription = node->create_subscription<IntraProcessMessage>(
+    "stamped", 10,
+    [&intra_received](IntraProcessMessage::SharedPtr msg) {
+      intra_received = msg;
+    });
+  auto inter_subscription = other_node->create_subscription<IntraProcessMessage>(
+    "stamped", 10,
+    [&inter_received](IntraProcessMessage::SharedPtr msg) {
+      inter_received = msg;
+    });
+  auto publisher = node->create_publisher<IntraProcessMessage>("stamped", 10);
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(node);
+  executor.add_node(other_node);
+  for (size_t i = 0; i < 500 && publisher->get_subscription_count() < 2; ++i) {
+    executor.spin_some(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(2u, publisher->get_subscription_count());
+
+  const IntraProcessMessage msg;
+  publisher->publish(msg);
+  for (size_t i = 0; i < 500 && !(intra_received && inter_received); ++i) {
+    executor.spin_some(std::chrono::milliseconds(10));
+  }
+  ASSERT_TRUE(intra_received && inter_received);
+  EXPECT_NE(0, intra_received->vandenhoven_timestamp);
+  EXPECT_EQ(intra_received->vandenhoven_timestamp, inter_received->vandenhoven_timestamp);
+  EXPECT_EQ(intra_received->vandenhoven_identifier, inter_received->vandenhoven_identifier);
+  EXPECT_EQ(
+    intra_received->vandenhoven_publisher_hash, inter_received->vandenhoven_publisher_hash);
+  EXPECT_EQ(IntraProcessMessage(), msg);
+}
+
+/*
+   Testing that a const message published without intra process is not written to, while a
+   non-const one is stamped in place.
+ */
+TEST_F(TestPublisher, publish_by_reference_stamps) {
+  initialize();
+  using rcl_interfaces::msg::IntraProcessMessage;
+  IntraProcessMessage::SharedPtr received;
+  auto subscription = node->create_subscription<IntraProcessMessage>(
+    "stamped", 10,
+    [&received](IntraProcessMessage::SharedPtr msg) {
+      received = msg;
+    });
+  auto publisher = node->create_publisher<IntraProcessMessage>("stamped", 10);
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(node);
+  for (size_t i = 0; i < 500 && publisher->get_subscription_count() < 1; ++i) {
+    executor.spin_some(std::chrono::milliseconds(10));
+  }
+
+  const IntraProcessMessage msg;
+  publisher->publish(msg);
+  for (size_t i = 0; i < 500 && !received; ++i) {
+    executor.spin_some(std::chrono::milliseconds(10));
+  }
+  ASSERT_TRUE(received);
+  EXPECT_NE(0, received->vandenhoven_timestamp);
+  EXPECT_EQ(IntraProcessMessage(), msg);
+
+  received.reset();
+  IntraProcessMessage stamped_in_place;
+  publisher->publish(stamped_in_place);
+  for (size_t i = 0; i < 500 && !received; ++i) {
+    executor.spin_some(std::chrono::milliseconds(10));
+  }
+  ASSERT_TRUE(received);
+  EXPECT_NE(0, stamped_in_place.vandenhoven_timestamp);
+  EXPECT_EQ(stamped_in_place, *received);
+}
+
 /*
    Testing publisher with intraprocess enabled and invalid QoS
  */
@@ -0,0 +1,148 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "rclcpp/measuring/realtime_violation_counter.hpp"
+
+using rclcpp::RealtimeViolationCounter;
+using rclcpp::RealtimeViolationCounts;
+using rclcpp::RealtimeViolationPause;
+using rclcpp::RealtimeViolationScope;
+
+/*
+   Nothing is counted outside of a scope, or in a disabled one.
+ */
+TEST(TestRealtimeViolationCounter, counts_only_inside_scope) {
+  EXPECT_FALSE(RealtimeViolationCounter::is_counting());
+  RealtimeViolationCounter::count_lock_wait();
+  RealtimeViolationCounter::count_allocation();
+  {
+    RealtimeViolationScope disabled(false);
+    EXPECT_FALSE(RealtimeViolationCounter::is_counting());
+    RealtimeViolationCounter::count_lock_wait();
+    EXPECT_FALSE(disabled.counts().any());
+  }
+  {
+    RealtimeViolationScope scope;
+    EXPECT_TRUE(RealtimeViolationCounter::is_counting());
+    EXPECT_FALSE(scope.counts().any());
+    RealtimeViolationCounter::count_lock_wait();
+    RealtimeViolationCounter::count_lock_wait();
+    EXPECT_EQ(2u, scope.counts().lock_waits);
+  }
+  EXPECT_FALSE(RealtimeViolationCounter::is_counting());
+}
+
+/*
+   A nested scope counts from where it was opened, the outer one sees everything.
+ */
+TEST(TestRealtimeViolationCounter, nested_scopes) {
+  RealtimeViolationScope outer;
+  RealtimeViolationCounter::count_lock_wait();
+  {
+    RealtimeViolationScope inner;
+    RealtimeViolationCounter::count_lock_wait();
+    EXPECT_EQ(1u, inner.counts().lock_waits);
+  }
+  EXPECT_TRUE(RealtimeViolationCounter::is_counting());
+  EXPECT_EQ(2u, outer.counts().lock_waits);
+}
+
+/*
+   Nothing is counted while a pause is alive, the scopes count on after it.
+ */
+TEST(TestRealtimeViolationCounter, pause) {
+  RealtimeViolationScope outer;
+  RealtimeViolationScope inner;
+  {
+    RealtimeViolationPause pause;
+    EXPECT_FALSE(RealtimeViolationCounter::is_counting());
+    RealtimeViolationCounter::count_lock_wait();
+  }
+  EXPECT_TRUE(RealtimeViolationCounter::is_counting());
+  EXPECT_FALSE(outer.counts().any());
+  RealtimeViolationCounter::count_lock_wait();
+  EXPECT_EQ(1u, inner.counts().lock_waits);
+  EXPECT_EQ(1u, outer.counts().lock_waits);
+}
+
+/*
+   Carried over counts go to the next scope on the same thread, and only to that one.
+ */
+TEST(TestRealtimeViolationCounter, carry_over) {
+  RealtimeViolationCounts carried;
+  carried.lock_waits = 3;
+  RealtimeViolationCounter::carry_over(carried);
+
+  std::thread([]() {
+    RealtimeViolationScope other_thread;
+    EXPECT_FALSE(other_thread.counts().any());
+  }).join();
+  {
+    RealtimeViolationScope next;
+    EXPECT_EQ(3u, next.counts().lock_waits);
+    EXPECT_EQ(0u, next.counts().allocations);
+  }
+  RealtimeViolationScope after;
+  EXPECT_FALSE(after.counts().any());
+}
+
+/*
+   Allocations count only when the hooks are compiled in.
+ */
+TEST(TestRealtimeViolationCounter, allocations) {
+  RealtimeViolationScope scope;
+  auto allocated = std::make_shared<int>(42);
+  if (RealtimeViolationCounter::counts_allocations()) {
+    EXPECT_LE(1u, scope.counts().allocations);
+  } else {
+    EXPECT_EQ(0u, scope.counts().allocations);
+  }
+}
+
+/*
+   Only acquisitions that had to wait for another thread count as lock waits.
+ */
+TEST(TestRealtimeViolationCounter, lock_counting_contention) {
+  std::mutex mutex;
+  RealtimeViolationScope scope;
+  {
+    auto lock = rclcpp::lock_counting_contention(mutex);
+    EXPECT_TRUE(lock.owns_lock());
+  }
+  EXPECT_EQ(0u, scope.counts().lock_waits);
+
+  std::atomic<bool> held{false};
+  std::thread holder([&mutex, &held]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      held.store(true);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    });
+  while (!held.load()) {
+    std::this_thread::yield();
+  }
+  {
+    auto lock = rclcpp::lock_counting_contention(mutex);
+    EXPECT_TRUE(lock.owns_lock());
+  }
+  holder.join();
+  EXPECT_EQ(1u, scope.counts().lock_waits);
+}
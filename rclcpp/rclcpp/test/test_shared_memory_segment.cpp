@@ -0,0 +1,305 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "rclcpp/shared_memory_segment.hpp"
+
+using rclcpp::SharedMemorySegment;
+
+namespace
+{
+
+rmw_gid_t
+make_gid(uint8_t value)
+{
+  rmw_gid_t gid;
+  gid.implementation_identifier = nullptr;
+  std::memset(gid.data, value, RMW_GID_STORAGE_SIZE);
+  return gid;
+}
+
+const std::chrono::hours no_lease(1);
+
+}  // namespace
+
+/*
+   A subscription opens the segment of a publisher by its key.
+ */
+TEST(TestSharedMemorySegment, create_and_open) {
+  EXPECT_THROW(SharedMemorySegment::create(0, 64, make_gid(1)), std::invalid_argument);
+  EXPECT_THROW(SharedMemorySegment::create(4, 0, make_gid(1)), std::invalid_argument);
+
+  auto created = SharedMemorySegment::create(4, 100, make_gid(7));
+  auto opened = SharedMemorySegment::open(created->get_key());
+  ASSERT_NE(nullptr, opened);
+  EXPECT_EQ(4u, opened->get_slot_count());
+  EXPECT_EQ(100u, opened->get_slot_size());
+  EXPECT_EQ(
+    0, std::memcmp(make_gid(7).data, opened->get_publisher_gid_data(), RMW_GID_STORAGE_SIZE));
+
+  // Another segment of the same process gets another key.
+  auto other = SharedMemorySegment::create(4, 100, make_gid(7));
+  EXPECT_NE(created->get_key(), other->get_key());
+
+  // Gone with its creator, but existing mappings stay valid.
+  uint64_t key = created->get_key();
+  EXPECT_FALSE(opened->is_closed());
+  created.reset();
+  EXPECT_TRUE(opened->is_closed());
+  EXPECT_EQ(nullptr, SharedMemorySegment::open(key));
+}
+
+/*
+   The shared memory gets the permissions it was created with, whatever the umask.
+ */
+TEST(TestSharedMemorySegment, mode) {
+  mode_t umask_before = umask(0077);
+  auto owner_only = SharedMemorySegment::create(1, 64, make_gid(1));
+  auto group = SharedMemorySegment::create(1, 64, make_gid(1), 0660);
+  umask(umask_before);
+
+  auto mode_of = [](const SharedMemorySegment & segment) {
+      char path[64];
+      std::snprintf(path, sizeof(path), "/dev/shm/pmros2_shm_%016" PRIx64, segment.get_key());
+      struct stat status;
+      return stat(path, &status) == 0 ? status.st_mode & 0777 : 0;
+    };
+  EXPECT_EQ(0600u, mode_of(*owner_only));
+  EXPECT_EQ(0660u, mode_of(*group));
+}
+
+/*
+   A message is read in place by each reader it was handed to, the last release frees the slot.
+ */
+TEST(TestSharedMemorySegment, write_read_release) {
+  auto publisher = SharedMemorySegment::create(1, 64, make_gid(1));
+  auto subscription = SharedMemorySegment::open(publisher->get_key());
+  ASSERT_NE(nullptr, subscription);
+
+  size_t slot;
+  uint32_t generation;
+  ASSERT_TRUE(publisher->acquire(slot, generation, no_lease));
+  // Not readable while being written.
+  EXPECT_FALSE(subscription->holds(slot, generation));
+  std::strcpy(reinterpret_cast<char *>(publisher->get_payload(slot)), "hello");
+  publisher->commit(slot, generation, 6, 2);
+
+  size_t length;
+  const uint8_t * payload = subscription->read(slot, generation, length);
+  ASSERT_NE(nullptr, payload);
+  EXPECT_EQ(6u, length);
+  EXPECT_STREQ("hello", reinterpret_cast<const char *>(payload));
+
+  // The only slot is in use until both readers released it.
+  size_t next_slot;
+  uint32_t next_generation;
+  EXPECT_FALSE(publisher->acquire(next_slot, next_generation, no_lease));
+  EXPECT_TRUE(subscription->release(slot, generation));
+  EXPECT_FALSE(publisher->acquire(next_slot, next_generation, no_lease));
+  EXPECT_TRUE(subscription->release(slot, generation));
+  EXPECT_FALSE(subscription->release(slot, generation));
+
+  ASSERT_TRUE(publisher->acquire(next_slot, next_generation, no_lease));
+  EXPECT_EQ(slot, next_slot);
+  EXPECT_NE(generation, next_generation);
+}
+
+/*
+   References to a previous message of a slot do not affect the next one.
+ */
+TEST(TestSharedMemorySegment, stale_generation) {
+  auto segment = SharedMemorySegment::create(1, 64, make_gid(1));
+
+  size_t slot;
+  uint32_t old_generation;
+  ASSERT_TRUE(segment->acquire(slot, old_generation, no_lease));
+  segment->commit(slot, old_generation, 1, 1);
+  EXPECT_TRUE(segment->release(slot, old_generation));
+
+  uint32_t generation;
+  ASSERT_TRUE(segment->acquire(slot, generation, no_lease));
+  segment->commit(slot, generation, 1, 1);
+
+  size_t length;
+  EXPECT_EQ(nullptr, segment->read(slot, old_generation, length));
+  EXPECT_EQ(0u, length);
+  EXPECT_FALSE(segment->release(slot, old_generation));
+  EXPECT_TRUE(segment->holds(slot, generation));
+
+  // Slots out of range never hold anything.
+  EXPECT_FALSE(segment->holds(1, generation));
+  EXPECT_FALSE(segment->release(1, generation));
+}
+
+/*
+   A slot that is not released within its lease is taken back when none is free.
+ */
+TEST(TestSharedMemorySegment, lease) {
+  auto segment = SharedMemorySegment::create(1, 64, make_gid(1));
+
+  size_t slot;
+  uint32_t generation;
+  ASSERT_TRUE(segment->acquire(slot, generation, no_lease));
+  segment->commit(slot, generation, 1, 1);
+
+  size_t next_slot;
+  uint32_t next_generation;
+  EXPECT_FALSE(segment->acquire(next_slot, next_generation, no_lease));
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  ASSERT_TRUE(segment->acquire(next_slot, next_generation, std::chrono::milliseconds(1)));
+  EXPECT_EQ(1u, segment->get_reclaimed_count());
+
+  // The slow reader finds out that what it read is not valid anymore.
+  EXPECT_FALSE(segment->release(slot, generation));
+
+  // Slots being written are never taken back.
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  EXPECT_FALSE(segment->acquire(slot, generation, std::chrono::milliseconds(1)));
+}
+
+/*
+   A pinned message stays valid after its lease, until it is unpinned.
+ */
+TEST(TestSharedMemorySegment, pin) {
+  auto segment = SharedMemorySegment::create(1, 64, make_gid(1));
+
+  size_t slot;
+  uint32_t generation;
+  ASSERT_TRUE(segment->acquire(slot, generation, no_lease));
+  segment->commit(slot, generation, 1, 2);
+  ASSERT_TRUE(segment->pin(slot, generation));
+
+  size_t next_slot;
+  uint32_t next_generation;
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  EXPECT_FALSE(segment->acquire(next_slot, next_generation, std::chrono::milliseconds(1)));
+  EXPECT_EQ(0u, segment->get_reclaimed_count());
+  EXPECT_TRUE(segment->holds(slot, generation));
+
+  // The other reader's reference is released as usual, the pin keeps the slot.
+  EXPECT_TRUE(segment->release(slot, generation));
+  EXPECT_FALSE(segment->release(slot, generation));
+  EXPECT_FALSE(segment->acquire(next_slot, next_generation, std::chrono::milliseconds(1)));
+  EXPECT_TRUE(segment->unpin(slot, generation));
+  EXPECT_FALSE(segment->unpin(slot, generation));
+  ASSERT_TRUE(segment->acquire(next_slot, next_generation, no_lease));
+  EXPECT_NE(generation, next_generation);
+
+  // Only references that are held can be pinned.
+  EXPECT_FALSE(segment->pin(slot, generation));
+}
+
+/*
+   Discarding frees a slot, whether it was handed over or not.
+ */
+TEST(TestSharedMemorySegment, discard) {
+  auto segment = SharedMemorySegment::create(1, 64, make_gid(1));
+
+  size_t slot;
+  uint32_t generation;
+  ASSERT_TRUE(segment->acquire(slot, generation, no_lease));
+  segment->discard(slot, generation);
+  ASSERT_TRUE(segment->acquire(slot, generation, no_lease));
+  segment->commit(slot, generation, 1, 3);
+  segment->discard(slot, generation);
+  EXPECT_FALSE(segment->holds(slot, generation));
+  ASSERT_TRUE(segment->acquire(slot, generation, no_lease));
+
+  // Except for pinned references.
+  segment->commit(slot, generation, 1, 2);
+  ASSERT_TRUE(segment->pin(slot, generation));
+  segment->discard(slot, generation);
+  EXPECT_FALSE(segment->release(slot, generation));
+  EXPECT_FALSE(segment->acquire(slot, generation, no_lease));
+  EXPECT_TRUE(segment->unpin(slot, generation));
+  EXPECT_TRUE(segment->acquire(slot, generation, no_lease));
+}
+
+/*
+   Another process reads and releases a message of this one.
+ */
+TEST(TestSharedMemorySegment, other_process) {
+  auto segment = SharedMemorySegment::create(1, 64, make_gid(1));
+
+  size_t slot;
+  uint32_t generation;
+  ASSERT_TRUE(segment->acquire(slot, generation, no_lease));
+  std::strcpy(reinterpret_cast<char *>(segment->get_payload(slot)), "across");
+  segment->commit(slot, generation, 7, 1);
+
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    auto opened = SharedMemorySegment::open(segment->get_key());
+    size_t length;
+    const uint8_t * payload = opened ? opened->read(slot, generation, length) : nullptr;
+    bool ok = payload && length == 7 &&
+      std::string(reinterpret_cast<const char *>(payload)) == "across" &&
+      opened->release(slot, generation);
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+
+  EXPECT_FALSE(segment->holds(slot, generation));
+  EXPECT_TRUE(segment->acquire(slot, generation, no_lease));
+}
+
+/*
+   The pin of a reader that died is dropped once the publisher runs out of slots.
+ */
+TEST(TestSharedMemorySegment, pin_of_dead_reader) {
+  auto segment = SharedMemorySegment::create(1, 64, make_gid(1));
+
+  size_t slot;
+  uint32_t generation;
+  ASSERT_TRUE(segment->acquire(slot, generation, no_lease));
+  segment->commit(slot, generation, 1, 1);
+
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    auto opened = SharedMemorySegment::open(segment->get_key());
+    // Dies without unpinning.
+    _exit(opened && opened->pin(slot, generation) ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+
+  // The pin of another process is not this one's to release.
+  EXPECT_FALSE(segment->unpin(slot, generation));
+  EXPECT_TRUE(segment->holds(slot, generation));
+  size_t next_slot;
+  uint32_t next_generation;
+  ASSERT_TRUE(segment->acquire(next_slot, next_generation, no_lease));
+  EXPECT_EQ(1u, segment->get_reclaimed_count());
+  EXPECT_FALSE(segment->holds(slot, generation));
+}
@@ -0,0 +1,105 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/shared_memory_transport.hpp"
+
+#include "rcl_interfaces/msg/intra_process_message.hpp"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+using namespace std::chrono_literals;
+using rcl_interfaces::msg::IntraProcessMessage;
+
+namespace
+{
+
+/// Wait for discovery to get there. \return false if it did not in time.
+bool
+wait_for(std::function<bool()> condition)
+{
+  auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(10ms);
+  }
+  return true;
+}
+
+rclcpp::SharedMemoryTransportOptions
+small_slots()
+{
+  rclcpp::SharedMemoryTransportOptions options;
+  options.enabled = true;
+  options.slot_count = 4;
+  options.slot_size = 1024;
+  return options;
+}
+
+}  // namespace
+
+class TestSharedMemoryTransport : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    rclcpp::init(0, nullptr);
+  }
+};
+
+/*
+   Messages only go through shared memory while every subscription of the data topic, in this
+   process or not, listens on the side channel.
+ */
+TEST_F(TestSharedMemoryTransport, falls_back_unless_all_subscriptions_listen) {
+  auto node = std::make_shared<rclcpp::Node>("test_shared_memory_fallback");
+  const std::string topic = "test_shared_memory_fallback";
+  // Publishes normally, the test drives the transport of it directly.
+  auto publisher = node->create_publisher<IntraProcessMessage>(topic, 10);
+  rclcpp::SharedMemoryPublisher transport(
+    node->get_node_base_interface()->get_shared_rcl_node_handle(),
+    publisher->get_publisher_handle(), publisher->get_gid(),
+    *rosidl_typesupport_cpp::get_message_type_support_handle<IntraProcessMessage>(),
+    small_slots());
+  IntraProcessMessage msg;
+
+  EXPECT_FALSE(transport.publish(&msg, publisher->get_subscription_count()));
+
+  rclcpp::SubscriptionOptions shared_memory_options;
+  shared_memory_options.shared_memory_transport.enabled = true;
+  auto reader = node->create_subscription<IntraProcessMessage>(
+    topic, 10, [](const IntraProcessMessage::SharedPtr) {}, shared_memory_options);
+  auto plain = node->create_subscription<IntraProcessMessage>(
+    topic, 10, [](const IntraProcessMessage::SharedPtr) {});
+  ASSERT_TRUE(
+    wait_for(
+      [&]() {
+        return publisher->get_subscription_count() == 2 && transport.get_reader_count() == 1;
+      }));
+  // The plain subscription would miss it.
+  EXPECT_FALSE(transport.publish(&msg, publisher->get_subscription_count()));
+
+  plain.reset();
+  ASSERT_TRUE(wait_for([&]() {return publisher->get_subscription_count() == 1;}));
+  EXPECT_TRUE(transport.publish(&msg, publisher->get_subscription_count()));
+}
@@ -14,8 +14,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "rclcpp/exceptions.hpp"
 #include "rclcpp/rclcpp.hpp"
@@ -260,3 +264,104 @@ TEST_F(TestSubscription, callback_bind) {
     auto sub = node->create_subscription<IntraProcessMessage>("topic", 1, callback);
   }
 }
+
+/*
+   Testing that a batch callback gets all messages of a dispatch at once, up to the batch size.
+ */
+TEST_F(TestSubscription, batch_callback) {
+  using rcl_interfaces::msg::IntraProcessMessage;
+  size_t single_messages = 0;
+  std::vector<size_t> batches;
+  auto sub = node->create_subscription<IntraProcessMessage>(
+    "batch_topic", 10, [&single_messages](const IntraProcessMessage::SharedPtr) {
+      ++single_messages;
+    });
+  sub->set_batch_size(3);
+  sub->set_batch_callback(
+    [&batches](const std::vector<std::shared_ptr<const IntraProcessMessage>> & messages) {
+      batches.push_back(messages.size());
+    });
+  auto pub = node->create_publisher<IntraProcessMessage>("batch_topic", 10);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (sub->get_publisher_count() == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(1u, sub->get_publisher_count());
+
+  for (uint64_t i = 0; i < 5; ++i) {
+    IntraProcessMessage msg;
+    msg.message_sequence = i;
+    pub->publish(msg);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(node);
+  size_t received = 0;
+  while (received < 5 && std::chrono::steady_clock::now() < deadline) {
+    executor.spin_once(std::chrono::milliseconds(10));
+    received = 0;
+    for (auto batch_size : batches) {
+      received += batch_size;
+    }
+  }
+  EXPECT_EQ(5u, received);
+  EXPECT_EQ(0u, single_messages);
+  ASSERT_FALSE(batches.empty());
+  EXPECT_LE(*std::max_element(batches.begin(), batches.end()), 3u);
+  EXPECT_LT(batches.size(), 5u);
+}
+
+/*
+   Testing that intra process messages are handed to the subscriptions directly, the message
+   itself when a single subscription takes unique_ptrs.
+ */
+TEST_F(TestSubscription, intra_process_delivery) {
+  using rcl_interfaces::msg::IntraProcessMessage;
+  auto intra_process_node = std::make_shared<rclcpp::Node>(
+    "test_subscription_intra_process", "/ns",
+    rclcpp::NodeOptions().use_intra_process_comms(true));
+  const IntraProcessMessage * unique_address = nullptr;
+  std::vector<uint64_t> unique_sequences;
+  auto unique_sub = intra_process_node->create_subscription<IntraProcessMessage>(
+    "intra_topic", 10,
+    [&unique_address, &unique_sequences](IntraProcessMessage::UniquePtr msg) {
+      unique_address = msg.get();
+      unique_sequences.push_back(msg->message_sequence);
+    });
+  EXPECT_EQ(nullptr, unique_sub->get_intra_process_subscription_handle());
+  auto pub = intra_process_node->create_publisher<IntraProcessMessage>("intra_topic", 10);
+
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(intra_process_node);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+  auto msg = std::make_unique<IntraProcessMessage>();
+  msg->message_sequence = 1;
+  const IntraProcessMessage * published_address = msg.get();
+  pub->publish(std::move(msg));
+  while (unique_sequences.size() < 1 && std::chrono::steady_clock::now() < deadline) {
+    executor.spin_once(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(1u, unique_sequences.size());
+  EXPECT_EQ(published_address, unique_address);
+
+  std::vector<uint64_t> shared_sequences;
+  auto shared_sub = intra_process_node->create_subscription<IntraProcessMessage>(
+    "intra_topic", 10, [&shared_sequences](IntraProcessMessage::ConstSharedPtr msg) {
+      shared_sequences.push_back(msg->message_sequence);
+    });
+  for (uint64_t i = 2; i < 5; ++i) {
+    IntraProcessMessage copied_msg;
+    copied_msg.message_sequence = i;
+    pub->publish(copied_msg);
+  }
+  while ((unique_sequences.size() < 4 || shared_sequences.size() < 3) &&
+    std::chrono::steady_clock::now() < deadline)
+  {
+    executor.spin_once(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(std::vector<uint64_t>({1, 2, 3, 4}), unique_sequences);
+  EXPECT_EQ(std::vector<uint64_t>({2, 3, 4}), shared_sequences);
+}
@@ -0,0 +1,265 @@
+// Copyright 2023 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "rclcpp/allocator/tlsf_allocator.hpp"
+#include "rclcpp/message_memory_strategy.hpp"
+#include "rclcpp/strategies/allocator_memory_strategy.hpp"
+
+#include "rcl/guard_condition.h"
+#include "rcl_interfaces/msg/intra_process_message.hpp"
+
+using rclcpp::allocator::TlsfAllocator;
+using rclcpp::allocator::TlsfHeap;
+
+/*
+   Blocks are aligned for any type, and counted while in use.
+ */
+TEST(TestTlsfAllocator, allocate_and_free) {
+  EXPECT_THROW(TlsfHeap(16, 1), std::invalid_argument);
+  EXPECT_THROW(TlsfHeap(64 * 1024, 0), std::invalid_argument);
+
+  TlsfHeap heap(64 * 1024, 1);
+  void * first = heap.allocate(100);
+  void * second = heap.allocate(0);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first) % alignof(std::max_align_t));
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(second) % alignof(std::max_align_t));
+  EXPECT_NE(first, second);
+
+  auto statistics = heap.get_arena_statistics(0);
+  EXPECT_TRUE(statistics.claimed);
+  EXPECT_EQ(2u, statistics.allocations);
+  EXPECT_GE(statistics.in_use, 100u);
+  EXPECT_LE(statistics.capacity, heap.get_arena_size());
+
+  heap.deallocate(first);
+  heap.deallocate(second);
+  heap.deallocate(nullptr);
+  statistics = heap.get_arena_statistics(0);
+  EXPECT_EQ(0u, statistics.in_use);
+  EXPECT_GE(statistics.high_water_mark, 100u);
+  EXPECT_THROW(heap.get_arena_statistics(1), std::out_of_range);
+}
+
+/*
+   Freed neighbours merge, so that a fragmented arena can serve a large block again.
+ */
+TEST(TestTlsfAllocator, merge_free_blocks) {
+  TlsfHeap heap(64 * 1024, 1);
+  std::vector<void *> blocks;
+  try {
+    while (true) {
+      blocks.push_back(heap.allocate(1000));
+    }
+  } catch (const std::bad_alloc &) {
+  }
+  ASSERT_GT(blocks.size(), 32u);
+  auto statistics = heap.get_arena_statistics(0);
+  EXPECT_EQ(1u, statistics.failed_allocations);
+  EXPECT_EQ(statistics.in_use, statistics.high_water_mark);
+  EXPECT_THROW(heap.allocate(1000), std::bad_alloc);
+
+  // Every other one first, which leaves nothing but small holes.
+  for (size_t i = 0; i < blocks.size(); i += 2) {
+    heap.deallocate(blocks[i]);
+  }
+  EXPECT_THROW(heap.allocate(4000), std::bad_alloc);
+  for (size_t i = 1; i < blocks.size(); i += 2) {
+    heap.deallocate(blocks[i]);
+  }
+  EXPECT_EQ(0u, heap.get_arena_statistics(0).in_use);
+  void * large = heap.allocate(32 * 1024);
+  heap.deallocate(large);
+  EXPECT_THROW(heap.allocate(64 * 1024), std::bad_alloc);
+}
+
+/*
+   Each thread allocates from an arena of its own, as long as there are enough.
+ */
+TEST(TestTlsfAllocator, arena_per_thread) {
+  TlsfHeap heap(64 * 1024, 2);
+  void * main_block = heap.allocate(64);
+
+  void * thread_block = nullptr;
+  bool second_arena_claimed = false;
+  bool third_thread_failed = false;
+  // The third thread runs while the second one still holds its arena.
+  std::thread([&heap, &thread_block, &second_arena_claimed, &third_thread_failed]() {
+    thread_block = heap.allocate(64);
+    second_arena_claimed = heap.get_arena_statistics(1).claimed;
+    std::thread([&heap, &third_thread_failed]() {
+      third_thread_failed = !heap.claim_thread_arena();
+    }).join();
+  }).join();
+
+  EXPECT_TRUE(heap.get_arena_statistics(0).claimed);
+  EXPECT_TRUE(second_arena_claimed);
+  EXPECT_TRUE(third_thread_failed);
+  // Given back when the second thread ended.
+  EXPECT_FALSE(heap.get_arena_statistics(1).claimed);
+  auto distance = static_cast<unsigned char *>(thread_block) -
+    static_cast<unsigned char *>(main_block);
+  EXPECT_GE(static_cast<size_t>(distance < 0 ? -distance : distance), heap.get_arena_size() / 2);
+
+  heap.deallocate(thread_block);
+  heap.deallocate(main_block);
+}
+
+/*
+   Blocks freed by another thread return to their arena once its owner allocates again.
+ */
+TEST(TestTlsfAllocator, free_from_other_thread) {
+  TlsfHeap heap(64 * 1024, 2);
+  void * block = heap.allocate(1000);
+  size_t in_use = heap.get_arena_statistics(0).in_use;
+
+  std::thread([&heap, block]() {
+    heap.deallocate(block);
+  }).join();
+  EXPECT_EQ(in_use, heap.get_arena_statistics(0).in_use);
+  EXPECT_FALSE(heap.get_arena_statistics(1).claimed);
+
+  void * next = heap.allocate(1000);
+  EXPECT_EQ(block, next);
+  EXPECT_EQ(in_use, heap.get_arena_statistics(0).in_use);
+  heap.deallocate(next);
+}
+
+/*
+   A released arena goes to the next thread, with what was allocated from it.
+ */
+TEST(TestTlsfAllocator, release_thread_arena) {
+  TlsfHeap heap(64 * 1024, 1);
+  void * block = nullptr;
+  std::thread([&heap, &block]() {
+    block = heap.allocate(100);
+    heap.release_thread_arena();
+  }).join();
+  EXPECT_FALSE(heap.get_arena_statistics(0).claimed);
+
+  heap.deallocate(block);
+  void * next = heap.allocate(100);
+  EXPECT_EQ(block, next);
+  EXPECT_EQ(2u, heap.get_arena_statistics(0).allocations);
+  heap.deallocate(next);
+}
+
+/*
+   Threads that end give their arenas back, with what other threads freed into them, so many
+   more threads than arenas can allocate one after the other.
+ */
+TEST(TestTlsfAllocator, threads_end) {
+  TlsfHeap heap(64 * 1024, 2);
+  std::vector<void *> blocks;
+  for (int i = 0; i < 8; ++i) {
+    std::thread([&heap, &blocks]() {
+      blocks.push_back(heap.allocate(1000));
+      void * freed = heap.allocate(1000);
+      std::thread([&heap, freed]() {
+        // While the owner still runs, which merges it when it ends.
+        heap.deallocate(freed);
+      }).join();
+    }).join();
+    EXPECT_FALSE(heap.get_arena_statistics(0).claimed);
+    EXPECT_FALSE(heap.get_arena_statistics(1).claimed);
+  }
+  EXPECT_EQ(8u, blocks.size());
+  EXPECT_GT(heap.get_arena_statistics(0).in_use, 0u);
+
+  // Nobody owns the arenas anymore, these wait for the next owner.
+  for (void * block : blocks) {
+    heap.deallocate(block);
+  }
+  EXPECT_FALSE(heap.get_arena_statistics(0).claimed);
+  EXPECT_GT(heap.get_arena_statistics(0).in_use, 0u);
+  // Only fits once all of them are merged.
+  heap.deallocate(heap.allocate(60 * 1024));
+  EXPECT_EQ(0u, heap.get_arena_statistics(0).in_use);
+  EXPECT_EQ(0u, heap.get_arena_statistics(1).in_use);
+}
+
+/*
+   Frees of other threads are merged a few per allocation, all of them when one would fail.
+ */
+TEST(TestTlsfAllocator, bounded_remote_frees) {
+  TlsfHeap heap(64 * 1024, 1);
+  std::vector<void *> blocks;
+  for (int i = 0; i < 40; ++i) {
+    blocks.push_back(heap.allocate(1000));
+  }
+  size_t in_use = heap.get_arena_statistics(0).in_use;
+  std::thread([&heap, &blocks]() {
+    for (void * block : blocks) {
+      heap.deallocate(block);
+    }
+  }).join();
+
+  heap.deallocate(heap.allocate(16));
+  size_t merged = in_use - heap.get_arena_statistics(0).in_use;
+  EXPECT_GT(merged, 0u);
+  EXPECT_LT(merged, in_use / 2);
+
+  heap.deallocate(heap.allocate(60 * 1024));
+  EXPECT_EQ(0u, heap.get_arena_statistics(0).in_use);
+}
+
+/*
+   The allocator works with the standard library and the rclcpp strategies.
+ */
+TEST(TestTlsfAllocator, allocator) {
+  auto heap = std::make_shared<TlsfHeap>(256 * 1024, 1);
+  TlsfAllocator<int> allocator(heap);
+  TlsfAllocator<double> rebound(allocator);
+  EXPECT_TRUE(allocator == rebound);
+  EXPECT_FALSE(allocator == TlsfAllocator<int>(std::make_shared<TlsfHeap>(64 * 1024, 1)));
+  EXPECT_THROW(TlsfAllocator<int>(nullptr), std::invalid_argument);
+
+  {
+    std::vector<int, TlsfAllocator<int>> numbers(allocator);
+    for (int i = 0; i < 1000; ++i) {
+      numbers.push_back(i);
+    }
+    std::map<int, int, std::less<int>, TlsfAllocator<std::pair<const int, int>>> squares(
+      allocator);
+    for (int i = 0; i < 100; ++i) {
+      squares[i] = i * i;
+    }
+    auto shared = std::allocate_shared<double>(rebound, 4.2);
+    EXPECT_GT(heap->get_arena_statistics(0).in_use, 1000 * sizeof(int));
+  }
+  EXPECT_EQ(0u, heap->get_arena_statistics(0).in_use);
+
+  using rcl_interfaces::msg::IntraProcessMessage;
+  auto void_allocator = std::make_shared<TlsfAllocator<void>>(heap);
+  rclcpp::message_memory_strategy::MessageMemoryStrategy<
+    IntraProcessMessage, TlsfAllocator<void>> message_strategy(void_allocator);
+  auto message = message_strategy.borrow_message();
+  EXPECT_GT(heap->get_arena_statistics(0).in_use, sizeof(IntraProcessMessage));
+  message_strategy.return_message(message);
+
+  rclcpp::memory_strategies::allocator_memory_strategy::AllocatorMemoryStrategy<
+    TlsfAllocator<void>> executor_strategy(void_allocator);
+  rcl_guard_condition_t guard_condition = rcl_get_zero_initialized_guard_condition();
+  executor_strategy.add_guard_condition(&guard_condition);
+  EXPECT_GT(heap->get_arena_statistics(0).in_use, 0u);
+  EXPECT_EQ(1u, executor_strategy.number_of_guard_conditions());
+}
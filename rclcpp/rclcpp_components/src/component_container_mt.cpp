@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
+#include <string>
 
 #include "rclcpp/rclcpp.hpp"
 
@@ -21,8 +23,21 @@
 int main(int argc, char * argv[])
 {
   /// Component container with a multi-threaded executor.
+  /**
+   * With --thread-per-callback-group every callback group, so at least every composed node, runs
+   * on a thread and wait set of its own, see rclcpp::executors::CallbackGroupThreadExecutor.
+   */
   rclcpp::init(argc, argv);
-  auto exec = std::make_shared<rclcpp::executors::MultiThreadedExecutor>();
+  bool thread_per_callback_group = std::any_of(
+    argv + 1, argv + argc, [](const char * arg) {
+      return std::string(arg) == "--thread-per-callback-group";
+    });
+  std::shared_ptr<rclcpp::executor::Executor> exec;
+  if (thread_per_callback_group) {
+    exec = std::make_shared<rclcpp::executors::CallbackGroupThreadExecutor>();
+  } else {
+    exec = std::make_shared<rclcpp::executors::MultiThreadedExecutor>();
+  }
   auto node = std::make_shared<rclcpp_components::ComponentManager>(exec);
   exec->add_node(node);
   exec->spin();
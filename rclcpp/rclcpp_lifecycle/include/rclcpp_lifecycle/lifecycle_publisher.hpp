@@ -111,6 +111,25 @@ public:
     rclcpp::Publisher<MessageT, Alloc>::publish(msg);
   }
 
+  /// LifecyclePublisher publish function
+  /**
+   * The publish function checks whether the communication
+   * was enabled or disabled and forwards the message
+   * to the actual rclcpp Publisher base class
+   */
+  virtual void
+  publish(MessageT & msg)
+  {
+    if (!enabled_) {
+      RCLCPP_WARN(logger_,
+        "Trying to publish message on the topic '%s', but the publisher is not activated",
+        this->get_topic_name());
+
+      return;
+    }
+    rclcpp::Publisher<MessageT, Alloc>::publish(msg);
+  }
+
   /// LifecyclePublisher publish function
   /**
    * The publish function checks whether the communication
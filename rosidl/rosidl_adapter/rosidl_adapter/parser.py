@@ -35,6 +35,13 @@ ACTION_GOAL_SERVICE_SUFFIX = '_Goal'
 ACTION_RESULT_SERVICE_SUFFIX = '_Result'
 ACTION_FEEDBACK_MESSAGE_SUFFIX = '_Feedback'
 
+# Opting out of the injected measuring fields, see is_tracked_interface().
+UNTRACKED_INTERFACES_ENV_VAR = 'PMROS2_UNTRACKED_INTERFACES'
+UNTRACKED_MARKER = '@pmros2_untracked'
+# Carries the out-of-band tracking samples (rclcpp/measuring/out_of_band_tracking.hpp),
+# so it always needs the fields.
+ALWAYS_TRACKED_PACKAGES = ['rcl_interfaces']
+
 PRIMITIVE_TYPES = [
     'bool',
     'byte',
@@ -438,14 +445,17 @@ def parse_message_file(pkg_name, interface_filename):
             pkg_name, msg_name, h.read())
 
 
-def parse_message_string(pkg_name, msg_name, message_string):
+def parse_message_string(pkg_name, msg_name, message_string, track=None):
     file_level_ended = False
     message_comments = []
     fields = []
     constants = []
     last_element = None  # either a field or a constant
 
-    gijsvandenhoven_hack_measuring_fields_into_message(fields, pkg_name)
+    if track is None:
+        track = is_tracked_interface(pkg_name, msg_name, message_string)
+    if track:
+        gijsvandenhoven_hack_measuring_fields_into_message(fields, pkg_name)
 
     current_comments = []
     lines = message_string.splitlines()
@@ -832,13 +842,16 @@ def parse_service_string(pkg_name, srv_name, message_string):
             "Could not find unique separator '%s' between request and response" %
             SERVICE_REQUEST_RESPONSE_SEPARATOR)
 
+    # decided once for the whole file, the marker may be in either half.
+    track = is_tracked_interface(pkg_name, srv_name, message_string)
+
     request_message_string = '\n'.join(lines[:separator_indices[0]])
     request_message = parse_message_string(
-        pkg_name, srv_name + SERVICE_REQUEST_MESSAGE_SUFFIX, request_message_string)
+        pkg_name, srv_name + SERVICE_REQUEST_MESSAGE_SUFFIX, request_message_string, track)
 
     response_message_string = '\n'.join(lines[separator_indices[0] + 1:])
     response_message = parse_message_string(
-        pkg_name, srv_name + SERVICE_RESPONSE_MESSAGE_SUFFIX, response_message_string)
+        pkg_name, srv_name + SERVICE_RESPONSE_MESSAGE_SUFFIX, response_message_string, track)
 
     return ServiceSpecification(pkg_name, srv_name, request_message, response_message)
 
@@ -873,17 +886,53 @@ def parse_action_string(pkg_name, action_name, action_string):
 
     goal_string, result_string, feedback_string = action_blocks
 
+    track = is_tracked_interface(pkg_name, action_name, action_string)
+
     goal_message = parse_message_string(
-        pkg_name, action_name + ACTION_GOAL_SUFFIX, goal_string)
+        pkg_name, action_name + ACTION_GOAL_SUFFIX, goal_string, track)
     result_message = parse_message_string(
-        pkg_name, action_name + ACTION_RESULT_SUFFIX, result_string)
+        pkg_name, action_name + ACTION_RESULT_SUFFIX, result_string, track)
     feedback_message = parse_message_string(
-        pkg_name, action_name + ACTION_FEEDBACK_SUFFIX, feedback_string)
+        pkg_name, action_name + ACTION_FEEDBACK_SUFFIX, feedback_string, track)
     # ---------------------------------------------------------------------------------------------
 
     return ActionSpecification(
         pkg_name, action_name, goal_message, result_message, feedback_message)
 
+
+def is_tracked_interface(pkg_name, interface_name, interface_string=''):
+    # Whether an interface gets the measuring fields injected. Interfaces that do not are
+    # tracked out-of-band by rclcpp instead, which keeps their wire format (and so
+    # compatibility with non-PMROS2 peers) intact.
+    # Opt out with either:
+    #  - a comment line containing '@pmros2_untracked' anywhere in the .msg/.srv/.action file;
+    #  - PMROS2_UNTRACKED_INTERFACES, a ';' or ',' separated list of 'pkg' (the whole package)
+    #    or 'pkg/Type' entries. 'pkg/Type' also covers the derived messages of a service or
+    #    action (Type_Request, Type_Goal, ...).
+    if pkg_name in ALWAYS_TRACKED_PACKAGES:
+        return True
+
+    for line in interface_string.splitlines():
+        index = line.find(COMMENT_DELIMITER)
+        if index != -1 and UNTRACKED_MARKER in line[index:]:
+            return False
+
+    entries = re.split('[;,]', os.environ.get(UNTRACKED_INTERFACES_ENV_VAR, ''))
+    for entry in (e.strip() for e in entries):
+        if not entry:
+            continue
+        if PACKAGE_NAME_MESSAGE_TYPE_SEPARATOR not in entry:
+            if entry == pkg_name:
+                return False
+            continue
+        entry_pkg, entry_type = entry.split(PACKAGE_NAME_MESSAGE_TYPE_SEPARATOR, 1)
+        if entry_pkg != pkg_name:
+            continue
+        if interface_name == entry_type or interface_name.startswith(entry_type + '_'):
+            return False
+    return True
+
+
 def gijsvandenhoven_hack_measuring_fields_into_message(fields, pkg_name):
     # ' fields '  is a list of Field objects.
     # We want to add two fields to _every_ message that gets built.
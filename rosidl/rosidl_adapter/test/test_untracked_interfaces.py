@@ -0,0 +1,52 @@
+# Copyright 2023 Open Source Robotics Foundation, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from rosidl_adapter.parser import is_tracked_interface
+from rosidl_adapter.parser import parse_message_string
+from rosidl_adapter.parser import parse_service_string
+from rosidl_adapter.parser import UNTRACKED_INTERFACES_ENV_VAR
+
+
+def field_names(msg_spec):
+    return [field.name for field in msg_spec.fields]
+
+
+def test_tracked_by_default(monkeypatch):
+    monkeypatch.delenv(UNTRACKED_INTERFACES_ENV_VAR, raising=False)
+    msg_spec = parse_message_string('pkg', 'Foo', 'bool foo')
+    assert 'vandenhoven_timestamp' in field_names(msg_spec)
+
+
+def test_untracked_marker(monkeypatch):
+    monkeypatch.delenv(UNTRACKED_INTERFACES_ENV_VAR, raising=False)
+    msg_spec = parse_message_string('pkg', 'Foo', '# @pmros2_untracked\n\nbool foo')
+    assert field_names(msg_spec) == ['foo']
+
+    srv_spec = parse_service_string('pkg', 'Srv', 'bool req\n---\n# @pmros2_untracked\nbool res')
+    assert field_names(srv_spec.request) == ['req']
+    assert field_names(srv_spec.response) == ['res']
+
+
+def test_untracked_env_var(monkeypatch):
+    monkeypatch.setenv(UNTRACKED_INTERFACES_ENV_VAR, 'other_pkg; pkg/Foo')
+    assert not is_tracked_interface('other_pkg', 'Anything')
+    assert not is_tracked_interface('pkg', 'Foo')
+    assert not is_tracked_interface('pkg', 'Foo_Request')
+    assert is_tracked_interface('pkg', 'FooBar')
+    assert is_tracked_interface('pkg', 'Bar')
+
+
+def test_side_channel_carrier_always_tracked(monkeypatch):
+    monkeypatch.setenv(UNTRACKED_INTERFACES_ENV_VAR, 'rcl_interfaces')
+    assert is_tracked_interface('rcl_interfaces', 'IntraProcessMessage', '# @pmros2_untracked')